@@ -0,0 +1,136 @@
+#pragma once
+#include "ir.h"
+#include <map>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// IR 上的通用分析：支配树、支配边界、自然循环、标量演化、活跃变量
+namespace ir {
+
+class DominatorTree {
+public:
+    explicit DominatorTree(const Function &func);
+
+    // 入口块和不可达块返回 nullptr
+    BasicBlock *idom(const BasicBlock *bb) const;
+    bool dominates(const BasicBlock *a, const BasicBlock *b) const;
+    bool isReachable(const BasicBlock *bb) const { return index.count(bb) != 0; }
+    const std::vector<BasicBlock *> &children(const BasicBlock *bb) const;
+    const std::vector<BasicBlock *> &frontier(const BasicBlock *bb) const;
+    // 可达块的逆后序
+    const std::vector<BasicBlock *> &reversePostOrder() const { return rpo; }
+
+private:
+    std::vector<BasicBlock *> rpo;
+    std::unordered_map<const BasicBlock *, int> index;     // 块在 rpo 中的位置
+    std::vector<int> idoms;
+    std::vector<std::vector<BasicBlock *>> kids;
+    std::vector<std::vector<BasicBlock *>> frontiers;
+    std::vector<int> preNum, postNum;                       // 支配树 DFS 区间，用于 O(1) 判断支配
+};
+
+// 自然循环：由回边 latch -> header（header 支配 latch）确定，同一个 header 的回边合并为一个循环
+struct Loop {
+    BasicBlock *header = nullptr;
+    std::vector<BasicBlock *> latches;
+    std::unordered_set<const BasicBlock *> blocks;     // 包括 header
+    int depth = 1;                                      // 嵌套深度，最外层为 1
+
+    bool contains(const BasicBlock *bb) const { return blocks.count(bb) != 0; }
+    // 循环中有后继在循环外的块
+    std::vector<BasicBlock *> exitingBlocks() const;
+    // 前置块：循环外唯一的前驱，并且只跳到 header；没有时为 nullptr
+    BasicBlock *preheader() const;
+};
+
+// 函数中的所有自然循环，内层循环排在外层之前
+std::vector<Loop> findNaturalLoops(const DominatorTree &dt);
+
+// 循环不变量的线性组合：constant + Σ factor * %reg，按 32 位补码回绕
+struct LinearSum {
+    int constant = 0;
+    std::map<int, int> terms;       // 寄存器 -> 系数，没有系数为 0 的项
+
+    static LinearSum of(const Value &v);
+    bool isConstant() const { return terms.empty(); }
+    bool isZero() const { return terms.empty() && constant == 0; }
+    LinearSum operator+(const LinearSum &o) const;
+    LinearSum operator*(int k) const;
+};
+
+// 加法递推 {c0,+,c1,+,c2}：循环头第 k 次（从 0 数）执行时的值为 c0 + c1*k + c2*k(k-1)/2。
+// 循环不变量是 0 阶的，归纳变量 i = i + 1 是 {i0,+,1}，累加归纳变量的 s = s + i 是 {s0,+,i0,+,1}
+struct AddRec {
+    LinearSum coeffs[3];
+
+    int order() const;
+};
+
+// 回边执行的次数（循环头执行次数减一）：lower < upper 时为 upper - lower，否则为 0
+struct BackedgeCount {
+    LinearSum lower, upper;
+};
+
+// 标量演化（SCEV）：把循环中的整数值表示为加法递推，求循环的回边执行次数。
+// loops 为 findNaturalLoops 的结果，分析期间不能修改函数
+class ScalarEvolution {
+public:
+    ScalarEvolution(const Function &func, const std::vector<Loop> &loops);
+
+    // v 在 loop 中的演化；算不出来（在内层循环中定义、不是加法、乘法组成的递推、阶数超过 2）时为空。
+    // 循环外定义的值是 0 阶的
+    std::optional<AddRec> evolution(const Value &v, const Loop &loop);
+    // 只有一个出口块、一条回边，出口条件比较步长为 ±1 的归纳变量和循环不变量（都是常量时步长任意）
+    // 并且保证不回绕时，回边执行的次数
+    std::optional<BackedgeCount> backedgeCount(const Loop &loop, const DominatorTree &dt);
+    // bb 所在的最内层循环，不在循环中时为 nullptr
+    const Loop *innermostLoop(const BasicBlock *bb) const;
+
+private:
+    std::unordered_map<int, const Instr *> defs;
+    std::unordered_map<int, const BasicBlock *> defBlocks;
+    std::unordered_map<const BasicBlock *, const Loop *> innermost;
+    std::map<std::pair<const Loop *, int>, std::optional<AddRec>> cache;
+    std::unordered_set<int> pending;    // 正在求演化的 phi，遇到时说明递推不是加法形式
+
+    std::optional<AddRec> compute(const Instr &instr, const Loop &loop);
+    std::optional<AddRec> offsetFrom(const Value &v, int phi, const Loop &loop);
+};
+
+// 虚拟寄存器粒度的活跃变量分析；phi 的操作数视为在对应前驱的出口处活跃
+struct Liveness {
+    std::unordered_map<const BasicBlock *, std::vector<bool>> liveIn;
+    std::unordered_map<const BasicBlock *, std::vector<bool>> liveOut;
+};
+
+Liveness computeLiveness(const Function &func);
+
+// 块末尾的尾调用：调用之后直接返回它的结果，或者 void 函数的调用之后直接（或跳到只有 ret 的块）返回。
+// 返回这条 call，不是尾调用时返回 nullptr
+const Instr *tailCallOf(const BasicBlock &bb);
+
+// 没有副作用的函数：ToyC 没有全局变量和指针，函数只能通过调用模块外的函数（运行时库）产生副作用。
+// 编译器生成的全局表只用作记忆化的缓存，读写它不改变程序可观察的行为，不算副作用。
+// 只调用模块内无副作用函数的函数也没有副作用（递归按乐观假设求不动点）
+std::unordered_set<std::string> findPureFunctions(const Module &module);
+
+// 可以推测执行的纯函数：CFG 无环、不递归、没有可能除以 0 的除法，并且只调用同类函数，
+// 因此总会很快返回，提前到不一定执行到它的位置上调用也不改变程序行为
+std::unordered_set<std::string> findSpeculatableFunctions(const Module &module,
+                                                          const std::unordered_set<std::string> &pure);
+
+// 过程间推断的函数属性
+struct FunctionAttributes {
+    bool pure = false;          // 没有副作用（见 findPureFunctions）
+    bool noRecurse = false;     // 经任何调用链都不会再调用到自己
+    bool leaf = false;          // 不调用任何函数，包括运行时库
+    bool willReturn = false;    // 总会返回：CFG 无环，只调用运行时库和同样总会返回的函数（因此不递归）
+};
+
+// 按函数名给出模块中每个函数的属性
+std::unordered_map<std::string, FunctionAttributes> inferFunctionAttributes(const Module &module);
+
+} // namespace ir
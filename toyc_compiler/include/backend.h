@@ -0,0 +1,44 @@
+#pragma once
+#include "ir.h"
+#include "mir.h"
+#include "regalloc.h"
+#include "strength.h"
+#include <memory>
+#include <ostream>
+#include <string>
+#include <unordered_map>
+
+// 后端的静态统计，按模块累计
+struct BackendStats {
+    int spilledVRegs = 0;
+    int spillInstrs = 0;
+    // 调用每个函数时栈最多增长的字节数（连同它调用的函数，运行时库不计）；可能递归时为 -1
+    std::unordered_map<std::string, int> stackBytes;
+};
+
+// 从 IR 选择 RISC-V 指令并输出汇编：指令选择 -> 寄存器分配 -> 帧布局 -> 打印
+class RiscvBackend {
+public:
+    // cost 为按目标核选择乘除法展开的代价模型，为空时不做强度削弱；
+    // loopAlign 为自然循环头标签前的 .p2align（log2 字节），0 不对齐；
+    // siblingCalls 时紧跟着返回其结果的调用在拆除栈帧后用 tail 跳过去
+    explicit RiscvBackend(std::ostream &out, mir::RegAllocKind regAlloc = mir::RegAllocKind::LinearScan,
+                          const mir::CoreCostModel *cost = &mir::coreCostModel("generic"), int loopAlign = 0,
+                          bool siblingCalls = true);
+
+    // 会就地消除 IR 中的 phi
+    void emitModule(ir::Module &module);
+
+    // 指令选择：IR 函数 -> 使用虚拟寄存器的 MIR 函数（不含序言/尾声）
+    std::unique_ptr<mir::MFunction> selectFunction(const ir::Function &func);
+
+    const BackendStats &stats() const { return stats_; }
+
+private:
+    std::ostream &out;
+    mir::RegAllocKind regAlloc;
+    const mir::CoreCostModel *costModel;
+    int loopAlign;
+    bool siblingCalls;
+    BackendStats stats_;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include "ast.h"
+#include "ir.h"
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+// 调用图：节点是程序中定义的函数，边是调用（运行时库等没有定义的函数不算）。
+// 可以从 AST 的 CallExpr 或 IR 的 call 指令建立；用 Tarjan 算法求强连通分量（SCC），
+// SCC 按自底向上的顺序排列：一个 SCC 调用的其他 SCC 都排在它前面
+class CallGraph {
+public:
+    explicit CallGraph(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+    explicit CallGraph(const ir::Module &module);
+
+    // 按定义顺序
+    const std::vector<std::string> &functions() const { return names; }
+    bool contains(const std::string &name) const { return index.count(name) != 0; }
+    // 直接调用的函数，按第一次调用的顺序、不重复
+    std::vector<std::string> callees(const std::string &name) const;
+
+    const std::vector<std::vector<std::string>> &sccs() const { return components; }
+    int sccOf(const std::string &name) const { return sccIndex[index.at(name)]; }
+    // SCC 直接调用的其他 SCC（都排在它前面）
+    const std::vector<int> &calleeSCCs(int scc) const { return sccEdges[scc]; }
+    // 在调用环上：与别的函数互相递归，或者直接调用自己
+    bool isRecursive(const std::string &name) const;
+    // 所在 SCC 不止一个函数的函数（互相递归）
+    std::unordered_set<std::string> mutuallyRecursive() const;
+
+    // 从 root 出发经调用能到达的函数（包括 root 本身；root 没有定义时为空）
+    std::unordered_set<std::string> reachableFrom(const std::string &root) const;
+    std::unordered_set<std::string> reachableFrom(const std::vector<std::string> &roots) const;
+
+private:
+    std::vector<std::string> names;
+    std::unordered_map<std::string, int> index;
+    std::vector<std::vector<int>> edges;
+    std::vector<std::vector<std::string>> components;
+    std::vector<int> sccIndex;
+    std::vector<std::vector<int>> sccEdges;
+
+    void addCall(int caller, const std::string &callee);
+    void computeSCCs();
+};
+
+// 自底向上处理每个 SCC：work(scc) 开始时它调用的 SCC 都已经处理完。jobs > 1 时互不依赖的 SCC
+// 在线程池中并发处理，work 只能修改本 SCC 中的函数；任一 work 抛出的异常在全部结束后重新抛出
+void forEachSCCBottomUp(const CallGraph &graph, int jobs, const std::function<void(int scc)> &work);
+
+// 整程序模式下删除从 root 出发调用不到的函数，返回删掉的函数名（按原顺序）；没有 root 时不删
+std::vector<std::string> eliminateDeadFunctions(std::vector<std::unique_ptr<FuncDef>> &funcs,
+                                                const std::string &root = "main");
+std::vector<std::string> eliminateDeadFunctions(ir::Module &module, const std::string &root = "main");
+// 删除 internal 函数（编译器生成，模块外没有调用者）中从其余函数出发调用不到的，返回删掉的函数名
+std::vector<std::string> eliminateUnusedInternalFunctions(ir::Module &module);
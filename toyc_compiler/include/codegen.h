@@ -3,21 +3,73 @@
 #include <ostream>
 #include <unordered_map>
 #include <string>
+#include <stack>
+#include <utility>
+#include <vector>
 
 class CodeGen {
 public:
-    CodeGen(std::ostream &out);
+    // eliminateDeadCode：不生成不可达的语句、多余的跳转和值不被使用的无副作用表达式；
+    // rotateLoops：while 生成为受保护的 do-while；loopAlign：循环头标签前的 .p2align（0 不对齐）
+    CodeGen(std::ostream &out, bool eliminateDeadCode = true, bool rotateLoops = true, int loopAlign = 0);
     void genBlock(Block *block);
     void generate(const std::vector<std::unique_ptr<FuncDef>> &funcs);
 
 private:
     std::ostream &out;
     int labelCount = 0;
-    std::unordered_map<std::string, int> localVarOffset;
+    // 作用域栈：变量名 -> 栈槽偏移，内层同名变量遮蔽外层
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    // 栈槽着色的结果：生存期不重叠的变量共用同一个槽
+    std::unordered_map<const VarDeclStmt *, int> declSlot;
+    std::vector<int> paramSlot;
+    std::stack<std::string> breakLabels;
+    std::stack<std::string> continueLabels;
+    // 当前位置是否可能被执行：return/break/continue 之后为 false，不可达的语句不生成代码
+    bool eliminateDeadCode = true;
+    bool reachable = true;
+    std::stack<bool> breakReached;  // 每层循环中是否有可达的 break（决定循环之后是否可达）
+    std::stack<bool> continueReached;   // 每层循环中是否有可达的 continue（决定底部的判断是否可达）
+    bool rotateLoops = true;
+    int loopAlign = 0;
+
+    // 当前函数的函数体先缓存起来，帧大小和需要保存的寄存器在生成完后才能确定
+    std::vector<std::string> body;
+    int slotCount = 0;      // 局部变量槽数，每槽 4 字节，从 0(sp) 向上排列
+    bool hasCall = false;   // 有调用时才需要保存 ra
+
+    // 表达式临时寄存器池 t0-t6；寄存器不够或跨调用时临时值溢出到局部变量槽之上的溢出槽，
+    // 溢出槽按栈的方式分配和释放
+    bool tempBusy[7] = {};
+    int spillDepth = 0;
+    int maxSpillDepth = 0;
 
     void genFunc(FuncDef *func);
     void genStmt(Stmt *stmt);
+    // 求值 expr，结果放在从池中分配的临时寄存器里，由调用者释放
     std::string genExpr(Expr *expr);
+    // 按 Sethi–Ullman 编号先求值需要寄存器多的一边，返回左右操作数所在的寄存器
+    std::pair<std::string, std::string> genOperands(Expr *lhs, Expr *rhs);
+    std::string genCall(CallExpr *call);
+    // 值不被使用的表达式（表达式语句）：只生成其中的调用，没有副作用的部分整个删掉
+    void genDiscarded(Expr *expr);
+    // 一边是 12 位常量的运算选 I 型指令（addi/slti/xori/slli），成功时结果放在 reg 中
+    bool genBinaryImm(BinaryExpr *bin, std::string &reg);
+    void emitLoadImm(const std::string &reg, int value);
+    // 条件上下文：expr 为 jumpIfTrue 时跳到 label，否则顺序执行；&&、|| 短路，比较直接用 b<cond>
+    void genBranch(Expr *expr, const std::string &label, bool jumpIfTrue);
     void emit(const std::string &instr);
+    void emitReturn();
+    // return/break/continue 之后：开启死代码消除时后面的代码不可达
+    void markUnreachable();
     std::string newLabel(const std::string &base);
+    void assignSlots(FuncDef *func);
+    int lookupVar(const std::string &name);
+    // 栈槽的访存地址；偏移超出 12 位立即数时先用 scratch 算出地址
+    std::string slotRef(int offset, const std::string &scratch);
+    std::string allocTemp();
+    void freeTemp(const std::string &reg);
+    int freeTempCount() const;
+    int allocSpillSlot();
+    void flushFunction();
 };
@@ -0,0 +1,22 @@
+#pragma once
+#include <ostream>
+#include <set>
+#include <string>
+
+struct CompileOptions {
+    int optLevel = 0;       // 0：直接从 AST 生成汇编；>= 1：经过 IR 流水线
+    bool emitIR = false;    // 输出 IR 而不是汇编（仅 IR 流水线）
+    std::set<std::string> disabledPasses;   // -fno-<pass> 关闭的优化
+    std::string tune = "generic";           // -mtune=<core>：乘除法强度削弱使用的代价模型
+    std::ostream *report = nullptr;         // --opt-report：各优化的改动统计写到这里
+    int alignLoops = 0;                     // -falign-loops=<n>：循环头按 n 字节（2 的幂）对齐，0 不对齐
+    int inlineThreshold = 40;               // -finline-threshold=<n>：内联的代价阈值
+    bool wholeProgram = false;              // -fwhole-program：删除从 main 调用不到的函数
+    int jobs = 1;                           // -j<n>：并发优化互不依赖的函数所用的线程数
+    long long constEvalSteps = 0;           // -fconst-eval[=<n>]：编译期执行 main 的步数上限，0 不执行
+
+    bool passEnabled(const std::string &name) const { return !disabledPasses.count(name); }
+};
+
+// 编译一个 ToyC 源文件，返回汇编（或 IR）文本；出错时抛出 std::runtime_error
+std::string compileSource(const std::string &source, const CompileOptions &opts);
@@ -0,0 +1,32 @@
+#pragma once
+#include "ast.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+struct FoldStats {
+    int foldedConstants = 0;    // 折叠成常量的子树
+    int simplified = 0;         // 代数恒等式化简和比较规范化
+    int divisionsByZero = 0;    // 常量除以 0（保留原运算，运行时按硬件语义求值）
+};
+
+// AST 上的常量折叠和代数化简，在语义分析之后运行，-O0 也开启。
+// 折叠按 32 位补码回绕求值；只在被删掉的子树没有调用（副作用）时才使用 x * 0 这类恒等式
+class ConstantFolder {
+public:
+    void run(std::vector<std::unique_ptr<FuncDef>> &funcs);
+    const FoldStats &stats() const { return stats_; }
+
+private:
+    FoldStats stats_;
+    std::string funcName;
+
+    void foldBlock(Block *block);
+    void foldStmt(Stmt *stmt);
+    std::unique_ptr<Expr> fold(std::unique_ptr<Expr> expr);
+    // 条件上下文只关心真假：!!c、c != 0 都可以化简为 c
+    std::unique_ptr<Expr> foldCondition(std::unique_ptr<Expr> expr);
+    std::unique_ptr<Expr> foldUnary(std::unique_ptr<UnaryExpr> unary);
+    std::unique_ptr<Expr> foldBinary(std::unique_ptr<BinaryExpr> bin);
+    std::unique_ptr<Expr> foldLogical(std::unique_ptr<BinaryExpr> bin);
+};
@@ -0,0 +1,30 @@
+#pragma once
+#include "ir.h"
+#include <string>
+#include <vector>
+
+// IR 解释器：在编译器中执行模块里的函数，用于编译期求值。
+// 按 RV32IM 的语义求值（32 位补码回绕），全局表每次求值都从全 0 开始。
+// 调用模块外的函数（运行时库）、除以 0、超出步数上限时停止，不产生任何可观察的效果
+namespace ir {
+
+struct EvalResult {
+    enum class Status {
+        Finished,       // 正常返回
+        OutOfSteps,     // 执行的指令数超过上限
+        External,       // 调用了模块外的函数，detail 为函数名
+        Trap            // 运行时会出错：除以 0、全局表越界、调用过深等，detail 为原因
+    };
+    Status status = Status::Finished;
+    int value = 0;              // Finished 时的返回值（void 函数为 0）
+    long long steps = 0;        // 执行的 IR 指令数
+    std::string detail;
+
+    bool finished() const { return status == Status::Finished; }
+};
+
+// 以 args 为实参执行 name，最多执行 maxSteps 条 IR 指令。IR 可以是 SSA 形式，也可以带栈槽
+EvalResult evaluateFunction(const Module &module, const std::string &name, const std::vector<int> &args,
+                            long long maxSteps);
+
+} // namespace ir
@@ -0,0 +1,151 @@
+#pragma once
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// ToyC 三地址中间表示（IR）
+//
+// Module -> Function -> BasicBlock -> Instr。每条指令最多定义一个虚拟寄存器（%N），
+// 操作数可以是虚拟寄存器或 32 位立即数。局部变量在降级阶段放在栈槽（$name）中，
+// 通过 load/store 访问，由后续优化提升为寄存器。模块还可以带编译器生成的全局表（@name），
+// 初值为 0，放在 .bss 中，通过 gload/gstore 按下标访问。
+namespace ir {
+
+enum class IRType {
+    I32,
+    Void
+};
+
+enum class Opcode {
+    // 二元运算：dst = ops[0] op ops[1]
+    Add, Sub, Mul, Div, Rem,
+    And, Or, Xor,
+    // 比较运算，结果为 0 或 1
+    Lt, Gt, Le, Ge, Eq, Ne,
+    // 一元运算：dst = op ops[0]（Not 为逻辑非）
+    Neg, Not,
+    // dst = ops[0]
+    Copy,
+    // dst = 第 index 个形参
+    Arg,
+    // dst = $slot[index]；$slot[index] = ops[0]
+    Load, Store,
+    // dst = @callee[ops[0]]；@callee[ops[0]] = ops[1]（按字下标访问全局表）
+    LoadGlobal, StoreGlobal,
+    // dst = callee(ops...)；dst 为 -1 表示返回值未使用或为 void
+    Call,
+    // dst = phi [ops[i], blocks[i]]
+    Phi,
+    // 终结指令
+    Jmp,    // jmp blocks[0]
+    Br,     // br ops[0], blocks[0], blocks[1]：非零转 blocks[0]，否则转 blocks[1]
+    Ret     // ret [ops[0]]
+};
+
+const char *opcodeName(Opcode op);
+bool isBinary(Opcode op);
+bool isCompare(Opcode op);
+bool isUnary(Opcode op);
+// 按 32 位补码回绕求值，与 RV32IM 的结果一致；除以 0 时返回 false
+bool evalBinary(Opcode op, int a, int b, int &result);
+int evalUnary(Opcode op, int a);
+// 源语言运算符对应的操作码（&& 和 || 另行降级为控制流）；不认识的运算符返回 false
+bool binaryOpcode(const std::string &op, Opcode &result);
+bool unaryOpcode(const std::string &op, Opcode &result);
+
+struct Value {
+    enum class Kind { None, Reg, Imm };
+    Kind kind = Kind::None;
+    int num = 0;    // 寄存器编号或立即数
+
+    static Value reg(int r) { return Value{Kind::Reg, r}; }
+    static Value imm(int v) { return Value{Kind::Imm, v}; }
+
+    bool isNone() const { return kind == Kind::None; }
+    bool isReg() const { return kind == Kind::Reg; }
+    bool isImm() const { return kind == Kind::Imm; }
+
+    bool operator==(const Value &o) const { return kind == o.kind && num == o.num; }
+    bool operator!=(const Value &o) const { return !(*this == o); }
+};
+
+struct BasicBlock;
+
+struct Instr {
+    Opcode op;
+    int dst = -1;
+    std::vector<Value> ops;
+    std::vector<BasicBlock *> blocks;   // Jmp/Br 的目标；Phi 中与 ops 一一对应的前驱块
+    std::string callee;                 // Call 的目标函数；LoadGlobal/StoreGlobal 的全局表
+    int index = -1;                     // Arg 的形参序号；Load/Store 的栈槽编号
+    IRType type = IRType::I32;          // Call 的返回类型
+
+    explicit Instr(Opcode o) : op(o) {}
+
+    bool isTerminator() const { return op == Opcode::Jmp || op == Opcode::Br || op == Opcode::Ret; }
+    // 删除该指令是否会改变程序行为（不考虑结果是否被使用）
+    bool hasSideEffects() const;
+};
+
+struct BasicBlock {
+    std::string name;
+    std::vector<Instr> instrs;
+    std::vector<BasicBlock *> preds;
+    std::vector<BasicBlock *> succs;
+
+    explicit BasicBlock(std::string n) : name(std::move(n)) {}
+
+    bool hasTerminator() const { return !instrs.empty() && instrs.back().isTerminator(); }
+    Instr &terminator() { return instrs.back(); }
+    const Instr &terminator() const { return instrs.back(); }
+};
+
+struct Function {
+    std::string name;
+    IRType retType = IRType::I32;
+    std::vector<std::string> paramNames;
+    std::vector<std::unique_ptr<BasicBlock>> blocks;    // blocks[0] 为入口块，顺序即布局顺序
+    std::vector<std::string> slots;                     // 栈槽（局部变量）名，互不相同
+    int numRegs = 0;
+    bool internal = false;      // 编译器生成的函数（如特化版本），模块外没有调用者，可以随意改签名
+
+    int newReg() { return numRegs++; }
+    int newSlot(const std::string &hint);
+    BasicBlock *newBlock(const std::string &hint);
+    // 新建块并放在 after 之后（布局上紧跟，便于顺序执行）
+    BasicBlock *newBlockAfter(const std::string &hint, BasicBlock *after);
+    BasicBlock *entry() const { return blocks.front().get(); }
+
+    // 根据各块的终结指令重建 preds/succs
+    void rebuildCFG();
+    // 删除从入口不可达的块，并清理 phi 中对应的入边；返回是否有改动
+    bool removeUnreachableBlocks();
+
+private:
+    int blockCounter = 0;
+};
+
+// 编译器管理的全局表（如记忆化的缓存），words 个字，初值全为 0
+struct Global {
+    std::string name;
+    int words = 0;
+};
+
+struct Module {
+    std::vector<std::unique_ptr<Function>> functions;
+    std::vector<Global> globals;
+
+    Function *getFunction(const std::string &name) const;
+    const Global *getGlobal(const std::string &name) const;
+};
+
+void printInstr(std::ostream &os, const Function &func, const Instr &instr);
+void printFunction(std::ostream &os, const Function &func);
+void printModule(std::ostream &os, const Module &module);
+
+// 检查 IR 结构是否合法，失败时把原因写入 err
+bool verifyFunction(const Function &func, const Module *module, std::string &err);
+bool verifyModule(const Module &module, std::string &err);
+
+} // namespace ir
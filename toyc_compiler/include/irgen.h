@@ -0,0 +1,38 @@
+#pragma once
+#include "ast.h"
+#include "ir.h"
+#include <stack>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// 把 AST 降级为三地址 IR：每个局部变量和形参分配一个栈槽，表达式结果放在新的虚拟寄存器中
+class IRGen {
+public:
+    // rotateLoops：while 降级为受保护的 do-while（入口判断一次，之后在循环底部判断）
+    explicit IRGen(bool rotateLoops = true) : rotateLoops(rotateLoops) {}
+    std::unique_ptr<ir::Module> generate(const std::vector<std::unique_ptr<FuncDef>> &funcs);
+
+private:
+    bool rotateLoops = true;
+    ir::Function *func = nullptr;
+    ir::BasicBlock *cur = nullptr;
+    std::unordered_map<std::string, ir::IRType> retTypes;
+    std::vector<std::unordered_map<std::string, int>> scopes;   // 变量名 -> 栈槽
+    std::stack<ir::BasicBlock *> breakTargets;
+    std::stack<ir::BasicBlock *> continueTargets;
+
+    void genFunc(FuncDef *funcDef);
+    void genBlock(Block *block);
+    void genStmt(Stmt *stmt);
+    ir::Value genExpr(Expr *expr);
+    // 条件上下文：按 expr 的真假跳到 ifTrue/ifFalse，&&、|| 短路为分支链
+    void genCond(Expr *expr, ir::BasicBlock *ifTrue, ir::BasicBlock *ifFalse);
+
+    int lookupSlot(const std::string &name) const;
+    ir::Instr &emit(ir::Instr instr);
+    ir::Value emitValue(ir::Opcode op, std::vector<ir::Value> ops);
+    void emitJump(ir::BasicBlock *target);
+    void emitBranch(ir::Value cond, ir::BasicBlock *ifTrue, ir::BasicBlock *ifFalse);
+    void setInsertPoint(ir::BasicBlock *bb) { cur = bb; }
+};
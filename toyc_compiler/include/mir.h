@@ -0,0 +1,116 @@
+#pragma once
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// RISC-V 机器级中间表示（MIR）
+//
+// 指令选择产生使用虚拟寄存器的 RISC-V 指令序列，寄存器分配把虚拟寄存器改写为物理寄存器，
+// 帧布局再把栈帧对象（frame index）折算为 sp 偏移，最后直接打印为汇编文本。
+namespace mir {
+
+// 物理寄存器编号与 RISC-V 的 x0..x31 一致
+enum PhysReg : int {
+    ZERO = 0, RA = 1, SP = 2, GP = 3, TP = 4,
+    T0 = 5, T1 = 6, T2 = 7,
+    S0 = 8, S1 = 9,
+    A0 = 10, A1, A2, A3, A4, A5, A6, A7,
+    S2 = 18, S3, S4, S5, S6, S7, S8, S9, S10, S11,
+    T3 = 28, T4, T5, T6
+};
+
+constexpr int kNumPhysRegs = 32;
+constexpr int kFirstVirtReg = 32;
+
+inline bool isVirtReg(int r) { return r >= kFirstVirtReg; }
+std::string regName(int r);
+bool isCalleeSaved(int r);
+// call 会破坏的寄存器（ra、t0-t6、a0-a7）
+const std::vector<int> &callerSavedRegs();
+
+struct MOperand {
+    enum class Kind { Reg, Imm, Label, Mem };
+    Kind kind = Kind::Imm;
+    int reg = 0;            // Reg；Mem 的基址寄存器
+    int imm = 0;            // Imm；Mem 的偏移
+    int frameIndex = -1;    // Mem：>= 0 时偏移相对于该栈帧对象，帧布局后折算
+    std::string label;
+
+    static MOperand r(int reg) { MOperand o; o.kind = Kind::Reg; o.reg = reg; return o; }
+    static MOperand i(int imm) { MOperand o; o.kind = Kind::Imm; o.imm = imm; return o; }
+    static MOperand l(std::string name) { MOperand o; o.kind = Kind::Label; o.label = std::move(name); return o; }
+    static MOperand mem(int base, int offset) {
+        MOperand o; o.kind = Kind::Mem; o.reg = base; o.imm = offset; return o;
+    }
+    static MOperand frame(int fi, int offset = 0) {
+        MOperand o; o.kind = Kind::Mem; o.reg = SP; o.imm = offset; o.frameIndex = fi; return o;
+    }
+
+    bool isReg() const { return kind == Kind::Reg; }
+    bool isMem() const { return kind == Kind::Mem; }
+};
+
+struct MInstr {
+    std::string op;
+    std::vector<MOperand> ops;
+    std::vector<int> implicitUses;
+    std::vector<int> implicitDefs;
+
+    MInstr(std::string o, std::vector<MOperand> operands = {})
+        : op(std::move(o)), ops(std::move(operands)) {}
+
+    // 是否定义第一个寄存器操作数（存储、分支、跳转、调用、返回不定义）
+    bool definesFirstOperand() const;
+    void getDefs(std::vector<int> &defs) const;
+    void getUses(std::vector<int> &uses) const;
+
+    bool isCopy() const { return op == "mv" && ops[0].isReg() && ops[1].isReg(); }
+    bool isCall() const { return op == "call"; }
+    // 离开函数：ret，以及尾调用的 tail（之前同样要拆除栈帧）
+    bool isReturn() const { return op == "ret" || op == "tail"; }
+    bool isBranch() const;          // 条件分支
+    bool isTerminator() const;      // 条件分支、j、ret、tail
+};
+
+struct MBlock {
+    std::string label;
+    std::vector<MInstr> instrs;
+    std::vector<MBlock *> succs;
+    std::vector<MBlock *> preds;
+    int loopDepth = 0;
+    int align = 0;      // 标签前的 .p2align（log2 字节），0 不对齐
+
+    explicit MBlock(std::string l) : label(std::move(l)) {}
+};
+
+struct FrameObject {
+    int size = 4;
+    int offset = 0;     // 帧布局确定的 sp 偏移
+};
+
+struct MFunction {
+    std::string name;
+    std::vector<std::unique_ptr<MBlock>> blocks;    // blocks[0] 为入口
+    std::vector<FrameObject> frameObjects;
+    int nextVReg = kFirstVirtReg;
+    bool hasCalls = false;
+    std::vector<int> usedCalleeSaved;   // 寄存器分配后实际使用的被调用者保存寄存器
+    int spilledVRegs = 0;               // 寄存器分配溢出的虚拟寄存器个数
+    int spillInstrs = 0;                // 为溢出插入的装载、写回和重新物化指令条数
+    int frameSize = 0;
+
+    int newVReg() { return nextVReg++; }
+    int newFrameObject(int size = 4) {
+        frameObjects.push_back(FrameObject{size, 0});
+        return (int)frameObjects.size() - 1;
+    }
+    void rebuildCFG();
+    // 按自然循环计算每个块的 loopDepth（需要先 rebuildCFG）
+    void computeLoopDepth();
+};
+
+void printInstr(std::ostream &os, const MInstr &instr);
+void printFunction(std::ostream &os, const MFunction &func);
+
+} // namespace mir
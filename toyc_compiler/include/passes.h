@@ -0,0 +1,166 @@
+#pragma once
+#include "ir.h"
+#include <ostream>
+#include <string>
+#include <unordered_set>
+
+// IR 上的变换。返回 bool 的变换在 IR 有改动时返回 true
+namespace ir {
+
+// mem2reg：把局部变量和形参的栈槽提升为 SSA 值（插入 phi 并重命名）
+bool promoteMemoryToRegisters(Function &func);
+
+// 尾递归消除的改动统计
+struct TailRecursionStats {
+    int calls = 0;              // 改写为跳回循环头的自递归尾调用
+    int accumulators = 0;       // 经累加器改写的 return v + f(...) / return v * f(...)
+};
+
+// 尾递归消除：把紧跟着返回其结果的自递归调用改为给形参的 phi 赋新值并跳回函数开头，
+// 递归变成循环，不再占用栈。入口块只保留 arg，其余指令移到新的循环头。
+// 线性递归 return v + f(...)（或 *）引入从单位元开始的累加器：调用点把 v 结合进累加器后跳回，
+// 其余 return 返回累加器与原返回值结合的结果
+bool eliminateTailRecursion(Function &func, TailRecursionStats *stats = nullptr);
+
+// 内联的决策统计
+struct InlineStats {
+    int inlined = 0;            // 换成函数体副本的调用点
+    int notInlined = 0;         // 保留的调用点（外部函数、递归、代价超过阈值）
+};
+
+// 函数体复制到调用点后会留下的指令数：arg 变成（多半被传播掉的）复制，ret 和 jmp 变成直落或一条跳转，
+// phi 不算。内联和特化用它估计代价
+int codeSize(const Function &func);
+
+// 函数内联：把 caller 中的调用点换成被调用者函数体的副本。代价是函数体大小减去调用本身，
+// 与 threshold 比较；调用点每在一层循环里、每个被用到的立即数实参、被调用者是叶子函数都放宽阈值。
+// 递归的函数不内联：mutuallyRecursive 中的函数，以及（尾递归消除之后）仍然调用自己的函数。
+// 被调用者应当已经优化完，并且不会同时被修改。remarks 非空时为每个调用点写一行决策及理由
+bool inlineCalls(Function &caller, const Module &module, const std::unordered_set<std::string> &mutuallyRecursive,
+                 int threshold, std::ostream *remarks = nullptr, InlineStats *stats = nullptr);
+// 按调用图自底向上对每个函数内联，被内联的函数体已经内联过它自己的调用
+bool inlineCalls(Module &module, int threshold, std::ostream *remarks = nullptr, InlineStats *stats = nullptr);
+
+// 过程间常量传播的改动统计
+struct IPSCCPStats {
+    int constantArgs = 0;       // 所有调用点都传同一个常量、在函数体中换成该常量的形参
+    int deadArgs = 0;           // 从签名和调用点删掉的形参
+    int specialized = 0;        // 改为调用特化版本的调用点
+    int constantReturns = 0;    // 换成被调用者常量返回值的调用结果
+};
+
+// 过程间常量传播，在 mem2reg 之后、逐函数的流水线之前对整个模块做：
+// 能改签名的函数（closedWorld 即整程序模式下除 main 以外的函数，以及 internal 函数）中，
+// 每个调用点都传同一个常量的形参换成该常量，并在函数体内做 SCCP 把常量传给它的调用，直到不再变化；
+// 之后没有用到的形参从签名和每个调用点删掉。循环里带常量实参调用不递归、不太大的函数时，
+// 克隆一个代入这些常量并去掉对应形参的 internal 特化版本，同样的常量组合共用一个
+bool propagateConstantsAcrossCalls(Module &module, bool closedWorld, std::ostream *remarks = nullptr,
+                                   IPSCCPStats *stats = nullptr);
+
+// 常量返回值：被调用者的每个 ret 都返回同一个立即数时，把调用的结果换成这个常量，调用本身留给 DCE。
+// 被调用者应当已经优化完，并且不会同时被修改
+bool propagateConstantReturns(Function &caller, const Module &module, std::ostream *remarks = nullptr,
+                              IPSCCPStats *stats = nullptr);
+
+// 自动记忆化（-O3）：只调用纯函数、只直接调用自己、有一两个形参并返回 i32 的函数，同一次激活里执行
+// 两处以上不在尾位置的自调用（调用树指数增长，如 fib）、自调用的实参只会变小，并且至少有一处常量实参的
+// 调用按普通递归算足够贵（用编译期解释器试算）时，原函数体改名为 internal 的 @f.body，@f 换成查表的包装：
+// 实参都在 [0, 边长) 内时先查 .bss 中的 @f.memo.valid/@f.memo 两张表，没算过才调用 @f.body 并记下结果；
+// 超出表的范围时直接调用 @f.body，即普通的递归。@f.body 中的自调用仍然经过包装。
+// 返回被记忆化的函数数
+int memoizeRecursiveFunctions(Module &module, std::ostream *remarks = nullptr);
+
+// 编译期求值的统计
+struct ConstEvalStats {
+    bool mainEvaluated = false; // main 整个求出了结果
+    int callsFolded = 0;        // 部分求值时换成结果的调用
+    long long steps = 0;        // 解释执行的 IR 指令总数
+};
+
+// 编译期求值（-fconst-eval）：ToyC 程序没有输入，main 的结果在编译期就确定了。用 IR 解释器
+// （见 interp.h）执行 main，maxSteps 步内执行完并且没有调用运行时库时 main 换成直接返回结果；
+// 否则退而做部分求值：每个实参都是常量的调用各自最多执行 maxSteps 步，执行完的换成结果
+bool evaluateAtCompileTime(Module &module, long long maxSteps, std::ostream *remarks = nullptr,
+                           ConstEvalStats *stats = nullptr);
+
+// SCCP 的改动统计
+struct SCCPStats {
+    int constants = 0;          // 被立即数替换并删除的定义
+    int branchesFolded = 0;     // 条件恒定、改写为 jmp 的 br
+    int blocksRemoved = 0;      // 因此不可达而删除的块
+};
+
+// 稀疏条件常量传播（Wegman–Zadeck）：常量沿 SSA 值（包括 phi）和可执行的 CFG 边同时传播，
+// 只在可执行的前驱上合并 phi。stats 非空时累加改动统计
+bool sparseConditionalConstantPropagation(Function &func, SCCPStats *stats = nullptr);
+
+// GVN 的改动统计
+struct GVNStats {
+    int redundant = 0;          // 与支配它的某个定义等价、被替换并删除的指令（含复制和可转发的 load）
+    int folded = 0;             // 操作数全为立即数、直接求值的运算
+};
+
+// 基于支配树作用域哈希表的全局值编号：沿支配树先序为每个无副作用的运算计算规范化的键
+// （交换律操作数排序，> 和 >= 翻转为 < 和 <=），遇到支配它的等价定义时直接复用。
+// 调用是屏障，只有 pureFunctions 中的函数（见 findPureFunctions）的调用参与编号
+bool globalValueNumbering(Function &func, const std::unordered_set<std::string> *pureFunctions,
+                          GVNStats *stats = nullptr);
+
+// LICM 的改动统计
+struct LICMStats {
+    int hoisted = 0;            // 提到前置块的指令
+    int loops = 0;              // 有指令被提出的循环
+    int preheaders = 0;         // 新建的前置块
+};
+
+// 循环不变量外提：为每个自然循环准备前置块，把操作数都在循环外定义的无副作用运算提到前置块。
+// 前置块在循环一次都不执行时也会执行，所以只提可以推测执行的运算：除数可能为 0 的除法和
+// 不属于 speculatableFunctions 的纯函数调用只在进入循环就一定执行到、并且循环里在它之前没有副作用时才提
+bool hoistLoopInvariants(Function &func, const std::unordered_set<std::string> *pureFunctions,
+                         const std::unordered_set<std::string> *speculatableFunctions, LICMStats *stats = nullptr);
+
+// 归纳变量化简的改动统计
+struct SCEVStats {
+    int loopsDeleted = 0;       // 换成出口值后删掉的循环
+    int exitValues = 0;         // 用闭式求出的循环出口值
+    int strengthReduced = 0;    // 改为逐次累加的 i * i 一类乘法
+};
+
+// 基于标量演化（ScalarEvolution）的循环化简，从内层循环开始：
+// 只计算值、回边次数算得出来的循环，把循环外用到的值换成前置块中按闭式算出的出口值并删掉循环；
+// 两个操作数都是归纳变量的乘法改为循环头的 phi 加增量。removableFunctions 的含义同 DCE
+bool simplifyInductionVariables(Function &func, const std::unordered_set<std::string> *removableFunctions,
+                                SCEVStats *stats = nullptr);
+
+// 死代码消除的改动统计
+struct DCEStats {
+    int deadInstrs = 0;         // 删除的无副作用、结果未被使用的指令
+    int deadCalls = 0;          // 其中结果未被使用的纯函数调用
+    int blocksRemoved = 0;      // 删除的不可达块
+    int jumpsRemoved = 0;       // 合并块、跳过空块和化简 br 省掉的跳转
+};
+
+// 标记-清除式死代码消除：从有副作用的指令（store、call、终结指令）出发标记被用到的定义，
+// 其余指令删除；返回值未被使用的调用去掉目标寄存器。removableFunctions 中的函数
+// （没有副作用并且总会返回，见 inferFunctionAttributes）的调用不算副作用，结果没人用时整条删除
+bool eliminateDeadCode(Function &func, const std::unordered_set<std::string> *removableFunctions,
+                       DCEStats *stats = nullptr);
+
+// CFG 化简：删除不可达块，两个目标相同的 br 改为 jmp，前驱直接跳过只含 jmp 的空块，
+// 唯一前驱以 jmp 跳过来的块并入前驱
+bool simplifyCFG(Function &func, DCEStats *stats = nullptr);
+
+// 块布局的统计
+struct LayoutStats {
+    int fallThroughsBefore = 0;     // 重排前后继紧跟在后面、不需要跳转的块数
+    int fallThroughsAfter = 0;
+};
+
+// 不依赖 profile 的块布局：从入口开始把块串成链，尽量让每个块的后继紧跟在后面（顺序执行、省掉跳转），
+// 优先留在循环里、其次是 br 的真分支；只在顺序执行的边变多时才重排
+bool placeBlocks(Function &func, LayoutStats *stats = nullptr);
+
+// 退出 SSA：把 phi 改写为前驱末尾的复制，并合并互不干涉的复制两端
+void destroySSA(Function &func);
+
+} // namespace ir
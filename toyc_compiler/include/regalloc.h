@@ -0,0 +1,42 @@
+#pragma once
+#include "mir.h"
+#include <vector>
+
+namespace mir {
+
+enum class RegAllocKind {
+    SpillAll,       // 每个虚拟寄存器都放在栈上（-fno-regalloc，用于对照）
+    LinearScan,     // 线性扫描（-O1）
+    GraphColoring,  // 迭代寄存器合并的图着色（-O2）
+};
+
+// 块级活跃性，寄存器编号覆盖物理寄存器和虚拟寄存器
+struct BlockLiveness {
+    std::vector<std::vector<bool>> liveIn, liveOut;    // 按块在 func.blocks 中的下标
+};
+BlockLiveness computeBlockLiveness(const MFunction &func);
+
+// 参与分配的物理寄存器：t0-t6、a0-a7、s1-s11
+bool isAllocatable(int r);
+const std::vector<int> &callerSavedOrder();
+const std::vector<int> &calleeSavedOrder();
+
+// 溢出一个虚拟寄存器：只有一条 li 定义时在每次使用前重新物化，否则分配栈槽，定义后写回、使用前装载。
+// 返回为每处引用新建的临时虚拟寄存器，这些寄存器不应再被溢出
+std::vector<int> spillVirtReg(MFunction &func, int vreg);
+
+// 最简单的分配器：每个虚拟寄存器独占一个栈槽，每条指令前后用 t0-t2 装载/写回
+void allocateSpillAll(MFunction &func);
+
+// 线性扫描分配器，可用寄存器为 t0-t6、a0-a7、s1-s11。
+// 跨调用的区间优先分到被调用者保存寄存器（由序言保存），分不到时放在调用者保存寄存器里并在
+// call 前后保存/恢复；寄存器不足时按循环深度加权的溢出代价选择溢出对象，li 定义的常量直接重新物化。
+void allocateLinearScan(MFunction &func);
+
+// George–Appel 迭代寄存器合并：按活跃性建干涉图，保守合并复制（Briggs/George 判据），
+// 乐观着色，着色失败时按循环深度加权的溢出代价/度数选择溢出对象
+void allocateGraphColoring(MFunction &func);
+
+void allocateRegisters(MFunction &func, RegAllocKind kind);
+
+} // namespace mir
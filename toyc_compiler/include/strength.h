@@ -0,0 +1,38 @@
+#pragma once
+#include "mir.h"
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace mir {
+
+// 目标核的指令延迟（周期），决定乘除法是否值得展开成移位/加减序列
+struct CoreCostModel {
+    std::string name;
+    int alu;    // add/sub/移位/li
+    int mul;    // mul/mulh
+    int div;    // div/rem
+};
+
+// 已知的核：generic、sifive-e31、picorv32；未知名字抛出 std::runtime_error
+const CoreCostModel &coreCostModel(const std::string &core);
+
+// 强度削弱：往 out 追加计算 dst = src * k 的移位/加减序列。
+// 序列按代价模型不比 li + mul 便宜时不生成，返回 false
+bool expandMulByConst(MFunction &func, std::vector<MInstr> &out, int dst, int src, int32_t k,
+                      const CoreCostModel &cost);
+
+// dst = src / k 或 src % k（isRem），C 语义（向零取整）：2 的幂用移位加符号修正，
+// 其余常量用 mulh 乘魔数。除数为 0、-1 以外无法处理或不划算时返回 false
+bool expandDivByConst(MFunction &func, std::vector<MInstr> &out, int dst, int src, int32_t k, bool isRem,
+                      const CoreCostModel &cost);
+
+// Hacker's Delight 10-1 的有符号除法魔数：q = (mulh(x, magic) [+/- x]) >> shift，再加上符号位修正。
+// 要求 |d| >= 2 且 d 不是 2 的幂
+struct DivMagic {
+    int32_t magic;
+    int shift;
+};
+DivMagic signedDivMagic(int32_t d);
+
+} // namespace mir
@@ -0,0 +1,34 @@
+#pragma once
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+// 固定数量工作线程的线程池。任务可以在运行中继续提交任务；wait() 等到队列为空、
+// 所有任务都结束，并重新抛出第一个任务异常（之后提交的任务不再执行）
+class ThreadPool {
+public:
+    explicit ThreadPool(int threads);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    void submit(std::function<void()> task);
+    void wait();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable ready;      // 有新任务或要退出
+    std::condition_variable idle;       // 队列空且没有正在运行的任务
+    int running = 0;
+    bool stopping = false;
+    std::exception_ptr error;
+
+    void workerLoop();
+};
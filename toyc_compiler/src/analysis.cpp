@@ -0,0 +1,346 @@
+#include "analysis.h"
+#include "callgraph.h"
+#include <algorithm>
+
+namespace ir {
+
+// Cooper-Harvey-Kennedy 迭代算法
+DominatorTree::DominatorTree(const Function &func) {
+    // 迭代 DFS 求后序
+    std::vector<BasicBlock *> post;
+    std::unordered_map<const BasicBlock *, bool> visited;
+    std::vector<std::pair<BasicBlock *, size_t>> stack{{func.entry(), 0}};
+    visited[func.entry()] = true;
+    while (!stack.empty()) {
+        auto &[bb, next] = stack.back();
+        if (next < bb->succs.size()) {
+            BasicBlock *s = bb->succs[next++];
+            if (!visited[s]) {
+                visited[s] = true;
+                stack.push_back({s, 0});
+            }
+        } else {
+            post.push_back(bb);
+            stack.pop_back();
+        }
+    }
+    rpo.assign(post.rbegin(), post.rend());
+    for (size_t i = 0; i < rpo.size(); i++) index[rpo[i]] = (int)i;
+
+    int n = (int)rpo.size();
+    idoms.assign(n, -1);
+    idoms[0] = 0;
+    auto intersect = [&](int a, int b) {
+        while (a != b) {
+            while (a > b) a = idoms[a];
+            while (b > a) b = idoms[b];
+        }
+        return a;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (int i = 1; i < n; i++) {
+            int newIdom = -1;
+            for (BasicBlock *p : rpo[i]->preds) {
+                auto it = index.find(p);
+                if (it == index.end() || idoms[it->second] < 0) continue;
+                newIdom = newIdom < 0 ? it->second : intersect(it->second, newIdom);
+            }
+            if (newIdom != idoms[i]) {
+                idoms[i] = newIdom;
+                changed = true;
+            }
+        }
+    }
+
+    kids.assign(n, {});
+    for (int i = 1; i < n; i++) kids[idoms[i]].push_back(rpo[i]);
+
+    // 支配边界
+    frontiers.assign(n, {});
+    for (int i = 0; i < n; i++) {
+        if (rpo[i]->preds.size() < 2) continue;
+        for (BasicBlock *p : rpo[i]->preds) {
+            auto it = index.find(p);
+            if (it == index.end()) continue;
+            int runner = it->second;
+            while (runner != idoms[i]) {
+                auto &df = frontiers[runner];
+                if (std::find(df.begin(), df.end(), rpo[i]) == df.end()) df.push_back(rpo[i]);
+                runner = idoms[runner];
+            }
+        }
+    }
+
+    // 支配树上的 DFS 编号
+    preNum.assign(n, 0);
+    postNum.assign(n, 0);
+    int counter = 0;
+    std::vector<std::pair<int, size_t>> dfs{{0, 0}};
+    preNum[0] = counter++;
+    while (!dfs.empty()) {
+        auto &[node, next] = dfs.back();
+        if (next < kids[node].size()) {
+            int child = index[kids[node][next++]];
+            preNum[child] = counter++;
+            dfs.push_back({child, 0});
+        } else {
+            postNum[node] = counter++;
+            dfs.pop_back();
+        }
+    }
+}
+
+BasicBlock *DominatorTree::idom(const BasicBlock *bb) const {
+    auto it = index.find(bb);
+    if (it == index.end() || it->second == 0) return nullptr;
+    return rpo[idoms[it->second]];
+}
+
+bool DominatorTree::dominates(const BasicBlock *a, const BasicBlock *b) const {
+    auto ia = index.find(a), ib = index.find(b);
+    if (ia == index.end() || ib == index.end()) return false;
+    return preNum[ia->second] <= preNum[ib->second] && postNum[ib->second] <= postNum[ia->second];
+}
+
+const std::vector<BasicBlock *> &DominatorTree::children(const BasicBlock *bb) const {
+    static const std::vector<BasicBlock *> none;
+    auto it = index.find(bb);
+    return it == index.end() ? none : kids[it->second];
+}
+
+const std::vector<BasicBlock *> &DominatorTree::frontier(const BasicBlock *bb) const {
+    static const std::vector<BasicBlock *> none;
+    auto it = index.find(bb);
+    return it == index.end() ? none : frontiers[it->second];
+}
+
+std::vector<BasicBlock *> Loop::exitingBlocks() const {
+    std::vector<BasicBlock *> exiting;
+    for (const BasicBlock *bb : blocks) {
+        for (BasicBlock *succ : bb->succs) {
+            if (contains(succ)) continue;
+            exiting.push_back(const_cast<BasicBlock *>(bb));
+            break;
+        }
+    }
+    return exiting;
+}
+
+BasicBlock *Loop::preheader() const {
+    BasicBlock *outside = nullptr;
+    for (BasicBlock *pred : header->preds) {
+        if (contains(pred)) continue;
+        if (outside && outside != pred) return nullptr;
+        outside = pred;
+    }
+    return outside && outside->succs.size() == 1 ? outside : nullptr;
+}
+
+std::vector<Loop> findNaturalLoops(const DominatorTree &dt) {
+    std::vector<Loop> loops;
+    // 按逆后序找 header，保证结果与块的顺序无关
+    for (BasicBlock *header : dt.reversePostOrder()) {
+        Loop loop;
+        loop.header = header;
+        for (BasicBlock *pred : header->preds) {
+            if (dt.isReachable(pred) && dt.dominates(header, pred)) loop.latches.push_back(pred);
+        }
+        if (loop.latches.empty()) continue;
+        // 从 latch 沿前驱反向走到 header 为止
+        loop.blocks.insert(header);
+        std::vector<BasicBlock *> work;
+        for (BasicBlock *latch : loop.latches) {
+            if (loop.blocks.insert(latch).second) work.push_back(latch);
+        }
+        while (!work.empty()) {
+            BasicBlock *bb = work.back();
+            work.pop_back();
+            for (BasicBlock *pred : bb->preds) {
+                if (dt.isReachable(pred) && loop.blocks.insert(pred).second) work.push_back(pred);
+            }
+        }
+        loops.push_back(std::move(loop));
+    }
+    for (auto &loop : loops) {
+        for (auto &other : loops) {
+            if (&other != &loop && other.contains(loop.header) && other.blocks.size() > loop.blocks.size())
+                loop.depth++;
+        }
+    }
+    std::stable_sort(loops.begin(), loops.end(), [](const Loop &a, const Loop &b) { return a.depth > b.depth; });
+    return loops;
+}
+
+Liveness computeLiveness(const Function &func) {
+    Liveness live;
+    int n = func.numRegs;
+    std::unordered_map<const BasicBlock *, std::vector<bool>> gen, kill;
+    // phiUses[pred]：后继块的 phi 中来自 pred 的寄存器
+    std::unordered_map<const BasicBlock *, std::vector<int>> phiUses;
+
+    for (auto &bb : func.blocks) {
+        std::vector<bool> &g = gen[bb.get()];
+        std::vector<bool> &k = kill[bb.get()];
+        g.assign(n, false);
+        k.assign(n, false);
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi) {
+                for (size_t i = 0; i < instr.ops.size(); i++) {
+                    if (instr.ops[i].isReg()) phiUses[instr.blocks[i]].push_back(instr.ops[i].num);
+                }
+            } else {
+                for (auto &v : instr.ops) {
+                    if (v.isReg() && !k[v.num]) g[v.num] = true;
+                }
+            }
+            if (instr.dst >= 0) k[instr.dst] = true;
+        }
+        live.liveIn[bb.get()].assign(n, false);
+        live.liveOut[bb.get()].assign(n, false);
+    }
+
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto it = func.blocks.rbegin(); it != func.blocks.rend(); ++it) {
+            const BasicBlock *bb = it->get();
+            std::vector<bool> out(n, false);
+            for (BasicBlock *s : bb->succs) {
+                // phi 的结果在后继入口定义，不在 liveIn 中
+                const std::vector<bool> &in = live.liveIn[s];
+                for (int r = 0; r < n; r++) {
+                    if (in[r]) out[r] = true;
+                }
+            }
+            for (int r : phiUses[bb]) out[r] = true;
+
+            const std::vector<bool> &g = gen[bb];
+            const std::vector<bool> &k = kill[bb];
+            std::vector<bool> in(n, false);
+            for (int r = 0; r < n; r++) in[r] = g[r] || (out[r] && !k[r]);
+
+            if (out != live.liveOut[bb] || in != live.liveIn[bb]) {
+                live.liveOut[bb] = std::move(out);
+                live.liveIn[bb] = std::move(in);
+                changed = true;
+            }
+        }
+    }
+    return live;
+}
+
+const Instr *tailCallOf(const BasicBlock &bb) {
+    size_t n = bb.instrs.size();
+    if (n < 2 || bb.instrs[n - 2].op != Opcode::Call) return nullptr;
+    const Instr &call = bb.instrs[n - 2], &term = bb.instrs[n - 1];
+    const Instr *ret = &term;
+    if (term.op == Opcode::Jmp) {
+        const BasicBlock *target = term.blocks[0];
+        if (target->instrs.size() != 1) return nullptr;
+        ret = &target->instrs[0];
+        if (ret->op != Opcode::Ret || !ret->ops.empty()) return nullptr;
+    }
+    if (ret->op != Opcode::Ret) return nullptr;
+    if (ret->ops.empty() || (call.dst >= 0 && ret->ops[0] == Value::reg(call.dst))) return &call;
+    return nullptr;
+}
+
+std::unordered_set<std::string> findPureFunctions(const Module &module) {
+    std::unordered_set<std::string> pure;
+    for (auto &f : module.functions) pure.insert(f->name);
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &f : module.functions) {
+            if (!pure.count(f->name)) continue;
+            bool ok = true;
+            for (auto &bb : f->blocks) {
+                for (auto &instr : bb->instrs) {
+                    if (instr.op == Opcode::Call && !pure.count(instr.callee)) ok = false;
+                }
+            }
+            if (!ok) {
+                pure.erase(f->name);
+                changed = true;
+            }
+        }
+    }
+    return pure;
+}
+
+std::unordered_set<std::string> findSpeculatableFunctions(const Module &module,
+                                                          const std::unordered_set<std::string> &pure) {
+    // 悲观地从空集开始，只加入被调用者都已在集合中的函数，递归的函数永远不会加入
+    std::unordered_set<std::string> result;
+    std::unordered_set<std::string> candidates;
+    for (auto &f : module.functions) {
+        if (!pure.count(f->name)) continue;
+        DominatorTree dt(*f);
+        bool ok = findNaturalLoops(dt).empty();
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) {
+                bool mayDivideByZero = (instr.op == Opcode::Div || instr.op == Opcode::Rem) &&
+                                       !(instr.ops[1].isImm() && instr.ops[1].num != 0);
+                ok = ok && !mayDivideByZero;
+            }
+        }
+        if (ok) candidates.insert(f->name);
+    }
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &f : module.functions) {
+            if (!candidates.count(f->name) || result.count(f->name)) continue;
+            bool ok = true;
+            for (auto &bb : f->blocks) {
+                for (auto &instr : bb->instrs) {
+                    if (instr.op == Opcode::Call && !result.count(instr.callee)) ok = false;
+                }
+            }
+            if (ok) {
+                result.insert(f->name);
+                changed = true;
+            }
+        }
+    }
+    return result;
+}
+
+std::unordered_map<std::string, FunctionAttributes> inferFunctionAttributes(const Module &module) {
+    std::unordered_map<std::string, FunctionAttributes> attrs;
+    CallGraph graph(module);
+    auto pure = findPureFunctions(module);
+    for (auto &f : module.functions) {
+        FunctionAttributes &a = attrs[f->name];
+        a.pure = pure.count(f->name) != 0;
+        a.noRecurse = !graph.isRecursive(f->name);
+        a.leaf = true;
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) a.leaf = a.leaf && instr.op != Opcode::Call;
+        }
+    }
+
+    // willReturn 与 findSpeculatableFunctions 一样悲观地从空集开始：调用图自底向上，
+    // 一个 SCC 中的函数只依赖已经定下来的被调用者，递归的函数自然不会加入
+    for (auto &scc : graph.sccs()) {
+        for (auto &name : scc) {
+            if (graph.isRecursive(name)) continue;
+            const Function &f = *module.getFunction(name);
+            DominatorTree dt(f);
+            bool ok = findNaturalLoops(dt).empty();
+            for (auto &bb : f.blocks) {
+                for (auto &instr : bb->instrs) {
+                    if (instr.op != Opcode::Call) continue;
+                    auto it = attrs.find(instr.callee);
+                    ok = ok && (it == attrs.end() || it->second.willReturn);
+                }
+            }
+            attrs[name].willReturn = ok;
+        }
+    }
+    return attrs;
+}
+
+} // namespace ir
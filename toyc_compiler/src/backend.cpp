@@ -0,0 +1,610 @@
+#include "backend.h"
+#include <algorithm>
+#include "analysis.h"
+#include "passes.h"
+#include "regalloc.h"
+#include "strength.h"
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+using namespace mir;
+
+namespace {
+
+class InstrSelector {
+public:
+    InstrSelector(const ir::Function &f, const CoreCostModel *cost, bool sibling)
+        : irFunc(f), costModel(cost), siblingCalls(sibling) {}
+
+    std::unique_ptr<MFunction> run() {
+        mf = std::make_unique<MFunction>();
+        mf->name = irFunc.name;
+        mf->nextVReg = kFirstVirtReg + irFunc.numRegs;
+        for (size_t i = 0; i < irFunc.slots.size(); i++) slotFrameIndex.push_back(mf->newFrameObject());
+
+        for (size_t i = 0; i < irFunc.blocks.size(); i++) {
+            const ir::BasicBlock *bb = irFunc.blocks[i].get();
+            std::string name = i == 0 ? irFunc.name : ".L" + irFunc.name + "_" + bb->name;
+            mf->blocks.push_back(std::make_unique<MBlock>(name));
+            blockMap[bb] = mf->blocks.back().get();
+        }
+        findFusedCompares();
+        for (size_t i = 0; i < irFunc.blocks.size(); i++) {
+            const ir::BasicBlock *bb = irFunc.blocks[i].get();
+            const ir::BasicBlock *next = i + 1 < irFunc.blocks.size() ? irFunc.blocks[i + 1].get() : nullptr;
+            cur = blockMap[bb];
+            // 实参都在 a0-a7 里，调用者栈帧中没有被调用者要用的东西，尾调用都可以改成兄弟调用
+            const ir::Instr *tailCall = siblingCalls ? ir::tailCallOf(*bb) : nullptr;
+            for (auto &instr : bb->instrs) {
+                if (instr.dst >= 0 && fusedCompares.count(instr.dst)) continue;
+                if (&instr == tailCall) {
+                    selectTailCall(instr);
+                    break;
+                }
+                selectInstr(instr, next);
+            }
+        }
+        hoistLoopConstants();
+        mf->rebuildCFG();
+        return std::move(mf);
+    }
+
+private:
+    const ir::Function &irFunc;
+    const CoreCostModel *costModel;     // 为空时不做强度削弱
+    bool siblingCalls;
+    std::unique_ptr<MFunction> mf;
+    MBlock *cur = nullptr;
+    std::unordered_map<const ir::BasicBlock *, MBlock *> blockMap;
+    std::vector<int> slotFrameIndex;
+    // 只被本块分支使用的比较：不单独求值，直接选成 blt/bge/beq/bne
+    std::unordered_map<int, const ir::Instr *> fusedCompares;
+
+    static int vreg(int irReg) { return kFirstVirtReg + irReg; }
+
+    static bool isCompare(ir::Opcode op) {
+        return op == ir::Opcode::Lt || op == ir::Opcode::Gt || op == ir::Opcode::Le ||
+               op == ir::Opcode::Ge || op == ir::Opcode::Eq || op == ir::Opcode::Ne;
+    }
+
+    void findFusedCompares() {
+        std::vector<int> useCount(irFunc.numRegs, 0);
+        for (auto &bb : irFunc.blocks) {
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) {
+                    if (v.isReg()) useCount[v.num]++;
+                }
+            }
+        }
+        for (auto &bb : irFunc.blocks) {
+            if (!bb->hasTerminator() || bb->terminator().op != ir::Opcode::Br) continue;
+            const ir::Value &cond = bb->terminator().ops[0];
+            if (!cond.isReg() || useCount[cond.num] != 1) continue;
+            // 在本块中找定义；从比较到分支之间不能改写比较的操作数
+            size_t end = bb->instrs.size() - 1, def = end;
+            for (size_t i = 0; i < end; i++) {
+                if (bb->instrs[i].dst == cond.num) def = i;
+            }
+            if (def == end || !isCompare(bb->instrs[def].op)) continue;
+            const ir::Instr &cmp = bb->instrs[def];
+            bool clobbered = false;
+            for (size_t i = def + 1; i < end; i++) {
+                for (auto &v : cmp.ops) clobbered = clobbered || (v.isReg() && v.num == bb->instrs[i].dst);
+            }
+            if (!clobbered) fusedCompares[cond.num] = &cmp;
+        }
+    }
+
+    // 兄弟调用：实参放好后由帧布局在前面插入尾声，再用 tail 跳到被调用者，由它直接返回到我们的调用者。
+    // 不破坏 ra，不算作调用
+    void selectTailCall(const ir::Instr &instr) {
+        MInstr tail("tail", {MOperand::l(instr.callee)});
+        for (size_t i = 0; i < instr.ops.size(); i++) {
+            moveTo(A0 + (int)i, instr.ops[i]);
+            tail.implicitUses.push_back(A0 + (int)i);
+        }
+        cur->instrs.push_back(std::move(tail));
+    }
+
+    void selectCompareBranch(const ir::Instr &cmp, const ir::BasicBlock *t, const ir::BasicBlock *f,
+                             const ir::BasicBlock *next) {
+        int a = useValue(cmp.ops[0]);
+        int b = useValue(cmp.ops[1]);
+        // 每种比较对应（分支指令, 是否交换操作数）；取反后得到另一种
+        const char *op = nullptr, *inverse = nullptr;
+        bool swap = false;
+        switch (cmp.op) {
+            case ir::Opcode::Lt: op = "blt"; inverse = "bge"; break;
+            case ir::Opcode::Ge: op = "bge"; inverse = "blt"; break;
+            case ir::Opcode::Gt: op = "blt"; inverse = "bge"; swap = true; break;
+            case ir::Opcode::Le: op = "bge"; inverse = "blt"; swap = true; break;
+            case ir::Opcode::Eq: op = "beq"; inverse = "bne"; break;
+            case ir::Opcode::Ne: op = "bne"; inverse = "beq"; break;
+            default: throw std::runtime_error("bad compare opcode in branch selection");
+        }
+        if (swap) std::swap(a, b);
+        if (t == next) {
+            emit(inverse, {MOperand::r(a), MOperand::r(b), MOperand::l(blockMap[f]->label)});
+        } else {
+            emit(op, {MOperand::r(a), MOperand::r(b), MOperand::l(blockMap[t]->label)});
+            if (f != next) emit("j", {MOperand::l(blockMap[f]->label)});
+        }
+    }
+
+    void emit(const std::string &op, std::vector<MOperand> ops) {
+        cur->instrs.emplace_back(op, std::move(ops));
+    }
+
+    // 循环里装入虚拟寄存器的常量（比较、乘除的立即数操作数，常量实参内联后尤其多）每次迭代都要 li，
+    // 移到前置块中只装一次，同一个常量共用一个寄存器。只动唯一定义的虚拟寄存器和不含调用的循环；
+    // 寄存器紧张时分配器会按 li 重新物化，不会因此溢出到栈上。内层循环先处理，逐层往外提
+    void hoistLoopConstants() {
+        std::unordered_map<int, int> defs;
+        std::vector<int> regs;
+        for (auto &bb : mf->blocks) {
+            for (auto &instr : bb->instrs) {
+                regs.clear();
+                instr.getDefs(regs);
+                for (int r : regs) defs[r]++;
+            }
+        }
+        mf->rebuildCFG();
+        BlockLiveness live = computeBlockLiveness(*mf);
+        std::unordered_map<const ir::BasicBlock *, size_t> blockIndex;
+        for (size_t i = 0; i < irFunc.blocks.size(); i++) blockIndex[irFunc.blocks[i].get()] = i;
+        ir::DominatorTree dt(irFunc);
+        for (auto &loop : ir::findNaturalLoops(dt)) {
+            // 前置块：循环外唯一的前驱，并且只跳到 header
+            std::vector<const ir::BasicBlock *> outside;
+            for (const ir::BasicBlock *pred : loop.header->preds) {
+                if (!loop.contains(pred)) outside.push_back(pred);
+            }
+            if (outside.size() != 1 || outside[0]->succs.size() != 1) continue;
+            // 跨调用的常量要占一个被调用者保存寄存器（序言尾声各多一次访存），不如每次 li
+            bool hasCalls = false;
+            for (const ir::BasicBlock *bb : loop.blocks) {
+                for (auto &instr : blockMap[bb]->instrs) hasCalls = hasCalls || instr.isCall();
+            }
+            if (hasCalls) continue;
+            auto hoistable = [&](const MInstr &instr) {
+                return instr.op == "li" && isVirtReg(instr.ops[0].reg) && defs[instr.ops[0].reg] == 1;
+            };
+            std::unordered_set<int> constants;
+            for (const ir::BasicBlock *bb : loop.blocks) {
+                for (auto &instr : blockMap[bb]->instrs) {
+                    if (hoistable(instr)) constants.insert(instr.ops[1].imm);
+                }
+            }
+            // 常量在整个循环中占着寄存器：连同进入循环时活跃的值放不进调用者保存寄存器时宁可每次 li
+            auto &liveIn = live.liveIn[blockIndex[loop.header]];
+            size_t pressure = std::count(liveIn.begin(), liveIn.end(), true) + constants.size();
+            if (constants.empty() || pressure > callerSavedOrder().size()) continue;
+
+            std::unordered_map<int, int> constReg;      // 常量 -> 前置块中装入它的寄存器
+            std::unordered_map<int, int> rename;        // 重复装入同一常量的寄存器 -> constReg 中的寄存器
+            std::vector<MInstr> hoisted;
+            for (auto &bb : irFunc.blocks) {
+                if (!loop.contains(bb.get())) continue;
+                auto &instrs = blockMap[bb.get()]->instrs;
+                std::vector<MInstr> kept;
+                for (auto &instr : instrs) {
+                    if (!hoistable(instr)) {
+                        kept.push_back(std::move(instr));
+                        continue;
+                    }
+                    auto [it, fresh] = constReg.insert({instr.ops[1].imm, instr.ops[0].reg});
+                    if (fresh) hoisted.push_back(std::move(instr));
+                    else rename[instr.ops[0].reg] = it->second;
+                }
+                instrs = std::move(kept);
+            }
+            MBlock *preheader = blockMap[outside[0]];
+            auto &instrs = preheader->instrs;
+            auto pos = instrs.end();
+            while (pos != instrs.begin() && (pos - 1)->isTerminator()) --pos;
+            instrs.insert(pos, std::make_move_iterator(hoisted.begin()), std::make_move_iterator(hoisted.end()));
+            if (rename.empty()) continue;
+            for (auto &bb : irFunc.blocks) {
+                if (!loop.contains(bb.get())) continue;
+                for (auto &instr : blockMap[bb.get()]->instrs) {
+                    for (auto &o : instr.ops) {
+                        if (o.isReg() && rename.count(o.reg)) o.reg = rename[o.reg];
+                    }
+                    for (auto &r : instr.implicitUses) {
+                        if (rename.count(r)) r = rename[r];
+                    }
+                }
+            }
+        }
+    }
+
+    // 把 IR 操作数放进寄存器：立即数 0 直接用 x0，其余立即数先用 li 装入新的虚拟寄存器
+    int useValue(const ir::Value &v) {
+        if (v.isReg()) return vreg(v.num);
+        if (v.num == 0) return ZERO;
+        int r = mf->newVReg();
+        emit("li", {MOperand::r(r), MOperand::i(v.num)});
+        return r;
+    }
+
+    // 全局表第 ops[0] 个字的地址：la 取表的基址，下标不是小常量时再加上下标乘 4
+    MOperand globalAddress(const ir::Instr &instr) {
+        int base = mf->newVReg();
+        emit("la", {MOperand::r(base), MOperand::l(instr.callee)});
+        const ir::Value &index = instr.ops[0];
+        if (index.isImm() && isImm12(index.num * 4LL)) return MOperand::mem(base, index.num * 4);
+        int offset = mf->newVReg(), addr = mf->newVReg();
+        emit("slli", {MOperand::r(offset), MOperand::r(useValue(index)), MOperand::i(2)});
+        emit("add", {MOperand::r(addr), MOperand::r(base), MOperand::r(offset)});
+        return MOperand::mem(addr, 0);
+    }
+
+    // 把 IR 操作数复制到指定的物理寄存器
+    void moveTo(int phys, const ir::Value &v) {
+        if (v.isReg()) emit("mv", {MOperand::r(phys), MOperand::r(vreg(v.num))});
+        else emit("li", {MOperand::r(phys), MOperand::i(v.num)});
+    }
+
+    static bool isImm12(long long v) { return v >= -2048 && v <= 2047; }
+
+    // 一个操作数是 12 位立即数时选 I 型指令；常量在左边时按交换律或翻转比较方向换到右边。
+    // 选不出来时返回 false，由 selectBinary 按寄存器形式处理
+    bool selectBinaryImm(const ir::Instr &instr) {
+        ir::Opcode op = instr.op;
+        ir::Value x = instr.ops[0], c = instr.ops[1];
+        if (x.isImm() && c.isReg()) {
+            switch (op) {
+                case ir::Opcode::Add: case ir::Opcode::Mul: case ir::Opcode::And: case ir::Opcode::Or:
+                case ir::Opcode::Xor: case ir::Opcode::Eq: case ir::Opcode::Ne: break;
+                case ir::Opcode::Lt: op = ir::Opcode::Gt; break;
+                case ir::Opcode::Gt: op = ir::Opcode::Lt; break;
+                case ir::Opcode::Le: op = ir::Opcode::Ge; break;
+                case ir::Opcode::Ge: op = ir::Opcode::Le; break;
+                default: return false;
+            }
+            std::swap(x, c);
+        }
+        if (!x.isReg() || !c.isImm()) return false;
+
+        int d = vreg(instr.dst), a = vreg(x.num);
+        long long k = c.num;
+        auto ri = [&](const char *name, int dst, long long imm) {
+            emit(name, {MOperand::r(dst), MOperand::r(a), MOperand::i((int)imm)});
+        };
+        // 先算出 0/1 再取反
+        auto negated = [&](const char *name, long long imm) {
+            int t = mf->newVReg();
+            ri(name, t, imm);
+            emit("xori", {MOperand::r(d), MOperand::r(t), MOperand::i(1)});
+        };
+        auto testZero = [&](const char *name) {
+            if (k == 0) {
+                emit(name, {MOperand::r(d), MOperand::r(a)});
+            } else {
+                int t = mf->newVReg();
+                ri("xori", t, k);
+                emit(name, {MOperand::r(d), MOperand::r(t)});
+            }
+        };
+        switch (op) {
+            case ir::Opcode::Add: if (!isImm12(k)) return false; ri("addi", d, k); return true;
+            case ir::Opcode::Sub: if (!isImm12(-k)) return false; ri("addi", d, -k); return true;
+            case ir::Opcode::And: if (!isImm12(k)) return false; ri("andi", d, k); return true;
+            case ir::Opcode::Or: if (!isImm12(k)) return false; ri("ori", d, k); return true;
+            case ir::Opcode::Xor: if (!isImm12(k)) return false; ri("xori", d, k); return true;
+            // x <= k 即 x < k+1，x > k 即 !(x < k+1)
+            case ir::Opcode::Lt: if (!isImm12(k)) return false; ri("slti", d, k); return true;
+            case ir::Opcode::Le: if (!isImm12(k + 1)) return false; ri("slti", d, k + 1); return true;
+            case ir::Opcode::Gt: if (!isImm12(k + 1)) return false; negated("slti", k + 1); return true;
+            case ir::Opcode::Ge: if (!isImm12(k)) return false; negated("slti", k); return true;
+            case ir::Opcode::Eq: if (!isImm12(k)) return false; testZero("seqz"); return true;
+            case ir::Opcode::Ne: if (!isImm12(k)) return false; testZero("snez"); return true;
+            default: return false;
+        }
+    }
+
+    // 乘除常量的强度削弱：乘法展开成移位/加减，除法和取模用移位修正或 mulh 魔数
+    bool selectMulDivByConst(const ir::Instr &instr) {
+        if (!costModel) return false;
+        const ir::Value &a = instr.ops[0], &b = instr.ops[1];
+        std::vector<MInstr> seq;
+        bool done = false;
+        if (instr.op == ir::Opcode::Mul && a.isReg() != b.isReg()) {
+            const ir::Value &x = a.isReg() ? a : b, &k = a.isReg() ? b : a;
+            done = expandMulByConst(*mf, seq, vreg(instr.dst), vreg(x.num), k.num, *costModel);
+        } else if ((instr.op == ir::Opcode::Div || instr.op == ir::Opcode::Rem) && a.isReg() && b.isImm()) {
+            done = expandDivByConst(*mf, seq, vreg(instr.dst), vreg(a.num), b.num, instr.op == ir::Opcode::Rem,
+                                    *costModel);
+        }
+        for (auto &i : seq) cur->instrs.push_back(std::move(i));
+        return done;
+    }
+
+    void selectBinary(const ir::Instr &instr) {
+        if (selectMulDivByConst(instr) || selectBinaryImm(instr)) return;
+        int d = vreg(instr.dst);
+        int a = useValue(instr.ops[0]);
+        int b = useValue(instr.ops[1]);
+        auto rrr = [&](const char *op, int x, int y) {
+            emit(op, {MOperand::r(d), MOperand::r(x), MOperand::r(y)});
+        };
+        auto viaTemp = [&](const char *op, int x, int y, const char *fixup, std::vector<MOperand> extra) {
+            int t = mf->newVReg();
+            emit(op, {MOperand::r(t), MOperand::r(x), MOperand::r(y)});
+            std::vector<MOperand> ops = {MOperand::r(d), MOperand::r(t)};
+            ops.insert(ops.end(), extra.begin(), extra.end());
+            emit(fixup, ops);
+        };
+        switch (instr.op) {
+            case ir::Opcode::Add: rrr("add", a, b); break;
+            case ir::Opcode::Sub: rrr("sub", a, b); break;
+            case ir::Opcode::Mul: rrr("mul", a, b); break;
+            case ir::Opcode::Div: rrr("div", a, b); break;
+            case ir::Opcode::Rem: rrr("rem", a, b); break;
+            case ir::Opcode::And: rrr("and", a, b); break;
+            case ir::Opcode::Or: rrr("or", a, b); break;
+            case ir::Opcode::Xor: rrr("xor", a, b); break;
+            case ir::Opcode::Lt: rrr("slt", a, b); break;
+            case ir::Opcode::Gt: rrr("slt", b, a); break;
+            case ir::Opcode::Le: viaTemp("slt", b, a, "xori", {MOperand::i(1)}); break;
+            case ir::Opcode::Ge: viaTemp("slt", a, b, "xori", {MOperand::i(1)}); break;
+            case ir::Opcode::Eq: viaTemp("xor", a, b, "seqz", {}); break;
+            case ir::Opcode::Ne: viaTemp("xor", a, b, "snez", {}); break;
+            default: throw std::runtime_error("bad binary opcode in instruction selection");
+        }
+    }
+
+    void selectInstr(const ir::Instr &instr, const ir::BasicBlock *next) {
+        if (ir::isBinary(instr.op)) {
+            selectBinary(instr);
+            return;
+        }
+        switch (instr.op) {
+            case ir::Opcode::Neg:
+                emit("neg", {MOperand::r(vreg(instr.dst)), MOperand::r(useValue(instr.ops[0]))});
+                break;
+            case ir::Opcode::Not:
+                emit("seqz", {MOperand::r(vreg(instr.dst)), MOperand::r(useValue(instr.ops[0]))});
+                break;
+            case ir::Opcode::Copy:
+                moveTo(vreg(instr.dst), instr.ops[0]);
+                break;
+            case ir::Opcode::Arg:
+                emit("mv", {MOperand::r(vreg(instr.dst)), MOperand::r(A0 + instr.index)});
+                break;
+            case ir::Opcode::Load:
+                emit("lw", {MOperand::r(vreg(instr.dst)), MOperand::frame(slotFrameIndex[instr.index])});
+                break;
+            case ir::Opcode::Store:
+                emit("sw", {MOperand::r(useValue(instr.ops[0])), MOperand::frame(slotFrameIndex[instr.index])});
+                break;
+            case ir::Opcode::LoadGlobal:
+                emit("lw", {MOperand::r(vreg(instr.dst)), globalAddress(instr)});
+                break;
+            case ir::Opcode::StoreGlobal: {
+                int value = useValue(instr.ops[1]);
+                emit("sw", {MOperand::r(value), globalAddress(instr)});
+                break;
+            }
+            case ir::Opcode::Call: {
+                for (size_t i = 0; i < instr.ops.size(); i++) moveTo(A0 + (int)i, instr.ops[i]);
+                MInstr call("call", {MOperand::l(instr.callee)});
+                for (size_t i = 0; i < instr.ops.size(); i++) call.implicitUses.push_back(A0 + (int)i);
+                call.implicitDefs = callerSavedRegs();
+                cur->instrs.push_back(std::move(call));
+                mf->hasCalls = true;
+                if (instr.dst >= 0) emit("mv", {MOperand::r(vreg(instr.dst)), MOperand::r(A0)});
+                break;
+            }
+            case ir::Opcode::Jmp:
+                if (instr.blocks[0] != next) emit("j", {MOperand::l(blockMap[instr.blocks[0]]->label)});
+                break;
+            case ir::Opcode::Br: {
+                const ir::BasicBlock *t = instr.blocks[0];
+                const ir::BasicBlock *f = instr.blocks[1];
+                if (instr.ops[0].isImm()) {
+                    const ir::BasicBlock *target = instr.ops[0].num ? t : f;
+                    if (target != next) emit("j", {MOperand::l(blockMap[target]->label)});
+                    break;
+                }
+                auto fused = fusedCompares.find(instr.ops[0].num);
+                if (fused != fusedCompares.end()) {
+                    selectCompareBranch(*fused->second, t, f, next);
+                    break;
+                }
+                int c = vreg(instr.ops[0].num);
+                if (t == next) {
+                    emit("beqz", {MOperand::r(c), MOperand::l(blockMap[f]->label)});
+                } else {
+                    emit("bnez", {MOperand::r(c), MOperand::l(blockMap[t]->label)});
+                    if (f != next) emit("j", {MOperand::l(blockMap[f]->label)});
+                }
+                break;
+            }
+            case ir::Opcode::Ret: {
+                MInstr ret("ret");
+                if (!instr.ops.empty()) {
+                    moveTo(A0, instr.ops[0]);
+                    ret.implicitUses.push_back(A0);
+                }
+                cur->instrs.push_back(std::move(ret));
+                break;
+            }
+            case ir::Opcode::Phi:
+                throw std::runtime_error("phi must be eliminated before instruction selection");
+            default:
+                throw std::runtime_error(std::string("cannot select IR opcode ") + ir::opcodeName(instr.op));
+        }
+    }
+};
+
+// 寄存器分配之后展开超出 12 位的 li：lui 装高 20 位，addi 补上带符号的低 12 位。
+// 分配之前保留 li，溢出时才能按单条 li 重新物化
+void expandConstants(MFunction &mf) {
+    for (auto &bb : mf.blocks) {
+        std::vector<MInstr> instrs;
+        for (auto &instr : bb->instrs) {
+            int value = instr.op == "li" ? instr.ops[1].imm : 0;
+            if (instr.op != "li" || (value >= -2048 && value <= 2047)) {
+                instrs.push_back(std::move(instr));
+                continue;
+            }
+            uint32_t hi = (((uint32_t)value + 0x800) >> 12) & 0xfffff;
+            int lo = (int)((uint32_t)value - (hi << 12));
+            MOperand dst = instr.ops[0];
+            instrs.emplace_back("lui", std::vector<MOperand>{dst, MOperand::i((int)hi)});
+            if (lo != 0) instrs.emplace_back("addi", std::vector<MOperand>{dst, dst, MOperand::i(lo)});
+        }
+        bb->instrs = std::move(instrs);
+    }
+}
+
+// 栈帧：[sp, sp+size) 依次放栈帧对象、用到的被调用者保存寄存器，有调用时顶部 4 字节保存 ra；
+// 大小按 16 字节对齐，为 0 时不建立栈帧。帧超出 12 位立即数时改为保存区在底部、对象在上面，
+// 远处的对象经 s0（分配器从不使用，按被调用者保存寄存器保存）算地址，sp 的调整经 t0
+// （入口和返回处 t0 都不活跃）
+void lowerFrame(MFunction &mf) {
+    int objectsSize = 0;
+    for (auto &obj : mf.frameObjects) objectsSize += obj.size;
+    int savesSize = 4 * ((int)mf.usedCalleeSaved.size() + (mf.hasCalls ? 1 : 0));
+    bool large = ((objectsSize + savesSize + 15) & ~15) > 2047;
+
+    std::vector<int> savedRegs(mf.usedCalleeSaved.begin(), mf.usedCalleeSaved.end());
+    if (large) savedRegs.push_back(S0);
+    if (mf.hasCalls) savedRegs.push_back(RA);
+    std::vector<std::pair<int, int>> saves;
+    int offset = 0;
+    auto placeSaves = [&] {
+        for (int r : savedRegs) {
+            saves.push_back({r, offset});
+            offset += 4;
+        }
+    };
+    if (large) placeSaves();
+    for (auto &obj : mf.frameObjects) {
+        obj.offset = offset;
+        offset += obj.size;
+    }
+    if (!large) placeSaves();
+    mf.frameSize = (offset + 15) & ~15;
+
+    auto adjustSp = [&](std::vector<MInstr> &out, int amount) {
+        if (amount >= -2048 && amount <= 2047) {
+            out.emplace_back("addi", std::vector<MOperand>{MOperand::r(SP), MOperand::r(SP), MOperand::i(amount)});
+        } else {
+            out.emplace_back("li", std::vector<MOperand>{MOperand::r(T0), MOperand::i(amount)});
+            out.emplace_back("add", std::vector<MOperand>{MOperand::r(SP), MOperand::r(SP), MOperand::r(T0)});
+        }
+    };
+    for (auto &bb : mf.blocks) {
+        std::vector<MInstr> instrs;
+        for (auto &instr : bb->instrs) {
+            for (auto &o : instr.ops) {
+                if (!o.isMem() || o.frameIndex < 0) continue;
+                o.imm += mf.frameObjects[o.frameIndex].offset;
+                o.frameIndex = -1;
+                if (o.imm > 2047) {
+                    instrs.emplace_back("li", std::vector<MOperand>{MOperand::r(S0), MOperand::i(o.imm)});
+                    instrs.emplace_back("add", std::vector<MOperand>{MOperand::r(S0), MOperand::r(SP), MOperand::r(S0)});
+                    o = MOperand::mem(S0, 0);
+                }
+            }
+            if (instr.isReturn() && mf.frameSize > 0) {
+                for (auto &[r, off] : saves)
+                    instrs.emplace_back("lw", std::vector<MOperand>{MOperand::r(r), MOperand::mem(SP, off)});
+                adjustSp(instrs, mf.frameSize);
+            }
+            instrs.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(instrs);
+    }
+    if (mf.frameSize == 0) return;
+    std::vector<MInstr> prologue;
+    adjustSp(prologue, -mf.frameSize);
+    for (auto &[r, off] : saves) prologue.emplace_back("sw", std::vector<MOperand>{MOperand::r(r), MOperand::mem(SP, off)});
+    auto &entry = mf.blocks.front()->instrs;
+    entry.insert(entry.begin(), prologue.begin(), prologue.end());
+}
+
+// 一个函数的帧以及它调用的函数，用来求栈深度的上界
+struct FrameSummary {
+    int frameSize = 0;
+    std::vector<std::string> calls;     // call：被调用者的帧压在我们的帧下面
+    std::vector<std::string> tails;     // tail：跳过去之前我们的帧已经拆除
+};
+
+// 调用 name 时栈最多增长的字节数；memo 中 -2 表示正在计算，再次遇到说明在调用环上
+int stackBound(const std::string &name, const std::unordered_map<std::string, FrameSummary> &frames,
+               std::unordered_map<std::string, int> &memo) {
+    auto it = frames.find(name);
+    if (it == frames.end()) return 0;
+    auto [entry, fresh] = memo.emplace(name, -2);
+    if (!fresh) return entry->second == -2 ? -1 : entry->second;
+    int deepest = 0;
+    bool unbounded = false;
+    for (auto &callee : it->second.calls) {
+        int bytes = stackBound(callee, frames, memo);
+        unbounded = unbounded || bytes < 0;
+        deepest = std::max(deepest, it->second.frameSize + bytes);
+    }
+    for (auto &callee : it->second.tails) {
+        int bytes = stackBound(callee, frames, memo);
+        unbounded = unbounded || bytes < 0;
+        deepest = std::max(deepest, bytes);
+    }
+    int result = unbounded ? -1 : std::max(deepest, it->second.frameSize);
+    memo[name] = result;
+    return result;
+}
+
+} // namespace
+
+RiscvBackend::RiscvBackend(std::ostream &os, RegAllocKind kind, const CoreCostModel *cost, int loopAlign,
+                           bool siblingCalls)
+    : out(os), regAlloc(kind), costModel(cost), loopAlign(loopAlign), siblingCalls(siblingCalls) {}
+
+std::unique_ptr<MFunction> RiscvBackend::selectFunction(const ir::Function &func) {
+    auto mf = InstrSelector(func, costModel, siblingCalls).run();
+    if (loopAlign > 0) {
+        // MIR 的块与 IR 的块一一对应、顺序相同；入口块前面是函数标签，不对齐
+        ir::DominatorTree dt(func);
+        for (auto &loop : ir::findNaturalLoops(dt)) {
+            for (size_t i = 1; i < func.blocks.size(); i++) {
+                if (func.blocks[i].get() == loop.header) mf->blocks[i]->align = loopAlign;
+            }
+        }
+    }
+    return mf;
+}
+
+void RiscvBackend::emitModule(ir::Module &module) {
+    std::unordered_map<std::string, FrameSummary> frames;
+    for (auto &f : module.functions) {
+        ir::destroySSA(*f);
+        auto mf = selectFunction(*f);
+        allocateRegisters(*mf, regAlloc);
+        stats_.spilledVRegs += mf->spilledVRegs;
+        stats_.spillInstrs += mf->spillInstrs;
+        lowerFrame(*mf);
+        expandConstants(*mf);
+        printFunction(out, *mf);
+        FrameSummary &summary = frames[mf->name];
+        summary.frameSize = mf->frameSize;
+        for (auto &bb : mf->blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.isCall()) summary.calls.push_back(instr.ops[0].label);
+                else if (instr.op == "tail") summary.tails.push_back(instr.ops[0].label);
+            }
+        }
+    }
+    std::unordered_map<std::string, int> memo;
+    for (auto &f : module.functions) stats_.stackBytes[f->name] = stackBound(f->name, frames, memo);
+    // 全局表初值为 0，放在 .bss 中不占可执行文件的空间
+    if (!module.globals.empty()) out << ".bss\n";
+    for (auto &g : module.globals) {
+        out << ".p2align 2\n";
+        out << g.name << ":\n";
+        out << "\t.zero " << g.words * 4 << "\n";
+    }
+}
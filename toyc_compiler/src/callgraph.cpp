@@ -0,0 +1,261 @@
+#include "callgraph.h"
+#include "threadpool.h"
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+// 按求值顺序（先实参后调用）收集 AST 中的调用，与 IR 中 call 指令的顺序一致
+void collectCalls(const Expr *expr, std::vector<std::string> &calls);
+
+void collectCalls(const Stmt *stmt, std::vector<std::string> &calls) {
+    if (auto decl = dynamic_cast<const VarDeclStmt *>(stmt)) {
+        if (decl->initializer) collectCalls(decl->initializer.get(), calls);
+    } else if (auto assign = dynamic_cast<const AssignStmt *>(stmt)) {
+        collectCalls(assign->value.get(), calls);
+    } else if (auto exprStmt = dynamic_cast<const ExprStmt *>(stmt)) {
+        collectCalls(exprStmt->expr.get(), calls);
+    } else if (auto ret = dynamic_cast<const ReturnStmt *>(stmt)) {
+        if (ret->expr) collectCalls(ret->expr.get(), calls);
+    } else if (auto block = dynamic_cast<const Block *>(stmt)) {
+        for (auto &s : block->stmts) collectCalls(s.get(), calls);
+    } else if (auto ifStmt = dynamic_cast<const IfStmt *>(stmt)) {
+        collectCalls(ifStmt->condition.get(), calls);
+        collectCalls(ifStmt->thenBlock.get(), calls);
+        if (ifStmt->elseBlock) collectCalls(ifStmt->elseBlock.get(), calls);
+    } else if (auto whileStmt = dynamic_cast<const WhileStmt *>(stmt)) {
+        collectCalls(whileStmt->condition.get(), calls);
+        collectCalls(whileStmt->body.get(), calls);
+    }
+}
+
+void collectCalls(const Expr *expr, std::vector<std::string> &calls) {
+    if (auto call = dynamic_cast<const CallExpr *>(expr)) {
+        for (auto &arg : call->args) collectCalls(arg.get(), calls);
+        calls.push_back(call->callee);
+    } else if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) {
+        collectCalls(unary->operand.get(), calls);
+    } else if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) {
+        collectCalls(bin->lhs.get(), calls);
+        collectCalls(bin->rhs.get(), calls);
+    }
+}
+
+} // namespace
+
+CallGraph::CallGraph(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    for (auto &func : funcs) {
+        index[func->name] = (int)names.size();
+        names.push_back(func->name);
+    }
+    edges.resize(names.size());
+    for (auto &func : funcs) {
+        std::vector<std::string> calls;
+        if (func->body) collectCalls(func->body.get(), calls);
+        for (auto &callee : calls) addCall(index[func->name], callee);
+    }
+    computeSCCs();
+}
+
+CallGraph::CallGraph(const ir::Module &module) {
+    for (auto &f : module.functions) {
+        index[f->name] = (int)names.size();
+        names.push_back(f->name);
+    }
+    edges.resize(names.size());
+    for (auto &f : module.functions) {
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op == ir::Opcode::Call) addCall(index[f->name], instr.callee);
+            }
+        }
+    }
+    computeSCCs();
+}
+
+void CallGraph::addCall(int caller, const std::string &callee) {
+    auto it = index.find(callee);
+    if (it == index.end()) return;
+    auto &out = edges[caller];
+    if (std::find(out.begin(), out.end(), it->second) == out.end()) out.push_back(it->second);
+}
+
+std::vector<std::string> CallGraph::callees(const std::string &name) const {
+    std::vector<std::string> result;
+    for (int callee : edges[index.at(name)]) result.push_back(names[callee]);
+    return result;
+}
+
+bool CallGraph::isRecursive(const std::string &name) const {
+    int f = index.at(name);
+    const auto &out = edges[f];
+    return components[sccIndex[f]].size() > 1 || std::find(out.begin(), out.end(), f) != out.end();
+}
+
+std::unordered_set<std::string> CallGraph::mutuallyRecursive() const {
+    std::unordered_set<std::string> result;
+    for (auto &component : components) {
+        if (component.size() > 1) result.insert(component.begin(), component.end());
+    }
+    return result;
+}
+
+std::unordered_set<std::string> CallGraph::reachableFrom(const std::string &root) const {
+    return reachableFrom(std::vector<std::string>{root});
+}
+
+std::unordered_set<std::string> CallGraph::reachableFrom(const std::vector<std::string> &roots) const {
+    std::unordered_set<std::string> reached;
+    std::vector<int> stack;
+    std::vector<bool> seen(names.size(), false);
+    for (auto &root : roots) {
+        auto it = index.find(root);
+        if (it == index.end() || seen[it->second]) continue;
+        seen[it->second] = true;
+        stack.push_back(it->second);
+    }
+    while (!stack.empty()) {
+        int f = stack.back();
+        stack.pop_back();
+        reached.insert(names[f]);
+        for (int callee : edges[f]) {
+            if (!seen[callee]) {
+                seen[callee] = true;
+                stack.push_back(callee);
+            }
+        }
+    }
+    return reached;
+}
+
+// Tarjan：DFS 中 lowlink 等于自身编号的节点是 SCC 的根，弹出栈上它之上的节点。
+// 一个 SCC 弹出时它能到达的 SCC 都已经弹出，所以弹出顺序就是自底向上的顺序。
+// 用显式栈迭代，调用链很长也不会爆栈
+void CallGraph::computeSCCs() {
+    size_t n = names.size();
+    std::vector<int> order(n, -1), low(n, 0);
+    std::vector<bool> onStack(n, false);
+    std::vector<int> stack;
+    sccIndex.assign(n, -1);
+    int counter = 0;
+    for (size_t start = 0; start < n; start++) {
+        if (order[start] >= 0) continue;
+        std::vector<std::pair<int, size_t>> dfs = {{(int)start, 0}};
+        order[start] = low[start] = counter++;
+        stack.push_back((int)start);
+        onStack[start] = true;
+        while (!dfs.empty()) {
+            auto &[f, next] = dfs.back();
+            if (next < edges[f].size()) {
+                int callee = edges[f][next++];
+                if (order[callee] < 0) {
+                    order[callee] = low[callee] = counter++;
+                    stack.push_back(callee);
+                    onStack[callee] = true;
+                    dfs.push_back({callee, 0});
+                } else if (onStack[callee]) {
+                    low[f] = std::min(low[f], order[callee]);
+                }
+                continue;
+            }
+            int done = f;
+            dfs.pop_back();
+            if (!dfs.empty()) low[dfs.back().first] = std::min(low[dfs.back().first], low[done]);
+            if (low[done] != order[done]) continue;
+            std::vector<std::string> component;
+            int member;
+            do {
+                member = stack.back();
+                stack.pop_back();
+                onStack[member] = false;
+                sccIndex[member] = (int)components.size();
+                component.push_back(names[member]);
+            } while (member != done);
+            // SCC 内按定义顺序
+            std::sort(component.begin(), component.end(),
+                      [&](const std::string &a, const std::string &b) { return index.at(a) < index.at(b); });
+            components.push_back(std::move(component));
+        }
+    }
+
+    sccEdges.assign(components.size(), {});
+    for (size_t f = 0; f < n; f++) {
+        for (int callee : edges[f]) {
+            int from = sccIndex[f], to = sccIndex[callee];
+            auto &out = sccEdges[from];
+            if (from != to && std::find(out.begin(), out.end(), to) == out.end()) out.push_back(to);
+        }
+    }
+}
+
+void forEachSCCBottomUp(const CallGraph &graph, int jobs, const std::function<void(int scc)> &work) {
+    int count = (int)graph.sccs().size();
+    if (jobs <= 1 || count <= 1) {
+        for (int scc = 0; scc < count; scc++) work(scc);
+        return;
+    }
+    // 每个 SCC 还差几个被调用的 SCC 没处理完；减到 0 就可以开始
+    std::vector<std::atomic<int>> pending(count);
+    std::vector<std::vector<int>> callers(count);
+    for (int scc = 0; scc < count; scc++) {
+        pending[scc] = (int)graph.calleeSCCs(scc).size();
+        for (int callee : graph.calleeSCCs(scc)) callers[callee].push_back(scc);
+    }
+    ThreadPool pool(std::min(jobs, count));
+    std::function<void(int)> run = [&](int scc) {
+        work(scc);
+        for (int caller : callers[scc]) {
+            if (--pending[caller] == 0) pool.submit([&run, caller] { run(caller); });
+        }
+    };
+    // 先取出没有依赖的 SCC 再提交：提交之后工作线程就会开始把调用者的计数减到 0
+    std::vector<int> leaves;
+    for (int scc = 0; scc < count; scc++) {
+        if (pending[scc] == 0) leaves.push_back(scc);
+    }
+    for (int scc : leaves) pool.submit([&run, scc] { run(scc); });
+    pool.wait();
+}
+
+std::vector<std::string> eliminateDeadFunctions(std::vector<std::unique_ptr<FuncDef>> &funcs,
+                                                const std::string &root) {
+    auto live = CallGraph(funcs).reachableFrom(root);
+    std::vector<std::string> removed;
+    if (live.empty()) return removed;
+    std::vector<std::unique_ptr<FuncDef>> kept;
+    for (auto &func : funcs) {
+        if (live.count(func->name)) kept.push_back(std::move(func));
+        else removed.push_back(func->name);
+    }
+    funcs = std::move(kept);
+    return removed;
+}
+
+std::vector<std::string> eliminateDeadFunctions(ir::Module &module, const std::string &root) {
+    auto live = CallGraph(module).reachableFrom(root);
+    std::vector<std::string> removed;
+    if (live.empty()) return removed;
+    std::vector<std::unique_ptr<ir::Function>> kept;
+    for (auto &f : module.functions) {
+        if (live.count(f->name)) kept.push_back(std::move(f));
+        else removed.push_back(f->name);
+    }
+    module.functions = std::move(kept);
+    return removed;
+}
+
+std::vector<std::string> eliminateUnusedInternalFunctions(ir::Module &module) {
+    std::vector<std::string> roots;
+    for (auto &f : module.functions) {
+        if (!f->internal) roots.push_back(f->name);
+    }
+    auto live = CallGraph(module).reachableFrom(roots);
+    std::vector<std::string> removed;
+    std::vector<std::unique_ptr<ir::Function>> kept;
+    for (auto &f : module.functions) {
+        if (live.count(f->name)) kept.push_back(std::move(f));
+        else removed.push_back(f->name);
+    }
+    module.functions = std::move(kept);
+    return removed;
+}
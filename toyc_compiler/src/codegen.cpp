@@ -2,8 +2,16 @@
 #include "ast.h"
 #include <iostream>
 #include <cassert>
+#include <algorithm>
+#include <cctype>
+#include <stdexcept>
+#include <tuple>
 
-CodeGen::CodeGen(std::ostream &os) : out(os), labelCount(0) {}
+// 函数体中 return 处的占位，帧布局确定后替换为尾声
+static const char *const kEpilogueMarker = "#epilogue";
+
+CodeGen::CodeGen(std::ostream &os, bool eliminateDeadCode, bool rotateLoops, int loopAlign)
+    : out(os), labelCount(0), eliminateDeadCode(eliminateDeadCode), rotateLoops(rotateLoops), loopAlign(loopAlign) {}
 
 void CodeGen::generate(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
     for (const auto &f : funcs) {
@@ -12,167 +20,760 @@ void CodeGen::generate(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
 }
 
 void CodeGen::emit(const std::string &code) {
-    out << "\t" << code << "\n";
+    body.push_back(code);
+}
+
+void CodeGen::emitReturn() {
+    body.push_back(kEpilogueMarker);
+}
+
+void CodeGen::markUnreachable() {
+    if (eliminateDeadCode) reachable = false;
+}
+
+namespace {
+
+// 栈槽着色：按语句编号给每个变量求生存区间 [声明, 最后一次引用]，在循环里引用外层变量时
+// 区间延伸到循环末尾（值要跨迭代保留），再像线性扫描一样把区间不相交的变量放进同一个槽
+class SlotColoring {
+public:
+    std::unordered_map<const VarDeclStmt *, int> declSlot;
+    std::vector<int> paramSlot;
+    int slotCount = 0;
+
+    void run(FuncDef *func) {
+        scopes.emplace_back();
+        for (auto &param : func->params) {
+            scopes.back()[param.name] = (int)vars.size();
+            vars.push_back(Var{nullptr, 0, 0});
+        }
+        visitBlock(func->body.get());
+        scopes.pop_back();
+        color();
+    }
+
+private:
+    struct Var {
+        const VarDeclStmt *decl;   // 参数为 nullptr
+        int start, end;
+    };
+    struct Loop {
+        int start;
+        std::vector<int> extended;  // 在循环内被引用、但在循环外声明的变量
+    };
+    std::vector<Var> vars;
+    std::vector<std::unordered_map<std::string, int>> scopes;
+    std::vector<Loop> loops;
+    int pos = 0;
+
+    void use(const std::string &name) {
+        for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+            auto found = it->find(name);
+            if (found == it->end()) continue;
+            Var &v = vars[found->second];
+            v.end = std::max(v.end, pos);
+            // 最外层不包含声明的循环
+            for (auto &loop : loops) {
+                if (loop.start > v.start) {
+                    loop.extended.push_back(found->second);
+                    break;
+                }
+            }
+            return;
+        }
+    }
+
+    void visitExpr(Expr *expr) {
+        if (!expr) return;
+        if (auto var = dynamic_cast<VarExpr *>(expr)) {
+            use(var->name);
+        } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+            visitExpr(bin->lhs.get());
+            visitExpr(bin->rhs.get());
+        } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+            visitExpr(unary->operand.get());
+        } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+            for (auto &arg : call->args) visitExpr(arg.get());
+        }
+    }
+
+    void visitBlock(Block *block) {
+        if (!block) return;
+        scopes.emplace_back();
+        for (auto &stmt : block->stmts) visitStmt(stmt.get());
+        scopes.pop_back();
+    }
+
+    void visitStmt(Stmt *stmt) {
+        pos++;
+        if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+            visitExpr(decl->initializer.get());
+            scopes.back()[decl->name] = (int)vars.size();
+            vars.push_back(Var{decl, pos, pos});
+        } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+            visitExpr(assign->value.get());
+            use(assign->name);
+        } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+            visitExpr(exprStmt->expr.get());
+        } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+            visitExpr(ret->expr.get());
+        } else if (auto block = dynamic_cast<Block *>(stmt)) {
+            visitBlock(block);
+        } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+            visitExpr(ifStmt->condition.get());
+            visitBlock(ifStmt->thenBlock.get());
+            visitBlock(ifStmt->elseBlock.get());
+        } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+            loops.push_back(Loop{pos, {}});
+            visitExpr(whileStmt->condition.get());
+            visitBlock(whileStmt->body.get());
+            pos++;
+            for (int v : loops.back().extended) vars[v].end = std::max(vars[v].end, pos);
+            loops.pop_back();
+        }
+    }
+
+    void color() {
+        std::vector<int> order(vars.size());
+        for (size_t i = 0; i < order.size(); i++) order[i] = (int)i;
+        std::stable_sort(order.begin(), order.end(), [&](int a, int b) { return vars[a].start < vars[b].start; });
+        std::vector<int> slotEnd;   // 每个槽当前占用者的区间终点
+        for (int v : order) {
+            int slot = -1;
+            for (size_t s = 0; s < slotEnd.size(); s++) {
+                if (slotEnd[s] < vars[v].start) {
+                    slot = (int)s;
+                    break;
+                }
+            }
+            if (slot < 0) {
+                slot = (int)slotEnd.size();
+                slotEnd.push_back(0);
+            }
+            slotEnd[slot] = vars[v].end;
+            if (vars[v].decl) declSlot[vars[v].decl] = 4 * slot;
+            else paramSlot.push_back(4 * slot);
+        }
+        slotCount = (int)slotEnd.size();
+    }
+};
+
+} // namespace
+
+void CodeGen::assignSlots(FuncDef *func) {
+    SlotColoring coloring;
+    coloring.run(func);
+    declSlot = std::move(coloring.declSlot);
+    paramSlot = std::move(coloring.paramSlot);
+    slotCount = coloring.slotCount;
+}
+
+int CodeGen::lookupVar(const std::string &name) {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
+    }
+    return -1;
+}
+
+// 栈槽的访存操作数；超出 12 位立即数范围时先用 scratch 算出地址
+std::string CodeGen::slotRef(int offset, const std::string &scratch) {
+    if (offset < 2048) return std::to_string(offset) + "(sp)";
+    emit("li " + scratch + ", " + std::to_string(offset));
+    emit("add " + scratch + ", sp, " + scratch);
+    return "0(" + scratch + ")";
 }
 
 std::string CodeGen::newLabel(const std::string &base) {
     return base + "_" + std::to_string(labelCount++);
 }
 
+namespace {
+
+const int kNumTemps = 7;
+// 调用会破坏所有临时寄存器，含调用的子树视为需要无穷多寄存器，优先求值
+const int kCallNeed = 1000;
+// 写栈槽时计算大偏移地址用的寄存器：表达式求值期间 a 寄存器只在传参到 call 之间被占用
+const char *const kStoreScratch = "a7";
+
+bool isTemp(const std::string &reg) {
+    return reg.size() == 2 && reg[0] == 't';
+}
+
+bool isImm12(long long v) {
+    return v >= -2048 && v <= 2047;
+}
+
+bool isZeroConst(Expr *expr) {
+    auto num = dynamic_cast<NumberExpr *>(expr);
+    return num && num->value == 0;
+}
+
+// 常量折叠之后恒真/恒假的条件
+bool isConstCondition(Expr *expr, bool &value) {
+    auto num = dynamic_cast<NumberExpr *>(expr);
+    if (num) value = num->value != 0;
+    return num != nullptr;
+}
+
+bool containsCall(Expr *expr) {
+    if (dynamic_cast<CallExpr *>(expr)) return true;
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) return containsCall(unary->operand.get());
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) return containsCall(bin->lhs.get()) || containsCall(bin->rhs.get());
+    return false;
+}
+
+// Sethi–Ullman 编号：不溢出地求值该子树所需的寄存器数
+int regNeed(Expr *expr) {
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        int l = regNeed(bin->lhs.get()), r = regNeed(bin->rhs.get());
+        // && 和 || 按分支求值，两边不会同时占用寄存器
+        if (bin->op == "&&" || bin->op == "||") return std::max(l, r);
+        return l == r ? l + 1 : std::max(l, r);
+    }
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) return regNeed(unary->operand.get());
+    if (dynamic_cast<CallExpr *>(expr)) return kCallNeed;
+    return 1;
+}
+
+} // namespace
+
+std::string CodeGen::allocTemp() {
+    for (int i = 0; i < kNumTemps; i++) {
+        if (!tempBusy[i]) {
+            tempBusy[i] = true;
+            return "t" + std::to_string(i);
+        }
+    }
+    throw std::runtime_error("codegen: temporary register pool exhausted");
+}
+
+void CodeGen::freeTemp(const std::string &reg) {
+    if (isTemp(reg)) tempBusy[reg[1] - '0'] = false;
+}
+
+int CodeGen::freeTempCount() const {
+    return (int)std::count(tempBusy, tempBusy + kNumTemps, false);
+}
+
+int CodeGen::allocSpillSlot() {
+    int offset = 4 * (slotCount + spillDepth++);
+    maxSpillDepth = std::max(maxSpillDepth, spillDepth);
+    return offset;
+}
+
+// 12 位以内用 li（即 addi rd, x0, imm），更大的常量拆成 lui 高 20 位加 addi 带符号的低 12 位
+void CodeGen::emitLoadImm(const std::string &reg, int value) {
+    if (isImm12(value)) {
+        emit("li " + reg + ", " + std::to_string(value));
+        return;
+    }
+    uint32_t hi = (((uint32_t)value + 0x800) >> 12) & 0xfffff;
+    int lo = (int)((uint32_t)value - (hi << 12));
+    emit("lui " + reg + ", " + std::to_string(hi));
+    if (lo != 0) emit("addi " + reg + ", " + reg + ", " + std::to_string(lo));
+}
+
+bool CodeGen::genBinaryImm(BinaryExpr *bin, std::string &reg) {
+    // 常量在左边时：可交换的运算直接换边，比较翻转方向
+    static const std::unordered_map<std::string, std::string> flipped = {
+        {"+", "+"}, {"*", "*"}, {"==", "=="}, {"!=", "!="},
+        {"<", ">"}, {">", "<"}, {"<=", ">="}, {">=", "<="},
+    };
+    std::string op = bin->op;
+    Expr *x = bin->lhs.get();
+    auto num = dynamic_cast<NumberExpr *>(bin->rhs.get());
+    if (!num) {
+        auto it = flipped.find(op);
+        num = dynamic_cast<NumberExpr *>(bin->lhs.get());
+        if (!num || it == flipped.end()) return false;
+        op = it->second;
+        x = bin->rhs.get();
+    }
+    long long k = num->value;
+    bool ok = false;
+    if (op == "+" || op == "<" || op == ">=" || op == "==" || op == "!=") ok = isImm12(k);
+    else if (op == "-") ok = isImm12(-k);
+    else if (op == "<=" || op == ">") ok = isImm12(k + 1);
+    else if (op == "*") ok = k > 0 && (k & (k - 1)) == 0;
+    if (!ok) return false;
+
+    reg = genExpr(x);
+    auto ri = [&](const std::string &name, long long imm) {
+        emit(name + " " + reg + ", " + reg + ", " + std::to_string(imm));
+    };
+    if (op == "+") {
+        ri("addi", k);
+    } else if (op == "-") {
+        ri("addi", -k);
+    } else if (op == "*") {
+        int shift = 0;
+        while ((1LL << shift) < k) shift++;
+        ri("slli", shift);
+    } else if (op == "<") {
+        ri("slti", k);
+    } else if (op == "<=") {
+        // x <= k 即 x < k+1
+        ri("slti", k + 1);
+    } else if (op == ">") {
+        ri("slti", k + 1);
+        ri("xori", 1);
+    } else if (op == ">=") {
+        ri("slti", k);
+        ri("xori", 1);
+    } else {
+        if (k != 0) ri("xori", k);
+        emit((op == "==" ? "seqz " : "snez ") + reg + ", " + reg);
+    }
+    return true;
+}
+
+std::pair<std::string, std::string> CodeGen::genOperands(Expr *lhs, Expr *rhs) {
+    // 两边需要的寄存器一样多时保持从左到右的求值顺序
+    bool rhsFirst = regNeed(rhs) > regNeed(lhs);
+    Expr *first = rhsFirst ? rhs : lhs;
+    Expr *second = rhsFirst ? lhs : rhs;
+
+    std::string firstReg = genExpr(first);
+    int spillOffset = -1;
+    if (freeTempCount() == 0) {
+        // 寄存器池用完：先把第一个结果放进溢出槽，求值完另一边再装回 a0
+        spillOffset = allocSpillSlot();
+        emit("sw " + firstReg + ", " + slotRef(spillOffset, kStoreScratch));
+        freeTemp(firstReg);
+    }
+    std::string secondReg = genExpr(second);
+    if (spillOffset >= 0) {
+        firstReg = "a0";
+        emit("lw a0, " + slotRef(spillOffset, "a0"));
+        spillDepth--;
+    }
+    return rhsFirst ? std::make_pair(secondReg, firstReg) : std::make_pair(firstReg, secondReg);
+}
+
+std::string CodeGen::genCall(CallExpr *call) {
+    size_t n = call->args.size();
+    if (n > 8) {
+        std::cerr << "Error: Function call has too many arguments (max 8)" << std::endl;
+        return allocTemp();
+    }
+    // 先把所有实参求值到临时寄存器里（池满时放进溢出槽），最后再一起搬进 a0-a7
+    int spillBase = spillDepth;
+    std::vector<std::string> argRegs(n);
+    std::vector<int> argSlots(n, -1);
+    for (size_t i = 0; i < n; i++) {
+        std::string reg = genExpr(call->args[i].get());
+        if (i + 1 < n && freeTempCount() == 0) {
+            argSlots[i] = allocSpillSlot();
+            emit("sw " + reg + ", " + slotRef(argSlots[i], kStoreScratch));
+            freeTemp(reg);
+        } else {
+            argRegs[i] = reg;
+        }
+    }
+    // 外层表达式仍在使用的临时寄存器是调用者保存的，跨调用要存到溢出槽里
+    std::vector<std::pair<std::string, int>> saved;
+    for (int i = 0; i < kNumTemps; i++) {
+        std::string reg = "t" + std::to_string(i);
+        if (!tempBusy[i] || std::find(argRegs.begin(), argRegs.end(), reg) != argRegs.end()) continue;
+        saved.emplace_back(reg, allocSpillSlot());
+        emit("sw " + reg + ", " + slotRef(saved.back().second, kStoreScratch));
+    }
+    for (size_t i = 0; i < n; i++) {
+        std::string argReg = "a" + std::to_string(i);
+        if (argSlots[i] >= 0) {
+            emit("lw " + argReg + ", " + slotRef(argSlots[i], argReg));
+        } else {
+            emit("mv " + argReg + ", " + argRegs[i]);
+            freeTemp(argRegs[i]);
+        }
+    }
+    emit("call " + call->callee);
+    hasCall = true;
+    for (auto &[reg, offset] : saved) emit("lw " + reg + ", " + slotRef(offset, reg));
+    spillDepth = spillBase;
+
+    std::string result = allocTemp();
+    emit("mv " + result + ", a0");
+    return result;
+}
+
 std::string CodeGen::genExpr(Expr *expr) {
     if (auto num = dynamic_cast<NumberExpr *>(expr)) {
-        emit("li a0, " + std::to_string(num->value));
-        return "a0";
+        std::string reg = allocTemp();
+        emitLoadImm(reg, num->value);
+        return reg;
     } else if (auto var = dynamic_cast<VarExpr *>(expr)) {
-        if (localVarOffset.count(var->name) == 0) {
+        std::string reg = allocTemp();
+        int offset = lookupVar(var->name);
+        if (offset < 0) {
             std::cerr << "Error: Variable '" << var->name << "' not found" << std::endl;
-            return "a0";
+            return reg;
         }
-        int offset = localVarOffset[var->name];
-        emit("lw a0, " + std::to_string(offset) + "(sp)");
-        return "a0";
+        emit("lw " + reg + ", " + slotRef(offset, reg));
+        return reg;
     } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
-        genExpr(bin->lhs.get());
-        emit("mv t0, a0");
-        genExpr(bin->rhs.get());
+        if (bin->op == "&&" || bin->op == "||") {
+            std::string falseLabel = newLabel("logic_false");
+            std::string endLabel = newLabel("logic_end");
+            genBranch(bin, falseLabel, false);
+            // genBranch 结束后不占用临时寄存器，两条路径上分到的是同一个寄存器
+            std::string reg = allocTemp();
+            emit("li " + reg + ", 1");
+            emit("j " + endLabel);
+            emit(falseLabel + ":");
+            emit("li " + reg + ", 0");
+            emit(endLabel + ":");
+            return reg;
+        }
+
+        std::string immReg;
+        if (genBinaryImm(bin, immReg)) return immReg;
 
+        auto [lhs, rhs] = genOperands(bin->lhs.get(), bin->rhs.get());
+        // 结果写回其中一个临时寄存器（另一个可能是装回溢出值的 a0）
+        std::string dst = isTemp(lhs) ? lhs : rhs;
+        std::string ops = dst + ", " + lhs + ", " + rhs;
         if (bin->op == "+") {
-            emit("add a0, t0, a0");
+            emit("add " + ops);
         } else if (bin->op == "-") {
-            emit("sub a0, t0, a0");
+            emit("sub " + ops);
         } else if (bin->op == "*") {
-            emit("mul a0, t0, a0");
+            emit("mul " + ops);
         } else if (bin->op == "/") {
-            emit("div a0, t0, a0");
+            emit("div " + ops);
         } else if (bin->op == "%") {
-            emit("rem a0, t0, a0");
+            emit("rem " + ops);
         } else if (bin->op == "<") {
-            emit("slt a0, t0, a0");
+            emit("slt " + ops);
         } else if (bin->op == ">") {
-            emit("sgt a0, t0, a0");
+            emit("sgt " + ops);
         } else if (bin->op == "<=") {
-            emit("sgt a0, a0, t0");
-            emit("xori a0, a0, 1");
+            emit("sgt " + ops);
+            emit("xori " + dst + ", " + dst + ", 1");
         } else if (bin->op == ">=") {
-            emit("slt a0, a0, t0");
-            emit("xori a0, a0, 1");
+            emit("slt " + ops);
+            emit("xori " + dst + ", " + dst + ", 1");
         } else if (bin->op == "==") {
-            emit("sub a0, t0, a0");
-            emit("seqz a0, a0");
+            emit("sub " + ops);
+            emit("seqz " + dst + ", " + dst);
         } else if (bin->op == "!=") {
-            emit("sub a0, t0, a0");
-            emit("snez a0, a0");
+            emit("sub " + ops);
+            emit("snez " + dst + ", " + dst);
         } else {
             std::cerr << "Warning: Unsupported binary operator '" << bin->op << "'" << std::endl;
-            emit("add a0, t0, a0"); // 默认加法
+            emit("add " + ops); // 默认加法
         }
-        return "a0";
+        freeTemp(dst == lhs ? rhs : lhs);
+        return dst;
     } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
-        if (call->args.size() > 8) {
-            std::cerr << "Error: Function call has too many arguments (max 8)" << std::endl;
-            return "a0";
-        }
-        for (size_t i = 0; i < call->args.size(); i++) {
-            genExpr(call->args[i].get());
-            emit("mv a" + std::to_string(i) + ", a0");
-        }
-        emit("call " + call->callee);
-        return "a0";
+        return genCall(call);
     } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
-        genExpr(unary->operand.get());
+        std::string reg = genExpr(unary->operand.get());
         if (unary->op == "-") {
-            emit("neg a0, a0");
+            emit("neg " + reg + ", " + reg);
         } else if (unary->op == "!") {
-            emit("seqz a0, a0");
+            emit("seqz " + reg + ", " + reg);
         } else {
             std::cerr << "Warning: Unsupported unary operator '" << unary->op << "'" << std::endl;
         }
-        return "a0";
+        return reg;
     }
     std::cerr << "Warning: Unknown expression type" << std::endl;
-    return "a0";
+    return allocTemp();
+}
+
+void CodeGen::genDiscarded(Expr *expr) {
+    if (!containsCall(expr)) return;
+    if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        freeTemp(genCall(call));
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        genDiscarded(unary->operand.get());
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        if (bin->op == "&&" || bin->op == "||") {
+            // 右边的调用只在短路不成立时执行
+            std::string skip = newLabel("logic_end");
+            genBranch(bin->lhs.get(), skip, bin->op == "||");
+            genDiscarded(bin->rhs.get());
+            emit(skip + ":");
+        } else {
+            genDiscarded(bin->lhs.get());
+            genDiscarded(bin->rhs.get());
+        }
+    }
+}
+
+void CodeGen::genBranch(Expr *expr, const std::string &label, bool jumpIfTrue) {
+    if (auto num = dynamic_cast<NumberExpr *>(expr)) {
+        if ((num->value != 0) == jumpIfTrue) emit("j " + label);
+        return;
+    }
+    if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        if (unary->op == "!") {
+            genBranch(unary->operand.get(), label, !jumpIfTrue);
+            return;
+        }
+    }
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        // a && b 为真时两边都要求值；为假时左边为假即可跳走
+        if (bin->op == "&&" || bin->op == "||") {
+            bool isAnd = bin->op == "&&";
+            if (isAnd != jumpIfTrue) {
+                genBranch(bin->lhs.get(), label, jumpIfTrue);
+                genBranch(bin->rhs.get(), label, jumpIfTrue);
+            } else {
+                std::string skip = newLabel(isAnd ? "and_skip" : "or_skip");
+                genBranch(bin->lhs.get(), skip, !jumpIfTrue);
+                genBranch(bin->rhs.get(), label, jumpIfTrue);
+                emit(skip + ":");
+            }
+            return;
+        }
+        // 比较：分支指令、取反形式，以及是否交换左右操作数
+        struct BranchOp {
+            const char *op, *inverse;
+            bool swap;
+        };
+        static const std::unordered_map<std::string, BranchOp> branchOps = {
+            {"<", {"blt", "bge", false}}, {">=", {"bge", "blt", false}},
+            {">", {"blt", "bge", true}},  {"<=", {"bge", "blt", true}},
+            {"==", {"beq", "bne", false}}, {"!=", {"bne", "beq", false}},
+        };
+        auto it = branchOps.find(bin->op);
+        if (it != branchOps.end()) {
+            // 和 0 比较时直接用 x0
+            std::string lhs = "zero", rhs = "zero";
+            if (isZeroConst(bin->rhs.get())) lhs = genExpr(bin->lhs.get());
+            else if (isZeroConst(bin->lhs.get())) rhs = genExpr(bin->rhs.get());
+            else std::tie(lhs, rhs) = genOperands(bin->lhs.get(), bin->rhs.get());
+            const BranchOp &b = it->second;
+            std::string ops = b.swap ? rhs + ", " + lhs : lhs + ", " + rhs;
+            emit(std::string(jumpIfTrue ? b.op : b.inverse) + " " + ops + ", " + label);
+            freeTemp(lhs);
+            freeTemp(rhs);
+            return;
+        }
+    }
+    std::string reg = genExpr(expr);
+    emit((jumpIfTrue ? "bnez " : "beqz ") + reg + ", " + label);
+    freeTemp(reg);
 }
 
 void CodeGen::genFunc(FuncDef *func) {
-    localVarOffset.clear();
-    int offset = 0;
+    scopes.clear();
+    body.clear();
+    hasCall = false;
+    spillDepth = maxSpillDepth = 0;
+    assignSlots(func);
 
     out << ".globl " << func->name << "\n";
     out << func->name << ":\n";
 
-    emit("addi sp, sp, -128"); // 分配栈空间
-
     // 参数保存
+    scopes.emplace_back();
     for (size_t i = 0; i < func->params.size(); i++) {
-        offset -= 4;
-        localVarOffset[func->params[i].name] = offset;
-        emit("sw a" + std::to_string(i) + ", " + std::to_string(offset) + "(sp)");
+        int offset = paramSlot[i];
+        scopes.back()[func->params[i].name] = offset;
+        // 此时 a0-a7 都可能是参数，大偏移用 t0 算地址
+        emit("sw a" + std::to_string(i) + ", " + slotRef(offset, "t0"));
     }
 
+    reachable = true;
     genBlock(func->body.get());
+    scopes.pop_back();
+    // 所有路径都已经 return 时不需要落到末尾的尾声
+    if (reachable) emitReturn();
+    flushFunction();
+}
+
+// 函数体中是否用到了 s<reg>（标签和调用目标不算）
+static bool usesCalleeSaved(const std::string &line, int reg) {
+    if (line.back() == ':' || line.rfind("call ", 0) == 0 || line.rfind("j ", 0) == 0) return false;
+    auto isIdent = [](char c) { return std::isalnum((unsigned char)c) || c == '_' || c == '.'; };
+    std::string name = "s" + std::to_string(reg);
+    for (size_t pos = line.find(name); pos != std::string::npos; pos = line.find(name, pos + 1)) {
+        bool startOk = pos == 0 || !isIdent(line[pos - 1]);
+        size_t end = pos + name.size();
+        bool endOk = end == line.size() || !isIdent(line[end]);
+        if (startOk && endOk) return true;
+    }
+    return false;
+}
+
+// 帧布局：[sp, sp+4*slotCount) 放局部变量，其上是表达式求值的溢出槽，顶部依次保存 ra 和用到的被调用者保存寄存器，
+// 总大小按 16 字节对齐；不需要栈的叶子函数不建立栈帧
+void CodeGen::flushFunction() {
+    std::vector<std::string> saved;
+    if (hasCall) saved.push_back("ra");
+    for (int r = 0; r <= 11; r++) {
+        for (auto &line : body) {
+            if (line != kEpilogueMarker && usesCalleeSaved(line, r)) {
+                saved.push_back("s" + std::to_string(r));
+                break;
+            }
+        }
+    }
+    int frameSize = ((slotCount + maxSpillDepth) * 4 + (int)saved.size() * 4 + 15) & ~15;
+
+    auto adjustSp = [&](int amount) {
+        if (amount >= -2048 && amount < 2048) {
+            out << "\taddi sp, sp, " << amount << "\n";
+        } else {
+            out << "\tli t0, " << amount << "\n";
+            out << "\tadd sp, sp, t0\n";
+        }
+    };
+    auto saveOrRestore = [&](const char *op, const std::string &reg, int offset) {
+        if (offset < 2048) {
+            out << "\t" << op << " " << reg << ", " << offset << "(sp)\n";
+        } else {
+            out << "\tli t0, " << offset << "\n";
+            out << "\tadd t0, sp, t0\n";
+            out << "\t" << op << " " << reg << ", 0(t0)\n";
+        }
+    };
 
-    emit("addi sp, sp, 128");
-    emit("ret");
+    if (frameSize > 0) {
+        adjustSp(-frameSize);
+        for (size_t i = 0; i < saved.size(); i++) saveOrRestore("sw", saved[i], frameSize - 4 * (int)(i + 1));
+    }
+    for (auto &line : body) {
+        if (line != kEpilogueMarker) {
+            out << "\t" << line << "\n";
+            continue;
+        }
+        if (frameSize > 0) {
+            // 尾声里 a0 是返回值，t0 可以用作临时寄存器
+            for (size_t i = 0; i < saved.size(); i++) saveOrRestore("lw", saved[i], frameSize - 4 * (int)(i + 1));
+            adjustSp(frameSize);
+        }
+        out << "\tret\n";
+    }
+    body.clear();
 }
 
 void CodeGen::genBlock(Block *block) {
+    scopes.emplace_back();
     for (auto &stmt : block->stmts) {
         genStmt(stmt.get());
     }
+    scopes.pop_back();
 }
 
 void CodeGen::genStmt(Stmt *stmt) {
+    // return、break、continue 之后的语句永远不会执行
+    if (!reachable) return;
+    bool cond;
     if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
-        int offset = localVarOffset.size() * -4 - 4;
-        localVarOffset[decl->name] = offset;
+        int offset = declSlot.at(decl);
+        scopes.back()[decl->name] = offset;
         if (decl->initializer) {
-            genExpr(decl->initializer.get());
-            emit("sw a0, " + std::to_string(offset) + "(sp)");
+            std::string reg = isZeroConst(decl->initializer.get()) ? "zero" : genExpr(decl->initializer.get());
+            emit("sw " + reg + ", " + slotRef(offset, kStoreScratch));
+            freeTemp(reg);
         }
     } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
-        int offset = localVarOffset[assign->name];
-        genExpr(assign->value.get());
-        emit("sw a0, " + std::to_string(offset) + "(sp)");
+        int offset = lookupVar(assign->name);
+        if (offset < 0) {
+            std::cerr << "Error: Variable '" << assign->name << "' not found" << std::endl;
+            return;
+        }
+        std::string reg = isZeroConst(assign->value.get()) ? "zero" : genExpr(assign->value.get());
+        emit("sw " + reg + ", " + slotRef(offset, kStoreScratch));
+        freeTemp(reg);
     } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
-        genExpr(exprStmt->expr.get());
+        if (eliminateDeadCode) genDiscarded(exprStmt->expr.get());
+        else freeTemp(genExpr(exprStmt->expr.get()));
     } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
-        if (ret->expr) genExpr(ret->expr.get());
-        emit("addi sp, sp, 128");
-        emit("ret");
+        if (ret->expr) {
+            std::string reg = genExpr(ret->expr.get());
+            emit("mv a0, " + reg);
+            freeTemp(reg);
+        }
+        emitReturn();
+        markUnreachable();
     } else if (auto block = dynamic_cast<Block *>(stmt)) {
         genBlock(block);
     } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        if (eliminateDeadCode && isConstCondition(ifStmt->condition.get(), cond)) {
+            // 条件恒定：只生成会执行的那一边
+            Block *taken = cond ? ifStmt->thenBlock.get() : ifStmt->elseBlock.get();
+            if (taken) genBlock(taken);
+            return;
+        }
+        if (eliminateDeadCode && !ifStmt->elseBlock) {
+            std::string endLabel = newLabel("endif");
+            genBranch(ifStmt->condition.get(), endLabel, false);
+            genBlock(ifStmt->thenBlock.get());
+            emit(endLabel + ":");
+            reachable = true;
+            return;
+        }
         std::string elseLabel = newLabel("else");
         std::string endLabel = newLabel("endif");
 
-        genExpr(ifStmt->condition.get());
-        emit("beqz a0, " + elseLabel);
+        genBranch(ifStmt->condition.get(), elseLabel, false);
         genBlock(ifStmt->thenBlock.get());
-        emit("j " + endLabel);
+        bool thenFallsThrough = reachable;
+        // then 分支以 return 等结尾时不需要跳过 else
+        if (thenFallsThrough) emit("j " + endLabel);
         emit(elseLabel + ":");
+        reachable = true;
         if (ifStmt->elseBlock) genBlock(ifStmt->elseBlock.get());
-        emit(endLabel + ":");
+        if (thenFallsThrough || reachable) emit(endLabel + ":");
+        reachable = thenFallsThrough || reachable;
     } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        bool constCond = eliminateDeadCode && isConstCondition(whileStmt->condition.get(), cond);
+        if (constCond && !cond) return;     // 循环体一次也不执行
         std::string loopLabel = newLabel("loop");
         std::string endLabel = newLabel("endloop");
+        // 轮转为受保护的 do-while：入口先判断一次，continue 跳到底部的判断，条件成立时跳回循环体
+        std::string condLabel = rotateLoops ? newLabel("loopcond") : loopLabel;
+
+        breakLabels.push(endLabel);
+        continueLabels.push(condLabel);
+        breakReached.push(false);
+        continueReached.push(false);
+
+        if (rotateLoops && !constCond) genBranch(whileStmt->condition.get(), endLabel, false);
+        if (loopAlign > 0) emit(".p2align " + std::to_string(loopAlign));
         emit(loopLabel + ":");
-        genExpr(whileStmt->condition.get());
-        emit("beqz a0, " + endLabel);
+        if (!rotateLoops && !constCond) genBranch(whileStmt->condition.get(), endLabel, false);
         genBlock(whileStmt->body.get());
-        emit("j " + loopLabel);
-        emit(endLabel + ":");
-    } else if (auto *breakStmt = dynamic_cast<BreakStmt*>(stmt)) {
+        if (rotateLoops) {
+            if (reachable || continueReached.top()) {
+                emit(condLabel + ":");
+                reachable = true;
+                if (constCond) emit("j " + loopLabel);
+                else genBranch(whileStmt->condition.get(), loopLabel, true);
+            }
+        } else if (reachable) {
+            emit("j " + loopLabel);
+        }
+        // while (1) 只能从 break 离开
+        reachable = !constCond || breakReached.top();
+        if (reachable) emit(endLabel + ":");
+
+        breakLabels.pop();
+        continueLabels.pop();
+        breakReached.pop();
+        continueReached.pop();
+    } else if (dynamic_cast<BreakStmt*>(stmt)) {
         if (breakLabels.empty()) {
             std::cerr << "Warning: break statement outside of loop" << std::endl;
             return;
         }
         emit("j " + breakLabels.top());
-    } else if (auto *continueStmt = dynamic_cast<ContinueStmt*>(stmt)) {
+        breakReached.top() = true;
+        markUnreachable();
+    } else if (dynamic_cast<ContinueStmt*>(stmt)) {
         if (continueLabels.empty()) {
             std::cerr << "Warning: continue statement outside of loop" << std::endl;
             return;
         }
         emit("j " + continueLabels.top());
+        continueReached.top() = true;
+        markUnreachable();
     } else {
         // 未知语句类型，跳过而不是断言失败
         std::cerr << "Warning: Unknown statement type in codegen" << std::endl;
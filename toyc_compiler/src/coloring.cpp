@@ -0,0 +1,396 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <unordered_set>
+
+namespace mir {
+
+namespace {
+
+// 按 Appel《Modern Compiler Implementation》中的迭代寄存器合并实现，结点与移动各自记录所在的工作表
+class GraphColoring {
+public:
+    explicit GraphColoring(MFunction &f) : func(f) {}
+
+    void run() {
+        func.rebuildCFG();
+        func.computeLoopDepth();
+        for (int round = 0;; round++) {
+            if (round > 32) throw std::runtime_error("register allocation did not converge in '" + func.name + "'");
+            init();
+            build();
+            makeWorklist();
+            while (true) {
+                if (!simplifyWorklist.empty()) simplify();
+                else if (!worklistMoves.empty()) coalesce();
+                else if (!freezeWorklist.empty()) freeze();
+                else if (!spillWorklist.empty()) selectSpill();
+                else break;
+            }
+            assignColors();
+            if (spilledNodes.empty()) break;
+            for (int v : spilledNodes) {
+                for (int t : spillVirtReg(func, v)) noSpill.insert(t);
+            }
+        }
+        rewrite();
+    }
+
+private:
+    enum class NodeState { Precolored, Initial, Simplify, Freeze, Spill, Spilled, Coalesced, Colored, OnStack };
+    enum class MoveState { Worklist, Active, Coalesced, Constrained, Frozen };
+    static constexpr int kInfiniteDegree = std::numeric_limits<int>::max() / 2;
+
+    MFunction &func;
+    int K = 0;
+    int numNodes = 0;
+    std::unordered_set<int> noSpill;
+
+    std::vector<NodeState> state;
+    std::vector<std::vector<int>> adjList;
+    std::unordered_set<long long> adjSet;
+    std::vector<int> degree, alias, color;
+    std::vector<std::vector<int>> moveList;     // 结点 -> 相关的移动下标
+    std::vector<double> spillWeight;
+
+    std::vector<std::pair<int, int>> moves;     // (dst, src)
+    std::vector<MoveState> moveState;
+
+    std::set<int> simplifyWorklist, freezeWorklist, spillWorklist;
+    std::set<int> worklistMoves;
+    std::vector<int> selectStack, spilledNodes, coalescedNodes;
+
+    static bool isNode(int r) { return isVirtReg(r) || isAllocatable(r); }
+    bool precolored(int n) const { return state[n] == NodeState::Precolored; }
+    long long edgeKey(int u, int v) const { return (long long)u * numNodes + v; }
+
+    void init() {
+        K = (int)(callerSavedOrder().size() + calleeSavedOrder().size());
+        numNodes = func.nextVReg;
+        state.assign(numNodes, NodeState::Initial);
+        adjList.assign(numNodes, {});
+        adjSet.clear();
+        degree.assign(numNodes, 0);
+        alias.assign(numNodes, -1);
+        color.assign(numNodes, -1);
+        moveList.assign(numNodes, {});
+        spillWeight.assign(numNodes, 0);
+        moves.clear();
+        moveState.clear();
+        simplifyWorklist.clear();
+        freezeWorklist.clear();
+        spillWorklist.clear();
+        worklistMoves.clear();
+        selectStack.clear();
+        spilledNodes.clear();
+        coalescedNodes.clear();
+        for (int r = 0; r < kNumPhysRegs; r++) {
+            state[r] = NodeState::Precolored;
+            degree[r] = kInfiniteDegree;
+            color[r] = r;
+        }
+    }
+
+    void addEdge(int u, int v) {
+        if (u == v || adjSet.count(edgeKey(u, v))) return;
+        adjSet.insert(edgeKey(u, v));
+        adjSet.insert(edgeKey(v, u));
+        if (!precolored(u)) {
+            adjList[u].push_back(v);
+            degree[u]++;
+        }
+        if (!precolored(v)) {
+            adjList[v].push_back(u);
+            degree[v]++;
+        }
+    }
+
+    void build() {
+        BlockLiveness live = computeBlockLiveness(func);
+        std::vector<bool> seen(numNodes, false);
+        std::vector<int> defs, uses;
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            MBlock &bb = *func.blocks[b];
+            double w = std::pow(10.0, std::min(bb.loopDepth, 6));
+            std::unordered_set<int> liveNow;
+            for (int r = 0; r < numNodes; r++) {
+                if (live.liveOut[b][r] && isNode(r)) liveNow.insert(r);
+            }
+            for (auto it = bb.instrs.rbegin(); it != bb.instrs.rend(); ++it) {
+                const MInstr &instr = *it;
+                instr.getDefs(defs);
+                instr.getUses(uses);
+                if (instr.isCopy() && isNode(instr.ops[0].reg) && isNode(instr.ops[1].reg)) {
+                    int d = instr.ops[0].reg, s = instr.ops[1].reg;
+                    liveNow.erase(s);
+                    int m = (int)moves.size();
+                    moves.push_back({d, s});
+                    moveState.push_back(MoveState::Worklist);
+                    worklistMoves.insert(m);
+                    moveList[d].push_back(m);
+                    if (s != d) moveList[s].push_back(m);
+                }
+                for (int d : defs) {
+                    if (!isNode(d)) continue;
+                    liveNow.insert(d);
+                }
+                for (int d : defs) {
+                    if (!isNode(d)) continue;
+                    for (int l : liveNow) addEdge(l, d);
+                }
+                for (int d : defs) liveNow.erase(d);
+                for (int u : uses) {
+                    if (isNode(u)) liveNow.insert(u);
+                }
+                for (int r : defs) {
+                    if (isVirtReg(r)) {
+                        spillWeight[r] += w;
+                        seen[r] = true;
+                    }
+                }
+                for (int r : uses) {
+                    if (isVirtReg(r)) {
+                        spillWeight[r] += w;
+                        seen[r] = true;
+                    }
+                }
+            }
+        }
+        for (int r = kFirstVirtReg; r < numNodes; r++) {
+            if (!seen[r]) state[r] = NodeState::Colored;   // 未出现的编号不参与分配
+            if (noSpill.count(r)) spillWeight[r] = std::numeric_limits<double>::infinity();
+        }
+    }
+
+    std::vector<int> nodeMoves(int n) const {
+        std::vector<int> result;
+        for (int m : moveList[n]) {
+            if (moveState[m] == MoveState::Active || moveState[m] == MoveState::Worklist) result.push_back(m);
+        }
+        return result;
+    }
+    bool moveRelated(int n) const {
+        for (int m : moveList[n]) {
+            if (moveState[m] == MoveState::Active || moveState[m] == MoveState::Worklist) return true;
+        }
+        return false;
+    }
+    std::vector<int> adjacent(int n) const {
+        std::vector<int> result;
+        for (int m : adjList[n]) {
+            if (state[m] != NodeState::OnStack && state[m] != NodeState::Coalesced) result.push_back(m);
+        }
+        return result;
+    }
+
+    void setState(int n, NodeState s) {
+        switch (state[n]) {
+            case NodeState::Simplify: simplifyWorklist.erase(n); break;
+            case NodeState::Freeze: freezeWorklist.erase(n); break;
+            case NodeState::Spill: spillWorklist.erase(n); break;
+            default: break;
+        }
+        state[n] = s;
+        switch (s) {
+            case NodeState::Simplify: simplifyWorklist.insert(n); break;
+            case NodeState::Freeze: freezeWorklist.insert(n); break;
+            case NodeState::Spill: spillWorklist.insert(n); break;
+            default: break;
+        }
+    }
+
+    void makeWorklist() {
+        for (int n = kFirstVirtReg; n < numNodes; n++) {
+            if (state[n] != NodeState::Initial) continue;
+            if (degree[n] >= K) setState(n, NodeState::Spill);
+            else if (moveRelated(n)) setState(n, NodeState::Freeze);
+            else setState(n, NodeState::Simplify);
+        }
+    }
+
+    void enableMoves(int n) {
+        for (int m : nodeMoves(n)) {
+            if (moveState[m] == MoveState::Active) {
+                moveState[m] = MoveState::Worklist;
+                worklistMoves.insert(m);
+            }
+        }
+    }
+
+    void decrementDegree(int m) {
+        if (precolored(m)) return;
+        int d = degree[m]--;
+        if (d != K) return;
+        enableMoves(m);
+        for (int a : adjacent(m)) enableMoves(a);
+        setState(m, moveRelated(m) ? NodeState::Freeze : NodeState::Simplify);
+    }
+
+    void simplify() {
+        int n = *simplifyWorklist.begin();
+        setState(n, NodeState::OnStack);
+        selectStack.push_back(n);
+        for (int m : adjacent(n)) decrementDegree(m);
+    }
+
+    int getAlias(int n) const {
+        while (state[n] == NodeState::Coalesced) n = alias[n];
+        return n;
+    }
+
+    void addWorkList(int u) {
+        if (!precolored(u) && !moveRelated(u) && degree[u] < K) setState(u, NodeState::Simplify);
+    }
+
+    bool ok(int t, int r) const {
+        return degree[t] < K || precolored(t) || adjSet.count(edgeKey(t, r));
+    }
+
+    // Briggs：合并后高度数邻居少于 K 个
+    bool conservative(const std::vector<int> &nodes) const {
+        std::unordered_set<int> distinct(nodes.begin(), nodes.end());
+        int k = 0;
+        for (int n : distinct) {
+            if (degree[n] >= K) k++;
+        }
+        return k < K;
+    }
+
+    void combine(int u, int v) {
+        setState(v, NodeState::Coalesced);
+        coalescedNodes.push_back(v);
+        alias[v] = u;
+        moveList[u].insert(moveList[u].end(), moveList[v].begin(), moveList[v].end());
+        enableMoves(v);
+        for (int t : adjacent(v)) {
+            addEdge(t, u);
+            decrementDegree(t);
+        }
+        if (degree[u] >= K && state[u] == NodeState::Freeze) setState(u, NodeState::Spill);
+    }
+
+    void coalesce() {
+        int m = *worklistMoves.begin();
+        worklistMoves.erase(m);
+        int x = getAlias(moves[m].first), y = getAlias(moves[m].second);
+        int u = x, v = y;
+        if (precolored(y)) std::swap(u, v);
+        if (u == v) {
+            moveState[m] = MoveState::Coalesced;
+            addWorkList(u);
+        } else if (precolored(v) || adjSet.count(edgeKey(u, v))) {
+            moveState[m] = MoveState::Constrained;
+            addWorkList(u);
+            addWorkList(v);
+        } else {
+            bool canCombine;
+            if (precolored(u)) {
+                // George：v 的每个邻居要么度数小、要么已与 u 干涉
+                canCombine = isAllocatable(u);
+                for (int t : adjacent(v)) canCombine = canCombine && ok(t, u);
+            } else {
+                std::vector<int> nodes = adjacent(u);
+                auto adjV = adjacent(v);
+                nodes.insert(nodes.end(), adjV.begin(), adjV.end());
+                canCombine = conservative(nodes);
+            }
+            if (canCombine) {
+                moveState[m] = MoveState::Coalesced;
+                combine(u, v);
+                addWorkList(u);
+            } else {
+                moveState[m] = MoveState::Active;
+            }
+        }
+    }
+
+    void freezeMoves(int u) {
+        for (int m : nodeMoves(u)) {
+            int x = moves[m].first, y = moves[m].second;
+            int v = getAlias(y) == getAlias(u) ? getAlias(x) : getAlias(y);
+            if (moveState[m] == MoveState::Worklist) worklistMoves.erase(m);
+            moveState[m] = MoveState::Frozen;
+            if (!precolored(v) && !moveRelated(v) && degree[v] < K) setState(v, NodeState::Simplify);
+        }
+    }
+
+    void freeze() {
+        int u = *freezeWorklist.begin();
+        setState(u, NodeState::Simplify);
+        freezeMoves(u);
+    }
+
+    void selectSpill() {
+        int best = -1;
+        double bestCost = 0;
+        for (int n : spillWorklist) {
+            double cost = spillWeight[n] / std::max(degree[n], 1);
+            if (best < 0 || cost < bestCost) {
+                best = n;
+                bestCost = cost;
+            }
+        }
+        setState(best, NodeState::Simplify);
+        freezeMoves(best);
+    }
+
+    void assignColors() {
+        while (!selectStack.empty()) {
+            int n = selectStack.back();
+            selectStack.pop_back();
+            std::vector<bool> okColors(kNumPhysRegs, false);
+            for (int r = 0; r < kNumPhysRegs; r++) okColors[r] = isAllocatable(r);
+            for (int w : adjList[n]) {
+                int a = getAlias(w);
+                if (state[a] == NodeState::Colored || precolored(a)) {
+                    if (color[a] >= 0) okColors[color[a]] = false;
+                }
+            }
+            int chosen = -1;
+            for (const auto *regs : {&callerSavedOrder(), &calleeSavedOrder()}) {
+                for (int r : *regs) {
+                    if (chosen < 0 && okColors[r]) chosen = r;
+                }
+            }
+            if (chosen < 0) {
+                if (noSpill.count(n)) throw std::runtime_error("register allocation failed in '" + func.name + "'");
+                state[n] = NodeState::Spilled;
+                spilledNodes.push_back(n);
+            } else {
+                state[n] = NodeState::Colored;
+                color[n] = chosen;
+            }
+        }
+        for (int n : coalescedNodes) color[n] = color[getAlias(n)];
+    }
+
+    void rewrite() {
+        std::set<int> calleeUsed;
+        for (auto &bb : func.blocks) {
+            std::vector<MInstr> out;
+            for (auto &instr : bb->instrs) {
+                for (auto &o : instr.ops) {
+                    if ((o.isReg() || o.isMem()) && isVirtReg(o.reg)) o.reg = color[o.reg];
+                }
+                for (auto &o : instr.ops) {
+                    if (o.isReg() && isCalleeSaved(o.reg)) calleeUsed.insert(o.reg);
+                }
+                if (instr.isCopy() && instr.ops[0].reg == instr.ops[1].reg) continue;
+                out.push_back(std::move(instr));
+            }
+            bb->instrs = std::move(out);
+        }
+        func.usedCalleeSaved.assign(calleeUsed.begin(), calleeUsed.end());
+    }
+};
+
+} // namespace
+
+void allocateGraphColoring(MFunction &func) {
+    GraphColoring(func).run();
+}
+
+} // namespace mir
@@ -0,0 +1,103 @@
+#include "interp.h"
+#include "passes.h"
+#include <map>
+#include <ostream>
+
+namespace ir {
+
+namespace {
+
+void printReason(std::ostream &os, const EvalResult &result, long long maxSteps) {
+    switch (result.status) {
+        case EvalResult::Status::OutOfSteps: os << "step budget of " << maxSteps << " exhausted"; break;
+        case EvalResult::Status::External: os << "calls @" << result.detail; break;
+        case EvalResult::Status::Trap: os << result.detail; break;
+        case EvalResult::Status::Finished: break;
+    }
+}
+
+// main 整个换成返回常量
+void replaceWithConstant(Function &func, int value) {
+    func.blocks.clear();
+    func.slots.clear();
+    BasicBlock *entry = func.newBlock("entry");
+    Instr ret(Opcode::Ret);
+    if (func.retType == IRType::I32) ret.ops = {Value::imm(value)};
+    entry->instrs.push_back(ret);
+    func.rebuildCFG();
+}
+
+// 实参都是常量、在步数上限内执行完的调用换成结果。执行完说明这次调用没有碰运行时库，
+// 也就没有可观察的效果，可以整个删掉
+bool foldConstantCalls(Module &module, Function &func, long long maxSteps,
+                       std::map<std::pair<std::string, std::vector<int>>, EvalResult> &cache,
+                       std::ostream *remarks, ConstEvalStats *stats) {
+    bool changed = false;
+    for (auto &bb : func.blocks) {
+        for (size_t i = 0; i < bb->instrs.size(); i++) {
+            Instr &call = bb->instrs[i];
+            if (call.op != Opcode::Call || !module.getFunction(call.callee)) continue;
+            std::vector<int> args;
+            for (auto &v : call.ops) {
+                if (v.isImm()) args.push_back(v.num);
+            }
+            if (args.size() != call.ops.size()) continue;
+            auto key = std::make_pair(call.callee, args);
+            auto it = cache.find(key);
+            if (it == cache.end()) {
+                it = cache.emplace(key, evaluateFunction(module, call.callee, args, maxSteps)).first;
+                if (stats) stats->steps += it->second.steps;
+            }
+            const EvalResult &result = it->second;
+            if (!result.finished()) continue;
+            if (remarks) {
+                *remarks << "const-eval: @" << func.name << ": @" << call.callee << "(";
+                for (size_t k = 0; k < args.size(); k++) *remarks << (k ? ", " : "") << args[k];
+                *remarks << ") = " << result.value << " in " << result.steps << " steps\n";
+            }
+            if (stats) stats->callsFolded++;
+            changed = true;
+            if (call.dst < 0) {
+                bb->instrs.erase(bb->instrs.begin() + i--);
+                continue;
+            }
+            call.op = Opcode::Copy;
+            call.ops = {Value::imm(result.value)};
+            call.callee.clear();
+        }
+    }
+    if (changed) {
+        sparseConditionalConstantPropagation(func);
+        eliminateDeadCode(func, nullptr);
+        simplifyCFG(func);
+    }
+    return changed;
+}
+
+} // namespace
+
+bool evaluateAtCompileTime(Module &module, long long maxSteps, std::ostream *remarks, ConstEvalStats *stats) {
+    Function *main = module.getFunction("main");
+    if (!main || !main->paramNames.empty()) return false;
+    EvalResult whole = evaluateFunction(module, "main", {}, maxSteps);
+    if (stats) stats->steps += whole.steps;
+    if (whole.finished()) {
+        replaceWithConstant(*main, whole.value);
+        if (stats) stats->mainEvaluated = true;
+        if (remarks) *remarks << "const-eval: @main evaluated to " << whole.value << " in " << whole.steps << " steps\n";
+        return true;
+    }
+    if (remarks) {
+        *remarks << "const-eval: @main not evaluated: ";
+        printReason(*remarks, whole, maxSteps);
+        *remarks << "\n";
+    }
+
+    // 部分求值：同样的调用只执行一次
+    std::map<std::pair<std::string, std::vector<int>>, EvalResult> cache;
+    bool changed = false;
+    for (auto &f : module.functions) changed = foldConstantCalls(module, *f, maxSteps, cache, remarks, stats) || changed;
+    return changed;
+}
+
+} // namespace ir
@@ -0,0 +1,199 @@
+#include "passes.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+bool isPred(const BasicBlock *pred, const BasicBlock *bb) {
+    return std::find(bb->preds.begin(), bb->preds.end(), pred) != bb->preds.end();
+}
+
+void retarget(Instr &term, BasicBlock *from, BasicBlock *to) {
+    for (auto &target : term.blocks) {
+        if (target == from) target = to;
+    }
+}
+
+// phi 在 a、b 两条入边上的值是否都相同
+bool samePhiValues(const BasicBlock *bb, const BasicBlock *a, const BasicBlock *b) {
+    for (auto &phi : bb->instrs) {
+        if (phi.op != Opcode::Phi) break;
+        Value va, vb;
+        for (size_t i = 0; i < phi.blocks.size(); i++) {
+            if (phi.blocks[i] == a) va = phi.ops[i];
+            if (phi.blocks[i] == b) vb = phi.ops[i];
+        }
+        if (va != vb) return false;
+    }
+    return true;
+}
+
+// 只含 jmp 的空块：把前驱直接接到它的目标上。目标里的 phi 为每个改接的前驱复制一份空块那条入边的值
+// （值的定义支配空块，也就支配空块的所有前驱）。前驱本来就是目标的前驱时，只有两条边的 phi 值都相同才能合并，
+// 之后前驱的 br 两个目标相同，化简为 jmp。以 br 结尾的前驱接到有 phi 的目标上会形成临界边，
+// phi 消除的复制只能放到分支之前、在另一条路径上也执行，这种空块保留
+bool forwardEmptyBlock(Function &func, BasicBlock *bb) {
+    if (bb == func.entry() || bb->instrs.size() != 1 || bb->terminator().op != Opcode::Jmp) return false;
+    BasicBlock *target = bb->terminator().blocks[0];
+    if (target == bb) return false;
+    bool changed = false;
+    for (BasicBlock *pred : std::vector<BasicBlock *>(bb->preds)) {
+        if (pred == bb) continue;
+        bool alreadyPred = isPred(pred, target);
+        bool hasPhis = target->instrs.front().op == Opcode::Phi;
+        if (hasPhis && !alreadyPred && pred->succs.size() > 1) continue;
+        if (alreadyPred && !samePhiValues(target, pred, bb)) continue;
+        retarget(pred->terminator(), bb, target);
+        for (auto &phi : target->instrs) {
+            if (phi.op != Opcode::Phi || alreadyPred) break;
+            for (size_t i = 0; i < phi.blocks.size(); i++) {
+                if (phi.blocks[i] != bb) continue;
+                phi.blocks.push_back(pred);
+                phi.ops.push_back(phi.ops[i]);
+                break;
+            }
+        }
+        changed = true;
+    }
+    if (changed) func.rebuildCFG();
+    return changed;
+}
+
+// 唯一前驱以 jmp 跳过来的块并入前驱：它的 phi 只有一条入边，直接用入值替换
+bool mergeIntoPredecessor(Function &func, BasicBlock *bb, std::unordered_map<int, Value> &replace) {
+    if (bb == func.entry() || bb->preds.size() != 1) return false;
+    BasicBlock *pred = bb->preds[0];
+    if (pred == bb || pred->terminator().op != Opcode::Jmp) return false;
+
+    pred->instrs.pop_back();
+    for (auto &instr : bb->instrs) {
+        if (instr.op == Opcode::Phi) replace[instr.dst] = instr.ops[0];
+        else pred->instrs.push_back(std::move(instr));
+    }
+    for (BasicBlock *succ : bb->succs) {
+        for (auto &phi : succ->instrs) {
+            if (phi.op != Opcode::Phi) break;
+            for (auto &from : phi.blocks) {
+                if (from == bb) from = pred;
+            }
+        }
+    }
+    bb->instrs.clear();
+    func.blocks.erase(std::find_if(func.blocks.begin(), func.blocks.end(),
+                                   [&](const std::unique_ptr<BasicBlock> &b) { return b.get() == bb; }));
+    func.rebuildCFG();
+    return true;
+}
+
+} // namespace
+
+bool eliminateDeadCode(Function &func, const std::unordered_set<std::string> *removableFunctions, DCEStats *stats) {
+    std::vector<Instr *> defOf(func.numRegs, nullptr);
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.dst >= 0) defOf[instr.dst] = &instr;
+        }
+    }
+
+    // 从有副作用的指令出发标记所有被用到的定义；只互相使用的 phi 环不会被标记
+    std::unordered_set<const Instr *> live;
+    std::vector<const Instr *> work;
+    std::vector<bool> used(func.numRegs, false);
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            bool removableCall = instr.op == Opcode::Call && removableFunctions &&
+                                 removableFunctions->count(instr.callee);
+            if (instr.hasSideEffects() && !removableCall && live.insert(&instr).second) work.push_back(&instr);
+        }
+    }
+    while (!work.empty()) {
+        const Instr *instr = work.back();
+        work.pop_back();
+        for (auto &v : instr->ops) {
+            if (!v.isReg()) continue;
+            used[v.num] = true;
+            Instr *def = defOf[v.num];
+            if (def && live.insert(def).second) work.push_back(def);
+        }
+    }
+
+    int removed = 0, calls = 0;
+    for (auto &bb : func.blocks) {
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            if (!live.count(&instr)) {
+                removed++;
+                calls += instr.op == Opcode::Call;
+                continue;
+            }
+            // 返回值没人用的调用只保留副作用
+            if (instr.op == Opcode::Call && instr.dst >= 0 && !used[instr.dst]) instr.dst = -1;
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+    }
+    if (stats) {
+        stats->deadInstrs += removed;
+        stats->deadCalls += calls;
+    }
+    return removed > 0;
+}
+
+bool simplifyCFG(Function &func, DCEStats *stats) {
+    DCEStats local;
+    std::unordered_map<int, Value> replace;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        size_t before = func.blocks.size();
+        if (func.removeUnreachableBlocks()) {
+            local.blocksRemoved += (int)(before - func.blocks.size());
+            changed = true;
+        }
+        for (auto &bb : func.blocks) {
+            // 两个目标相同的 br 不需要判断条件
+            Instr &term = bb->terminator();
+            if (term.op == Opcode::Br && term.blocks[0] == term.blocks[1]) {
+                term.op = Opcode::Jmp;
+                term.ops.clear();
+                term.blocks.pop_back();
+                local.jumpsRemoved++;
+                changed = true;
+            }
+        }
+        func.rebuildCFG();
+        for (size_t i = 0; i < func.blocks.size(); i++) {
+            BasicBlock *bb = func.blocks[i].get();
+            if (forwardEmptyBlock(func, bb)) {
+                local.jumpsRemoved++;
+                changed = true;
+            } else if (mergeIntoPredecessor(func, bb, replace)) {
+                local.jumpsRemoved++;
+                changed = true;
+                i--;
+            }
+        }
+    }
+
+    if (!replace.empty()) {
+        auto resolve = [&](Value v) {
+            while (v.isReg() && replace.count(v.num)) v = replace.at(v.num);
+            return v;
+        };
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) v = resolve(v);
+            }
+        }
+    }
+    if (stats) {
+        stats->blocksRemoved += local.blocksRemoved;
+        stats->jumpsRemoved += local.jumpsRemoved;
+    }
+    return local.blocksRemoved || local.jumpsRemoved;
+}
+
+} // namespace ir
@@ -0,0 +1,240 @@
+#include "driver.h"
+#include "analysis.h"
+#include "backend.h"
+#include "callgraph.h"
+#include "codegen.h"
+#include "fold.h"
+#include "irgen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "passes.h"
+#include "semantic.h"
+#include <sstream>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+static void verifyOrThrow(const ir::Module &module, const char *after) {
+    std::string err;
+    if (!ir::verifyModule(module, err)) throw std::runtime_error(std::string("invalid IR after ") + after + ": " + err);
+}
+
+static void verifyOrThrow(const ir::Module &module, const ir::Function &func, const char *after) {
+    std::string err;
+    if (!ir::verifyFunction(func, &module, err))
+        throw std::runtime_error(std::string("invalid IR after ") + after + ": " + err);
+}
+
+// 优化开始前对整个模块的分析，流水线中只读
+struct ModuleFacts {
+    std::unordered_set<std::string> mutuallyRecursive;
+    std::unordered_set<std::string> pure;
+    std::unordered_set<std::string> speculatable;
+    std::unordered_set<std::string> removable;      // 没有副作用并且总会返回，结果没人用时可以删掉调用
+};
+
+// 一个函数的优化流水线。它调用的其他 SCC 中的函数已经优化完，内联进来的是优化后的函数体
+static void optimizeFunction(ir::Module &module, ir::Function &f, const CompileOptions &opts,
+                             const ModuleFacts &facts, std::ostream *report) {
+    if (opts.passEnabled("tailrec")) {
+        ir::TailRecursionStats stats;
+        if (ir::eliminateTailRecursion(f, &stats) && report)
+            *report << "tailrec: @" << f.name << ": " << stats.calls << " tail calls turned into jumps, "
+                    << stats.accumulators << " through an accumulator\n";
+        verifyOrThrow(module, f, "tailrec");
+    }
+    if (opts.passEnabled("inline")) {
+        ir::inlineCalls(f, module, facts.mutuallyRecursive, opts.inlineThreshold, report);
+        verifyOrThrow(module, f, "inline");
+    }
+    if (opts.passEnabled("ipsccp")) {
+        ir::propagateConstantReturns(f, module, report);
+        verifyOrThrow(module, f, "ipsccp");
+    }
+    if (opts.passEnabled("sccp")) {
+        ir::SCCPStats stats;
+        ir::sparseConditionalConstantPropagation(f, &stats);
+        if (report && (stats.constants || stats.branchesFolded || stats.blocksRemoved)) {
+            *report << "sccp: @" << f.name << ": " << stats.constants << " constants propagated, "
+                    << stats.branchesFolded << " branches folded, " << stats.blocksRemoved << " blocks removed\n";
+        }
+        verifyOrThrow(module, f, "sccp");
+    }
+    if (opts.passEnabled("gvn")) {
+        ir::GVNStats stats;
+        ir::globalValueNumbering(f, &facts.pure, &stats);
+        if (report && (stats.redundant || stats.folded)) {
+            *report << "gvn: @" << f.name << ": " << stats.redundant << " redundant computations removed, "
+                    << stats.folded << " folded\n";
+        }
+        verifyOrThrow(module, f, "gvn");
+    }
+    if (opts.passEnabled("licm")) {
+        ir::LICMStats stats;
+        ir::hoistLoopInvariants(f, &facts.pure, &facts.speculatable, &stats);
+        if (report && (stats.hoisted || stats.preheaders)) {
+            *report << "licm: @" << f.name << ": " << stats.hoisted << " instructions hoisted from " << stats.loops
+                    << " loops, " << stats.preheaders << " preheaders inserted\n";
+        }
+        verifyOrThrow(module, f, "licm");
+    }
+    if (opts.passEnabled("scev")) {
+        ir::SCEVStats stats;
+        if (ir::simplifyInductionVariables(f, &facts.removable, &stats) && report) {
+            *report << "scev: @" << f.name << ": " << stats.loopsDeleted << " loops replaced by " << stats.exitValues
+                    << " closed-form exit values, " << stats.strengthReduced << " multiplications strength-reduced\n";
+        }
+        verifyOrThrow(module, f, "scev");
+    }
+    if (opts.passEnabled("dce")) {
+        ir::DCEStats stats;
+        ir::eliminateDeadCode(f, &facts.removable, &stats);
+        ir::simplifyCFG(f, &stats);
+        if (report && (stats.deadInstrs || stats.blocksRemoved || stats.jumpsRemoved)) {
+            *report << "dce: @" << f.name << ": " << stats.deadInstrs << " dead instructions";
+            if (stats.deadCalls) *report << " (" << stats.deadCalls << " unused calls)";
+            *report << ", " << stats.blocksRemoved << " blocks removed, " << stats.jumpsRemoved << " jumps removed\n";
+        }
+        verifyOrThrow(module, f, "dce");
+    }
+    if (opts.passEnabled("block-placement")) {
+        ir::LayoutStats stats;
+        if (ir::placeBlocks(f, &stats) && report) {
+            *report << "block-placement: @" << f.name << ": " << stats.fallThroughsBefore << " -> "
+                    << stats.fallThroughsAfter << " fall-through blocks\n";
+        }
+        verifyOrThrow(module, f, "block-placement");
+    }
+}
+
+// IR 优化流水线：mem2reg、过程间常量传播和 -O3 的记忆化对整个模块做一遍，然后按调用图自底向上
+// 逐个 SCC 优化，互不依赖的 SCC 可以并发（-j<n>）。每个函数的报告先写到自己的缓冲区，最后按自底向上的
+// 顺序输出，与线程数无关
+static void optimizeModule(ir::Module &module, const CompileOptions &opts) {
+    if (opts.optLevel < 1) return;
+    if (opts.passEnabled("mem2reg")) {
+        for (auto &f : module.functions) ir::promoteMemoryToRegisters(*f);
+        verifyOrThrow(module, "mem2reg");
+    }
+    if (opts.passEnabled("ipsccp")) {
+        ir::propagateConstantsAcrossCalls(module, opts.wholeProgram, opts.report);
+        verifyOrThrow(module, "ipsccp");
+    }
+    if (opts.optLevel >= 3 && opts.passEnabled("memoize")) {
+        ir::memoizeRecursiveFunctions(module, opts.report);
+        verifyOrThrow(module, "memoize");
+    }
+
+    CallGraph graph(module);
+    ModuleFacts facts;
+    facts.mutuallyRecursive = graph.mutuallyRecursive();
+    auto attributes = ir::inferFunctionAttributes(module);
+    for (auto &f : module.functions) {
+        const ir::FunctionAttributes &attrs = attributes[f->name];
+        if (attrs.pure) facts.pure.insert(f->name);
+        if (attrs.pure && attrs.willReturn) facts.removable.insert(f->name);
+        if (opts.report && (attrs.pure || attrs.noRecurse || attrs.leaf || attrs.willReturn)) {
+            *opts.report << "attributes: @" << f->name << ":" << (attrs.pure ? " pure" : "")
+                         << (attrs.noRecurse ? " norecurse" : "") << (attrs.leaf ? " leaf" : "")
+                         << (attrs.willReturn ? " willreturn" : "") << "\n";
+        }
+    }
+    facts.speculatable = ir::findSpeculatableFunctions(module, facts.pure);
+
+    std::vector<std::ostringstream> reports(module.functions.size());
+    std::unordered_map<std::string, std::ostringstream *> reportOf;
+    for (size_t i = 0; i < module.functions.size(); i++) reportOf[module.functions[i]->name] = &reports[i];
+    forEachSCCBottomUp(graph, opts.jobs, [&](int scc) {
+        for (auto &name : graph.sccs()[scc]) {
+            optimizeFunction(module, *module.getFunction(name), opts, facts, opts.report ? reportOf.at(name) : nullptr);
+        }
+    });
+    verifyOrThrow(module, "optimization");
+    if (opts.report) {
+        for (auto &scc : graph.sccs()) {
+            for (auto &name : scc) *opts.report << reportOf.at(name)->str();
+        }
+    }
+
+    if (opts.constEvalSteps > 0) {
+        ir::evaluateAtCompileTime(module, opts.constEvalSteps, opts.report);
+        verifyOrThrow(module, "const-eval");
+    }
+
+    // 内联之后没有调用者的函数；特化版本在模块外不可见，总是可以删
+    for (auto &name : eliminateUnusedInternalFunctions(module))
+        if (opts.report) *opts.report << "ipsccp: @" << name << " removed, every call was inlined\n";
+    if (opts.wholeProgram) {
+        for (auto &name : eliminateDeadFunctions(module))
+            if (opts.report) *opts.report << "whole-program: @" << name << " removed, unreachable from @main\n";
+    }
+}
+
+// -falign-loops 的字节数换成 .p2align 的指数
+static int loopAlignLog2(int bytes) {
+    int log2 = 0;
+    while ((1 << log2) < bytes) log2++;
+    return log2;
+}
+
+std::string compileSource(const std::string &source, const CompileOptions &opts) {
+    // 词法分析
+    Lexer lexer(source);
+    auto tokens = lexer.tokenize();
+
+    // 语法分析
+    Parser parser(tokens);
+    auto ast = parser.parseCompUnit();
+
+    // 语义分析
+    SemanticAnalyzer analyzer;
+    analyzer.analyze(ast);
+
+    // 常量折叠与代数化简：很便宜，-O0 也运行
+    if (opts.passEnabled("fold")) {
+        ConstantFolder folder;
+        folder.run(ast);
+    }
+
+    // 整程序模式：从 main 调用不到的函数不生成代码
+    if (opts.wholeProgram) {
+        for (auto &name : eliminateDeadFunctions(ast))
+            if (opts.report) *opts.report << "whole-program: @" << name << " removed, unreachable from @main\n";
+    }
+
+    std::ostringstream oss;
+    if (opts.optLevel == 0 && !opts.emitIR) {
+        // 代码生成
+        CodeGen codegen(oss, opts.passEnabled("dce"), opts.passEnabled("loop-rotate"), loopAlignLog2(opts.alignLoops));
+        codegen.generate(ast);
+        return oss.str();
+    }
+
+    // IR 生成
+    IRGen irgen(opts.passEnabled("loop-rotate"));
+    auto module = irgen.generate(ast);
+    verifyOrThrow(*module, "IR generation");
+    optimizeModule(*module, opts);
+
+    if (opts.emitIR) {
+        ir::printModule(oss, *module);
+        return oss.str();
+    }
+
+    mir::RegAllocKind regAlloc = mir::RegAllocKind::SpillAll;
+    if (opts.passEnabled("regalloc"))
+        regAlloc = opts.optLevel >= 2 ? mir::RegAllocKind::GraphColoring : mir::RegAllocKind::LinearScan;
+    const mir::CoreCostModel *cost = nullptr;
+    if (opts.passEnabled("strength-reduce")) cost = &mir::coreCostModel(opts.tune);
+    RiscvBackend backend(oss, regAlloc, cost, loopAlignLog2(opts.alignLoops), opts.passEnabled("sibling-calls"));
+    backend.emitModule(*module);
+    if (opts.report) {
+        for (auto &f : module->functions) {
+            int bytes = backend.stats().stackBytes.at(f->name);
+            *opts.report << "stack: @" << f->name << ": ";
+            if (bytes < 0) *opts.report << "unbounded (recursive)\n";
+            else *opts.report << "at most " << bytes << " bytes\n";
+        }
+    }
+    return oss.str();
+}
@@ -0,0 +1,241 @@
+#include "fold.h"
+#include "ir.h"
+#include <iostream>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace {
+
+bool asConst(const Expr *expr, int &value) {
+    auto num = dynamic_cast<const NumberExpr *>(expr);
+    if (num) value = num->value;
+    return num != nullptr;
+}
+
+bool isComparison(const std::string &op) {
+    return op == "<" || op == ">" || op == "<=" || op == ">=" || op == "==" || op == "!=";
+}
+
+// 不含调用的表达式没有副作用，整棵删掉不影响语义
+bool isPure(const Expr *expr) {
+    if (dynamic_cast<const CallExpr *>(expr)) return false;
+    if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) return isPure(unary->operand.get());
+    if (auto bin = dynamic_cast<const BinaryExpr *>(expr)) return isPure(bin->lhs.get()) && isPure(bin->rhs.get());
+    return true;
+}
+
+// 值只可能是 0 或 1 的表达式
+bool isBoolean(const Expr *expr) {
+    int value;
+    if (asConst(expr, value)) return value == 0 || value == 1;
+    if (auto unary = dynamic_cast<const UnaryExpr *>(expr)) return unary->op == "!";
+    if (auto bin = dynamic_cast<const BinaryExpr *>(expr))
+        return isComparison(bin->op) || bin->op == "&&" || bin->op == "||";
+    return false;
+}
+
+std::unique_ptr<Expr> makeNum(int value) {
+    return std::make_unique<NumberExpr>(value);
+}
+
+// 把任意整数值规范成 0/1
+std::unique_ptr<Expr> toBool(std::unique_ptr<Expr> expr) {
+    if (isBoolean(expr.get())) return expr;
+    return std::make_unique<BinaryExpr>("!=", std::move(expr), makeNum(0));
+}
+
+// 与 IR 层共用同一份求值语义（32 位补码回绕，INT_MIN / -1 同 RISC-V）；除以 0 返回 false
+bool evalBinary(const std::string &op, int a, int b, int &result) {
+    ir::Opcode opcode;
+    return ir::binaryOpcode(op, opcode) && ir::evalBinary(opcode, a, b, result);
+}
+
+int evalUnary(const std::string &op, int a) {
+    ir::Opcode opcode;
+    if (!ir::unaryOpcode(op, opcode)) throw std::runtime_error("Unsupported unary operator '" + op + "'");
+    return ir::evalUnary(opcode, a);
+}
+
+} // namespace
+
+void ConstantFolder::run(std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    for (auto &func : funcs) {
+        funcName = func->name;
+        if (func->body) foldBlock(func->body.get());
+    }
+}
+
+void ConstantFolder::foldBlock(Block *block) {
+    for (auto &stmt : block->stmts) foldStmt(stmt.get());
+}
+
+void ConstantFolder::foldStmt(Stmt *stmt) {
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        if (decl->initializer) decl->initializer = fold(std::move(decl->initializer));
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        assign->value = fold(std::move(assign->value));
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        exprStmt->expr = fold(std::move(exprStmt->expr));
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        if (ret->expr) ret->expr = fold(std::move(ret->expr));
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        foldBlock(block);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        ifStmt->condition = foldCondition(std::move(ifStmt->condition));
+        foldBlock(ifStmt->thenBlock.get());
+        if (ifStmt->elseBlock) foldBlock(ifStmt->elseBlock.get());
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        whileStmt->condition = foldCondition(std::move(whileStmt->condition));
+        foldBlock(whileStmt->body.get());
+    }
+}
+
+std::unique_ptr<Expr> ConstantFolder::fold(std::unique_ptr<Expr> expr) {
+    if (dynamic_cast<UnaryExpr *>(expr.get())) {
+        return foldUnary(std::unique_ptr<UnaryExpr>(static_cast<UnaryExpr *>(expr.release())));
+    }
+    if (dynamic_cast<BinaryExpr *>(expr.get())) {
+        return foldBinary(std::unique_ptr<BinaryExpr>(static_cast<BinaryExpr *>(expr.release())));
+    }
+    if (auto call = dynamic_cast<CallExpr *>(expr.get())) {
+        for (auto &arg : call->args) arg = fold(std::move(arg));
+    }
+    return expr;
+}
+
+std::unique_ptr<Expr> ConstantFolder::foldCondition(std::unique_ptr<Expr> expr) {
+    expr = fold(std::move(expr));
+    while (true) {
+        auto unary = dynamic_cast<UnaryExpr *>(expr.get());
+        auto inner = unary && unary->op == "!" ? dynamic_cast<UnaryExpr *>(unary->operand.get()) : nullptr;
+        if (inner && inner->op == "!") {
+            expr = std::move(inner->operand);
+            stats_.simplified++;
+            continue;
+        }
+        auto bin = dynamic_cast<BinaryExpr *>(expr.get());
+        int value;
+        if (bin && bin->op == "!=" && asConst(bin->rhs.get(), value) && value == 0) {
+            expr = std::move(bin->lhs);
+            stats_.simplified++;
+            continue;
+        }
+        return expr;
+    }
+}
+
+std::unique_ptr<Expr> ConstantFolder::foldUnary(std::unique_ptr<UnaryExpr> unary) {
+    unary->operand = fold(std::move(unary->operand));
+    int value;
+    if (asConst(unary->operand.get(), value)) {
+        stats_.foldedConstants++;
+        return makeNum(evalUnary(unary->op, value));
+    }
+    auto inner = dynamic_cast<UnaryExpr *>(unary->operand.get());
+    if (unary->op == "-" && inner && inner->op == "-") {
+        // -(-x) == x（INT_MIN 取负两次仍是自身）
+        stats_.simplified++;
+        return std::move(inner->operand);
+    }
+    if (unary->op == "!") {
+        // !!c：c 本身是 0/1 时就是 c
+        if (inner && inner->op == "!" && isBoolean(inner->operand.get())) {
+            stats_.simplified++;
+            return std::move(inner->operand);
+        }
+        // !(a < b) => a >= b
+        static const std::unordered_map<std::string, std::string> inverse = {
+            {"<", ">="}, {">=", "<"}, {">", "<="}, {"<=", ">"}, {"==", "!="}, {"!=", "=="},
+        };
+        auto bin = dynamic_cast<BinaryExpr *>(unary->operand.get());
+        if (bin && inverse.count(bin->op)) {
+            bin->op = inverse.at(bin->op);
+            stats_.simplified++;
+            return std::move(unary->operand);
+        }
+    }
+    return unary;
+}
+
+std::unique_ptr<Expr> ConstantFolder::foldBinary(std::unique_ptr<BinaryExpr> bin) {
+    if (bin->op == "&&" || bin->op == "||") return foldLogical(std::move(bin));
+    bin->lhs = fold(std::move(bin->lhs));
+    bin->rhs = fold(std::move(bin->rhs));
+
+    int a, b;
+    bool lhsConst = asConst(bin->lhs.get(), a), rhsConst = asConst(bin->rhs.get(), b);
+    if (rhsConst && b == 0 && (bin->op == "/" || bin->op == "%")) {
+        std::cerr << "Warning: division by zero in function '" << funcName << "'" << std::endl;
+        stats_.divisionsByZero++;
+        return bin;
+    }
+    int result;
+    if (lhsConst && rhsConst && evalBinary(bin->op, a, b, result)) {
+        stats_.foldedConstants++;
+        return makeNum(result);
+    }
+
+    // 常量换到右边：可交换的运算直接交换，比较翻转方向
+    static const std::unordered_map<std::string, std::string> swapped = {
+        {"+", "+"}, {"*", "*"}, {"==", "=="}, {"!=", "!="},
+        {"<", ">"}, {">", "<"}, {"<=", ">="}, {">=", "<="},
+    };
+    auto swap = swapped.find(bin->op);
+    if (lhsConst && !rhsConst && swap != swapped.end()) {
+        std::swap(bin->lhs, bin->rhs);
+        bin->op = swap->second;
+        std::swap(lhsConst, rhsConst);
+        std::swap(a, b);
+        if (isComparison(bin->op)) stats_.simplified++;
+    }
+
+    const std::string &op = bin->op;
+    if (rhsConst) {
+        if ((b == 0 && (op == "+" || op == "-")) || (b == 1 && (op == "*" || op == "/"))) {
+            stats_.simplified++;
+            return std::move(bin->lhs);
+        }
+        if (b == -1 && (op == "*" || op == "/")) {
+            stats_.simplified++;
+            return foldUnary(std::make_unique<UnaryExpr>("-", std::move(bin->lhs)));
+        }
+        if (((b == 0 && op == "*") || ((b == 1 || b == -1) && op == "%")) && isPure(bin->lhs.get())) {
+            stats_.foldedConstants++;
+            return makeNum(0);
+        }
+    }
+    if (lhsConst && a == 0 && op == "-") {
+        stats_.simplified++;
+        return foldUnary(std::make_unique<UnaryExpr>("-", std::move(bin->rhs)));
+    }
+    return bin;
+}
+
+// && 和 || 只看操作数的真假，结果总是 0/1；常量左操作数决定右边是否求值
+std::unique_ptr<Expr> ConstantFolder::foldLogical(std::unique_ptr<BinaryExpr> bin) {
+    bool isAnd = bin->op == "&&";
+    bin->lhs = foldCondition(std::move(bin->lhs));
+    bin->rhs = foldCondition(std::move(bin->rhs));
+
+    int a, b;
+    if (asConst(bin->lhs.get(), a)) {
+        // 0 && x、1 || x 的右边不会被求值
+        if ((a != 0) != isAnd) {
+            stats_.foldedConstants++;
+            return makeNum(isAnd ? 0 : 1);
+        }
+        stats_.simplified++;
+        return toBool(std::move(bin->rhs));
+    }
+    if (asConst(bin->rhs.get(), b)) {
+        if ((b != 0) == isAnd) {
+            stats_.simplified++;
+            return toBool(std::move(bin->lhs));
+        }
+        if (isPure(bin->lhs.get())) {
+            stats_.foldedConstants++;
+            return makeNum(isAnd ? 0 : 1);
+        }
+    }
+    return bin;
+}
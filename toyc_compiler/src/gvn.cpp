@@ -0,0 +1,233 @@
+#include "analysis.h"
+#include "passes.h"
+#include <functional>
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+// 值编号的键：操作码、规范化后的操作数，以及区分同类指令的附加信息
+struct ExprKey {
+    Opcode op;
+    std::vector<Value> ops;
+    std::vector<const BasicBlock *> blocks;     // phi 的入边：只有同一块中入边相同的 phi 才可能相等
+    std::string callee;
+    int index = -1;
+
+    bool operator==(const ExprKey &o) const {
+        return op == o.op && ops == o.ops && blocks == o.blocks && callee == o.callee && index == o.index;
+    }
+};
+
+struct ExprKeyHash {
+    size_t operator()(const ExprKey &k) const {
+        size_t h = std::hash<std::string>()(k.callee) * 31 + (size_t)k.op * 7 + (size_t)k.index;
+        for (auto &v : k.ops) h = h * 31 + (size_t)v.kind * 1000003u + (size_t)v.num;
+        for (auto *bb : k.blocks) h = h * 31 + std::hash<const BasicBlock *>()(bb);
+        return h;
+    }
+};
+
+bool isCommutative(Opcode op) {
+    switch (op) {
+        case Opcode::Add: case Opcode::Mul: case Opcode::And: case Opcode::Or: case Opcode::Xor:
+        case Opcode::Eq: case Opcode::Ne:
+            return true;
+        default:
+            return false;
+    }
+}
+
+bool valueLess(const Value &a, const Value &b) {
+    return a.kind != b.kind ? a.kind < b.kind : a.num < b.num;
+}
+
+Value resolve(const std::unordered_map<int, Value> &replace, Value v) {
+    while (v.isReg() && replace.count(v.num)) v = replace.at(v.num);
+    return v;
+}
+
+// 规范化：交换律运算的操作数排序，a > b 改写为 b < a，a >= b 改写为 b <= a
+ExprKey makeKey(const Instr &instr, const BasicBlock *bb) {
+    ExprKey key{instr.op, instr.ops, {}, instr.callee, instr.index};
+    if (instr.op == Opcode::Phi) {
+        key.blocks.assign(instr.blocks.begin(), instr.blocks.end());
+        key.blocks.push_back(bb);
+    } else if (isCommutative(instr.op) && valueLess(key.ops[1], key.ops[0])) {
+        std::swap(key.ops[0], key.ops[1]);
+    } else if (instr.op == Opcode::Gt || instr.op == Opcode::Ge) {
+        key.op = instr.op == Opcode::Gt ? Opcode::Lt : Opcode::Le;
+        std::swap(key.ops[0], key.ops[1]);
+    }
+    return key;
+}
+
+class ValueNumbering {
+public:
+    ValueNumbering(Function &f, const std::unordered_set<std::string> *pure) : func(f), pureFunctions(pure) {}
+
+    void run(GVNStats &stats) {
+        DominatorTree dt(func);
+        struct Frame {
+            BasicBlock *bb;
+            size_t undoMark;    // 进入该块之前的撤销栈高度，离开子树时恢复
+            int calls;          // 块结束时支配路径上的调用数，子块从这里开始
+            size_t nextChild;
+        };
+        std::vector<Frame> stack;
+        auto enter = [&](BasicBlock *bb) {
+            size_t mark = undo.size();
+            visitBlock(bb, stats);
+            stack.push_back(Frame{bb, mark, calls, 0});
+        };
+        enter(func.entry());
+        while (!stack.empty()) {
+            Frame &top = stack.back();
+            const auto &kids = dt.children(top.bb);
+            if (top.nextChild < kids.size()) {
+                calls = top.calls;
+                enter(kids[top.nextChild++]);
+                continue;
+            }
+            // 离开子树：子树中加入的表项不支配兄弟子树，撤销
+            while (undo.size() > top.undoMark) {
+                auto &[key, shadowed] = undo.back();
+                if (shadowed.value.isNone()) table.erase(key);
+                else table[key] = shadowed;
+                undo.pop_back();
+            }
+            stack.pop_back();
+        }
+
+        // 回边上的 phi 操作数在定义处理之前就访问过，统一再替换一遍
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) v = resolve(replace, v);
+            }
+        }
+    }
+
+private:
+    Function &func;
+    const std::unordered_set<std::string> *pureFunctions;
+    struct Entry {
+        Value value;
+        int calls = 0;      // 定义处支配路径上已经过的调用数
+    };
+    // 作用域化的值表：只含支配当前块的定义。撤销栈记下每次加入的键和被它遮蔽的旧表项
+    std::unordered_map<ExprKey, Entry, ExprKeyHash> table;
+    std::vector<std::pair<ExprKey, Entry>> undo;
+    std::unordered_map<int, Value> replace;
+    int calls = 0;
+
+    // 一条指令就能重算的值（寄存器与立即数的加减、逻辑和比较）跨调用复用时会占住一个被调用者保存
+    // 寄存器，还要在序言尾声里保存恢复，不如在调用之后重算
+    static bool cheapToRecompute(const Instr &instr) {
+        if (!isBinary(instr.op) || instr.op == Opcode::Mul || instr.op == Opcode::Div || instr.op == Opcode::Rem)
+            return false;
+        return instr.ops[0].isImm() || instr.ops[1].isImm();
+    }
+
+    bool isPureCall(const Instr &instr) const {
+        return pureFunctions && pureFunctions->count(instr.callee) != 0;
+    }
+
+    // 操作数全是立即数时直接求值；除以 0 留到运行时
+    bool fold(const Instr &instr, Value &result) const {
+        if (isBinary(instr.op) && instr.ops[0].isImm() && instr.ops[1].isImm()) {
+            int v;
+            if (!evalBinary(instr.op, instr.ops[0].num, instr.ops[1].num, v)) return false;
+            result = Value::imm(v);
+            return true;
+        }
+        if (isUnary(instr.op) && instr.ops[0].isImm()) {
+            result = Value::imm(evalUnary(instr.op, instr.ops[0].num));
+            return true;
+        }
+        return false;
+    }
+
+    // 所有入值（除自身外）都相同的 phi：该值支配所有前驱，也就支配 phi 所在的块
+    bool trivialPhi(const Instr &phi, Value &result) const {
+        Value same;
+        for (auto &v : phi.ops) {
+            if (v == Value::reg(phi.dst) || v == same) continue;
+            if (!same.isNone()) return false;
+            same = v;
+        }
+        if (same.isNone()) return false;
+        result = same;
+        return true;
+    }
+
+    void visitBlock(BasicBlock *bb, GVNStats &stats) {
+        // 栈槽只能由本函数的 store 改写（没有指针，调用也碰不到），load 在块内按栈槽编号，
+        // 并直接转发之前 store 的值。重新 load 只要一条指令，同样不跨调用转发
+        std::unordered_map<int, Entry> slotValue;
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            for (auto &v : instr.ops) v = resolve(replace, v);
+            Value same;
+            if (instr.op == Opcode::Store) {
+                slotValue[instr.index] = Entry{instr.ops[0], calls};
+            } else if (instr.op == Opcode::Load) {
+                auto it = slotValue.find(instr.index);
+                if (it != slotValue.end() && (it->second.calls == calls || it->second.value.isImm())) {
+                    replace[instr.dst] = it->second.value;
+                    stats.redundant++;
+                    continue;
+                }
+                slotValue[instr.index] = Entry{Value::reg(instr.dst), calls};
+            } else if (instr.op == Opcode::LoadGlobal) {
+                // 全局表会被 gstore 和调用改写，每次都重新读
+            } else if (instr.op == Opcode::Copy) {
+                replace[instr.dst] = instr.ops[0];
+                stats.redundant++;
+                continue;
+            } else if (fold(instr, same)) {
+                replace[instr.dst] = same;
+                stats.folded++;
+                continue;
+            } else if (instr.op == Opcode::Phi && trivialPhi(instr, same)) {
+                replace[instr.dst] = same;
+                stats.redundant++;
+                continue;
+            } else if (instr.dst >= 0 && (!instr.hasSideEffects() || (instr.op == Opcode::Call && isPureCall(instr)))) {
+                // 无副作用的运算、phi、形参和纯函数调用参与编号；其余调用是屏障，每次都执行
+                ExprKey key = makeKey(instr, bb);
+                auto it = table.find(key);
+                Entry shadowed;
+                if (it != table.end()) {
+                    if (it->second.calls == calls || !cheapToRecompute(instr)) {
+                        replace[instr.dst] = it->second.value;
+                        stats.redundant++;
+                        continue;
+                    }
+                    shadowed = it->second;
+                }
+                table[key] = Entry{Value::reg(instr.dst), calls};
+                undo.push_back({std::move(key), shadowed});
+            }
+            calls += instr.op == Opcode::Call;
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+    }
+};
+
+} // namespace
+
+bool globalValueNumbering(Function &func, const std::unordered_set<std::string> *pureFunctions, GVNStats *stats) {
+    // 不可达块不在支配树上，先删掉，避免它们引用被替换掉的定义
+    func.removeUnreachableBlocks();
+    GVNStats local;
+    ValueNumbering(func, pureFunctions).run(local);
+    if (stats) {
+        stats->redundant += local.redundant;
+        stats->folded += local.folded;
+    }
+    return local.redundant || local.folded;
+}
+
+} // namespace ir
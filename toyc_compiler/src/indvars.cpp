@@ -0,0 +1,210 @@
+#include "analysis.h"
+#include "passes.h"
+#include <climits>
+
+namespace ir {
+
+namespace {
+
+// 在块末尾（终结指令之前）生成计算循环不变量的代码，操作数都是常量时直接折叠
+class Builder {
+public:
+    Builder(Function &f, BasicBlock *bb) : func(f), block(bb) {}
+
+    Value binary(Opcode op, Value a, Value b) {
+        int result;
+        if (a.isImm() && b.isImm() && evalBinary(op, a.num, b.num, result)) return Value::imm(result);
+        if (op == Opcode::Add && a == Value::imm(0)) return b;
+        if ((op == Opcode::Add || op == Opcode::Sub) && b == Value::imm(0)) return a;
+        if (op == Opcode::Mul) {
+            if (a == Value::imm(0) || b == Value::imm(0)) return Value::imm(0);
+            if (a == Value::imm(1)) return b;
+            if (b == Value::imm(1)) return a;
+        }
+        Instr instr(op);
+        instr.dst = func.newReg();
+        instr.ops = {a, b};
+        block->instrs.insert(block->instrs.end() - 1, std::move(instr));
+        return Value::reg(func.newReg() - 1);
+    }
+
+    Value sum(const LinearSum &s) {
+        Value acc = Value::imm(s.constant);
+        for (auto &[reg, factor] : s.terms)
+            acc = binary(Opcode::Add, acc, binary(Opcode::Mul, Value::reg(reg), Value::imm(factor)));
+        return acc;
+    }
+
+    // 回边执行 count 次：lower < upper 时为 upper - lower
+    Value count(const BackedgeCount &c) {
+        Value lower = sum(c.lower), upper = sum(c.upper);
+        return binary(Opcode::Mul, binary(Opcode::Lt, lower, upper), binary(Opcode::Sub, upper, lower));
+    }
+
+    // 第 k 次迭代的值 c0 + c1*k + c2*k(k-1)/2。k 按无符号数理解（可能超过 2^31），
+    // k 与 k-1 中的偶数先折半：偶数部分翻转符号位后有符号除以 2，再加回 2^30
+    Value at(const AddRec &rec, Value k) {
+        Value value = binary(Opcode::Add, sum(rec.coeffs[0]), binary(Opcode::Mul, sum(rec.coeffs[1]), k));
+        if (rec.coeffs[2].isZero()) return value;
+        Value odd = binary(Opcode::And, k, Value::imm(1));
+        Value even = binary(Opcode::Sub, k, odd);
+        Value half = binary(Opcode::Add, binary(Opcode::Div, binary(Opcode::Xor, even, Value::imm(INT_MIN)), Value::imm(2)),
+                            Value::imm(1 << 30));
+        Value pairs = binary(Opcode::Mul, half, binary(Opcode::Add, binary(Opcode::Sub, k, Value::imm(1)), odd));
+        return binary(Opcode::Add, value, binary(Opcode::Mul, sum(rec.coeffs[2]), pairs));
+    }
+
+private:
+    Function &func;
+    BasicBlock *block;
+};
+
+// 只计算值的循环：不含内层循环，除了可以删掉的纯函数调用没有副作用，回边次数算得出来，
+// 循环外用到的值都是加法递推。用前置块中算出的出口值替换这些使用，然后删掉整个循环
+bool replaceWithExitValues(Function &func, const Loop &loop, const DominatorTree &dt, ScalarEvolution &se,
+                           const std::unordered_set<std::string> *removableFunctions, SCEVStats &stats) {
+    std::unordered_set<int> defined;
+    for (const BasicBlock *bb : loop.blocks) {
+        if (se.innermostLoop(bb) != &loop) return false;
+        for (auto &instr : bb->instrs) {
+            if (instr.isTerminator()) continue;
+            bool removableCall = instr.op == Opcode::Call && removableFunctions && removableFunctions->count(instr.callee);
+            if (instr.hasSideEffects() && !removableCall) return false;
+            if (instr.dst >= 0) defined.insert(instr.dst);
+        }
+    }
+    BasicBlock *pre = loop.preheader();
+    if (pre->terminator().op != Opcode::Jmp) return false;
+    auto count = se.backedgeCount(loop, dt);
+    if (!count) return false;
+    BasicBlock *exiting = loop.exitingBlocks()[0];
+    const Instr &br = exiting->terminator();
+    BasicBlock *exit = loop.contains(br.blocks[0]) ? br.blocks[1] : br.blocks[0];
+
+    std::vector<std::pair<int, AddRec>> liveOut;
+    std::unordered_set<int> seen;
+    for (auto &bb : func.blocks) {
+        if (loop.contains(bb.get())) continue;
+        for (auto &instr : bb->instrs) {
+            for (auto &v : instr.ops) {
+                if (!v.isReg() || !defined.count(v.num) || !seen.insert(v.num).second) continue;
+                auto rec = se.evolution(v, loop);
+                if (!rec) return false;
+                liveOut.push_back({v.num, *rec});
+            }
+        }
+    }
+    // 出口值在最后一次迭代中求得，定义必须在出口判断之前
+    for (auto &bb : func.blocks) {
+        if (!loop.contains(bb.get())) continue;
+        for (auto &instr : bb->instrs) {
+            if (instr.dst >= 0 && seen.count(instr.dst) && !dt.dominates(bb.get(), exiting)) return false;
+        }
+    }
+
+    Builder builder(func, pre);
+    Value k = builder.count(*count);
+    for (auto &[reg, rec] : liveOut) {
+        Value value = builder.at(rec, k);
+        for (auto &bb : func.blocks) {
+            if (loop.contains(bb.get())) continue;
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) {
+                    if (v.isReg() && v.num == reg) v = value;
+                }
+            }
+        }
+    }
+    pre->terminator().blocks[0] = exit;
+    for (auto &phi : exit->instrs) {
+        if (phi.op != Opcode::Phi) break;
+        for (auto &from : phi.blocks) {
+            if (from == exiting) from = pre;
+        }
+    }
+    func.rebuildCFG();
+    func.removeUnreachableBlocks();
+    stats.loopsDeleted++;
+    stats.exitValues += (int)liveOut.size();
+    return true;
+}
+
+// 两个操作数都随迭代变化、每次迭代都执行的乘法（如 i * i）是 1 阶或 2 阶的递推 t，改为
+// 上一次的值加上差分：p 为循环头的 phi（初值 t(-1)，回边取 t），乘法原地换成 t = p + d。
+// 1 阶时差分 d 是循环不变量；2 阶时 d 本身也是 phi，在 latch 中加上 c2
+bool reduceMultiplications(Function &func, const Loop &loop, const DominatorTree &dt, ScalarEvolution &se,
+                           SCEVStats &stats) {
+    BasicBlock *pre = loop.preheader(), *latch = loop.latches[0];
+    std::vector<std::pair<Instr *, AddRec>> products;
+    for (auto &bb : func.blocks) {
+        if (se.innermostLoop(bb.get()) != &loop || !dt.dominates(bb.get(), latch)) continue;
+        for (auto &instr : bb->instrs) {
+            if (instr.op != Opcode::Mul) continue;
+            auto a = se.evolution(instr.ops[0], loop), b = se.evolution(instr.ops[1], loop);
+            if (!a || !b || a->order() == 0 || b->order() == 0) continue;
+            if (auto rec = se.evolution(Value::reg(instr.dst), loop)) products.push_back({&instr, *rec});
+        }
+    }
+    if (products.empty()) return false;
+
+    // 前置块不在循环中，在其中插入指令不影响指向乘法的指针；latch 和循环头最后再改
+    Builder init(func, pre);
+    std::vector<Instr> phis, updates;
+    auto recurrence = [&](Value start, int next) {
+        Instr phi(Opcode::Phi);
+        phi.dst = func.newReg();
+        phi.ops = {start, Value::reg(next)};
+        phi.blocks = {pre, latch};
+        phis.push_back(phi);
+        return Value::reg(phi.dst);
+    };
+    for (auto &[mul, rec] : products) {
+        // t(k) - t(k-1) = c1 + c2*(k-1)，k = 0 时为 c1 - c2
+        Value first = init.sum(rec.coeffs[1] + rec.coeffs[2] * -1), delta = first;
+        if (rec.order() == 2) {
+            Instr update(Opcode::Add);
+            update.dst = func.newReg();
+            delta = recurrence(first, update.dst);
+            update.ops = {delta, init.sum(rec.coeffs[2])};
+            updates.push_back(update);
+        }
+        Value previous = recurrence(init.binary(Opcode::Sub, init.sum(rec.coeffs[0]), first), mul->dst);
+        mul->op = Opcode::Add;
+        mul->ops = {previous, delta};
+        stats.strengthReduced++;
+    }
+    latch->instrs.insert(latch->instrs.end() - 1, updates.begin(), updates.end());
+    loop.header->instrs.insert(loop.header->instrs.begin(), phis.begin(), phis.end());
+    return true;
+}
+
+} // namespace
+
+bool simplifyInductionVariables(Function &func, const std::unordered_set<std::string> *removableFunctions,
+                                SCEVStats *stats) {
+    func.removeUnreachableBlocks();
+    SCEVStats local;
+    // 每次改动后重新分析：删掉循环改变了 CFG，新加的 phi 也需要重新求演化
+    for (bool again = true; again;) {
+        again = false;
+        DominatorTree dt(func);
+        auto loops = findNaturalLoops(dt);
+        ScalarEvolution se(func, loops);
+        for (auto &loop : loops) {
+            if (!loop.preheader() || loop.latches.size() != 1) continue;
+            if (replaceWithExitValues(func, loop, dt, se, removableFunctions, local) ||
+                reduceMultiplications(func, loop, dt, se, local)) {
+                again = true;
+                break;
+            }
+        }
+    }
+    if (stats) {
+        stats->loopsDeleted += local.loopsDeleted;
+        stats->exitValues += local.exitValues;
+        stats->strengthReduced += local.strengthReduced;
+    }
+    return local.loopsDeleted || local.strengthReduced;
+}
+
+} // namespace ir
@@ -0,0 +1,224 @@
+#include "analysis.h"
+#include "callgraph.h"
+#include "passes.h"
+#include <algorithm>
+#include <ostream>
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+constexpr int kLoopBonus = 20;          // 每层循环加的阈值，最多算 3 层
+constexpr int kConstantArgBonus = 10;   // 每个被用到的立即数实参：内联后可以常量传播
+constexpr int kLeafBonus = 10;          // 被调用者不再调用别的函数：内联后调用者省掉的不只是这一次调用
+constexpr int kMaxCallerSize = 1000;    // 调用者长到这么大就不再往里内联
+
+bool callsItself(const Function &func) {
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Call && instr.callee == func.name) return true;
+        }
+    }
+    return false;
+}
+
+// 优化后的函数体里一条 ret 都没有：调用永远不会返回，内联只会留下一个走不到的后继块
+bool neverReturns(const Function &func) {
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Ret) return false;
+        }
+    }
+    return true;
+}
+
+bool isLeaf(const Function &func) {
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Call) return false;
+        }
+    }
+    return true;
+}
+
+// 把 bb 中第 pos 条指令（对 callee 的调用）换成 callee 函数体的副本，返回接着调用之后执行的块
+BasicBlock *inlineCall(Function &caller, BasicBlock *bb, size_t pos, const Function &callee) {
+    Instr call = std::move(bb->instrs[pos]);
+
+    // 调用之后的指令移到新块，bb 的后继中来自 bb 的 phi 入边改为来自它
+    BasicBlock *cont = caller.newBlockAfter("inline.cont", bb);
+    cont->instrs.assign(std::make_move_iterator(bb->instrs.begin() + pos + 1),
+                        std::make_move_iterator(bb->instrs.end()));
+    bb->instrs.erase(bb->instrs.begin() + pos, bb->instrs.end());
+    for (BasicBlock *succ : bb->succs) {
+        for (auto &phi : succ->instrs) {
+            if (phi.op != Opcode::Phi) break;
+            for (auto &from : phi.blocks) {
+                if (from == bb) from = cont;
+            }
+        }
+    }
+
+    // 复制函数体：寄存器整体平移，栈槽在调用者中重新分配，块按原顺序放在 bb 和 cont 之间
+    int regBase = caller.numRegs;
+    caller.numRegs += callee.numRegs;
+    std::vector<int> slotMap;
+    for (auto &slot : callee.slots) slotMap.push_back(caller.newSlot(callee.name + "." + slot));
+    std::unordered_map<const BasicBlock *, BasicBlock *> blockMap;
+    BasicBlock *last = bb;
+    for (auto &src : callee.blocks) {
+        last = caller.newBlockAfter(callee.name + "." + src->name + ".", last);
+        blockMap[src.get()] = last;
+    }
+
+    Instr result(Opcode::Phi);
+    result.dst = call.dst;
+    for (auto &src : callee.blocks) {
+        BasicBlock *copy = blockMap[src.get()];
+        for (const Instr &orig : src->instrs) {
+            Instr instr = orig;
+            if (instr.dst >= 0) instr.dst += regBase;
+            for (auto &v : instr.ops) {
+                if (v.isReg()) v.num += regBase;
+            }
+            for (auto &target : instr.blocks) target = blockMap[target];
+            if (instr.op == Opcode::Load || instr.op == Opcode::Store) instr.index = slotMap[instr.index];
+            if (instr.op == Opcode::Arg) {
+                // 形参直接取实参；复制由后面的 SCCP/GVN 传播掉
+                instr.op = Opcode::Copy;
+                instr.ops = {call.ops[instr.index]};
+                instr.index = -1;
+            } else if (instr.op == Opcode::Ret) {
+                if (call.dst >= 0) {
+                    result.ops.push_back(instr.ops[0]);
+                    result.blocks.push_back(copy);
+                }
+                instr = Instr(Opcode::Jmp);
+                instr.blocks = {cont};
+            }
+            copy->instrs.push_back(std::move(instr));
+        }
+    }
+
+    // 返回值：只有一个 ret 时是复制，否则是 cont 开头的 phi
+    if (call.dst >= 0) {
+        if (result.ops.size() == 1) {
+            result.op = Opcode::Copy;
+            result.blocks.clear();
+        }
+        cont->instrs.insert(cont->instrs.begin(), std::move(result));
+    }
+    Instr jmp(Opcode::Jmp);
+    jmp.blocks = {blockMap[callee.entry()]};
+    bb->instrs.push_back(std::move(jmp));
+    caller.rebuildCFG();
+    return cont;
+}
+
+} // namespace
+
+int codeSize(const Function &func) {
+    int size = 0;
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            size += instr.op != Opcode::Phi && instr.op != Opcode::Arg && instr.op != Opcode::Ret &&
+                    instr.op != Opcode::Jmp;
+        }
+    }
+    return size;
+}
+
+bool inlineCalls(Function &caller, const Module &module, const std::unordered_set<std::string> &mutuallyRecursive,
+                 int threshold, std::ostream *remarks, InlineStats *stats) {
+    std::unordered_map<const BasicBlock *, int> depth;
+    DominatorTree dt(caller);
+    for (auto &loop : findNaturalLoops(dt)) {
+        for (const BasicBlock *bb : loop.blocks) depth[bb] = std::max(depth[bb], loop.depth);
+    }
+    int callerSize = codeSize(caller);
+    bool changed = false;
+
+    // 只看调用者原有的调用点；内联进来的函数体中的调用在处理被调用者时已经决定过
+    std::vector<BasicBlock *> original;
+    for (auto &bb : caller.blocks) original.push_back(bb.get());
+    for (BasicBlock *bb : original) {
+        int loopDepth = depth.count(bb) ? depth[bb] : 0;
+        for (size_t i = 0; i < bb->instrs.size(); i++) {
+            const Instr &call = bb->instrs[i];
+            if (call.op != Opcode::Call) continue;
+            Function *callee = module.getFunction(call.callee);
+            bool inlined = false;
+            std::string reason;
+            if (!callee) {
+                reason = "no definition in this module";
+            } else if (mutuallyRecursive.count(callee->name) || callsItself(*callee)) {
+                reason = "@" + callee->name + " is recursive";
+            } else if (neverReturns(*callee)) {
+                reason = "@" + callee->name + " never returns";
+            } else {
+                // 代价：函数体的大小减去调用本身（call 和传参）；阈值按调用点的热度和收益放宽
+                int size = codeSize(*callee);
+                int cost = std::max(0, size - 1 - (int)call.ops.size());
+                int limit = threshold;
+                std::string why = std::to_string(threshold);
+                if (loopDepth > 0) {
+                    int bonus = kLoopBonus * std::min(loopDepth, 3);
+                    limit += bonus;
+                    why += " + loop depth " + std::to_string(loopDepth) + " " + std::to_string(bonus);
+                }
+                int constants = 0;
+                for (auto &src : callee->blocks) {
+                    for (auto &instr : src->instrs) {
+                        constants += instr.op == Opcode::Arg && call.ops[instr.index].isImm();
+                    }
+                }
+                if (constants) {
+                    limit += kConstantArgBonus * constants;
+                    why += " + " + std::to_string(constants) + " constant args " +
+                           std::to_string(kConstantArgBonus * constants);
+                }
+                if (isLeaf(*callee)) {
+                    limit += kLeafBonus;
+                    why += " + leaf " + std::to_string(kLeafBonus);
+                }
+                std::string costs = "cost " + std::to_string(cost);
+                if (cost > limit) {
+                    reason = costs + " > threshold " + std::to_string(limit) + " = " + why;
+                } else if (callerSize + size > kMaxCallerSize) {
+                    reason = "@" + caller.name + " would grow past " + std::to_string(kMaxCallerSize) +
+                             " instructions";
+                } else {
+                    inlined = true;
+                    reason = costs + " <= threshold " + std::to_string(limit) + " = " + why;
+                    callerSize += size;
+                }
+            }
+            if (remarks) {
+                *remarks << "inline: @" << caller.name << " -> @" << call.callee << ": "
+                         << (inlined ? "inlined (" : "not inlined (") << reason << ")\n";
+            }
+            if (stats) (inlined ? stats->inlined : stats->notInlined)++;
+            if (!inlined) continue;
+            // 调用之后的指令到了新块里，接着从它开头扫描；新块与 bb 在同样的循环中
+            bb = inlineCall(caller, bb, i, *callee);
+            i = (size_t)-1;
+            changed = true;
+        }
+    }
+    return changed;
+}
+
+bool inlineCalls(Module &module, int threshold, std::ostream *remarks, InlineStats *stats) {
+    CallGraph graph(module);
+    auto mutuallyRecursive = graph.mutuallyRecursive();
+    bool changed = false;
+    for (auto &scc : graph.sccs()) {
+        for (auto &name : scc) {
+            changed |= inlineCalls(*module.getFunction(name), module, mutuallyRecursive, threshold, remarks, stats);
+        }
+    }
+    return changed;
+}
+
+} // namespace ir
@@ -0,0 +1,156 @@
+#include "interp.h"
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+using Status = EvalResult::Status;
+
+constexpr size_t kMaxCallDepth = 100000;   // 更深的递归在目标机上多半已经栈溢出
+
+struct Frame {
+    const Function *func;
+    std::vector<int> args;
+    std::vector<int> regs;
+    std::vector<int> slots;
+    const BasicBlock *block = nullptr;
+    size_t pc = 0;
+    int resultReg = -1;     // 调用者中接收返回值的寄存器
+};
+
+// 调用栈显式保存在 stack 中，深递归不占用编译器自己的栈
+class Interpreter {
+public:
+    explicit Interpreter(const Module &module) {
+        for (auto &f : module.functions) functions[f->name] = f.get();
+        for (auto &g : module.globals) globals[g.name].assign(g.words, 0);
+    }
+
+    EvalResult run(const std::string &name, const std::vector<int> &args, long long maxSteps) {
+        EvalResult result;
+        auto it = functions.find(name);
+        if (it == functions.end()) return stop(result, Status::External, name);
+        push(*it->second, args, -1);
+        while (true) {
+            if (result.steps >= maxSteps) return stop(result, Status::OutOfSteps, "");
+            result.steps++;
+            Frame &frame = stack.back();
+            const Instr &instr = frame.block->instrs[frame.pc++];
+            if (isBinary(instr.op)) {
+                int value;
+                if (!evalBinary(instr.op, operand(frame, instr.ops[0]), operand(frame, instr.ops[1]), value))
+                    return stop(result, Status::Trap, "division by zero");
+                frame.regs[instr.dst] = value;
+                continue;
+            }
+            if (isUnary(instr.op)) {
+                frame.regs[instr.dst] = evalUnary(instr.op, operand(frame, instr.ops[0]));
+                continue;
+            }
+            switch (instr.op) {
+                case Opcode::Copy:
+                    frame.regs[instr.dst] = operand(frame, instr.ops[0]);
+                    break;
+                case Opcode::Arg:
+                    frame.regs[instr.dst] = frame.args[instr.index];
+                    break;
+                case Opcode::Load:
+                    frame.regs[instr.dst] = frame.slots[instr.index];
+                    break;
+                case Opcode::Store:
+                    frame.slots[instr.index] = operand(frame, instr.ops[0]);
+                    break;
+                case Opcode::LoadGlobal:
+                case Opcode::StoreGlobal: {
+                    std::vector<int> &table = globals[instr.callee];
+                    int index = operand(frame, instr.ops[0]);
+                    if (index < 0 || index >= (int)table.size())
+                        return stop(result, Status::Trap, "global index out of range");
+                    if (instr.op == Opcode::LoadGlobal) frame.regs[instr.dst] = table[index];
+                    else table[index] = operand(frame, instr.ops[1]);
+                    break;
+                }
+                case Opcode::Call: {
+                    auto callee = functions.find(instr.callee);
+                    if (callee == functions.end()) return stop(result, Status::External, instr.callee);
+                    if (stack.size() >= kMaxCallDepth) return stop(result, Status::Trap, "call depth limit");
+                    std::vector<int> args;
+                    for (auto &v : instr.ops) args.push_back(operand(frame, v));
+                    push(*callee->second, args, instr.dst);     // frame 此后失效
+                    break;
+                }
+                case Opcode::Jmp:
+                    result.steps += jump(frame, instr.blocks[0]);
+                    break;
+                case Opcode::Br:
+                    result.steps += jump(frame, instr.blocks[operand(frame, instr.ops[0]) ? 0 : 1]);
+                    break;
+                case Opcode::Ret: {
+                    int value = instr.ops.empty() ? 0 : operand(frame, instr.ops[0]);
+                    int dst = frame.resultReg;
+                    stack.pop_back();
+                    if (stack.empty()) {
+                        result.value = value;
+                        return result;
+                    }
+                    if (dst >= 0) stack.back().regs[dst] = value;
+                    break;
+                }
+                default:
+                    return stop(result, Status::Trap, std::string("unexpected ") + opcodeName(instr.op));
+            }
+        }
+    }
+
+private:
+    std::unordered_map<std::string, const Function *> functions;
+    std::unordered_map<std::string, std::vector<int>> globals;
+    std::vector<Frame> stack;
+
+    static EvalResult &stop(EvalResult &result, Status status, const std::string &detail) {
+        result.status = status;
+        result.detail = detail;
+        return result;
+    }
+
+    static int operand(const Frame &frame, const Value &v) { return v.isImm() ? v.num : frame.regs[v.num]; }
+
+    void push(const Function &func, const std::vector<int> &args, int resultReg) {
+        Frame frame;
+        frame.func = &func;
+        frame.args = args;
+        frame.regs.assign(func.numRegs, 0);
+        frame.slots.assign(func.slots.size(), 0);
+        frame.block = func.entry();
+        frame.resultReg = resultReg;
+        stack.push_back(std::move(frame));
+    }
+
+    // 跳到 target：块首的 phi 按来路同时取值。返回执行的 phi 数
+    static long long jump(Frame &frame, const BasicBlock *target) {
+        std::vector<int> incoming;
+        for (auto &phi : target->instrs) {
+            if (phi.op != Opcode::Phi) break;
+            for (size_t k = 0; k < phi.blocks.size(); k++) {
+                if (phi.blocks[k] == frame.block) {
+                    incoming.push_back(operand(frame, phi.ops[k]));
+                    break;
+                }
+            }
+        }
+        for (size_t k = 0; k < incoming.size(); k++) frame.regs[target->instrs[k].dst] = incoming[k];
+        frame.block = target;
+        frame.pc = incoming.size();
+        return (long long)incoming.size();
+    }
+};
+
+} // namespace
+
+EvalResult evaluateFunction(const Module &module, const std::string &name, const std::vector<int> &args,
+                            long long maxSteps) {
+    return Interpreter(module).run(name, args, maxSteps);
+}
+
+} // namespace ir
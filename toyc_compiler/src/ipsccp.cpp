@@ -0,0 +1,265 @@
+#include "analysis.h"
+#include "callgraph.h"
+#include "passes.h"
+#include <map>
+#include <optional>
+#include <ostream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+constexpr int kMaxSpecializeSize = 150;     // 比这大的函数不克隆
+constexpr int kMaxSpecializations = 4;      // 每个函数最多几个特化版本
+
+struct CallSite {
+    Function *caller;
+    Instr *call;
+};
+
+std::vector<CallSite> callSitesOf(Module &module, const std::string &callee) {
+    std::vector<CallSite> sites;
+    for (auto &f : module.functions) {
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op == Opcode::Call && instr.callee == callee) sites.push_back({f.get(), &instr});
+            }
+        }
+    }
+    return sites;
+}
+
+// 第 index 个形参的 arg 定义的寄存器；没有 arg（已经换成常量或删掉）时为 -1
+int argReg(const Function &func, int index) {
+    for (auto &instr : func.entry()->instrs) {
+        if (instr.op == Opcode::Arg && instr.index == index) return instr.dst;
+    }
+    return -1;
+}
+
+bool isUsed(const Function &func, int reg) {
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            for (auto &v : instr.ops) {
+                if (v.isReg() && v.num == reg) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 形参被用到：有 arg 并且它的结果有人用
+bool paramUsed(const Function &func, int index) {
+    int reg = argReg(func, index);
+    return reg >= 0 && isUsed(func, reg);
+}
+
+// arg 改为常量的复制，由 SCCP 传播掉
+void bindParam(Function &func, int index, int value) {
+    for (auto &instr : func.entry()->instrs) {
+        if (instr.op == Opcode::Arg && instr.index == index) {
+            instr.op = Opcode::Copy;
+            instr.ops = {Value::imm(value)};
+            instr.index = -1;
+        }
+    }
+}
+
+// 从签名中删掉没有用到的形参，后面的形参序号前移；调用点由调用者负责
+void removeParam(Function &func, int index) {
+    auto &entry = func.entry()->instrs;
+    for (size_t i = 0; i < entry.size();) {
+        if (entry[i].op == Opcode::Arg && entry[i].index == index) {
+            entry.erase(entry.begin() + i);
+            continue;
+        }
+        if (entry[i].op == Opcode::Arg && entry[i].index > index) entry[i].index--;
+        i++;
+    }
+    func.paramNames.erase(func.paramNames.begin() + index);
+}
+
+std::unique_ptr<Function> cloneFunction(const Function &src, const std::string &name) {
+    auto clone = std::make_unique<Function>();
+    clone->name = name;
+    clone->retType = src.retType;
+    clone->paramNames = src.paramNames;
+    clone->slots = src.slots;
+    clone->numRegs = src.numRegs;
+    clone->internal = true;
+    std::unordered_map<const BasicBlock *, BasicBlock *> blockMap;
+    for (auto &bb : src.blocks) blockMap[bb.get()] = clone->newBlock(clone->blocks.empty() ? bb->name : bb->name + ".");
+    for (auto &bb : src.blocks) {
+        BasicBlock *copy = blockMap[bb.get()];
+        copy->instrs = bb->instrs;
+        for (auto &instr : copy->instrs) {
+            for (auto &target : instr.blocks) target = blockMap[target];
+        }
+    }
+    clone->rebuildCFG();
+    return clone;
+}
+
+// 把每个调用点都传同一个常量的形参绑定为常量。f 调用自己时原样传回的形参不算另一个值
+bool bindConstantArgs(Module &module, Function &f, std::ostream *remarks, IPSCCPStats *stats) {
+    auto sites = callSitesOf(module, f.name);
+    if (sites.empty()) return false;
+    bool changed = false;
+    for (int i = 0; i < (int)f.paramNames.size(); i++) {
+        int reg = argReg(f, i);
+        if (reg < 0 || !isUsed(f, reg)) continue;
+        std::optional<int> value;
+        bool constant = true;
+        for (auto &site : sites) {
+            const Value &v = site.call->ops[i];
+            if (site.caller == &f && v.isReg() && v.num == reg) continue;
+            if (!v.isImm() || (value && *value != v.num)) {
+                constant = false;
+                break;
+            }
+            value = v.num;
+        }
+        if (!constant || !value) continue;
+        bindParam(f, i, *value);
+        changed = true;
+        if (stats) stats->constantArgs++;
+        if (remarks) *remarks << "ipsccp: @" << f.name << ": argument " << f.paramNames[i] << " is always " << *value << "\n";
+    }
+    // 常量继续传给 f 调用的函数
+    if (changed) sparseConditionalConstantPropagation(f);
+    return changed;
+}
+
+bool removeDeadParams(Module &module, Function &f, std::ostream *remarks, IPSCCPStats *stats) {
+    bool changed = false;
+    for (int i = (int)f.paramNames.size() - 1; i >= 0; i--) {
+        if (paramUsed(f, i)) continue;
+        if (remarks) *remarks << "ipsccp: @" << f.name << ": removed unused argument " << f.paramNames[i] << "\n";
+        for (auto &site : callSitesOf(module, f.name)) site.call->ops.erase(site.call->ops.begin() + i);
+        removeParam(f, i);
+        changed = true;
+        if (stats) stats->deadArgs++;
+    }
+    return changed;
+}
+
+// 循环里带常量实参的调用改为调用代入这些常量的特化版本
+bool specializeHotCalls(Module &module, std::ostream *remarks, IPSCCPStats *stats) {
+    CallGraph graph(module);
+    std::map<std::pair<std::string, std::vector<std::pair<int, int>>>, std::string> clones;
+    std::unordered_map<std::string, int> cloneCount;
+    std::vector<Function *> originals;
+    for (auto &f : module.functions) originals.push_back(f.get());
+    bool changed = false;
+    for (Function *caller : originals) {
+        DominatorTree dt(*caller);
+        std::unordered_set<const BasicBlock *> inLoop;
+        for (auto &loop : findNaturalLoops(dt)) inLoop.insert(loop.blocks.begin(), loop.blocks.end());
+        for (auto &bb : caller->blocks) {
+            if (!inLoop.count(bb.get())) continue;
+            for (auto &call : bb->instrs) {
+                if (call.op != Opcode::Call || !graph.contains(call.callee)) continue;
+                Function *callee = module.getFunction(call.callee);
+                if (callee == caller || callee->name == "main" || graph.isRecursive(callee->name)) continue;
+                std::vector<std::pair<int, int>> constants;
+                for (int i = 0; i < (int)call.ops.size(); i++) {
+                    if (call.ops[i].isImm() && paramUsed(*callee, i)) constants.push_back({i, call.ops[i].num});
+                }
+                if (constants.empty() || codeSize(*callee) > kMaxSpecializeSize) continue;
+                auto key = std::make_pair(callee->name, constants);
+                auto it = clones.find(key);
+                if (it == clones.end()) {
+                    int &count = cloneCount[callee->name];
+                    if (count >= kMaxSpecializations) continue;
+                    std::string name = callee->name + ".spec" + std::to_string(count++);
+                    auto clone = cloneFunction(*callee, name);
+                    for (auto &[index, value] : constants) bindParam(*clone, index, value);
+                    for (auto c = constants.rbegin(); c != constants.rend(); ++c) removeParam(*clone, c->first);
+                    module.functions.push_back(std::move(clone));
+                    it = clones.emplace(key, name).first;
+                    if (remarks) {
+                        *remarks << "ipsccp: @" << callee->name << ": specialized as @" << name << " for";
+                        for (auto &[index, value] : constants)
+                            *remarks << " " << callee->paramNames[index] << " = " << value;
+                        *remarks << "\n";
+                    }
+                }
+                call.callee = it->second;
+                for (auto c = constants.rbegin(); c != constants.rend(); ++c) call.ops.erase(call.ops.begin() + c->first);
+                changed = true;
+                if (stats) stats->specialized++;
+            }
+        }
+    }
+    return changed;
+}
+
+} // namespace
+
+bool propagateConstantsAcrossCalls(Module &module, bool closedWorld, std::ostream *remarks, IPSCCPStats *stats) {
+    auto mayRewrite = [&](const Function &f) { return f.internal || (closedWorld && f.name != "main"); };
+    // 绑定常量后 SCCP 可能让更多调用点的实参变成常量，或者删掉调用点
+    auto bindAll = [&] {
+        bool any = false;
+        for (bool again = true; again;) {
+            again = false;
+            for (auto &f : module.functions) {
+                if (mayRewrite(*f) && bindConstantArgs(module, *f, remarks, stats)) again = any = true;
+            }
+        }
+        return any;
+    };
+    // 先绑定所有调用点一致的常量，剩下的才靠特化；特化版本的调用点也可能一致
+    bool changed = bindAll();
+    if (specializeHotCalls(module, remarks, stats)) {
+        bindAll();
+        changed = true;
+    }
+    for (auto &f : module.functions) {
+        if (mayRewrite(*f)) changed = removeDeadParams(module, *f, remarks, stats) || changed;
+    }
+    return changed;
+}
+
+bool propagateConstantReturns(Function &caller, const Module &module, std::ostream *remarks, IPSCCPStats *stats) {
+    std::unordered_map<std::string, std::optional<int>> returns;    // 被调用者总是返回的常量
+    auto constantReturn = [&](const std::string &name) -> std::optional<int> {
+        auto it = returns.find(name);
+        if (it != returns.end()) return it->second;
+        std::optional<int> value;
+        const Function *callee = module.getFunction(name);
+        bool constant = callee && callee->retType == IRType::I32;
+        for (size_t b = 0; constant && b < callee->blocks.size(); b++) {
+            for (auto &instr : callee->blocks[b]->instrs) {
+                if (instr.op != Opcode::Ret) continue;
+                constant = constant && instr.ops[0].isImm() && (!value || *value == instr.ops[0].num);
+                value = instr.ops[0].num;
+            }
+        }
+        return returns[name] = constant ? value : std::nullopt;
+    };
+
+    bool changed = false;
+    for (auto &bb : caller.blocks) {
+        for (size_t i = 0; i < bb->instrs.size(); i++) {
+            Instr &call = bb->instrs[i];
+            if (call.op != Opcode::Call || call.dst < 0 || call.callee == caller.name) continue;
+            auto value = constantReturn(call.callee);
+            if (!value) continue;
+            if (remarks)
+                *remarks << "ipsccp: @" << caller.name << ": @" << call.callee << " always returns " << *value << "\n";
+            Instr result(Opcode::Copy);
+            result.dst = call.dst;
+            result.ops = {Value::imm(*value)};
+            call.dst = -1;
+            bb->instrs.insert(bb->instrs.begin() + i + 1, std::move(result));
+            changed = true;
+            if (stats) stats->constantReturns++;
+        }
+    }
+    return changed;
+}
+
+} // namespace ir
@@ -0,0 +1,527 @@
+#include "ir.h"
+#include "analysis.h"
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+const char *opcodeName(Opcode op) {
+    switch (op) {
+        case Opcode::Add: return "add";
+        case Opcode::Sub: return "sub";
+        case Opcode::Mul: return "mul";
+        case Opcode::Div: return "div";
+        case Opcode::Rem: return "rem";
+        case Opcode::And: return "and";
+        case Opcode::Or: return "or";
+        case Opcode::Xor: return "xor";
+        case Opcode::Lt: return "lt";
+        case Opcode::Gt: return "gt";
+        case Opcode::Le: return "le";
+        case Opcode::Ge: return "ge";
+        case Opcode::Eq: return "eq";
+        case Opcode::Ne: return "ne";
+        case Opcode::Neg: return "neg";
+        case Opcode::Not: return "not";
+        case Opcode::Copy: return "copy";
+        case Opcode::Arg: return "arg";
+        case Opcode::Load: return "load";
+        case Opcode::Store: return "store";
+        case Opcode::LoadGlobal: return "gload";
+        case Opcode::StoreGlobal: return "gstore";
+        case Opcode::Call: return "call";
+        case Opcode::Phi: return "phi";
+        case Opcode::Jmp: return "jmp";
+        case Opcode::Br: return "br";
+        case Opcode::Ret: return "ret";
+    }
+    return "?";
+}
+
+bool isCompare(Opcode op) {
+    return op == Opcode::Lt || op == Opcode::Gt || op == Opcode::Le ||
+           op == Opcode::Ge || op == Opcode::Eq || op == Opcode::Ne;
+}
+
+bool isBinary(Opcode op) {
+    switch (op) {
+        case Opcode::Add: case Opcode::Sub: case Opcode::Mul:
+        case Opcode::Div: case Opcode::Rem:
+        case Opcode::And: case Opcode::Or: case Opcode::Xor:
+            return true;
+        default:
+            return isCompare(op);
+    }
+}
+
+bool isUnary(Opcode op) {
+    return op == Opcode::Neg || op == Opcode::Not || op == Opcode::Copy;
+}
+
+bool evalBinary(Opcode op, int a, int b, int &result) {
+    uint32_t ua = (uint32_t)a, ub = (uint32_t)b;
+    switch (op) {
+        case Opcode::Add: result = (int)(ua + ub); return true;
+        case Opcode::Sub: result = (int)(ua - ub); return true;
+        case Opcode::Mul: result = (int)(ua * ub); return true;
+        case Opcode::Div: case Opcode::Rem:
+            if (b == 0) return false;
+            // INT_MIN / -1 溢出：与 RISC-V 的 div/rem 一致
+            if (a == INT32_MIN && b == -1) result = op == Opcode::Div ? INT32_MIN : 0;
+            else result = op == Opcode::Div ? a / b : a % b;
+            return true;
+        case Opcode::And: result = a & b; return true;
+        case Opcode::Or: result = a | b; return true;
+        case Opcode::Xor: result = a ^ b; return true;
+        case Opcode::Lt: result = a < b; return true;
+        case Opcode::Gt: result = a > b; return true;
+        case Opcode::Le: result = a <= b; return true;
+        case Opcode::Ge: result = a >= b; return true;
+        case Opcode::Eq: result = a == b; return true;
+        case Opcode::Ne: result = a != b; return true;
+        default: return false;
+    }
+}
+
+int evalUnary(Opcode op, int a) {
+    switch (op) {
+        case Opcode::Neg: return (int)(0u - (uint32_t)a);
+        case Opcode::Not: return !a;
+        default: return a;
+    }
+}
+
+bool binaryOpcode(const std::string &op, Opcode &result) {
+    static const std::unordered_map<std::string, Opcode> binOps = {
+        {"+", Opcode::Add}, {"-", Opcode::Sub}, {"*", Opcode::Mul},
+        {"/", Opcode::Div}, {"%", Opcode::Rem},
+        {"<", Opcode::Lt}, {">", Opcode::Gt}, {"<=", Opcode::Le},
+        {">=", Opcode::Ge}, {"==", Opcode::Eq}, {"!=", Opcode::Ne},
+    };
+    auto it = binOps.find(op);
+    if (it == binOps.end()) return false;
+    result = it->second;
+    return true;
+}
+
+bool unaryOpcode(const std::string &op, Opcode &result) {
+    if (op == "+") result = Opcode::Copy;
+    else if (op == "-") result = Opcode::Neg;
+    else if (op == "!") result = Opcode::Not;
+    else return false;
+    return true;
+}
+
+bool Instr::hasSideEffects() const {
+    return op == Opcode::Store || op == Opcode::StoreGlobal || op == Opcode::Call || isTerminator();
+}
+
+// ---------------------------------------------------------------------------
+// Function / Module
+// ---------------------------------------------------------------------------
+
+int Function::newSlot(const std::string &hint) {
+    std::string name = hint;
+    int suffix = 1;
+    while (std::find(slots.begin(), slots.end(), name) != slots.end()) {
+        name = hint + "." + std::to_string(suffix++);
+    }
+    slots.push_back(name);
+    return (int)slots.size() - 1;
+}
+
+BasicBlock *Function::newBlock(const std::string &hint) {
+    std::string name = blocks.empty() ? hint : hint + std::to_string(blockCounter++);
+    blocks.push_back(std::make_unique<BasicBlock>(name));
+    return blocks.back().get();
+}
+
+BasicBlock *Function::newBlockAfter(const std::string &hint, BasicBlock *after) {
+    BasicBlock *bb = newBlock(hint);
+    auto owned = std::move(blocks.back());
+    blocks.pop_back();
+    auto it = std::find_if(blocks.begin(), blocks.end(), [&](const auto &b) { return b.get() == after; });
+    blocks.insert(it == blocks.end() ? it : it + 1, std::move(owned));
+    return bb;
+}
+
+void Function::rebuildCFG() {
+    for (auto &bb : blocks) {
+        bb->preds.clear();
+        bb->succs.clear();
+    }
+    for (auto &bb : blocks) {
+        if (!bb->hasTerminator()) continue;
+        for (BasicBlock *target : bb->terminator().blocks) {
+            if (std::find(bb->succs.begin(), bb->succs.end(), target) != bb->succs.end()) continue;
+            bb->succs.push_back(target);
+            target->preds.push_back(bb.get());
+        }
+    }
+}
+
+bool Function::removeUnreachableBlocks() {
+    std::unordered_set<BasicBlock *> reachable;
+    std::vector<BasicBlock *> worklist{entry()};
+    reachable.insert(entry());
+    while (!worklist.empty()) {
+        BasicBlock *bb = worklist.back();
+        worklist.pop_back();
+        if (!bb->hasTerminator()) continue;
+        for (BasicBlock *target : bb->terminator().blocks) {
+            if (reachable.insert(target).second) worklist.push_back(target);
+        }
+    }
+    if (reachable.size() == blocks.size()) return false;
+
+    for (auto &bb : blocks) {
+        if (!reachable.count(bb.get())) continue;
+        for (auto &instr : bb->instrs) {
+            if (instr.op != Opcode::Phi) break;
+            for (size_t i = instr.blocks.size(); i-- > 0;) {
+                if (!reachable.count(instr.blocks[i])) {
+                    instr.blocks.erase(instr.blocks.begin() + i);
+                    instr.ops.erase(instr.ops.begin() + i);
+                }
+            }
+        }
+    }
+    blocks.erase(std::remove_if(blocks.begin(), blocks.end(),
+                                [&](const std::unique_ptr<BasicBlock> &bb) { return !reachable.count(bb.get()); }),
+                 blocks.end());
+    rebuildCFG();
+    return true;
+}
+
+Function *Module::getFunction(const std::string &name) const {
+    for (auto &f : functions) {
+        if (f->name == name) return f.get();
+    }
+    return nullptr;
+}
+
+const Global *Module::getGlobal(const std::string &name) const {
+    for (auto &g : globals) {
+        if (g.name == name) return &g;
+    }
+    return nullptr;
+}
+
+// ---------------------------------------------------------------------------
+// 打印
+// ---------------------------------------------------------------------------
+
+static void printValue(std::ostream &os, const Value &v) {
+    if (v.isReg()) os << "%" << v.num;
+    else if (v.isImm()) os << v.num;
+    else os << "<none>";
+}
+
+void printInstr(std::ostream &os, const Function &func, const Instr &instr) {
+    if (instr.dst >= 0) os << "%" << instr.dst << " = ";
+    os << opcodeName(instr.op);
+    switch (instr.op) {
+        case Opcode::Arg:
+            os << " " << instr.index;
+            break;
+        case Opcode::Load:
+            os << " $" << func.slots[instr.index];
+            break;
+        case Opcode::Store:
+            os << " $" << func.slots[instr.index] << ", ";
+            printValue(os, instr.ops[0]);
+            break;
+        case Opcode::LoadGlobal:
+        case Opcode::StoreGlobal:
+            os << " @" << instr.callee << "[";
+            printValue(os, instr.ops[0]);
+            os << "]";
+            if (instr.op == Opcode::StoreGlobal) {
+                os << ", ";
+                printValue(os, instr.ops[1]);
+            }
+            break;
+        case Opcode::Call:
+            os << (instr.type == IRType::Void ? " void " : " i32 ") << "@" << instr.callee << "(";
+            for (size_t i = 0; i < instr.ops.size(); i++) {
+                if (i) os << ", ";
+                printValue(os, instr.ops[i]);
+            }
+            os << ")";
+            break;
+        case Opcode::Phi:
+            for (size_t i = 0; i < instr.ops.size(); i++) {
+                os << (i ? ", [" : " [");
+                printValue(os, instr.ops[i]);
+                os << ", " << instr.blocks[i]->name << "]";
+            }
+            break;
+        default:
+            for (size_t i = 0; i < instr.ops.size(); i++) {
+                os << (i ? ", " : " ");
+                printValue(os, instr.ops[i]);
+            }
+            for (size_t i = 0; i < instr.blocks.size(); i++) {
+                os << ((i || !instr.ops.empty()) ? ", " : " ") << instr.blocks[i]->name;
+            }
+            break;
+    }
+}
+
+void printFunction(std::ostream &os, const Function &func) {
+    os << "func " << (func.retType == IRType::Void ? "void" : "i32") << " @" << func.name << "(";
+    for (size_t i = 0; i < func.paramNames.size(); i++) {
+        if (i) os << ", ";
+        os << func.paramNames[i];
+    }
+    os << ") {\n";
+    if (!func.slots.empty()) {
+        os << "  ; slots:";
+        for (auto &s : func.slots) os << " $" << s;
+        os << "\n";
+    }
+    for (auto &bb : func.blocks) {
+        os << bb->name << ":";
+        if (!bb->preds.empty()) {
+            os << "\t\t\t; preds:";
+            for (auto *p : bb->preds) os << " " << p->name;
+        }
+        os << "\n";
+        for (auto &instr : bb->instrs) {
+            os << "  ";
+            printInstr(os, func, instr);
+            os << "\n";
+        }
+    }
+    os << "}\n";
+}
+
+void printModule(std::ostream &os, const Module &module) {
+    for (auto &g : module.globals) os << "global @" << g.name << "[" << g.words << "]\n";
+    for (size_t i = 0; i < module.functions.size(); i++) {
+        if (i || !module.globals.empty()) os << "\n";
+        printFunction(os, *module.functions[i]);
+    }
+}
+
+// ---------------------------------------------------------------------------
+// 校验
+// ---------------------------------------------------------------------------
+
+namespace {
+
+struct Verifier {
+    const Function &func;
+    const Module *module;
+    std::ostringstream msg;
+
+    Verifier(const Function &f, const Module *m) : func(f), module(m) {}
+
+    bool fail(const BasicBlock *bb, const Instr *instr, const std::string &what) {
+        msg << "in @" << func.name;
+        if (bb) msg << ", block " << bb->name;
+        if (instr) {
+            msg << ", '";
+            printInstr(msg, func, *instr);
+            msg << "'";
+        }
+        msg << ": " << what;
+        return false;
+    }
+
+    size_t expectedOperands(const Instr &instr) const {
+        if (isBinary(instr.op)) return 2;
+        switch (instr.op) {
+            case Opcode::Neg: case Opcode::Not: case Opcode::Copy:
+            case Opcode::Store: case Opcode::Br: case Opcode::LoadGlobal:
+                return 1;
+            case Opcode::StoreGlobal:
+                return 2;
+            case Opcode::Arg: case Opcode::Load: case Opcode::Jmp:
+                return 0;
+            default:
+                return instr.ops.size();
+        }
+    }
+
+    bool run() {
+        if (func.blocks.empty()) return fail(nullptr, nullptr, "function has no blocks");
+
+        std::unordered_set<const BasicBlock *> owned;
+        std::unordered_set<std::string> names;
+        for (auto &bb : func.blocks) {
+            owned.insert(bb.get());
+            if (!names.insert(bb->name).second) return fail(bb.get(), nullptr, "duplicate block name");
+        }
+        if (!func.entry()->preds.empty()) return fail(func.entry(), nullptr, "entry block has predecessors");
+
+        std::vector<int> defCount(func.numRegs, 0);
+        for (auto &bb : func.blocks) {
+            if (!bb->hasTerminator()) return fail(bb.get(), nullptr, "block does not end with a terminator");
+            bool phisDone = false;
+            for (size_t i = 0; i < bb->instrs.size(); i++) {
+                const Instr &instr = bb->instrs[i];
+                if (instr.isTerminator() && i + 1 != bb->instrs.size())
+                    return fail(bb.get(), &instr, "terminator in the middle of a block");
+                if (instr.op == Opcode::Phi) {
+                    if (phisDone) return fail(bb.get(), &instr, "phi after non-phi instruction");
+                } else {
+                    phisDone = true;
+                }
+                if (!checkInstr(bb.get(), instr, owned)) return false;
+                if (instr.dst >= 0) {
+                    if (instr.dst >= func.numRegs) return fail(bb.get(), &instr, "register out of range");
+                    defCount[instr.dst]++;
+                }
+            }
+
+            // preds/succs 必须与终结指令一致
+            std::vector<BasicBlock *> succs;
+            for (BasicBlock *t : bb->terminator().blocks) {
+                if (std::find(succs.begin(), succs.end(), t) == succs.end()) succs.push_back(t);
+            }
+            if (succs != bb->succs) return fail(bb.get(), nullptr, "successor list out of date");
+            for (BasicBlock *s : succs) {
+                if (std::count(s->preds.begin(), s->preds.end(), bb.get()) != 1)
+                    return fail(bb.get(), nullptr, "predecessor list of " + s->name + " out of date");
+            }
+            for (BasicBlock *p : bb->preds) {
+                if (!owned.count(p) || std::find(p->succs.begin(), p->succs.end(), bb.get()) == p->succs.end())
+                    return fail(bb.get(), nullptr, "stale predecessor " + p->name);
+            }
+        }
+
+        for (int r = 0; r < func.numRegs; r++) {
+            if (defCount[r] > 1) return fail(nullptr, nullptr, "%" + std::to_string(r) + " defined more than once");
+        }
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) {
+                    if (v.isReg() && (v.num < 0 || v.num >= func.numRegs || defCount[v.num] == 0))
+                        return fail(bb.get(), &instr, "use of undefined register %" + std::to_string(v.num));
+                }
+            }
+        }
+        return checkDominance();
+    }
+
+    // 定义必须支配所有使用；phi 的使用位于对应前驱的末尾
+    bool checkDominance() {
+        std::vector<std::pair<const BasicBlock *, size_t>> defAt(func.numRegs, {nullptr, 0});
+        for (auto &bb : func.blocks) {
+            for (size_t i = 0; i < bb->instrs.size(); i++) {
+                if (bb->instrs[i].dst >= 0) defAt[bb->instrs[i].dst] = {bb.get(), i};
+            }
+        }
+        DominatorTree dt(func);
+        for (auto &bb : func.blocks) {
+            if (!dt.isReachable(bb.get())) return fail(bb.get(), nullptr, "unreachable block");
+            for (size_t i = 0; i < bb->instrs.size(); i++) {
+                const Instr &instr = bb->instrs[i];
+                for (size_t k = 0; k < instr.ops.size(); k++) {
+                    if (!instr.ops[k].isReg()) continue;
+                    auto [defBB, defIdx] = defAt[instr.ops[k].num];
+                    bool ok;
+                    if (instr.op == Opcode::Phi) ok = dt.dominates(defBB, instr.blocks[k]);
+                    else if (defBB == bb.get()) ok = defIdx < i;
+                    else ok = dt.dominates(defBB, bb.get());
+                    if (!ok) return fail(bb.get(), &instr, "use of %" + std::to_string(instr.ops[k].num) +
+                                                               " is not dominated by its definition");
+                }
+            }
+        }
+        return true;
+    }
+
+    bool checkInstr(const BasicBlock *bb, const Instr &instr,
+                    const std::unordered_set<const BasicBlock *> &owned) {
+        if (instr.ops.size() != expectedOperands(instr)) return fail(bb, &instr, "wrong number of operands");
+        for (auto &v : instr.ops) {
+            if (v.isNone()) return fail(bb, &instr, "missing operand");
+        }
+        for (auto *t : instr.blocks) {
+            if (!owned.count(t)) return fail(bb, &instr, "target block not in function");
+        }
+
+        bool needsDst = isBinary(instr.op) || isUnary(instr.op) || instr.op == Opcode::Arg ||
+                        instr.op == Opcode::Load || instr.op == Opcode::LoadGlobal || instr.op == Opcode::Phi;
+        bool noDst = instr.op == Opcode::Store || instr.op == Opcode::StoreGlobal || instr.isTerminator();
+        if (needsDst && instr.dst < 0) return fail(bb, &instr, "missing destination");
+        if (noDst && instr.dst >= 0) return fail(bb, &instr, "unexpected destination");
+
+        switch (instr.op) {
+            case Opcode::Arg:
+                if (instr.index < 0 || instr.index >= (int)func.paramNames.size())
+                    return fail(bb, &instr, "argument index out of range");
+                break;
+            case Opcode::Load: case Opcode::Store:
+                if (instr.index < 0 || instr.index >= (int)func.slots.size())
+                    return fail(bb, &instr, "slot index out of range");
+                break;
+            case Opcode::Jmp:
+                if (instr.blocks.size() != 1) return fail(bb, &instr, "jmp needs one target");
+                break;
+            case Opcode::Br:
+                if (instr.blocks.size() != 2) return fail(bb, &instr, "br needs two targets");
+                break;
+            case Opcode::Ret:
+                if (func.retType == IRType::I32 && instr.ops.size() != 1)
+                    return fail(bb, &instr, "missing return value");
+                if (func.retType == IRType::Void && !instr.ops.empty())
+                    return fail(bb, &instr, "void function returns a value");
+                break;
+            case Opcode::Phi: {
+                if (instr.ops.size() != instr.blocks.size()) return fail(bb, &instr, "malformed phi");
+                std::vector<const BasicBlock *> incoming(instr.blocks.begin(), instr.blocks.end());
+                std::vector<const BasicBlock *> preds(bb->preds.begin(), bb->preds.end());
+                std::sort(incoming.begin(), incoming.end());
+                std::sort(preds.begin(), preds.end());
+                if (incoming != preds) return fail(bb, &instr, "phi incoming blocks do not match predecessors");
+                break;
+            }
+            case Opcode::Call:
+                if (instr.ops.size() > 8) return fail(bb, &instr, "more than 8 call arguments");
+                if (instr.type == IRType::Void && instr.dst >= 0) return fail(bb, &instr, "void call has a result");
+                if (module) {
+                    const Function *callee = module->getFunction(instr.callee);
+                    if (callee && callee->paramNames.size() != instr.ops.size())
+                        return fail(bb, &instr, "argument count mismatch");
+                    if (callee && callee->retType != instr.type)
+                        return fail(bb, &instr, "return type mismatch");
+                }
+                break;
+            case Opcode::LoadGlobal: case Opcode::StoreGlobal:
+                if (module && !module->getGlobal(instr.callee)) return fail(bb, &instr, "unknown global");
+                break;
+            default:
+                break;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool verifyFunction(const Function &func, const Module *module, std::string &err) {
+    Verifier v(func, module);
+    if (v.run()) return true;
+    err = v.msg.str();
+    return false;
+}
+
+bool verifyModule(const Module &module, std::string &err) {
+    std::unordered_set<std::string> names;
+    for (auto &f : module.functions) {
+        if (!names.insert(f->name).second) {
+            err = "duplicate function @" + f->name;
+            return false;
+        }
+        if (!verifyFunction(*f, &module, err)) return false;
+    }
+    return true;
+}
+
+} // namespace ir
@@ -0,0 +1,276 @@
+#include "irgen.h"
+#include <stdexcept>
+
+using namespace ir;
+
+std::unique_ptr<Module> IRGen::generate(const std::vector<std::unique_ptr<FuncDef>> &funcs) {
+    auto module = std::make_unique<Module>();
+    // 先收集所有函数的返回类型，允许调用定义在后面的函数
+    for (const auto &f : funcs) {
+        retTypes[f->name] = f->retType == "void" ? IRType::Void : IRType::I32;
+    }
+    for (const auto &f : funcs) {
+        module->functions.push_back(std::make_unique<Function>());
+        func = module->functions.back().get();
+        genFunc(f.get());
+    }
+    func = nullptr;
+    cur = nullptr;
+    return module;
+}
+
+Instr &IRGen::emit(Instr instr) {
+    cur->instrs.push_back(std::move(instr));
+    return cur->instrs.back();
+}
+
+Value IRGen::emitValue(Opcode op, std::vector<Value> ops) {
+    Instr instr(op);
+    instr.dst = func->newReg();
+    instr.ops = std::move(ops);
+    emit(std::move(instr));
+    return Value::reg(cur->instrs.back().dst);
+}
+
+void IRGen::emitJump(BasicBlock *target) {
+    Instr instr(Opcode::Jmp);
+    instr.blocks = {target};
+    emit(std::move(instr));
+}
+
+void IRGen::emitBranch(Value cond, BasicBlock *ifTrue, BasicBlock *ifFalse) {
+    Instr instr(Opcode::Br);
+    instr.ops = {cond};
+    instr.blocks = {ifTrue, ifFalse};
+    emit(std::move(instr));
+}
+
+int IRGen::lookupSlot(const std::string &name) const {
+    for (auto it = scopes.rbegin(); it != scopes.rend(); ++it) {
+        auto found = it->find(name);
+        if (found != it->end()) return found->second;
+    }
+    throw std::runtime_error("Variable '" + name + "' not found");
+}
+
+void IRGen::genFunc(FuncDef *funcDef) {
+    func->name = funcDef->name;
+    func->retType = retTypes[funcDef->name];
+    scopes.clear();
+    scopes.emplace_back();
+
+    setInsertPoint(func->newBlock("entry"));
+    for (size_t i = 0; i < funcDef->params.size(); i++) {
+        const std::string &name = funcDef->params[i].name;
+        func->paramNames.push_back(name);
+        int slot = func->newSlot(name);
+        scopes.back()[name] = slot;
+
+        Instr arg(Opcode::Arg);
+        arg.dst = func->newReg();
+        arg.index = (int)i;
+        emit(std::move(arg));
+
+        Instr store(Opcode::Store);
+        store.index = slot;
+        store.ops = {Value::reg(cur->instrs.back().dst)};
+        emit(std::move(store));
+    }
+
+    genBlock(funcDef->body.get());
+
+    // 末尾没有 return 时补一条；int 函数按 0 返回
+    if (!cur->hasTerminator()) {
+        Instr ret(Opcode::Ret);
+        if (func->retType == IRType::I32) ret.ops = {Value::imm(0)};
+        emit(std::move(ret));
+    }
+
+    func->rebuildCFG();
+    func->removeUnreachableBlocks();
+}
+
+void IRGen::genBlock(Block *block) {
+    scopes.emplace_back();
+    for (auto &stmt : block->stmts) {
+        // 上一条语句已经结束了当前块（return/break/continue），后续代码不可达
+        if (cur->hasTerminator()) setInsertPoint(func->newBlock("dead"));
+        genStmt(stmt.get());
+    }
+    scopes.pop_back();
+}
+
+void IRGen::genStmt(Stmt *stmt) {
+    if (auto decl = dynamic_cast<VarDeclStmt *>(stmt)) {
+        // 先求值初始化表达式，使 int x = x + 1 中的 x 指向外层变量
+        Value init = decl->initializer ? genExpr(decl->initializer.get()) : Value::imm(0);
+        int slot = func->newSlot(decl->name);
+        scopes.back()[decl->name] = slot;
+        Instr store(Opcode::Store);
+        store.index = slot;
+        store.ops = {init};
+        emit(std::move(store));
+    } else if (auto assign = dynamic_cast<AssignStmt *>(stmt)) {
+        Value v = genExpr(assign->value.get());
+        Instr store(Opcode::Store);
+        store.index = lookupSlot(assign->name);
+        store.ops = {v};
+        emit(std::move(store));
+    } else if (auto exprStmt = dynamic_cast<ExprStmt *>(stmt)) {
+        genExpr(exprStmt->expr.get());
+    } else if (auto ret = dynamic_cast<ReturnStmt *>(stmt)) {
+        Instr instr(Opcode::Ret);
+        if (ret->expr) {
+            Value v = genExpr(ret->expr.get());
+            if (func->retType == IRType::I32) instr.ops = {v};
+        } else if (func->retType == IRType::I32) {
+            instr.ops = {Value::imm(0)};
+        }
+        emit(std::move(instr));
+    } else if (auto block = dynamic_cast<Block *>(stmt)) {
+        genBlock(block);
+    } else if (auto ifStmt = dynamic_cast<IfStmt *>(stmt)) {
+        BasicBlock *thenBB = func->newBlock("if.then");
+        BasicBlock *elseBB = ifStmt->elseBlock ? func->newBlock("if.else") : nullptr;
+        BasicBlock *endBB = func->newBlock("if.end");
+
+        genCond(ifStmt->condition.get(), thenBB, elseBB ? elseBB : endBB);
+
+        setInsertPoint(thenBB);
+        genBlock(ifStmt->thenBlock.get());
+        if (!cur->hasTerminator()) emitJump(endBB);
+
+        if (elseBB) {
+            setInsertPoint(elseBB);
+            genBlock(ifStmt->elseBlock.get());
+            if (!cur->hasTerminator()) emitJump(endBB);
+        }
+        setInsertPoint(endBB);
+    } else if (auto whileStmt = dynamic_cast<WhileStmt *>(stmt)) {
+        // 轮转后的布局为 body、cond、end：入口处的判断直接落到 body，循环底部的判断成立时跳回 body，
+        // 每次迭代只有一个跳转
+        BasicBlock *condBB = rotateLoops ? nullptr : func->newBlock("while.cond");
+        BasicBlock *bodyBB = func->newBlock("while.body");
+        if (rotateLoops) condBB = func->newBlock("while.cond");
+        BasicBlock *endBB = func->newBlock("while.end");
+
+        if (rotateLoops) {
+            genCond(whileStmt->condition.get(), bodyBB, endBB);
+        } else {
+            emitJump(condBB);
+            setInsertPoint(condBB);
+            genCond(whileStmt->condition.get(), bodyBB, endBB);
+        }
+
+        breakTargets.push(endBB);
+        continueTargets.push(condBB);
+        setInsertPoint(bodyBB);
+        genBlock(whileStmt->body.get());
+        if (!cur->hasTerminator()) emitJump(condBB);
+        breakTargets.pop();
+        continueTargets.pop();
+
+        if (rotateLoops) {
+            setInsertPoint(condBB);
+            genCond(whileStmt->condition.get(), bodyBB, endBB);
+        }
+        setInsertPoint(endBB);
+    } else if (dynamic_cast<BreakStmt *>(stmt)) {
+        if (breakTargets.empty()) throw std::runtime_error("break statement outside of loop");
+        emitJump(breakTargets.top());
+    } else if (dynamic_cast<ContinueStmt *>(stmt)) {
+        if (continueTargets.empty()) throw std::runtime_error("continue statement outside of loop");
+        emitJump(continueTargets.top());
+    } else {
+        throw std::runtime_error("Unknown statement type in IR generation");
+    }
+}
+
+Value IRGen::genExpr(Expr *expr) {
+    if (auto num = dynamic_cast<NumberExpr *>(expr)) {
+        return Value::imm(num->value);
+    } else if (auto var = dynamic_cast<VarExpr *>(expr)) {
+        Instr load(Opcode::Load);
+        load.dst = func->newReg();
+        load.index = lookupSlot(var->name);
+        emit(std::move(load));
+        return Value::reg(cur->instrs.back().dst);
+    } else if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        if (bin->op == "&&" || bin->op == "||") {
+            // 值上下文：两条分支分别把 1/0 存进临时栈槽，mem2reg 之后成为 phi
+            BasicBlock *trueBB = func->newBlockAfter("logic.true", cur);
+            BasicBlock *falseBB = func->newBlockAfter("logic.false", trueBB);
+            BasicBlock *endBB = func->newBlockAfter("logic.end", falseBB);
+            int slot = func->newSlot("logic.tmp");
+            genCond(bin, trueBB, falseBB);
+            for (auto [bb, value] : {std::pair<BasicBlock *, int>{trueBB, 1}, {falseBB, 0}}) {
+                setInsertPoint(bb);
+                Instr store(Opcode::Store);
+                store.index = slot;
+                store.ops = {Value::imm(value)};
+                emit(std::move(store));
+                emitJump(endBB);
+            }
+            setInsertPoint(endBB);
+            Instr load(Opcode::Load);
+            load.dst = func->newReg();
+            load.index = slot;
+            emit(std::move(load));
+            return Value::reg(cur->instrs.back().dst);
+        }
+        Value lhs = genExpr(bin->lhs.get());
+        Value rhs = genExpr(bin->rhs.get());
+        Opcode op;
+        if (!binaryOpcode(bin->op, op)) throw std::runtime_error("Unsupported binary operator '" + bin->op + "'");
+        return emitValue(op, {lhs, rhs});
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        Value v = genExpr(unary->operand.get());
+        if (unary->op == "+") return v;
+        if (unary->op == "-") return emitValue(Opcode::Neg, {v});
+        if (unary->op == "!") return emitValue(Opcode::Not, {v});
+        throw std::runtime_error("Unsupported unary operator '" + unary->op + "'");
+    } else if (auto call = dynamic_cast<CallExpr *>(expr)) {
+        if (call->args.size() > 8) {
+            throw std::runtime_error("Function call has too many arguments (max 8)");
+        }
+        Instr instr(Opcode::Call);
+        instr.callee = call->callee;
+        for (auto &arg : call->args) instr.ops.push_back(genExpr(arg.get()));
+        auto rt = retTypes.find(call->callee);
+        instr.type = rt != retTypes.end() ? rt->second : IRType::I32;
+        if (instr.type == IRType::Void) {
+            emit(std::move(instr));
+            return Value::imm(0);
+        }
+        instr.dst = func->newReg();
+        emit(std::move(instr));
+        return Value::reg(cur->instrs.back().dst);
+    }
+    throw std::runtime_error("Unknown expression type in IR generation");
+}
+
+void IRGen::genCond(Expr *expr, BasicBlock *ifTrue, BasicBlock *ifFalse) {
+    if (auto bin = dynamic_cast<BinaryExpr *>(expr)) {
+        if (bin->op == "&&") {
+            BasicBlock *rhsBB = func->newBlockAfter("land.rhs", cur);
+            genCond(bin->lhs.get(), rhsBB, ifFalse);
+            setInsertPoint(rhsBB);
+            genCond(bin->rhs.get(), ifTrue, ifFalse);
+            return;
+        }
+        if (bin->op == "||") {
+            BasicBlock *rhsBB = func->newBlockAfter("lor.rhs", cur);
+            genCond(bin->lhs.get(), ifTrue, rhsBB);
+            setInsertPoint(rhsBB);
+            genCond(bin->rhs.get(), ifTrue, ifFalse);
+            return;
+        }
+    } else if (auto unary = dynamic_cast<UnaryExpr *>(expr)) {
+        if (unary->op == "!") {
+            genCond(unary->operand.get(), ifFalse, ifTrue);
+            return;
+        }
+    }
+    // 比较的结果只被分支使用时，后端会把比较与分支合并成一条 blt/bge/beq/bne
+    emitBranch(genExpr(expr), ifTrue, ifFalse);
+}
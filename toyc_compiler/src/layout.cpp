@@ -0,0 +1,119 @@
+#include "analysis.h"
+#include "passes.h"
+#include <functional>
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+// 按 order 排列时后继紧跟在后面的块数：这些边上不需要跳转指令。weight 非空时每条边按 weight 计
+int countFallThroughs(const std::vector<BasicBlock *> &order,
+                      const std::function<int(const BasicBlock *, const BasicBlock *)> &weight = nullptr) {
+    int n = 0;
+    for (size_t i = 0; i + 1 < order.size(); i++) {
+        for (BasicBlock *succ : order[i]->succs) {
+            if (succ != order[i + 1]) continue;
+            n += weight ? weight(order[i], succ) : 1;
+            break;
+        }
+    }
+    return n;
+}
+
+} // namespace
+
+bool placeBlocks(Function &func, LayoutStats *stats) {
+    func.removeUnreachableBlocks();
+    std::vector<BasicBlock *> original;
+    for (auto &bb : func.blocks) original.push_back(bb.get());
+    DominatorTree dt(func);
+    auto loops = findNaturalLoops(dt);
+    // 每个块所在的最内层循环（findNaturalLoops 内层在前）
+    std::unordered_map<const BasicBlock *, const Loop *> innermost;
+    for (auto &loop : loops) {
+        for (const BasicBlock *bb : loop.blocks) innermost.emplace(bb, &loop);
+    }
+    auto leavesLoop = [&](const BasicBlock *from, const BasicBlock *to) {
+        auto it = innermost.find(from);
+        return it != innermost.end() && !it->second->contains(to);
+    };
+
+    std::unordered_map<const BasicBlock *, bool> placed;
+    // 除回边外的前驱都已放好：放在这里不会打断还没放的前驱的链
+    auto ready = [&](const BasicBlock *bb) {
+        for (BasicBlock *pred : bb->preds) {
+            if (!placed[pred] && !dt.dominates(bb, pred)) return false;
+        }
+        return true;
+    };
+
+    // 从入口开始贪心地把链接下去：下一个块取当前块的某个后继，优先留在循环里的、然后是 br 的真分支
+    // （与源码顺序一致）。没有合适的后继时从原顺序里取第一个前驱都已放好的块开始新链
+    std::vector<BasicBlock *> order;
+    BasicBlock *cur = func.entry();
+    while (cur) {
+        placed[cur] = true;
+        order.push_back(cur);
+        BasicBlock *next = nullptr;
+        int best = -1;
+        for (size_t k = 0; k < cur->succs.size(); k++) {
+            BasicBlock *succ = cur->succs[k];
+            if (placed[succ] || !ready(succ)) continue;
+            int score = (leavesLoop(cur, succ) ? 0 : 2) + (k == 0 ? 1 : 0);
+            if (score > best) {
+                best = score;
+                next = succ;
+            }
+        }
+        for (auto &bb : func.blocks) {
+            if (next) break;
+            if (!placed[bb.get()] && ready(bb.get())) next = bb.get();
+        }
+        for (auto &bb : func.blocks) {
+            if (next) break;
+            if (!placed[bb.get()]) next = bb.get();
+        }
+        cur = next;
+    }
+
+    // 循环里的边每次迭代都走，按所在的循环层数加权：尾递归改成的循环里留在循环中的直落比离开循环的值钱。
+    // 循环体里还在递归调用自己时（fib 的累加器循环）不加权：大多数激活一圈不转就退出，
+    // 离开循环的边至少和回边一样热。启发式没有改进（包括持平）时保留原来的布局
+    auto recursesInside = [&](const Loop &loop) {
+        for (const BasicBlock *bb : loop.blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op == Opcode::Call && instr.callee == func.name) return true;
+            }
+        }
+        return false;
+    };
+    std::vector<const Loop *> hot;
+    for (auto &loop : loops) {
+        if (!recursesInside(loop)) hot.push_back(&loop);
+    }
+    auto weight = [&](const BasicBlock *from, const BasicBlock *to) {
+        int w = 1;
+        for (const Loop *loop : hot) w += loop->contains(from) && loop->contains(to);
+        return w;
+    };
+    int before = countFallThroughs(original), after = countFallThroughs(order);
+    bool better = countFallThroughs(order, weight) > countFallThroughs(original, weight);
+    if (stats) {
+        stats->fallThroughsBefore += before;
+        stats->fallThroughsAfter += better ? after : before;
+    }
+    if (!better) return false;
+
+    std::unordered_map<const BasicBlock *, size_t> position;
+    for (size_t i = 0; i < order.size(); i++) position[order[i]] = i;
+    std::vector<std::unique_ptr<BasicBlock>> blocks(order.size());
+    for (auto &bb : func.blocks) {
+        size_t i = position[bb.get()];
+        blocks[i] = std::move(bb);
+    }
+    func.blocks = std::move(blocks);
+    return true;
+}
+
+} // namespace ir
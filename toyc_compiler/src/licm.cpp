@@ -0,0 +1,231 @@
+#include "analysis.h"
+#include "passes.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+std::vector<BasicBlock *> outsidePreds(const Loop &loop) {
+    std::vector<BasicBlock *> outside;
+    for (BasicBlock *pred : loop.header->preds) {
+        if (!loop.contains(pred) && std::find(outside.begin(), outside.end(), pred) == outside.end())
+            outside.push_back(pred);
+    }
+    return outside;
+}
+
+// 在 header 之前新建前置块，把循环外的前驱都改接到它上面。header 中 phi 来自这些前驱的入边
+// 合并为前置块中的一个 phi（只有一个前驱时直接改成来自前置块）。之后需要 rebuildCFG
+void insertPreheader(Function &func, const Loop &loop) {
+    BasicBlock *header = loop.header;
+    auto outside = outsidePreds(loop);
+    auto pos = std::find_if(func.blocks.begin(), func.blocks.end(),
+                            [&](const std::unique_ptr<BasicBlock> &b) { return b.get() == header; });
+    BasicBlock *pre = func.newBlockAfter("preheader", (pos - 1)->get());
+
+    for (auto &phi : header->instrs) {
+        if (phi.op != Opcode::Phi) break;
+        Instr merged(Opcode::Phi);
+        std::vector<Value> ops;
+        std::vector<BasicBlock *> blocks;
+        for (size_t i = 0; i < phi.blocks.size(); i++) {
+            if (loop.contains(phi.blocks[i])) {
+                ops.push_back(phi.ops[i]);
+                blocks.push_back(phi.blocks[i]);
+            } else {
+                merged.ops.push_back(phi.ops[i]);
+                merged.blocks.push_back(phi.blocks[i]);
+            }
+        }
+        Value incoming = merged.ops.empty() ? Value::imm(0) : merged.ops[0];
+        if (merged.ops.size() > 1) {
+            merged.dst = func.newReg();
+            incoming = Value::reg(merged.dst);
+            pre->instrs.push_back(std::move(merged));
+        }
+        ops.push_back(incoming);
+        blocks.push_back(pre);
+        phi.ops = std::move(ops);
+        phi.blocks = std::move(blocks);
+    }
+    Instr jmp(Opcode::Jmp);
+    jmp.blocks = {header};
+    pre->instrs.push_back(std::move(jmp));
+    for (BasicBlock *pred : outside) {
+        for (auto &target : pred->terminator().blocks) {
+            if (target == header) target = pre;
+        }
+    }
+}
+
+class Hoister {
+public:
+    Hoister(Function &f, const DominatorTree &d, const std::unordered_set<std::string> *pure,
+            const std::unordered_set<std::string> *speculatable)
+        : func(f), dt(d), pureFunctions(pure), speculatableFunctions(speculatable) {
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.dst >= 0) defBlock[instr.dst] = bb.get();
+            }
+        }
+    }
+
+    int hoist(const Loop &loop, BasicBlock *pre) {
+        storedSlots.clear();
+        for (const BasicBlock *bb : loop.blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op == Opcode::Store) storedSlots.insert(instr.index);
+            }
+        }
+        exiting = loop.exitingBlocks();
+
+        int hoisted = 0;
+        bool changed = true;
+        while (changed) {
+            changed = false;
+            // 按逆后序访问，定义先于使用，一条依赖链通常一遍就能整个提出去
+            for (BasicBlock *bb : dt.reversePostOrder()) {
+                if (!loop.contains(bb)) continue;
+                auto &instrs = bb->instrs;
+                for (size_t i = 0; i < instrs.size();) {
+                    if (!canHoist(loop, instrs[i], bb)) {
+                        i++;
+                        continue;
+                    }
+                    defBlock[instrs[i].dst] = pre;
+                    pre->instrs.insert(pre->instrs.end() - 1, std::move(instrs[i]));
+                    instrs.erase(instrs.begin() + i);
+                    hoisted++;
+                    changed = true;
+                }
+            }
+        }
+        return hoisted;
+    }
+
+private:
+    Function &func;
+    const DominatorTree &dt;
+    const std::unordered_set<std::string> *pureFunctions;
+    const std::unordered_set<std::string> *speculatableFunctions;
+    std::unordered_map<int, BasicBlock *> defBlock;
+    std::unordered_set<int> storedSlots;
+    std::vector<BasicBlock *> exiting;
+
+    bool isInvariant(const Loop &loop, const Value &v) const {
+        if (!v.isReg()) return true;
+        auto it = defBlock.find(v.num);
+        return it != defBlock.end() && !loop.contains(it->second);
+    }
+
+    // 只要进入循环就一定执行到 bb：bb 支配所有出口和回边。提到前置块里只是提前执行
+    bool alwaysExecuted(const Loop &loop, const BasicBlock *bb) const {
+        if (exiting.empty()) return false;
+        for (BasicBlock *e : exiting) {
+            if (!dt.dominates(bb, e)) return false;
+        }
+        for (BasicBlock *latch : loop.latches) {
+            if (!dt.dominates(bb, latch)) return false;
+        }
+        return true;
+    }
+
+    // 一次迭代里从 header 走到 instr 之前会不会先执行有副作用的指令（写栈槽、写全局表、调用非纯函数）。
+    // 可能不返回或者会出错的指令提到这些指令前面，程序在出问题之前的输出就变了
+    bool effectsBefore(const Loop &loop, const Instr &instr, const BasicBlock *bb) const {
+        auto hasEffect = [&](const Instr &i) {
+            if (i.op == Opcode::Call) return !pureFunctions || !pureFunctions->count(i.callee);
+            return i.op == Opcode::Store || i.op == Opcode::StoreGlobal;
+        };
+        for (auto &i : bb->instrs) {
+            if (&i == &instr) break;
+            if (hasEffect(i)) return true;
+        }
+        if (bb == loop.header) return false;
+        std::vector<const BasicBlock *> work(bb->preds.begin(), bb->preds.end());
+        std::unordered_set<const BasicBlock *> seen;
+        while (!work.empty()) {
+            const BasicBlock *p = work.back();
+            work.pop_back();
+            if (!loop.contains(p) || !seen.insert(p).second) continue;
+            for (auto &i : p->instrs) {
+                if (hasEffect(i)) return true;
+            }
+            if (p != loop.header) work.insert(work.end(), p->preds.begin(), p->preds.end());
+        }
+        return false;
+    }
+
+    // 只是提前执行也安全：每次进入循环都会执行到，并且之前没有副作用
+    bool safeToHoistEarly(const Loop &loop, const Instr &instr, const BasicBlock *bb) const {
+        return alwaysExecuted(loop, bb) && !effectsBefore(loop, instr, bb);
+    }
+
+    bool canHoist(const Loop &loop, const Instr &instr, const BasicBlock *bb) const {
+        if (instr.dst < 0 || instr.op == Opcode::Phi || instr.op == Opcode::Arg) return false;
+        for (auto &v : instr.ops) {
+            if (!isInvariant(loop, v)) return false;
+        }
+        switch (instr.op) {
+            case Opcode::Load:
+                return !storedSlots.count(instr.index);
+            case Opcode::Call:
+                // 纯函数的调用结果只取决于参数；不一定很快返回的只在每次进入循环都会调用、
+                // 并且前面没有副作用时才提出去
+                if (!pureFunctions || !pureFunctions->count(instr.callee)) return false;
+                return (speculatableFunctions && speculatableFunctions->count(instr.callee)) ||
+                       safeToHoistEarly(loop, instr, bb);
+            case Opcode::Div:
+            case Opcode::Rem:
+                // 除数可能为 0 的除法只在受保护（本来就一定执行、前面没有副作用）时才提出去
+                return (instr.ops[1].isImm() && instr.ops[1].num != 0) || safeToHoistEarly(loop, instr, bb);
+            default:
+                return isBinary(instr.op) || isUnary(instr.op) || instr.op == Opcode::Copy;
+        }
+    }
+};
+
+} // namespace
+
+bool hoistLoopInvariants(Function &func, const std::unordered_set<std::string> *pureFunctions,
+                         const std::unordered_set<std::string> *speculatableFunctions, LICMStats *stats) {
+    func.removeUnreachableBlocks();
+    LICMStats local;
+    // 每插入一个前置块都重新找循环：新块属于包含 header 的外层循环。入口块没有可以改接的前驱，不放前置块
+    bool inserted = true;
+    while (inserted) {
+        inserted = false;
+        for (auto &loop : findNaturalLoops(DominatorTree(func))) {
+            if (loop.header == func.entry() || loop.preheader()) continue;
+            insertPreheader(func, loop);
+            func.rebuildCFG();
+            local.preheaders++;
+            inserted = true;
+            break;
+        }
+    }
+
+    DominatorTree dt(func);
+    auto loops = findNaturalLoops(dt);
+    Hoister hoister(func, dt, pureFunctions, speculatableFunctions);
+    // 先内层后外层：提到内层前置块里的指令还可能继续提出外层循环
+    for (auto &loop : loops) {
+        BasicBlock *pre = loop.preheader();
+        if (!pre) continue;
+        int n = hoister.hoist(loop, pre);
+        local.hoisted += n;
+        local.loops += n > 0;
+    }
+
+    if (stats) {
+        stats->hoisted += local.hoisted;
+        stats->loops += local.loops;
+        stats->preheaders += local.preheaders;
+    }
+    return local.hoisted || local.preheaders;
+}
+
+} // namespace ir
@@ -1,11 +1,9 @@
-#include "lexer.h"
-#include "parser.h"
-#include "semantic.h"
-#include "codegen.h"
+#include "driver.h"
 #include <iostream>
 #include <fstream>
 #include <sstream>
 #include <string>
+#include <cstdlib>
 #include <cstring>
 #include <memory>
 
@@ -15,7 +13,26 @@ void printHelp() {
               << "Options:\n"
               << "  -h, --help     Show this help message\n"
               << "  -v, --version  Show version information\n"
-              << "  -o <file>      Write output to <file>\n";
+              << "  -o <file>      Write output to <file>\n"
+              << "  -O<n>          Optimization level (0: direct AST codegen, 1: IR pipeline with linear-scan\n"
+              << "                 register allocation, 2: graph-colouring register allocation,\n"
+              << "                 3: also memoise pure recursive functions)\n"
+              << "  --emit-ir      Print the intermediate representation instead of assembly\n"
+              << "  -fno-<pass>    Disable an optimization pass (e.g. -fno-fold, -fno-mem2reg,\n"
+              << "                 -fno-tailrec, -fno-inline, -fno-ipsccp, -fno-sccp, -fno-gvn, -fno-licm,\n"
+              << "                 -fno-scev, -fno-dce, -fno-loop-rotate, -fno-block-placement, -fno-sibling-calls,\n"
+              << "                 -fno-strength-reduce, -fno-memoize, -fno-regalloc)\n"
+              << "  -falign-loops=<n>  Align loop headers to <n> bytes (a power of two)\n"
+              << "  -finline-threshold=<n>  Inline calls whose callee costs at most <n> instructions (default 40,\n"
+              << "                 raised for calls in loops, constant arguments and leaf callees)\n"
+              << "  -fwhole-program  Drop functions that main can never call\n"
+              << "  -fconst-eval[=<n>]  Run main in the compiler for at most <n> IR instructions (default\n"
+              << "                 1000000) and return its result directly; if it does not finish, fold the\n"
+              << "                 calls with constant arguments that do\n"
+              << "  -j<n>          Optimize independent functions on <n> threads (default 1)\n"
+              << "  --opt-report   Print what each optimization changed to stderr\n"
+              << "  -mtune=<core>  Cost model for multiply/divide strength reduction\n"
+              << "                 (generic, sifive-e31, picorv32)\n";
 }
 
 void printVersion() {
@@ -26,6 +43,7 @@ int main(int argc, char* argv[]) {
     std::string inputFile;
     std::string outputFile;
     bool hasOutputFile = false;
+    CompileOptions options;
 
     // 解析命令行参数
     for (int i = 1; i < argc; i++) {
@@ -45,6 +63,70 @@ int main(int argc, char* argv[]) {
             outputFile = argv[++i];
             hasOutputFile = true;
         }
+        else if (strncmp(argv[i], "-O", 2) == 0) {
+            const char *level = argv[i] + 2;
+            if (*level == '\0') {
+                options.optLevel = 1;
+            } else if (level[0] >= '0' && level[0] <= '9' && level[1] == '\0') {
+                options.optLevel = level[0] - '0';
+            } else {
+                std::cerr << "Error: invalid optimization level '" << argv[i] << "'\n";
+                return 1;
+            }
+        }
+        else if (strcmp(argv[i], "--emit-ir") == 0) {
+            options.emitIR = true;
+        }
+        else if (strcmp(argv[i], "--opt-report") == 0) {
+            options.report = &std::cerr;
+        }
+        else if (strncmp(argv[i], "-falign-loops=", 14) == 0) {
+            int bytes = atoi(argv[i] + 14);
+            if (bytes < 0 || (bytes & (bytes - 1)) != 0) {
+                std::cerr << "Error: -falign-loops expects a power of two, got '" << argv[i] + 14 << "'\n";
+                return 1;
+            }
+            options.alignLoops = bytes;
+        }
+        else if (strncmp(argv[i], "-finline-threshold=", 19) == 0) {
+            char *end = nullptr;
+            long threshold = strtol(argv[i] + 19, &end, 10);
+            if (end == argv[i] + 19 || *end != '\0' || threshold < 0) {
+                std::cerr << "Error: -finline-threshold expects a non-negative integer, got '" << argv[i] + 19 << "'\n";
+                return 1;
+            }
+            options.inlineThreshold = (int)threshold;
+        }
+        else if (strcmp(argv[i], "-fconst-eval") == 0) {
+            options.constEvalSteps = 1000000;
+        }
+        else if (strncmp(argv[i], "-fconst-eval=", 13) == 0) {
+            char *end = nullptr;
+            long long steps = strtoll(argv[i] + 13, &end, 10);
+            if (end == argv[i] + 13 || *end != '\0' || steps < 1) {
+                std::cerr << "Error: -fconst-eval expects a positive step budget, got '" << argv[i] + 13 << "'\n";
+                return 1;
+            }
+            options.constEvalSteps = steps;
+        }
+        else if (strcmp(argv[i], "-fwhole-program") == 0) {
+            options.wholeProgram = true;
+        }
+        else if (strncmp(argv[i], "-j", 2) == 0) {
+            char *end = nullptr;
+            long jobs = strtol(argv[i] + 2, &end, 10);
+            if (end == argv[i] + 2 || *end != '\0' || jobs < 1) {
+                std::cerr << "Error: -j expects a positive thread count, got '" << argv[i] + 2 << "'\n";
+                return 1;
+            }
+            options.jobs = (int)jobs;
+        }
+        else if (strncmp(argv[i], "-fno-", 5) == 0) {
+            options.disabledPasses.insert(argv[i] + 5);
+        }
+        else if (strncmp(argv[i], "-mtune=", 7) == 0) {
+            options.tune = argv[i] + 7;
+        }
         else if (inputFile.empty()) {
             inputFile = argv[i];
         }
@@ -74,23 +156,7 @@ int main(int argc, char* argv[]) {
     }
 
     try {
-        // 词法分析
-        Lexer lexer(sourceCode);
-        auto tokens = lexer.tokenize();
-
-        // 语法分析
-        Parser parser(tokens);
-        auto ast = parser.parseCompUnit();
-
-        // 语义分析
-        SemanticAnalyzer analyzer;
-        analyzer.analyze(ast);
-
-        // 代码生成
-        std::ostringstream oss;
-        CodeGen codegen(oss);
-        codegen.generate(ast);
-        std::string output = oss.str();
+        std::string output = compileSource(sourceCode, options);
 
         // 输出
         if (hasOutputFile) {
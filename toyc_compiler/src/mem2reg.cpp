@@ -0,0 +1,188 @@
+#include "analysis.h"
+#include "passes.h"
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+Value resolve(const std::unordered_map<int, Value> &replace, Value v) {
+    while (v.isReg()) {
+        auto it = replace.find(v.num);
+        if (it == replace.end()) break;
+        v = it->second;
+    }
+    return v;
+}
+
+// 删除平凡 phi（所有入值相同或为自身）与无用 phi，直到不动点
+void simplifyPhis(Function &func) {
+    std::unordered_map<int, Value> replace;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op != Opcode::Phi || instr.dst < 0) continue;
+                Value same;
+                bool trivial = true;
+                for (auto &v : instr.ops) {
+                    Value r = resolve(replace, v);
+                    if (r == Value::reg(instr.dst) || r == same) continue;
+                    if (!same.isNone()) {
+                        trivial = false;
+                        break;
+                    }
+                    same = r;
+                }
+                if (!trivial) continue;
+                replace[instr.dst] = same.isNone() ? Value::imm(0) : same;
+                instr.dst = -1;     // 标记删除
+                changed = true;
+            }
+        }
+    }
+
+    // 只被 phi 使用、最终没有真正使用者的 phi 也是死的
+    std::unordered_map<int, const Instr *> phiOf;
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi && instr.dst >= 0) phiOf[instr.dst] = &instr;
+        }
+    }
+    std::unordered_set<int> used;
+    std::vector<const Instr *> work;
+    auto markUsed = [&](const Value &v) {
+        Value r = resolve(replace, v);
+        if (!r.isReg() || !used.insert(r.num).second) return;
+        auto it = phiOf.find(r.num);
+        if (it != phiOf.end()) work.push_back(it->second);
+    };
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi) continue;
+            for (auto &v : instr.ops) markUsed(v);
+        }
+    }
+    while (!work.empty()) {
+        const Instr *phi = work.back();
+        work.pop_back();
+        for (auto &v : phi->ops) markUsed(v);
+    }
+
+    for (auto &bb : func.blocks) {
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi && (instr.dst < 0 || !used.count(instr.dst))) continue;
+            for (auto &v : instr.ops) v = resolve(replace, v);
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+    }
+}
+
+} // namespace
+
+bool promoteMemoryToRegisters(Function &func) {
+    if (func.slots.empty()) return false;
+    func.rebuildCFG();
+    DominatorTree dt(func);
+    int numSlots = (int)func.slots.size();
+
+    // 1. 在每个栈槽定义块的迭代支配边界插入 phi
+    std::vector<std::vector<BasicBlock *>> defBlocks(numSlots);
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Store) {
+                auto &defs = defBlocks[instr.index];
+                if (defs.empty() || defs.back() != bb.get()) defs.push_back(bb.get());
+            }
+        }
+    }
+    std::unordered_map<int, int> phiSlot;   // phi 结果寄存器 -> 栈槽
+    for (int s = 0; s < numSlots; s++) {
+        std::unordered_set<BasicBlock *> hasPhi;
+        std::vector<BasicBlock *> work = defBlocks[s];
+        std::unordered_set<BasicBlock *> queued(work.begin(), work.end());
+        while (!work.empty()) {
+            BasicBlock *bb = work.back();
+            work.pop_back();
+            for (BasicBlock *df : dt.frontier(bb)) {
+                if (!hasPhi.insert(df).second) continue;
+                Instr phi(Opcode::Phi);
+                phi.dst = func.newReg();
+                phiSlot[phi.dst] = s;
+                df->instrs.insert(df->instrs.begin(), std::move(phi));
+                if (queued.insert(df).second) work.push_back(df);
+            }
+        }
+    }
+
+    // 2. 沿支配树重命名
+    std::unordered_map<int, Value> replace;
+    std::vector<Value> current(numSlots, Value::imm(0));   // 未初始化的读按 0 处理
+    struct Frame {
+        BasicBlock *bb;
+        std::vector<Value> saved;
+        size_t nextChild;
+    };
+    std::vector<Frame> stack;
+    auto enter = [&](BasicBlock *bb) {
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi) {
+                auto it = phiSlot.find(instr.dst);
+                if (it != phiSlot.end()) current[it->second] = Value::reg(instr.dst);
+                kept.push_back(std::move(instr));
+                continue;
+            }
+            if (instr.op == Opcode::Load) {
+                replace[instr.dst] = current[instr.index];
+                continue;
+            }
+            for (auto &v : instr.ops) v = resolve(replace, v);
+            if (instr.op == Opcode::Store) {
+                current[instr.index] = instr.ops[0];
+                continue;
+            }
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+        for (BasicBlock *succ : bb->succs) {
+            for (auto &instr : succ->instrs) {
+                if (instr.op != Opcode::Phi) break;
+                auto it = phiSlot.find(instr.dst);
+                if (it == phiSlot.end()) continue;
+                instr.ops.push_back(current[it->second]);
+                instr.blocks.push_back(bb);
+            }
+        }
+        // 支配树上的子块从本块结束时的值开始
+        stack.push_back(Frame{bb, current, 0});
+    };
+    enter(func.entry());
+    while (!stack.empty()) {
+        Frame &top = stack.back();
+        const auto &kids = dt.children(top.bb);
+        if (top.nextChild < kids.size()) {
+            BasicBlock *child = kids[top.nextChild++];
+            current = top.saved;
+            enter(child);
+        } else {
+            stack.pop_back();
+        }
+    }
+
+    // 原有的 phi（例如来自内联）在其前驱处理时未必已经解析，统一再替换一遍
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            for (auto &v : instr.ops) v = resolve(replace, v);
+        }
+    }
+    func.slots.clear();
+    simplifyPhis(func);
+    return true;
+}
+
+} // namespace ir
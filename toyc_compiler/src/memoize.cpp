@@ -0,0 +1,234 @@
+#include "analysis.h"
+#include "callgraph.h"
+#include "interp.h"
+#include "passes.h"
+#include <map>
+#include <ostream>
+
+namespace ir {
+
+namespace {
+
+constexpr int kMaxTableEntries = 4096;      // 每个函数的表最多几项（两张表共 32KB）
+constexpr int kMaxMemoParams = 2;
+constexpr long long kProfitableSteps = 2000;    // 按普通递归至少要执行的 IR 指令数，再少查表的开销就不划算
+
+// 同一次激活里至少执行两处不在尾位置的自调用（两处调用所在的块一个支配另一个），调用树才会指数增长。
+// 分在两个分支里、或者结果直接返回的自调用只是线性递归，交给尾递归消除
+bool recursesTwicePerActivation(const Function &f) {
+    DominatorTree dt(f);
+    std::vector<const BasicBlock *> sites;
+    for (auto &bb : f.blocks) {
+        const Instr *tail = tailCallOf(*bb);
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Call && instr.callee == f.name && &instr != tail) sites.push_back(bb.get());
+        }
+    }
+    for (size_t i = 0; i < sites.size(); i++) {
+        for (size_t j = i + 1; j < sites.size(); j++) {
+            if (dt.dominates(sites[i], sites[j]) || dt.dominates(sites[j], sites[i])) return true;
+        }
+    }
+    return false;
+}
+
+// 自调用的每个实参都是常量、同一位置的形参或者它减去一个正常量：调用树里的实参不会超过入口的实参，
+// 子问题落在有界的范围里反复出现，查表才有用（ack 这样把调用结果当实参的函数不行）
+bool argumentsShrink(const Function &f) {
+    std::unordered_map<int, const Instr *> defs;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.dst >= 0) defs[instr.dst] = &instr;
+        }
+    }
+    auto paramOf = [&](const Value &v) {
+        auto it = v.isReg() ? defs.find(v.num) : defs.end();
+        return it != defs.end() && it->second->op == Opcode::Arg ? it->second->index : -1;
+    };
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op != Opcode::Call || instr.callee != f.name) continue;
+            for (int i = 0; i < (int)instr.ops.size(); i++) {
+                const Value &a = instr.ops[i];
+                if (a.isImm() || paramOf(a) == i) continue;
+                auto it = defs.find(a.num);
+                const Instr *def = it == defs.end() ? nullptr : it->second;
+                bool shrinks = def && def->ops.size() == 2 && paramOf(def->ops[0]) == i && def->ops[1].isImm() &&
+                               ((def->op == Opcode::Sub && def->ops[1].num > 0) ||
+                                (def->op == Opcode::Add && def->ops[1].num < 0));
+                if (!shrinks) return false;
+            }
+        }
+    }
+    return true;
+}
+
+// 模块里至少有一处从外面用常量实参调用它，并且在编译期解释器里按普通递归算要执行 kProfitableSteps 条以上
+// IR 指令。实参不是常量时算不出调用树有多大：小的调用树（如 examples/test.c 里的 fib(5)）查表反而更慢
+bool profitable(const Module &module, const Function &f) {
+    std::map<std::vector<int>, bool> known;
+    for (auto &caller : module.functions) {
+        if (caller->name == f.name) continue;
+        for (auto &bb : caller->blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op != Opcode::Call || instr.callee != f.name) continue;
+                std::vector<int> args;
+                for (auto &a : instr.ops) {
+                    if (a.isImm()) args.push_back(a.num);
+                }
+                if (args.size() != instr.ops.size()) continue;
+                auto it = known.find(args);
+                if (it == known.end()) {
+                    EvalResult r = evaluateFunction(module, f.name, args, kProfitableSteps);
+                    it = known.emplace(args, r.status == EvalResult::Status::OutOfSteps).first;
+                }
+                if (it->second) return true;
+            }
+        }
+    }
+    return false;
+}
+
+// 每一维的边长：一个形参时整张表，两个形参时 64 x 64
+int tableSide(int params) {
+    int side = 1;
+    while (true) {
+        long long next = side * 2LL, entries = 1;
+        for (int i = 0; i < params; i++) entries *= next;
+        if (entries > kMaxTableEntries) return side;
+        side = (int)next;
+    }
+}
+
+Instr binary(Opcode op, int dst, Value a, Value b) {
+    Instr instr(op);
+    instr.dst = dst;
+    instr.ops = {a, b};
+    return instr;
+}
+
+Instr jump(Opcode op, std::vector<Value> ops, std::vector<BasicBlock *> targets) {
+    Instr instr(op);
+    instr.ops = std::move(ops);
+    instr.blocks = std::move(targets);
+    return instr;
+}
+
+// 原函数体改名为 body 之后，在原来的名字上生成查表的包装
+std::unique_ptr<Function> buildWrapper(const Function &body, const std::string &name, const std::string &valid,
+                                       const std::string &table, int side) {
+    auto f = std::make_unique<Function>();
+    f->name = name;
+    f->retType = IRType::I32;
+    f->paramNames = body.paramNames;
+    BasicBlock *entry = f->newBlock("entry");
+    BasicBlock *probe = f->newBlock("memo.probe");
+    BasicBlock *hit = f->newBlock("memo.hit");
+    BasicBlock *miss = f->newBlock("memo.miss");
+    BasicBlock *outside = f->newBlock("memo.outside");
+
+    // 每个实参都在 [0, side) 内才查表；下标按行主序展开
+    std::vector<Value> args;
+    Value inRange = Value::imm(1), index = Value::imm(0);
+    for (int i = 0; i < (int)f->paramNames.size(); i++) {
+        Instr arg(Opcode::Arg);
+        arg.dst = f->newReg();
+        arg.index = i;
+        entry->instrs.push_back(arg);
+        Value a = Value::reg(arg.dst);
+        args.push_back(a);
+        int low = f->newReg(), high = f->newReg(), both = f->newReg();
+        entry->instrs.push_back(binary(Opcode::Ge, low, a, Value::imm(0)));
+        entry->instrs.push_back(binary(Opcode::Lt, high, a, Value::imm(side)));
+        entry->instrs.push_back(binary(Opcode::And, both, Value::reg(low), Value::reg(high)));
+        if (i == 0) {
+            inRange = Value::reg(both);
+            index = a;
+            continue;
+        }
+        int all = f->newReg(), scaled = f->newReg(), next = f->newReg();
+        entry->instrs.push_back(binary(Opcode::And, all, inRange, Value::reg(both)));
+        probe->instrs.push_back(binary(Opcode::Mul, scaled, index, Value::imm(side)));
+        probe->instrs.push_back(binary(Opcode::Add, next, Value::reg(scaled), a));
+        inRange = Value::reg(all);
+        index = Value::reg(next);
+    }
+    entry->instrs.push_back(jump(Opcode::Br, {inRange}, {probe, outside}));
+
+    Instr seen(Opcode::LoadGlobal);
+    seen.dst = f->newReg();
+    seen.callee = valid;
+    seen.ops = {index};
+    probe->instrs.push_back(seen);
+    probe->instrs.push_back(jump(Opcode::Br, {Value::reg(seen.dst)}, {hit, miss}));
+
+    Instr cached(Opcode::LoadGlobal);
+    cached.dst = f->newReg();
+    cached.callee = table;
+    cached.ops = {index};
+    hit->instrs.push_back(cached);
+    hit->instrs.push_back(jump(Opcode::Ret, {Value::reg(cached.dst)}, {}));
+
+    auto callBody = [&](BasicBlock *bb) {
+        Instr call(Opcode::Call);
+        call.dst = f->newReg();
+        call.callee = body.name;
+        call.ops = args;
+        bb->instrs.push_back(call);
+        return Value::reg(call.dst);
+    };
+    Value result = callBody(miss);
+    Instr store(Opcode::StoreGlobal);
+    store.callee = table;
+    store.ops = {index, result};
+    miss->instrs.push_back(store);
+    store.callee = valid;
+    store.ops = {index, Value::imm(1)};
+    miss->instrs.push_back(store);
+    miss->instrs.push_back(jump(Opcode::Ret, {result}, {}));
+
+    outside->instrs.push_back(jump(Opcode::Ret, {callBody(outside)}, {}));
+    f->rebuildCFG();
+    return f;
+}
+
+} // namespace
+
+int memoizeRecursiveFunctions(Module &module, std::ostream *remarks) {
+    CallGraph graph(module);
+    auto pure = findPureFunctions(module);
+    auto mutual = graph.mutuallyRecursive();
+    std::vector<std::string> candidates;
+    for (auto &f : module.functions) {
+        if (f->name == "main" || f->retType != IRType::I32 || !pure.count(f->name) || mutual.count(f->name))
+            continue;
+        if (f->paramNames.empty() || (int)f->paramNames.size() > kMaxMemoParams) continue;
+        if (!recursesTwicePerActivation(*f) || !argumentsShrink(*f) || !profitable(module, *f)) continue;
+        candidates.push_back(f->name);
+    }
+
+    for (auto &name : candidates) {
+        auto it = module.functions.begin();
+        while ((*it)->name != name) ++it;
+        Function &body = **it;
+        body.name = name + ".body";
+        body.internal = true;
+        int side = tableSide((int)body.paramNames.size());
+        int entries = 1;
+        for (size_t i = 0; i < body.paramNames.size(); i++) entries *= side;
+        std::string table = name + ".memo", valid = name + ".memo.valid";
+        module.globals.push_back({valid, entries});
+        module.globals.push_back({table, entries});
+        auto wrapper = buildWrapper(body, name, valid, table, side);
+        if (remarks) {
+            *remarks << "memoize: @" << name << ": cached in @" << table << " for";
+            for (size_t i = 0; i < body.paramNames.size(); i++)
+                *remarks << (i ? ", " : " ") << "0 <= " << body.paramNames[i] << " < " << side;
+            *remarks << "\n";
+        }
+        module.functions.insert(it, std::move(wrapper));
+    }
+    return (int)candidates.size();
+}
+
+} // namespace ir
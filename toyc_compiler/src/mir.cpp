@@ -0,0 +1,198 @@
+#include "mir.h"
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace mir {
+
+std::string regName(int r) {
+    static const char *names[kNumPhysRegs] = {
+        "zero", "ra", "sp", "gp", "tp", "t0", "t1", "t2",
+        "s0", "s1", "a0", "a1", "a2", "a3", "a4", "a5",
+        "a6", "a7", "s2", "s3", "s4", "s5", "s6", "s7",
+        "s8", "s9", "s10", "s11", "t3", "t4", "t5", "t6",
+    };
+    if (r >= 0 && r < kNumPhysRegs) return names[r];
+    return "%v" + std::to_string(r - kFirstVirtReg);
+}
+
+bool isCalleeSaved(int r) {
+    return r == S0 || r == S1 || (r >= S2 && r <= S11);
+}
+
+const std::vector<int> &callerSavedRegs() {
+    static const std::vector<int> regs = {
+        RA, T0, T1, T2, A0, A1, A2, A3, A4, A5, A6, A7, T3, T4, T5, T6,
+    };
+    return regs;
+}
+
+bool MInstr::isBranch() const {
+    static const std::unordered_set<std::string> branches = {
+        "beq", "bne", "blt", "bge", "bltu", "bgeu", "bgt", "ble", "bgtu", "bleu",
+        "beqz", "bnez", "bltz", "bgez", "blez", "bgtz",
+    };
+    return branches.count(op) != 0;
+}
+
+bool MInstr::isTerminator() const {
+    return op == "j" || op == "ret" || op == "tail" || isBranch();
+}
+
+bool MInstr::definesFirstOperand() const {
+    return !(op == "sw" || op == "j" || op == "call" || op == "tail" || op == "ret" || isBranch());
+}
+
+void MInstr::getDefs(std::vector<int> &defs) const {
+    defs.clear();
+    if (definesFirstOperand() && !ops.empty() && ops[0].isReg()) defs.push_back(ops[0].reg);
+    defs.insert(defs.end(), implicitDefs.begin(), implicitDefs.end());
+}
+
+void MInstr::getUses(std::vector<int> &uses) const {
+    uses.clear();
+    for (size_t i = definesFirstOperand() ? 1 : 0; i < ops.size(); i++) {
+        if (ops[i].isReg() || ops[i].isMem()) uses.push_back(ops[i].reg);
+    }
+    uses.insert(uses.end(), implicitUses.begin(), implicitUses.end());
+}
+
+void MFunction::rebuildCFG() {
+    std::unordered_map<std::string, MBlock *> byLabel;
+    for (auto &bb : blocks) {
+        bb->succs.clear();
+        bb->preds.clear();
+        byLabel[bb->label] = bb.get();
+    }
+    auto addEdge = [](MBlock *from, MBlock *to) {
+        if (std::find(from->succs.begin(), from->succs.end(), to) != from->succs.end()) return;
+        from->succs.push_back(to);
+        to->preds.push_back(from);
+    };
+    for (size_t i = 0; i < blocks.size(); i++) {
+        MBlock *bb = blocks[i].get();
+        bool fallsThrough = true;
+        for (auto &instr : bb->instrs) {
+            if (instr.op == "j" || instr.isBranch()) {
+                auto it = byLabel.find(instr.ops.back().label);
+                if (it != byLabel.end()) addEdge(bb, it->second);
+            }
+        }
+        if (!bb->instrs.empty()) {
+            const MInstr &last = bb->instrs.back();
+            fallsThrough = !(last.op == "j" || last.op == "ret" || last.op == "tail");
+        }
+        if (fallsThrough && i + 1 < blocks.size()) addEdge(bb, blocks[i + 1].get());
+    }
+}
+
+void MFunction::computeLoopDepth() {
+    std::unordered_map<MBlock *, int> index;
+    for (size_t i = 0; i < blocks.size(); i++) {
+        index[blocks[i].get()] = (int)i;
+        blocks[i]->loopDepth = 0;
+    }
+    // 逆后序
+    std::vector<MBlock *> postorder;
+    std::vector<bool> visited(blocks.size(), false);
+    std::vector<std::pair<MBlock *, size_t>> stack = {{blocks[0].get(), 0}};
+    visited[0] = true;
+    while (!stack.empty()) {
+        auto &[bb, next] = stack.back();
+        if (next < bb->succs.size()) {
+            MBlock *succ = bb->succs[next++];
+            if (!visited[index[succ]]) {
+                visited[index[succ]] = true;
+                stack.push_back({succ, 0});
+            }
+        } else {
+            postorder.push_back(bb);
+            stack.pop_back();
+        }
+    }
+    std::vector<MBlock *> rpo(postorder.rbegin(), postorder.rend());
+
+    // 迭代求支配集合；MIR 的函数都很小，位向量足够
+    size_t n = blocks.size();
+    std::vector<std::vector<bool>> dom(n, std::vector<bool>(n, true));
+    dom[0].assign(n, false);
+    dom[0][0] = true;
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (MBlock *bb : rpo) {
+            int b = index[bb];
+            if (b == 0) continue;
+            std::vector<bool> d(n, true);
+            for (MBlock *pred : bb->preds) {
+                int p = index[pred];
+                if (!visited[p]) continue;
+                for (size_t i = 0; i < n; i++) d[i] = d[i] && dom[p][i];
+            }
+            d[b] = true;
+            if (d != dom[b]) {
+                dom[b] = std::move(d);
+                changed = true;
+            }
+        }
+    }
+
+    // 回边 latch -> header 确定的自然循环；同一循环头的多条回边合并为一个循环
+    std::unordered_map<MBlock *, std::unordered_set<MBlock *>> loops;
+    for (MBlock *bb : rpo) {
+        for (MBlock *succ : bb->succs) {
+            if (!dom[index[bb]][index[succ]]) continue;
+            auto &body = loops[succ];
+            body.insert(succ);
+            std::vector<MBlock *> work;
+            if (body.insert(bb).second) work.push_back(bb);
+            while (!work.empty()) {
+                MBlock *cur = work.back();
+                work.pop_back();
+                for (MBlock *pred : cur->preds) {
+                    if (visited[index[pred]] && body.insert(pred).second) work.push_back(pred);
+                }
+            }
+        }
+    }
+    for (auto &[header, body] : loops) {
+        for (MBlock *bb : body) bb->loopDepth++;
+    }
+}
+
+static void printOperand(std::ostream &os, const MOperand &o) {
+    switch (o.kind) {
+        case MOperand::Kind::Reg: os << regName(o.reg); break;
+        case MOperand::Kind::Imm: os << o.imm; break;
+        case MOperand::Kind::Label: os << o.label; break;
+        case MOperand::Kind::Mem:
+            if (o.frameIndex >= 0) os << "fi#" << o.frameIndex << "+";
+            os << o.imm << "(" << regName(o.reg) << ")";
+            break;
+    }
+}
+
+void printInstr(std::ostream &os, const MInstr &instr) {
+    os << instr.op;
+    for (size_t i = 0; i < instr.ops.size(); i++) {
+        os << (i ? ", " : " ");
+        printOperand(os, instr.ops[i]);
+    }
+}
+
+void printFunction(std::ostream &os, const MFunction &func) {
+    os << ".globl " << func.name << "\n";
+    os << func.name << ":\n";
+    for (size_t i = 0; i < func.blocks.size(); i++) {
+        const MBlock &bb = *func.blocks[i];
+        if (bb.align > 0) os << ".p2align " << bb.align << "\n";
+        if (i) os << bb.label << ":\n";
+        for (auto &instr : bb.instrs) {
+            os << "\t";
+            printInstr(os, instr);
+            os << "\n";
+        }
+    }
+}
+
+} // namespace mir
@@ -0,0 +1,214 @@
+#include "analysis.h"
+#include "passes.h"
+#include <algorithm>
+#include <numeric>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+struct UnionFind {
+    std::vector<int> parent;
+    explicit UnionFind(int n) : parent(n) { std::iota(parent.begin(), parent.end(), 0); }
+    int find(int x) {
+        while (parent[x] != x) x = parent[x] = parent[parent[x]];
+        return x;
+    }
+};
+
+} // namespace
+
+// Sreedhar 方法 I：先为每个 phi 的结果和入值插入新的复制，得到 phi 资源互不干涉的 CSSA，
+// 把每个 phi 的资源合并为同一个变量后删除 phi；再按干涉图合并其余互不干涉的复制两端。
+void destroySSA(Function &func) {
+    bool hasPhi = false;
+    for (auto &bb : func.blocks) {
+        if (!bb->instrs.empty() && bb->instrs.front().op == Opcode::Phi) hasPhi = true;
+    }
+    if (!hasPhi) return;
+
+    // 0. 切开离开循环的关键边：出口 phi 的入值复制如果放在循环里的前驱末尾，每次迭代都要执行，
+    //    而且和循环头 phi 的复制同时活跃无法合并。新块放在出口块之前，通常直接落入出口块
+    DominatorTree dt(func);
+    auto loops = findNaturalLoops(dt);
+    bool split = false;
+    for (size_t b = 1; b < func.blocks.size(); b++) {
+        BasicBlock *bb = func.blocks[b].get();
+        if (bb->preds.size() < 2 || bb->instrs.front().op != Opcode::Phi) continue;
+        for (BasicBlock *pred : std::vector<BasicBlock *>(bb->preds)) {
+            bool exits = std::any_of(loops.begin(), loops.end(),
+                                     [&](const Loop &l) { return l.contains(pred) && !l.contains(bb); });
+            if (pred->succs.size() < 2 || !exits) continue;
+            BasicBlock *edge = func.newBlockAfter("exit", func.blocks[b - 1].get());
+            Instr jmp(Opcode::Jmp);
+            jmp.blocks = {bb};
+            edge->instrs.push_back(std::move(jmp));
+            for (auto &target : pred->terminator().blocks) {
+                if (target == bb) target = edge;
+            }
+            for (auto &phi : bb->instrs) {
+                if (phi.op != Opcode::Phi) break;
+                for (auto &from : phi.blocks) {
+                    if (from == pred) from = edge;
+                }
+            }
+            split = true;
+            b++;
+        }
+    }
+    if (split) func.rebuildCFG();
+
+    // 1. 转为 CSSA
+    std::vector<std::vector<int>> phiGroups;
+    std::vector<std::pair<BasicBlock *, Instr>> predCopies;
+    for (auto &bb : func.blocks) {
+        std::vector<Instr> headCopies;
+        for (auto &phi : bb->instrs) {
+            if (phi.op != Opcode::Phi) break;
+            std::vector<int> group;
+            for (size_t i = 0; i < phi.ops.size(); i++) {
+                Instr copy(Opcode::Copy);
+                copy.dst = func.newReg();
+                copy.ops = {phi.ops[i]};
+                phi.ops[i] = Value::reg(copy.dst);
+                group.push_back(copy.dst);
+                predCopies.push_back({phi.blocks[i], std::move(copy)});
+            }
+            Instr copy(Opcode::Copy);
+            copy.dst = phi.dst;
+            phi.dst = func.newReg();
+            copy.ops = {Value::reg(phi.dst)};
+            group.push_back(phi.dst);
+            headCopies.push_back(copy);
+            phiGroups.push_back(std::move(group));
+        }
+        auto firstNonPhi = std::find_if(bb->instrs.begin(), bb->instrs.end(),
+                                        [](const Instr &i) { return i.op != Opcode::Phi; });
+        bb->instrs.insert(firstNonPhi, headCopies.begin(), headCopies.end());
+    }
+    for (auto &[pred, copy] : predCopies) pred->instrs.insert(pred->instrs.end() - 1, std::move(copy));
+
+    // 2. 只对参与复制的寄存器建立干涉关系
+    int n = func.numRegs;
+    std::vector<bool> candidate(n, false);
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op != Opcode::Copy && instr.op != Opcode::Phi) continue;
+            candidate[instr.dst] = true;
+            for (auto &v : instr.ops) {
+                if (v.isReg()) candidate[v.num] = true;
+            }
+        }
+    }
+    std::vector<std::unordered_set<int>> interfere(n);
+    auto addEdge = [&](int a, int b) {
+        if (a == b || !candidate[a] || !candidate[b]) return;
+        interfere[a].insert(b);
+        interfere[b].insert(a);
+    };
+
+    // 活跃的候选寄存器用稀疏集合维护
+    std::vector<int> dense, pos(n, -1);
+    auto setLive = [&](int r, bool on) {
+        if (!candidate[r]) return;
+        if (on && pos[r] < 0) {
+            pos[r] = (int)dense.size();
+            dense.push_back(r);
+        } else if (!on && pos[r] >= 0) {
+            int last = dense.back();
+            dense[pos[r]] = last;
+            pos[last] = pos[r];
+            dense.pop_back();
+            pos[r] = -1;
+        }
+    };
+
+    Liveness live = computeLiveness(func);
+    for (auto &bb : func.blocks) {
+        for (int r : dense) pos[r] = -1;
+        dense.clear();
+        const std::vector<bool> &out = live.liveOut[bb.get()];
+        for (int r = 0; r < n; r++) {
+            if (out[r]) setLive(r, true);
+        }
+        std::vector<int> phiDefs;
+        for (auto it = bb->instrs.rbegin(); it != bb->instrs.rend(); ++it) {
+            const Instr &instr = *it;
+            if (instr.op == Opcode::Phi) {
+                phiDefs.push_back(instr.dst);
+                continue;
+            }
+            if (instr.dst >= 0) {
+                setLive(instr.dst, false);
+                if (candidate[instr.dst]) {
+                    // 复制的源与目标持有相同的值，不算干涉
+                    int src = instr.op == Opcode::Copy && instr.ops[0].isReg() ? instr.ops[0].num : -1;
+                    for (int r : dense) {
+                        if (r != src) addEdge(instr.dst, r);
+                    }
+                }
+            }
+            for (auto &v : instr.ops) {
+                if (v.isReg()) setLive(v.num, true);
+            }
+        }
+        // phi 的结果同时在块入口定义
+        for (int d : phiDefs) setLive(d, false);
+        for (int d : phiDefs) {
+            for (int r : dense) addEdge(d, r);
+            for (int other : phiDefs) addEdge(d, other);
+        }
+    }
+
+    // 3. 合并
+    UnionFind uf(n);
+    std::vector<std::vector<int>> members(n);
+    for (int r = 0; r < n; r++) members[r] = {r};
+    auto classesInterfere = [&](int a, int b) {
+        const auto &small = members[a].size() < members[b].size() ? members[a] : members[b];
+        int other = members[a].size() < members[b].size() ? b : a;
+        for (int m : small) {
+            for (int x : interfere[m]) {
+                if (uf.find(x) == other) return true;
+            }
+        }
+        return false;
+    };
+    auto unite = [&](int a, int b) {
+        a = uf.find(a);
+        b = uf.find(b);
+        if (a == b) return;
+        if (members[a].size() < members[b].size()) std::swap(a, b);
+        uf.parent[b] = a;
+        members[a].insert(members[a].end(), members[b].begin(), members[b].end());
+        members[b].clear();
+    };
+    for (auto &group : phiGroups) {
+        for (int r : group) unite(group.front(), r);
+    }
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op != Opcode::Copy || !instr.ops[0].isReg()) continue;
+            int a = uf.find(instr.dst), b = uf.find(instr.ops[0].num);
+            if (a != b && !classesInterfere(a, b)) unite(a, b);
+        }
+    }
+
+    // 4. 改写为代表寄存器，删除 phi 和自复制
+    for (auto &bb : func.blocks) {
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            if (instr.op == Opcode::Phi) continue;
+            if (instr.dst >= 0) instr.dst = uf.find(instr.dst);
+            for (auto &v : instr.ops) {
+                if (v.isReg()) v.num = uf.find(v.num);
+            }
+            if (instr.op == Opcode::Copy && instr.ops[0] == Value::reg(instr.dst)) continue;
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+    }
+}
+
+} // namespace ir
@@ -0,0 +1,513 @@
+#include "regalloc.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <limits>
+#include <set>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace mir {
+
+void allocateSpillAll(MFunction &func) {
+    static const int scratch[] = {T0, T1, T2};
+    std::vector<int> defs, uses;
+
+    // 只在一个块内出现、不跨块活跃的虚拟寄存器（指令选择展开的临时值）在最后一次使用后
+    // 归还栈槽，给后面的临时值复用；其余虚拟寄存器各占一个槽
+    BlockLiveness live = computeBlockLiveness(func);
+    std::vector<int> homeBlock(func.nextVReg, -1);
+    for (size_t b = 0; b < func.blocks.size(); b++) {
+        for (auto &instr : func.blocks[b]->instrs) {
+            instr.getUses(uses);
+            instr.getDefs(defs);
+            uses.insert(uses.end(), defs.begin(), defs.end());
+            for (int r : uses) {
+                if (isVirtReg(r)) homeBlock[r] = homeBlock[r] == -1 || homeBlock[r] == (int)b ? (int)b : -2;
+            }
+        }
+    }
+    auto isBlockLocal = [&](int r, size_t b) {
+        return homeBlock[r] == (int)b && !live.liveIn[b][r] && !live.liveOut[b][r];
+    };
+
+    std::unordered_map<int, int> slotOf;
+    std::vector<int> localSlots, freeLocalSlots;
+    int spilled = 0;
+    auto slotFor = [&](int vreg) {
+        auto it = slotOf.find(vreg);
+        if (it != slotOf.end()) return it->second;
+        int fi = func.newFrameObject();
+        slotOf[vreg] = fi;
+        spilled++;
+        return fi;
+    };
+
+    for (size_t b = 0; b < func.blocks.size(); b++) {
+        auto &bb = func.blocks[b];
+        std::unordered_map<int, size_t> lastUse;
+        for (size_t i = 0; i < bb->instrs.size(); i++) {
+            bb->instrs[i].getUses(uses);
+            bb->instrs[i].getDefs(defs);
+            uses.insert(uses.end(), defs.begin(), defs.end());
+            for (int r : uses) {
+                if (isVirtReg(r) && isBlockLocal(r, b)) lastUse[r] = i;
+            }
+        }
+        freeLocalSlots = localSlots;
+        std::unordered_map<int, int> localSlotOf;
+        auto localSlotFor = [&](int vreg) {
+            auto it = localSlotOf.find(vreg);
+            if (it != localSlotOf.end()) return it->second;
+            int fi;
+            if (freeLocalSlots.empty()) {
+                fi = func.newFrameObject();
+                localSlots.push_back(fi);
+            } else {
+                fi = freeLocalSlots.back();
+                freeLocalSlots.pop_back();
+            }
+            localSlotOf[vreg] = fi;
+            spilled++;
+            return fi;
+        };
+        auto slotOfReg = [&](int vreg) { return lastUse.count(vreg) ? localSlotFor(vreg) : slotFor(vreg); };
+
+        std::vector<MInstr> out;
+        for (size_t index = 0; index < bb->instrs.size(); index++) {
+            auto &instr = bb->instrs[index];
+            // 指令内每个不同的虚拟寄存器各占一个临时寄存器
+            std::unordered_map<int, int> assigned;
+            auto physFor = [&](int vreg) {
+                auto it = assigned.find(vreg);
+                if (it != assigned.end()) return it->second;
+                if (assigned.size() >= sizeof(scratch) / sizeof(scratch[0]))
+                    throw std::runtime_error("too many virtual registers in one instruction");
+                int phys = scratch[assigned.size()];
+                assigned[vreg] = phys;
+                return phys;
+            };
+
+            instr.getUses(uses);
+            for (int r : uses) {
+                if (!isVirtReg(r) || assigned.count(r)) continue;
+                out.emplace_back("lw", std::vector<MOperand>{MOperand::r(physFor(r)), MOperand::frame(slotOfReg(r))});
+                func.spillInstrs++;
+            }
+            instr.getDefs(defs);
+            std::vector<int> defined;
+            for (int r : defs) {
+                if (isVirtReg(r)) {
+                    physFor(r);
+                    defined.push_back(r);
+                }
+            }
+            for (auto &o : instr.ops) {
+                if ((o.isReg() || o.isMem()) && isVirtReg(o.reg)) o.reg = assigned[o.reg];
+            }
+            out.push_back(std::move(instr));
+            for (int r : defined) {
+                out.emplace_back("sw", std::vector<MOperand>{MOperand::r(assigned[r]), MOperand::frame(slotOfReg(r))});
+                func.spillInstrs++;
+            }
+            for (auto &[r, phys] : assigned) {
+                auto it = lastUse.find(r);
+                if (it != lastUse.end() && it->second == index) freeLocalSlots.push_back(localSlotOf.at(r));
+            }
+        }
+        bb->instrs = std::move(out);
+    }
+    func.spilledVRegs = spilled;
+}
+
+BlockLiveness computeBlockLiveness(const MFunction &func) {
+    size_t n = func.blocks.size();
+    int numRegs = func.nextVReg;
+    std::unordered_map<const MBlock *, size_t> index;
+    for (size_t i = 0; i < n; i++) index[func.blocks[i].get()] = i;
+
+    std::vector<std::vector<bool>> use(n, std::vector<bool>(numRegs)), def(n, std::vector<bool>(numRegs));
+    std::vector<int> defs, uses;
+    for (size_t b = 0; b < n; b++) {
+        for (auto &instr : func.blocks[b]->instrs) {
+            instr.getUses(uses);
+            for (int r : uses) {
+                if (!def[b][r]) use[b][r] = true;
+            }
+            instr.getDefs(defs);
+            for (int r : defs) def[b][r] = true;
+        }
+    }
+
+    BlockLiveness live;
+    live.liveIn.assign(n, std::vector<bool>(numRegs));
+    live.liveOut.assign(n, std::vector<bool>(numRegs));
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (size_t b = n; b-- > 0;) {
+            std::vector<bool> out(numRegs);
+            for (MBlock *succ : func.blocks[b]->succs) {
+                const auto &in = live.liveIn[index[succ]];
+                for (int r = 0; r < numRegs; r++) {
+                    if (in[r]) out[r] = true;
+                }
+            }
+            std::vector<bool> in(numRegs);
+            for (int r = 0; r < numRegs; r++) in[r] = use[b][r] || (out[r] && !def[b][r]);
+            if (in != live.liveIn[b] || out != live.liveOut[b]) {
+                live.liveIn[b] = std::move(in);
+                live.liveOut[b] = std::move(out);
+                changed = true;
+            }
+        }
+    }
+    return live;
+}
+
+bool isAllocatable(int r) {
+    return (r >= T0 && r <= T2) || (r >= T3 && r <= T6) || (r >= A0 && r <= A7) || r == S1 || (r >= S2 && r <= S11);
+}
+
+const std::vector<int> &callerSavedOrder() {
+    static const std::vector<int> regs = {T0, T1, T2, T3, T4, T5, T6, A7, A6, A5, A4, A3, A2, A1, A0};
+    return regs;
+}
+
+const std::vector<int> &calleeSavedOrder() {
+    static const std::vector<int> regs = {S1, S2, S3, S4, S5, S6, S7, S8, S9, S10, S11};
+    return regs;
+}
+
+// 单一 li 定义的常量在每次使用前重新生成，否则用栈槽在每次定义后写回、使用前装载
+std::vector<int> spillVirtReg(MFunction &func, int v) {
+    const MInstr *def = nullptr;
+    int numDefs = 0;
+    std::vector<int> defs, uses;
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            instr.getDefs(defs);
+            if (std::find(defs.begin(), defs.end(), v) != defs.end()) {
+                numDefs++;
+                def = &instr;
+            }
+        }
+    }
+    bool remat = numDefs == 1 && def->op == "li";
+    int imm = remat ? def->ops[1].imm : 0;
+    int fi = remat ? -1 : func.newFrameObject();
+    std::vector<int> temps;
+    func.spilledVRegs++;
+
+    for (auto &bb : func.blocks) {
+        std::vector<MInstr> out;
+        for (auto &instr : bb->instrs) {
+            instr.getDefs(defs);
+            bool isDef = std::find(defs.begin(), defs.end(), v) != defs.end();
+            if (remat && isDef) continue;
+            instr.getUses(uses);
+            bool isUse = std::find(uses.begin(), uses.end(), v) != uses.end();
+            if (!isDef && !isUse) {
+                out.push_back(std::move(instr));
+                continue;
+            }
+            int t = func.newVReg();
+            temps.push_back(t);
+            if (isUse) {
+                func.spillInstrs++;
+                if (remat) out.emplace_back("li", std::vector<MOperand>{MOperand::r(t), MOperand::i(imm)});
+                else out.emplace_back("lw", std::vector<MOperand>{MOperand::r(t), MOperand::frame(fi)});
+            }
+            for (auto &o : instr.ops) {
+                if ((o.isReg() || o.isMem()) && o.reg == v) o.reg = t;
+            }
+            out.push_back(std::move(instr));
+            if (isDef) {
+                out.emplace_back("sw", std::vector<MOperand>{MOperand::r(t), MOperand::frame(fi)});
+                func.spillInstrs++;
+            }
+        }
+        bb->instrs = std::move(out);
+    }
+    return temps;
+}
+
+namespace {
+
+// 线性扫描使用的程序点：第 i 条指令读操作数在 2i，写结果在 2i+1
+struct LiveInterval {
+    int vreg = 0;
+    int start = INT_MAX;
+    int end = -1;
+    double weight = 0;      // 循环深度加权的引用次数
+    bool noSpill = false;   // 溢出代码引入的临时寄存器
+    bool crossesCall = false;
+    bool remat = false;     // 唯一的定义是 li，溢出时只需重新物化
+    int numDefs = 0;
+    int reg = -1;
+
+    void cover(int pos) {
+        start = std::min(start, pos);
+        end = std::max(end, pos);
+    }
+    double spillCost() const {
+        if (noSpill) return std::numeric_limits<double>::infinity();
+        return (remat ? 0.5 : 1.0) * weight / (end - start + 1);
+    }
+};
+
+class LinearScan {
+public:
+    explicit LinearScan(MFunction &f) : func(f) {}
+
+    void run() {
+        func.rebuildCFG();
+        func.computeLoopDepth();
+        while (true) {
+            buildIntervals();
+            std::vector<int> spilled = scan();
+            if (spilled.empty()) break;
+            for (int v : spilled) {
+                for (int t : spillVirtReg(func, v)) noSpill.insert(t);
+            }
+        }
+        rewrite();
+    }
+
+private:
+    MFunction &func;
+    std::unordered_set<int> noSpill;
+    std::unordered_map<int, LiveInterval> intervals;
+    std::vector<std::vector<std::pair<int, int>>> fixed;    // 物理寄存器被占用的区间
+    std::vector<int> callPositions;
+    std::unordered_map<int, std::vector<int>> hints;        // 复制相关的寄存器
+
+    void buildIntervals() {
+        intervals.clear();
+        fixed.assign(kNumPhysRegs, {});
+        callPositions.clear();
+        hints.clear();
+        BlockLiveness live = computeBlockLiveness(func);
+        std::vector<int> defs, uses;
+        int numRegs = func.nextVReg;
+
+        int index = 0;
+        for (size_t b = 0; b < func.blocks.size(); b++) {
+            MBlock &bb = *func.blocks[b];
+            if (bb.instrs.empty()) continue;
+            int blockStart = 2 * index;
+            int blockEnd = 2 * (index + (int)bb.instrs.size()) - 1;
+            double w = std::pow(10.0, std::min(bb.loopDepth, 6));
+
+            // 物理寄存器：逆序扫描得到精确的占用区间
+            std::vector<int> openEnd(kNumPhysRegs, -1);
+            for (int r = 0; r < kNumPhysRegs; r++) {
+                if (isAllocatable(r) && live.liveOut[b][r]) openEnd[r] = blockEnd;
+            }
+            for (int i = (int)bb.instrs.size() - 1; i >= 0; i--) {
+                const MInstr &instr = bb.instrs[i];
+                int pos = 2 * (index + i);
+                instr.getDefs(defs);
+                for (int r : defs) {
+                    if (!isAllocatable(r)) continue;
+                    if (openEnd[r] >= 0) {
+                        fixed[r].push_back({pos + 1, openEnd[r]});
+                        openEnd[r] = -1;
+                    } else if (!instr.isCall()) {
+                        fixed[r].push_back({pos + 1, pos + 1});
+                    }
+                }
+                instr.getUses(uses);
+                for (int r : uses) {
+                    if (isAllocatable(r) && openEnd[r] < 0) openEnd[r] = pos;
+                }
+            }
+            for (int r = 0; r < kNumPhysRegs; r++) {
+                if (openEnd[r] >= 0) fixed[r].push_back({blockStart, openEnd[r]});
+            }
+
+            // 虚拟寄存器：只记录覆盖所有活跃点的单一区间
+            for (int r = kFirstVirtReg; r < numRegs; r++) {
+                if (live.liveIn[b][r]) intervals[r].cover(blockStart);
+                if (live.liveOut[b][r]) intervals[r].cover(blockEnd);
+            }
+            for (size_t i = 0; i < bb.instrs.size(); i++) {
+                const MInstr &instr = bb.instrs[i];
+                int pos = 2 * (index + (int)i);
+                if (instr.isCall()) callPositions.push_back(pos);
+                instr.getUses(uses);
+                for (int r : uses) {
+                    if (!isVirtReg(r)) continue;
+                    intervals[r].cover(pos);
+                    intervals[r].weight += w;
+                }
+                instr.getDefs(defs);
+                for (int r : defs) {
+                    if (!isVirtReg(r)) continue;
+                    LiveInterval &li = intervals[r];
+                    li.cover(pos + 1);
+                    li.weight += w;
+                    li.remat = ++li.numDefs == 1 && instr.op == "li";
+                }
+                if (instr.isCopy()) {
+                    int d = instr.ops[0].reg, s = instr.ops[1].reg;
+                    hints[d].push_back(s);
+                    hints[s].push_back(d);
+                }
+            }
+            index += (int)bb.instrs.size();
+        }
+
+        for (auto &[v, li] : intervals) {
+            li.vreg = v;
+            li.noSpill = noSpill.count(v) != 0;
+            for (int c : callPositions) {
+                if (li.start <= c && li.end >= c + 1) {
+                    li.crossesCall = true;
+                    break;
+                }
+            }
+        }
+    }
+
+    bool fixedConflict(int reg, const LiveInterval &li) const {
+        for (auto &[s, e] : fixed[reg]) {
+            if (s <= li.end && li.start <= e) return true;
+        }
+        return false;
+    }
+
+    // 返回需要溢出的虚拟寄存器；为空表示分配成功
+    std::vector<int> scan() {
+        std::vector<LiveInterval *> order;
+        for (auto &[v, li] : intervals) order.push_back(&li);
+        std::sort(order.begin(), order.end(), [](const LiveInterval *a, const LiveInterval *b) {
+            return a->start != b->start ? a->start < b->start : a->vreg < b->vreg;
+        });
+
+        std::vector<LiveInterval *> active;
+        std::vector<LiveInterval *> regOwner(kNumPhysRegs, nullptr);
+        std::vector<int> spilled;
+        for (LiveInterval *cur : order) {
+            // 释放已经结束的区间
+            for (size_t i = 0; i < active.size();) {
+                if (active[i]->end < cur->start) {
+                    regOwner[active[i]->reg] = nullptr;
+                    active[i] = active.back();
+                    active.pop_back();
+                } else {
+                    i++;
+                }
+            }
+
+            auto isFree = [&](int r) { return isAllocatable(r) && !regOwner[r] && !fixedConflict(r, *cur); };
+            int chosen = -1;
+            // 先尝试复制另一端的寄存器，能省掉 mv
+            auto hintIt = hints.find(cur->vreg);
+            if (hintIt != hints.end()) {
+                for (int h : hintIt->second) {
+                    int r = isVirtReg(h) ? (intervals.count(h) ? intervals[h].reg : -1) : h;
+                    if (r < 0 || !isFree(r)) continue;
+                    if (cur->crossesCall && !isCalleeSaved(r)) continue;
+                    chosen = r;
+                    break;
+                }
+            }
+            const auto &first = cur->crossesCall ? calleeSavedOrder() : callerSavedOrder();
+            const auto &second = cur->crossesCall ? callerSavedOrder() : calleeSavedOrder();
+            for (const auto *regs : {&first, &second}) {
+                for (int r : *regs) {
+                    if (chosen < 0 && isFree(r)) chosen = r;
+                }
+            }
+
+            if (chosen < 0) {
+                // 在能让出合适寄存器的活跃区间里找溢出代价最小的
+                LiveInterval *victim = nullptr;
+                for (LiveInterval *a : active) {
+                    if (fixedConflict(a->reg, *cur)) continue;
+                    if (!victim || a->spillCost() < victim->spillCost()) victim = a;
+                }
+                if (victim && victim->spillCost() < cur->spillCost()) {
+                    chosen = victim->reg;
+                    regOwner[chosen] = nullptr;
+                    active.erase(std::find(active.begin(), active.end(), victim));
+                    victim->reg = -1;
+                    spilled.push_back(victim->vreg);
+                } else if (!cur->noSpill) {
+                    spilled.push_back(cur->vreg);
+                    continue;
+                } else {
+                    throw std::runtime_error("register allocation failed in '" + func.name + "'");
+                }
+            }
+            cur->reg = chosen;
+            regOwner[chosen] = cur;
+            active.push_back(cur);
+        }
+        return spilled;
+    }
+
+    // 改写为物理寄存器，删除自复制，为跨调用的调用者保存寄存器插入保存/恢复
+    void rewrite() {
+        std::vector<const LiveInterval *> callerSavedAcrossCall;
+        std::unordered_map<int, int> saveSlot;
+        std::set<int> calleeUsed;
+        for (auto &[v, li] : intervals) {
+            if (isCalleeSaved(li.reg)) calleeUsed.insert(li.reg);
+            else if (li.crossesCall) {
+                callerSavedAcrossCall.push_back(&li);
+                saveSlot[v] = func.newFrameObject();
+            }
+        }
+        std::sort(callerSavedAcrossCall.begin(), callerSavedAcrossCall.end(),
+                  [](const LiveInterval *a, const LiveInterval *b) { return a->reg < b->reg; });
+        func.usedCalleeSaved.assign(calleeUsed.begin(), calleeUsed.end());
+
+        int index = 0;
+        for (auto &bb : func.blocks) {
+            std::vector<MInstr> out;
+            for (auto &instr : bb->instrs) {
+                int pos = 2 * index++;
+                for (auto &o : instr.ops) {
+                    if ((o.isReg() || o.isMem()) && isVirtReg(o.reg)) o.reg = intervals.at(o.reg).reg;
+                }
+                if (instr.isCopy() && instr.ops[0].reg == instr.ops[1].reg) continue;
+                if (!instr.isCall()) {
+                    out.push_back(std::move(instr));
+                    continue;
+                }
+                std::vector<const LiveInterval *> saved;
+                for (const LiveInterval *li : callerSavedAcrossCall) {
+                    if (li->start <= pos && li->end >= pos + 1) saved.push_back(li);
+                }
+                func.spillInstrs += 2 * (int)saved.size();
+                for (const LiveInterval *li : saved) {
+                    out.emplace_back("sw", std::vector<MOperand>{MOperand::r(li->reg), MOperand::frame(saveSlot[li->vreg])});
+                }
+                out.push_back(std::move(instr));
+                for (const LiveInterval *li : saved) {
+                    out.emplace_back("lw", std::vector<MOperand>{MOperand::r(li->reg), MOperand::frame(saveSlot[li->vreg])});
+                }
+            }
+            bb->instrs = std::move(out);
+        }
+    }
+};
+
+} // namespace
+
+void allocateLinearScan(MFunction &func) {
+    LinearScan(func).run();
+}
+
+void allocateRegisters(MFunction &func, RegAllocKind kind) {
+    switch (kind) {
+        case RegAllocKind::SpillAll: allocateSpillAll(func); break;
+        case RegAllocKind::LinearScan: allocateLinearScan(func); break;
+        case RegAllocKind::GraphColoring: allocateGraphColoring(func); break;
+    }
+}
+
+} // namespace mir
@@ -0,0 +1,233 @@
+#include "passes.h"
+#include <algorithm>
+#include <set>
+#include <unordered_map>
+#include <unordered_set>
+
+namespace ir {
+
+namespace {
+
+// 格：Top（还没有可执行的定义）> Const > Bottom（不是常量）
+struct Lattice {
+    enum class State { Top, Const, Bottom };
+    State state = State::Top;
+    int value = 0;
+
+    static Lattice constant(int v) { return Lattice{State::Const, v}; }
+    static Lattice bottom() { return Lattice{State::Bottom, 0}; }
+
+    bool isTop() const { return state == State::Top; }
+    bool isConst() const { return state == State::Const; }
+    bool isBottom() const { return state == State::Bottom; }
+    bool operator==(const Lattice &o) const { return state == o.state && (!isConst() || value == o.value); }
+};
+
+Lattice meet(const Lattice &a, const Lattice &b) {
+    if (a.isTop()) return b;
+    if (b.isTop()) return a;
+    if (a == b) return a;
+    return Lattice::bottom();
+}
+
+class Solver {
+public:
+    explicit Solver(Function &f) : func(f), values(f.numRegs) {
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                for (auto &v : instr.ops) {
+                    if (v.isReg()) users[v.num].push_back({&instr, bb.get()});
+                }
+            }
+        }
+    }
+
+    void solve() {
+        edgeWork.push_back({nullptr, func.entry()});
+        while (!edgeWork.empty() || !valueWork.empty()) {
+            while (!edgeWork.empty()) {
+                auto edge = edgeWork.back();
+                edgeWork.pop_back();
+                if (!executableEdges.insert(edge).second) continue;
+                BasicBlock *bb = edge.second;
+                // 第一次到达的块求值全部指令，之后新增的入边只影响 phi
+                bool first = executableBlocks.insert(bb).second;
+                for (auto &instr : bb->instrs) {
+                    if (!first && instr.op != Opcode::Phi) break;
+                    visit(instr, bb);
+                }
+            }
+            while (!valueWork.empty()) {
+                int reg = valueWork.back();
+                valueWork.pop_back();
+                for (auto [instr, bb] : users[reg]) {
+                    if (executableBlocks.count(bb)) visit(*instr, bb);
+                }
+            }
+        }
+    }
+
+    bool isExecutable(const BasicBlock *bb) const { return executableBlocks.count(bb) != 0; }
+    const Lattice &valueOf(int reg) const { return values[reg]; }
+
+private:
+    Function &func;
+    std::vector<Lattice> values;
+    std::unordered_map<int, std::vector<std::pair<Instr *, BasicBlock *>>> users;
+    std::set<std::pair<const BasicBlock *, BasicBlock *>> executableEdges;
+    std::unordered_set<const BasicBlock *> executableBlocks;
+    std::vector<std::pair<const BasicBlock *, BasicBlock *>> edgeWork;
+    std::vector<int> valueWork;
+
+    Lattice operand(const Value &v) const {
+        return v.isImm() ? Lattice::constant(v.num) : values[v.num];
+    }
+
+    void update(int reg, const Lattice &v) {
+        // 只会沿格往下走，最多改变两次
+        Lattice merged = meet(values[reg], v);
+        if (merged == values[reg]) return;
+        values[reg] = merged;
+        valueWork.push_back(reg);
+    }
+
+    void markEdge(const BasicBlock *from, BasicBlock *to) {
+        if (!executableEdges.count({from, to})) edgeWork.push_back({from, to});
+    }
+
+    void visit(Instr &instr, BasicBlock *bb) {
+        switch (instr.op) {
+            case Opcode::Jmp:
+                markEdge(bb, instr.blocks[0]);
+                return;
+            case Opcode::Br: {
+                Lattice cond = operand(instr.ops[0]);
+                if (cond.isTop()) return;
+                if (cond.isBottom() || cond.value != 0) markEdge(bb, instr.blocks[0]);
+                if (cond.isBottom() || cond.value == 0) markEdge(bb, instr.blocks[1]);
+                return;
+            }
+            case Opcode::Phi: {
+                Lattice v;
+                for (size_t i = 0; i < instr.ops.size(); i++) {
+                    if (executableEdges.count({instr.blocks[i], bb})) v = meet(v, operand(instr.ops[i]));
+                }
+                if (!v.isTop()) update(instr.dst, v);
+                return;
+            }
+            default:
+                break;
+        }
+        if (instr.dst < 0) return;
+
+        if (isBinary(instr.op)) {
+            Lattice a = operand(instr.ops[0]), b = operand(instr.ops[1]);
+            int result;
+            if (a.isBottom() || b.isBottom()) update(instr.dst, Lattice::bottom());
+            else if (a.isTop() || b.isTop()) return;
+            else if (evalBinary(instr.op, a.value, b.value, result)) update(instr.dst, Lattice::constant(result));
+            else update(instr.dst, Lattice::bottom());    // 除以 0 留到运行时
+        } else if (isUnary(instr.op)) {
+            Lattice a = operand(instr.ops[0]);
+            if (a.isConst()) update(instr.dst, Lattice::constant(evalUnary(instr.op, a.value)));
+            else if (a.isBottom()) update(instr.dst, Lattice::bottom());
+        } else {
+            // 形参、栈槽和调用结果都不是常量
+            update(instr.dst, Lattice::bottom());
+        }
+    }
+};
+
+// 删除所有入值相同的 phi（删边之后只剩一个前驱的 phi 也属于此类）
+void removeRedundantPhis(Function &func) {
+    std::unordered_map<int, Value> replace;
+    auto resolve = [&](Value v) {
+        while (v.isReg() && replace.count(v.num)) v = replace.at(v.num);
+        return v;
+    };
+    bool changed = true;
+    while (changed) {
+        changed = false;
+        for (auto &bb : func.blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op != Opcode::Phi || instr.dst < 0 || instr.ops.empty()) continue;
+                Value same = resolve(instr.ops[0]);
+                bool trivial = true;
+                for (auto &v : instr.ops) trivial = trivial && resolve(v) == same;
+                if (!trivial || same == Value::reg(instr.dst)) continue;
+                replace[instr.dst] = same;
+                instr.dst = -1;
+                changed = true;
+            }
+        }
+    }
+    if (replace.empty()) return;
+    for (auto &bb : func.blocks) {
+        auto &instrs = bb->instrs;
+        instrs.erase(std::remove_if(instrs.begin(), instrs.end(),
+                                    [](const Instr &i) { return i.op == Opcode::Phi && i.dst < 0; }),
+                     instrs.end());
+        for (auto &instr : instrs) {
+            for (auto &v : instr.ops) v = resolve(v);
+        }
+    }
+}
+
+} // namespace
+
+bool sparseConditionalConstantPropagation(Function &func, SCCPStats *stats) {
+    Solver solver(func);
+    solver.solve();
+
+    SCCPStats local;
+    for (auto &bb : func.blocks) {
+        if (!solver.isExecutable(bb.get())) continue;
+        std::vector<Instr> kept;
+        for (auto &instr : bb->instrs) {
+            if (instr.dst >= 0 && solver.valueOf(instr.dst).isConst() && !instr.hasSideEffects()) {
+                local.constants++;
+                continue;
+            }
+            for (auto &v : instr.ops) {
+                if (v.isReg() && solver.valueOf(v.num).isConst()) v = Value::imm(solver.valueOf(v.num).value);
+            }
+            kept.push_back(std::move(instr));
+        }
+        bb->instrs = std::move(kept);
+
+        // 条件恒定的分支：改写为 jmp，并从不再走到的后继的 phi 中删掉这条入边
+        Instr &term = bb->terminator();
+        if (term.op != Opcode::Br || !term.ops[0].isImm()) continue;
+        BasicBlock *taken = term.blocks[term.ops[0].num != 0 ? 0 : 1];
+        BasicBlock *dropped = term.blocks[term.ops[0].num != 0 ? 1 : 0];
+        if (dropped != taken) {
+            for (auto &instr : dropped->instrs) {
+                if (instr.op != Opcode::Phi) break;
+                for (size_t i = instr.blocks.size(); i-- > 0;) {
+                    if (instr.blocks[i] != bb.get()) continue;
+                    instr.blocks.erase(instr.blocks.begin() + i);
+                    instr.ops.erase(instr.ops.begin() + i);
+                }
+            }
+        }
+        term.op = Opcode::Jmp;
+        term.ops.clear();
+        term.blocks = {taken};
+        local.branchesFolded++;
+    }
+
+    size_t before = func.blocks.size();
+    func.rebuildCFG();
+    func.removeUnreachableBlocks();
+    local.blocksRemoved = (int)(before - func.blocks.size());
+    if (local.branchesFolded || local.blocksRemoved) removeRedundantPhis(func);
+
+    if (stats) {
+        stats->constants += local.constants;
+        stats->branchesFolded += local.branchesFolded;
+        stats->blocksRemoved += local.blocksRemoved;
+    }
+    return local.constants || local.branchesFolded || local.blocksRemoved;
+}
+
+} // namespace ir
@@ -0,0 +1,304 @@
+#include "analysis.h"
+#include <climits>
+
+namespace ir {
+
+namespace {
+
+int wrapAdd(int a, int b) { return (int)((unsigned)a + (unsigned)b); }
+int wrapMul(int a, int b) { return (int)((unsigned)a * (unsigned)b); }
+
+AddRec invariant(const LinearSum &s) {
+    AddRec r;
+    r.coeffs[0] = s;
+    return r;
+}
+
+AddRec add(const AddRec &a, const AddRec &b) {
+    AddRec r;
+    for (int i = 0; i < 3; i++) r.coeffs[i] = a.coeffs[i] + b.coeffs[i];
+    return r;
+}
+
+AddRec scale(const AddRec &a, int k) {
+    AddRec r;
+    for (int i = 0; i < 3; i++) r.coeffs[i] = a.coeffs[i] * k;
+    return r;
+}
+
+// 线性组合只能乘常量，两个都带寄存器时不是线性的
+std::optional<LinearSum> multiply(const LinearSum &a, const LinearSum &b) {
+    if (a.isConstant()) return b * a.constant;
+    if (b.isConstant()) return a * b.constant;
+    return std::nullopt;
+}
+
+// (a0 + a1 k)(b0 + b1 k) = a0 b0 + (a0 b1 + a1 b0 + a1 b1) k + 2 a1 b1 k(k-1)/2
+std::optional<AddRec> multiply(const AddRec &a, const AddRec &b) {
+    if (a.order() + b.order() > 2) return std::nullopt;
+    if (a.order() == 0 || b.order() == 0) {
+        const AddRec &c = a.order() == 0 ? a : b, &r = a.order() == 0 ? b : a;
+        AddRec product;
+        for (int i = 0; i < 3; i++) {
+            auto coeff = multiply(c.coeffs[0], r.coeffs[i]);
+            if (!coeff) return std::nullopt;
+            product.coeffs[i] = *coeff;
+        }
+        return product;
+    }
+    auto a0b0 = multiply(a.coeffs[0], b.coeffs[0]), a0b1 = multiply(a.coeffs[0], b.coeffs[1]);
+    auto a1b0 = multiply(a.coeffs[1], b.coeffs[0]), a1b1 = multiply(a.coeffs[1], b.coeffs[1]);
+    if (!a0b0 || !a0b1 || !a1b0 || !a1b1) return std::nullopt;
+    AddRec product;
+    product.coeffs[0] = *a0b0;
+    product.coeffs[1] = *a0b1 + *a1b0 + *a1b1;
+    product.coeffs[2] = *a1b1 * 2;
+    return product;
+}
+
+Opcode negate(Opcode op) {
+    switch (op) {
+        case Opcode::Lt: return Opcode::Ge;
+        case Opcode::Le: return Opcode::Gt;
+        case Opcode::Gt: return Opcode::Le;
+        case Opcode::Ge: return Opcode::Lt;
+        case Opcode::Eq: return Opcode::Ne;
+        default: return Opcode::Eq;
+    }
+}
+
+// a op b 等价于 b swapped(op) a
+Opcode swapped(Opcode op) {
+    switch (op) {
+        case Opcode::Lt: return Opcode::Gt;
+        case Opcode::Le: return Opcode::Ge;
+        case Opcode::Gt: return Opcode::Lt;
+        case Opcode::Ge: return Opcode::Le;
+        default: return op;
+    }
+}
+
+// x + step*k 与常量 n 比较：第一次不满足 op 时的 k。要求此前不回绕
+std::optional<long long> constantTripCount(Opcode op, long long x, long long step, long long n) {
+    auto holds = [&](long long v) {
+        switch (op) {
+            case Opcode::Lt: return v < n;
+            case Opcode::Le: return v <= n;
+            case Opcode::Gt: return v > n;
+            case Opcode::Ge: return v >= n;
+            case Opcode::Eq: return v == n;
+            default: return v != n;
+        }
+    };
+    long long count = 0;
+    if (holds(x)) {
+        switch (op) {
+            case Opcode::Lt:
+                if (step <= 0) return std::nullopt;
+                count = (n - x + step - 1) / step;
+                break;
+            case Opcode::Le:
+                if (step <= 0) return std::nullopt;
+                count = (n - x) / step + 1;
+                break;
+            case Opcode::Gt:
+                if (step >= 0) return std::nullopt;
+                count = (x - n - step - 1) / -step;
+                break;
+            case Opcode::Ge:
+                if (step >= 0) return std::nullopt;
+                count = (x - n) / -step + 1;
+                break;
+            case Opcode::Eq:
+                count = 1;
+                break;
+            default:
+                if ((n - x) % step != 0 || (n - x) / step <= 0) return std::nullopt;
+                count = (n - x) / step;
+                break;
+        }
+    }
+    long long last = x + step * count;
+    if (count > INT_MAX || last < INT_MIN || last > INT_MAX) return std::nullopt;
+    return count;
+}
+
+} // namespace
+
+LinearSum LinearSum::of(const Value &v) {
+    LinearSum s;
+    if (v.isImm()) s.constant = v.num;
+    else if (v.isReg()) s.terms[v.num] = 1;
+    return s;
+}
+
+LinearSum LinearSum::operator+(const LinearSum &o) const {
+    LinearSum s = *this;
+    s.constant = wrapAdd(constant, o.constant);
+    for (auto &[reg, factor] : o.terms) {
+        int f = wrapAdd(s.terms[reg], factor);
+        if (f) s.terms[reg] = f;
+        else s.terms.erase(reg);
+    }
+    return s;
+}
+
+LinearSum LinearSum::operator*(int k) const {
+    LinearSum s;
+    s.constant = wrapMul(constant, k);
+    for (auto &[reg, factor] : terms) {
+        if (int f = wrapMul(factor, k)) s.terms[reg] = f;
+    }
+    return s;
+}
+
+int AddRec::order() const {
+    for (int i = 2; i > 0; i--) {
+        if (!coeffs[i].isZero()) return i;
+    }
+    return 0;
+}
+
+ScalarEvolution::ScalarEvolution(const Function &func, const std::vector<Loop> &loops) {
+    for (auto &bb : func.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.dst < 0) continue;
+            defs[instr.dst] = &instr;
+            defBlocks[instr.dst] = bb.get();
+        }
+    }
+    // 内层循环排在前面，第一个包含它的就是最内层
+    for (auto &loop : loops) {
+        for (const BasicBlock *bb : loop.blocks) innermost.emplace(bb, &loop);
+    }
+}
+
+const Loop *ScalarEvolution::innermostLoop(const BasicBlock *bb) const {
+    auto it = innermost.find(bb);
+    return it == innermost.end() ? nullptr : it->second;
+}
+
+std::optional<AddRec> ScalarEvolution::evolution(const Value &v, const Loop &loop) {
+    if (!v.isReg()) return invariant(LinearSum::of(v));
+    auto block = defBlocks.find(v.num);
+    if (block == defBlocks.end() || !loop.contains(block->second)) return invariant(LinearSum::of(v));
+    if (innermostLoop(block->second) != &loop) return std::nullopt;
+    auto key = std::make_pair(&loop, v.num);
+    auto it = cache.find(key);
+    if (it != cache.end()) return it->second;
+    if (pending.count(v.num)) return std::nullopt;
+    pending.insert(v.num);
+    auto result = compute(*defs.at(v.num), loop);
+    pending.erase(v.num);
+    // 求某个 phi 的途中因为绕回它而失败的结果，换个起点可能求得出来，不记
+    if (result || pending.empty()) cache[key] = result;
+    return result;
+}
+
+std::optional<AddRec> ScalarEvolution::compute(const Instr &instr, const Loop &loop) {
+    switch (instr.op) {
+        case Opcode::Copy:
+            return evolution(instr.ops[0], loop);
+        case Opcode::Neg: {
+            auto a = evolution(instr.ops[0], loop);
+            if (!a) return std::nullopt;
+            return scale(*a, -1);
+        }
+        case Opcode::Add:
+        case Opcode::Sub:
+        case Opcode::Mul: {
+            auto a = evolution(instr.ops[0], loop), b = evolution(instr.ops[1], loop);
+            if (!a || !b) return std::nullopt;
+            if (instr.op == Opcode::Mul) return multiply(*a, *b);
+            return add(*a, instr.op == Opcode::Add ? *b : scale(*b, -1));
+        }
+        case Opcode::Phi: {
+            // 循环头的 phi：从循环外进来的初值，加上每次迭代的增量。增量本身最多是 1 阶的
+            if (defBlocks.at(instr.dst) != loop.header || instr.ops.size() != 2) return std::nullopt;
+            int inside = loop.contains(instr.blocks[0]) ? 0 : 1;
+            if (loop.contains(instr.blocks[1 - inside]) || !loop.contains(instr.blocks[inside])) return std::nullopt;
+            auto step = offsetFrom(instr.ops[inside], instr.dst, loop);
+            if (!step || step->order() > 1) return std::nullopt;
+            AddRec r;
+            r.coeffs[0] = LinearSum::of(instr.ops[1 - inside]);
+            r.coeffs[1] = step->coeffs[0];
+            r.coeffs[2] = step->coeffs[1];
+            return r;
+        }
+        default:
+            return std::nullopt;
+    }
+}
+
+// v = %phi + 返回值：沿 v 的定义中含有 %phi 的那一侧的加减法往回找
+std::optional<AddRec> ScalarEvolution::offsetFrom(const Value &v, int phi, const Loop &loop) {
+    if (!v.isReg()) return std::nullopt;
+    if (v.num == phi) return invariant(LinearSum());
+    auto block = defBlocks.find(v.num);
+    if (block == defBlocks.end() || innermostLoop(block->second) != &loop) return std::nullopt;
+    const Instr &def = *defs.at(v.num);
+    switch (def.op) {
+        case Opcode::Copy:
+            return offsetFrom(def.ops[0], phi, loop);
+        case Opcode::Add:
+            for (int side = 0; side < 2; side++) {
+                auto a = offsetFrom(def.ops[side], phi, loop);
+                if (!a) continue;
+                auto b = evolution(def.ops[1 - side], loop);
+                if (!b) return std::nullopt;
+                return add(*a, *b);
+            }
+            return std::nullopt;
+        case Opcode::Sub: {
+            auto a = offsetFrom(def.ops[0], phi, loop);
+            auto b = a ? evolution(def.ops[1], loop) : std::nullopt;
+            if (!b) return std::nullopt;
+            return add(*a, scale(*b, -1));
+        }
+        default:
+            return std::nullopt;
+    }
+}
+
+std::optional<BackedgeCount> ScalarEvolution::backedgeCount(const Loop &loop, const DominatorTree &dt) {
+    auto exiting = loop.exitingBlocks();
+    if (loop.latches.size() != 1 || exiting.size() != 1) return std::nullopt;
+    BasicBlock *exit = exiting[0];
+    // 每次迭代都要经过出口判断
+    if (!dt.dominates(exit, loop.latches[0]) || innermostLoop(exit) != &loop) return std::nullopt;
+    const Instr &br = exit->terminator();
+    if (br.op != Opcode::Br || !br.ops[0].isReg()) return std::nullopt;
+    bool continueOnTrue = loop.contains(br.blocks[0]);
+    if (continueOnTrue == loop.contains(br.blocks[1])) return std::nullopt;
+    auto cond = defs.find(br.ops[0].num);
+    if (cond == defs.end() || !isCompare(cond->second->op)) return std::nullopt;
+
+    // 化为“x0 + step*k op bound 时继续”
+    Opcode op = continueOnTrue ? cond->second->op : negate(cond->second->op);
+    auto iv = evolution(cond->second->ops[0], loop), bound = evolution(cond->second->ops[1], loop);
+    if (!iv || !bound) return std::nullopt;
+    if (iv->order() == 0 && bound->order() == 1) {
+        std::swap(iv, bound);
+        op = swapped(op);
+    }
+    if (iv->order() != 1 || bound->order() != 0 || !iv->coeffs[1].isConstant()) return std::nullopt;
+    const LinearSum &x0 = iv->coeffs[0], &n = bound->coeffs[0];
+    int step = iv->coeffs[1].constant;
+
+    BackedgeCount count;
+    if (x0.isConstant() && n.isConstant()) {
+        auto k = constantTripCount(op, x0.constant, step, n.constant);
+        if (!k) return std::nullopt;
+        count.upper.constant = (int)*k;
+        return count;
+    }
+    // 步长 ±1 严格比较时，继续的条件保证下一次的值不回绕；非严格比较要求边界不是极值
+    LinearSum one = LinearSum::of(Value::imm(1)), minusOne = LinearSum::of(Value::imm(-1));
+    if (step == 1 && op == Opcode::Le && n.isConstant() && n.constant < INT_MAX) return BackedgeCount{x0, n + one};
+    if (step == 1 && op == Opcode::Lt) return BackedgeCount{x0, n};
+    if (step == -1 && op == Opcode::Ge && n.isConstant() && n.constant > INT_MIN) return BackedgeCount{n + minusOne, x0};
+    if (step == -1 && op == Opcode::Gt) return BackedgeCount{n, x0};
+    return std::nullopt;
+}
+
+} // namespace ir
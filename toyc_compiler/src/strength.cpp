@@ -0,0 +1,212 @@
+#include "strength.h"
+#include <stdexcept>
+
+namespace mir {
+
+const CoreCostModel &coreCostModel(const std::string &core) {
+    static const std::vector<CoreCostModel> models = {
+        {"generic", 1, 4, 34},      // 一般的 RV32IM 顺序核
+        {"sifive-e31", 1, 2, 33},   // 流水化乘法器，逐位除法
+        {"picorv32", 1, 40, 40},    // 非流水的 PCPI 乘除法单元
+    };
+    for (auto &m : models) {
+        if (m.name == core) return m;
+    }
+    throw std::runtime_error("unknown core '" + core + "'");
+}
+
+namespace {
+
+// 往序列末尾追加指令，每个中间结果都用新的虚拟寄存器
+class SeqBuilder {
+public:
+    SeqBuilder(MFunction &f, std::vector<MInstr> &o) : func(f), out(o), start(o.size()) {}
+
+    int rri(const char *op, int a, int imm) {
+        int d = func.newVReg();
+        out.emplace_back(op, std::vector<MOperand>{MOperand::r(d), MOperand::r(a), MOperand::i(imm)});
+        return d;
+    }
+    int rrr(const char *op, int a, int b) {
+        int d = func.newVReg();
+        out.emplace_back(op, std::vector<MOperand>{MOperand::r(d), MOperand::r(a), MOperand::r(b)});
+        return d;
+    }
+    int rr(const char *op, int a) {
+        int d = func.newVReg();
+        out.emplace_back(op, std::vector<MOperand>{MOperand::r(d), MOperand::r(a)});
+        return d;
+    }
+    int li(int32_t imm) {
+        int d = func.newVReg();
+        out.emplace_back("li", std::vector<MOperand>{MOperand::r(d), MOperand::i(imm)});
+        return d;
+    }
+    // 最后一条指令直接写 dst，结果不是新算出来的（例如乘以 1）时补一条 mv
+    void finish(int dst, int result) {
+        if (out.size() > start && out.back().ops[0].isReg() && out.back().ops[0].reg == result) {
+            out.back().ops[0].reg = dst;
+        } else {
+            out.emplace_back("mv", std::vector<MOperand>{MOperand::r(dst), MOperand::r(result)});
+        }
+    }
+
+private:
+    MFunction &func;
+    std::vector<MInstr> &out;
+    size_t start;
+};
+
+int liCost(int32_t imm, const CoreCostModel &cost) {
+    return imm >= -2048 && imm <= 2047 ? cost.alu : 2 * cost.alu;
+}
+
+// 非相邻形式（NAF）：k = Σ sign * 2^pos（模 2^32），相邻位不同时非零，非零位最少。按位置从低到高
+std::vector<std::pair<int, int>> nafDigits(uint32_t k) {
+    std::vector<std::pair<int, int>> digits;
+    uint64_t n = k;
+    for (int pos = 0; n != 0 && pos < 32; pos++, n >>= 1) {
+        if ((n & 1) == 0) continue;
+        int sign = (n & 3) == 1 ? 1 : -1;
+        digits.push_back({pos, sign});
+        n = sign > 0 ? n - 1 : n + 1;
+    }
+    return digits;
+}
+
+// 从最高位开始按 Horner 形式展开：acc = ((±x << a) ± x) << b ...
+int mulSequenceLength(const std::vector<std::pair<int, int>> &digits) {
+    if (digits.empty()) return 1;
+    int n = digits.back().second < 0 ? 1 : 0;
+    n += 2 * ((int)digits.size() - 1);
+    if (digits.front().first > 0) n++;
+    return n;
+}
+
+bool isPowerOfTwo(uint32_t v) {
+    return v != 0 && (v & (v - 1)) == 0;
+}
+
+int log2Exact(uint32_t v) {
+    int s = 0;
+    while ((1u << s) < v) s++;
+    return s;
+}
+
+} // namespace
+
+bool expandMulByConst(MFunction &func, std::vector<MInstr> &out, int dst, int src, int32_t k,
+                      const CoreCostModel &cost) {
+    auto digits = nafDigits((uint32_t)k);
+    int seqCost = mulSequenceLength(digits) * cost.alu;
+    if (seqCost >= liCost(k, cost) + cost.mul) return false;
+
+    SeqBuilder b(func, out);
+    if (digits.empty()) {
+        b.finish(dst, b.li(0));
+        return true;
+    }
+    int acc = digits.back().second > 0 ? src : b.rr("neg", src);
+    for (int i = (int)digits.size() - 2; i >= 0; i--) {
+        acc = b.rri("slli", acc, digits[i + 1].first - digits[i].first);
+        acc = b.rrr(digits[i].second > 0 ? "add" : "sub", acc, src);
+    }
+    if (digits.front().first > 0) acc = b.rri("slli", acc, digits.front().first);
+    b.finish(dst, acc);
+    return true;
+}
+
+DivMagic signedDivMagic(int32_t d) {
+    const uint32_t two31 = 0x80000000u;
+    uint32_t ad = d < 0 ? 0u - (uint32_t)d : (uint32_t)d;
+    uint32_t t = two31 + ((uint32_t)d >> 31);
+    uint32_t anc = t - 1 - t % ad;      // |nc|
+    int p = 31;
+    uint32_t q1 = two31 / anc, r1 = two31 - q1 * anc;
+    uint32_t q2 = two31 / ad, r2 = two31 - q2 * ad;
+    uint32_t delta;
+    do {
+        p++;
+        q1 *= 2;
+        r1 *= 2;
+        if (r1 >= anc) {
+            q1++;
+            r1 -= anc;
+        }
+        q2 *= 2;
+        r2 *= 2;
+        if (r2 >= ad) {
+            q2++;
+            r2 -= ad;
+        }
+        delta = ad - r2;
+    } while (q1 < delta || (q1 == delta && r1 == 0));
+    uint32_t magic = q2 + 1;
+    if (d < 0) magic = 0u - magic;
+    return DivMagic{(int32_t)magic, p - 32};
+}
+
+bool expandDivByConst(MFunction &func, std::vector<MInstr> &out, int dst, int src, int32_t k, bool isRem,
+                      const CoreCostModel &cost) {
+    // 除以 0 保留硬件语义；INT_MIN 的绝对值不能用 12 位以内的修正处理，也保留 div
+    if (k == 0 || k == INT32_MIN) return false;
+    int divCost = liCost(k, cost) + cost.div;
+    SeqBuilder b(func, out);
+
+    if (k == 1 || k == -1) {
+        if (isRem) b.finish(dst, b.li(0));
+        else b.finish(dst, k == 1 ? src : b.rr("neg", src));
+        return true;
+    }
+
+    uint32_t ak = k < 0 ? 0u - (uint32_t)k : (uint32_t)k;
+    if (isPowerOfTwo(ak)) {
+        // 负数先加上 2^s - 1 再算术右移，实现向零取整
+        int s = log2Exact(ak);
+        int seqLen = (s == 1 ? 3 : 4) + (isRem ? (s <= 11 ? 1 : 2) : (k < 0 ? 1 : 0));
+        if (seqLen * cost.alu >= divCost) return false;
+        int bias = s == 1 ? b.rri("srli", src, 31) : b.rri("srli", b.rri("srai", src, 31), 32 - s);
+        int biased = b.rrr("add", src, bias);
+        if (isRem) {
+            // 余数的符号跟随被除数，与除数的符号无关
+            int rounded = s <= 11 ? b.rri("andi", biased, -(1 << s)) : b.rri("slli", b.rri("srai", biased, s), s);
+            b.finish(dst, b.rrr("sub", src, rounded));
+        } else {
+            int q = b.rri("srai", biased, s);
+            b.finish(dst, k < 0 ? b.rr("neg", q) : q);
+        }
+        return true;
+    }
+
+    DivMagic m = signedDivMagic(k);
+    bool addBack = k > 0 && m.magic < 0, subBack = k < 0 && m.magic > 0;
+    int quotientCost = liCost(m.magic, cost) + cost.mul + (addBack || subBack ? cost.alu : 0) +
+                       (m.shift > 0 ? cost.alu : 0) + 2 * cost.alu;
+    // 余数 x - q*k：乘法本身也可能被展开
+    std::vector<MInstr> scratch;
+    MFunction probe;
+    probe.nextVReg = kFirstVirtReg;
+    int mulCost = liCost(k, cost) + cost.mul;
+    if (expandMulByConst(probe, scratch, kFirstVirtReg, kFirstVirtReg, k, cost)) mulCost = (int)scratch.size() * cost.alu;
+    int seqCost = quotientCost + (isRem ? mulCost + cost.alu : 0);
+    if (seqCost >= divCost) return false;
+
+    int q = b.rrr("mulh", src, b.li(m.magic));
+    if (addBack) q = b.rrr("add", q, src);
+    if (subBack) q = b.rrr("sub", q, src);
+    if (m.shift > 0) q = b.rri("srai", q, m.shift);
+    q = b.rrr("add", q, b.rri("srli", q, 31));
+    if (!isRem) {
+        b.finish(dst, q);
+        return true;
+    }
+    int product = func.newVReg();
+    if (!expandMulByConst(func, out, product, q, k, cost)) {
+        int kReg = b.li(k);
+        out.emplace_back("mul", std::vector<MOperand>{MOperand::r(product), MOperand::r(q), MOperand::r(kReg)});
+    }
+    b.finish(dst, b.rrr("sub", src, product));
+    return true;
+}
+
+} // namespace mir
@@ -0,0 +1,197 @@
+#include "analysis.h"
+#include "passes.h"
+#include <unordered_map>
+
+namespace ir {
+
+namespace {
+
+// 改写为跳回循环头的递归调用点
+struct Site {
+    BasicBlock *bb;
+    size_t call;                // call 在块中的位置
+    Opcode op = Opcode::Copy;   // 累加器形式中与调用结果结合的 add/mul；尾调用为 Copy
+    Value operand;              // 与调用结果结合的另一个操作数
+};
+
+// 线性递归的累加器形式：%r = call @func(...)，之后是不用 %r 的无副作用指令，最后 %x = add/mul %r, v 并返回 %x。
+// 加法和乘法（按 32 位回绕）满足结合律和交换律，v op f(...) 可以改成先把 v 乘/加进累加器再递归
+bool findAccumulatorSite(const Function &func, BasicBlock &bb, Site &site) {
+    size_t n = bb.instrs.size();
+    if (n < 3) return false;
+    const Instr &ret = bb.instrs[n - 1], &combine = bb.instrs[n - 2];
+    if (ret.op != Opcode::Ret || ret.ops.empty() || ret.ops[0] != Value::reg(combine.dst)) return false;
+    if (combine.op != Opcode::Add && combine.op != Opcode::Mul) return false;
+    // 两个操作数都是递归调用的结果时（如 fib）取后一个调用，前一个照常递归
+    bool found = false;
+    for (int side = 0; side < 2; side++) {
+        const Value &r = combine.ops[side], &v = combine.ops[1 - side];
+        if (!r.isReg() || v == r) continue;
+        size_t k = n - 2;
+        while (k > 0 && bb.instrs[k - 1].dst != r.num) k--;
+        if (k == 0) continue;
+        const Instr &call = bb.instrs[k - 1];
+        if (call.op != Opcode::Call || call.callee != func.name || (found && k - 1 < site.call)) continue;
+        bool movable = true;
+        for (size_t i = k; i < n - 2; i++) {
+            const Instr &mid = bb.instrs[i];
+            for (auto &o : mid.ops) movable = movable && o != r;
+            movable = movable && !mid.hasSideEffects();
+        }
+        if (!movable) continue;
+        site = Site{&bb, k - 1, combine.op, v};
+        found = true;
+    }
+    return found;
+}
+
+} // namespace
+
+bool eliminateTailRecursion(Function &func, TailRecursionStats *stats) {
+    std::vector<Site> sites;
+    for (auto &bb : func.blocks) {
+        const Instr *call = tailCallOf(*bb);
+        Site site{bb.get(), bb->instrs.size() - 2, Opcode::Copy, Value::imm(0)};
+        if (call && call->callee == func.name) sites.push_back(site);
+        else if (func.retType == IRType::I32 && findAccumulatorSite(func, *bb, site)) sites.push_back(site);
+    }
+    // 所有累加器形式的调用点用同一种运算；混用时只改尾调用
+    Opcode accOp = Opcode::Copy;
+    bool mixed = false;
+    for (auto &site : sites) {
+        if (site.op == Opcode::Copy) continue;
+        mixed = mixed || (accOp != Opcode::Copy && accOp != site.op);
+        accOp = site.op;
+    }
+    if (mixed) {
+        std::vector<Site> tails;
+        for (auto &site : sites) {
+            if (site.op == Opcode::Copy) tails.push_back(site);
+        }
+        sites = std::move(tails);
+        accOp = Opcode::Copy;
+    }
+    if (sites.empty()) return false;
+
+    // 入口块只留下 arg，其余指令移到紧随其后的循环头；递归调用改为带着新实参跳回循环头
+    BasicBlock *entry = func.entry();
+    BasicBlock *header = func.newBlockAfter("tailrec", entry);
+    std::unordered_map<int, int> argReg;    // 形参序号 -> arg 的结果
+    std::vector<Instr> kept;
+    for (auto &instr : entry->instrs) {
+        if (instr.op == Opcode::Arg) {
+            argReg[instr.index] = instr.dst;
+            kept.push_back(std::move(instr));
+        } else {
+            header->instrs.push_back(std::move(instr));
+        }
+    }
+    entry->instrs = std::move(kept);
+    Instr jmp(Opcode::Jmp);
+    jmp.blocks = {header};
+    entry->instrs.push_back(jmp);
+    for (BasicBlock *succ : entry->succs) {
+        for (auto &phi : succ->instrs) {
+            if (phi.op != Opcode::Phi) break;
+            for (auto &from : phi.blocks) {
+                if (from == entry) from = header;
+            }
+        }
+    }
+    for (auto &site : sites) {
+        if (site.bb != entry) continue;
+        site.bb = header;
+        site.call -= entry->instrs.size() - 1;
+    }
+
+    // 每个用到的形参在循环头有一个 phi：第一次来自 arg，之后来自递归调用的实参
+    std::unordered_map<int, int> phiOf;     // arg 的结果 -> phi
+    std::vector<Instr> phis;
+    std::vector<int> phiParam;              // phi 对应的形参序号
+    for (size_t i = 0; i < func.paramNames.size(); i++) {
+        auto it = argReg.find((int)i);
+        if (it == argReg.end()) continue;
+        Instr phi(Opcode::Phi);
+        phi.dst = func.newReg();
+        phi.ops = {Value::reg(it->second)};
+        phi.blocks = {entry};
+        phiOf[it->second] = phi.dst;
+        phis.push_back(std::move(phi));
+        phiParam.push_back((int)i);
+    }
+    for (auto &bb : func.blocks) {
+        if (bb.get() == entry) continue;
+        for (auto &instr : bb->instrs) {
+            for (auto &v : instr.ops) {
+                auto it = v.isReg() ? phiOf.find(v.num) : phiOf.end();
+                if (it != phiOf.end()) v = Value::reg(it->second);
+            }
+        }
+    }
+    for (auto &site : sites) {
+        if (site.operand.isReg() && phiOf.count(site.operand.num)) site.operand = Value::reg(phiOf[site.operand.num]);
+    }
+
+    // 累加器：循环头的 phi 从单位元开始，每个累加器形式的调用点把另一个操作数结合进去再跳回，
+    // 其余的 ret 返回累加器与原返回值结合的结果
+    Instr acc(Opcode::Phi);
+    if (accOp != Opcode::Copy) {
+        Value identity = Value::imm(accOp == Opcode::Mul ? 1 : 0);
+        acc.dst = func.newReg();
+        acc.ops = {identity};
+        acc.blocks = {entry};
+        for (auto &bb : func.blocks) {
+            Instr &ret = bb->instrs.back();
+            bool isSite = false;
+            for (auto &site : sites) isSite = isSite || site.bb == bb.get();
+            if (ret.op != Opcode::Ret || isSite) continue;
+            if (ret.ops[0] == identity) {
+                ret.ops[0] = Value::reg(acc.dst);
+                continue;
+            }
+            Instr combine(accOp);
+            combine.dst = func.newReg();
+            combine.ops = {Value::reg(acc.dst), ret.ops[0]};
+            ret.ops[0] = Value::reg(combine.dst);
+            bb->instrs.insert(bb->instrs.end() - 1, std::move(combine));
+        }
+    }
+
+    int accumulated = 0;
+    for (auto &site : sites) {
+        // 去掉 call、之后的结合运算和 ret（或跳到 ret 块的 jmp），中间的指令保留
+        auto &instrs = site.bb->instrs;
+        Instr call = std::move(instrs[site.call]);
+        instrs.erase(instrs.begin() + site.call);
+        instrs.erase(instrs.end() - (site.op == Opcode::Copy ? 1 : 2), instrs.end());
+        for (size_t k = 0; k < phis.size(); k++) {
+            phis[k].ops.push_back(call.ops[phiParam[k]]);
+            phis[k].blocks.push_back(site.bb);
+        }
+        if (accOp != Opcode::Copy) {
+            Value next = Value::reg(acc.dst);
+            if (site.op != Opcode::Copy) {
+                Instr combine(accOp);
+                combine.dst = func.newReg();
+                combine.ops = {Value::reg(acc.dst), site.operand};
+                next = Value::reg(combine.dst);
+                instrs.push_back(std::move(combine));
+                accumulated++;
+            }
+            acc.ops.push_back(next);
+            acc.blocks.push_back(site.bb);
+        }
+        instrs.push_back(jmp);
+    }
+    if (accOp != Opcode::Copy) phis.push_back(std::move(acc));
+    header->instrs.insert(header->instrs.begin(), phis.begin(), phis.end());
+    func.rebuildCFG();
+
+    if (stats) {
+        stats->calls += (int)sites.size() - accumulated;
+        stats->accumulators += accumulated;
+    }
+    return true;
+}
+
+} // namespace ir
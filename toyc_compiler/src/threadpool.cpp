@@ -0,0 +1,59 @@
+#include "threadpool.h"
+#include <utility>
+
+ThreadPool::ThreadPool(int threads) {
+    for (int i = 0; i < threads; i++) workers.emplace_back([this] { workerLoop(); });
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    ready.notify_all();
+    for (auto &worker : workers) worker.join();
+}
+
+void ThreadPool::submit(std::function<void()> task) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (error) return;
+        tasks.push(std::move(task));
+    }
+    ready.notify_one();
+}
+
+void ThreadPool::wait() {
+    std::unique_lock<std::mutex> lock(mutex);
+    idle.wait(lock, [this] { return tasks.empty() && running == 0; });
+    if (error) std::rethrow_exception(std::exchange(error, nullptr));
+}
+
+void ThreadPool::workerLoop() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            ready.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop();
+            running++;
+        }
+        std::exception_ptr failure;
+        try {
+            task();
+        } catch (...) {
+            failure = std::current_exception();
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            running--;
+            if (failure && !error) {
+                error = failure;
+                std::queue<std::function<void()>>().swap(tasks);
+            }
+            if (tasks.empty() && running == 0) idle.notify_all();
+        }
+    }
+}
@@ -0,0 +1,25 @@
+// lowering.h
+// 测试共用的前端流水线：源码 → 词法 → 语法 → IR，可选提升到 SSA
+// （不经过 AST 常量折叠，常量全部留给被测的 IR 遍）
+#pragma once
+#include "irgen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "passes.h"
+#include <memory>
+#include <string>
+
+inline std::unique_ptr<ir::Module> lowerToIR(const std::string &src, bool rotateLoops = true) {
+    Lexer lexer(src);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    auto ast = parser.parseCompUnit();
+    IRGen irgen(rotateLoops);
+    return irgen.generate(ast);
+}
+
+inline std::unique_ptr<ir::Module> lowerToSSA(const std::string &src, bool rotateLoops = true) {
+    auto module = lowerToIR(src, rotateLoops);
+    for (auto &f : module->functions) ir::promoteMemoryToRegisters(*f);
+    return module;
+}
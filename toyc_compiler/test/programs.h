@@ -0,0 +1,292 @@
+// programs.h
+// 测试与基准共用的 ToyC 程序集合，expected 为 main 的返回值
+#pragma once
+#include <string>
+#include <vector>
+
+struct TestProgram {
+    const char *name;
+    const char *source;
+    int expected;
+};
+
+inline const std::vector<TestProgram> &benchmarkPrograms() {
+    static const std::vector<TestProgram> programs = {
+        {"fib", R"(
+int fib(int n) {
+    if (n <= 1) {
+        return n;
+    }
+    return fib(n - 1) + fib(n - 2);
+}
+int main() {
+    return fib(20);
+}
+)", 6765},
+        {"gcd", R"(
+int gcd(int a, int b) {
+    while (b != 0) {
+        int temp = b;
+        b = a % b;
+        a = temp;
+    }
+    return a;
+}
+int main() {
+    int i = 1;
+    int s = 0;
+    while (i < 300) {
+        s = s + gcd(i * 7919, 104729 % i + i);
+        i = i + 1;
+    }
+    return s;
+}
+)", 299},
+        {"primes", R"(
+int isPrime(int n) {
+    if (n <= 1) {
+        return 0;
+    }
+    int i = 2;
+    while (i * i <= n) {
+        if (n % i == 0) {
+            return 0;
+        }
+        i = i + 1;
+    }
+    return 1;
+}
+int main() {
+    int count = 0;
+    int n = 0;
+    while (n < 5000) {
+        count = count + isPrime(n);
+        n = n + 1;
+    }
+    return count;
+}
+)", 669},
+        {"collatz", R"(
+int steps(int n) {
+    int s = 0;
+    while (n != 1) {
+        if (n % 2 == 0) {
+            n = n / 2;
+        } else {
+            n = 3 * n + 1;
+        }
+        s = s + 1;
+    }
+    return s;
+}
+int main() {
+    int best = 0;
+    int arg = 0;
+    int i = 1;
+    while (i < 3000) {
+        int s = steps(i);
+        if (s > best) {
+            best = s;
+            arg = i;
+        }
+        i = i + 1;
+    }
+    return arg * 1000 + best;
+}
+)", 2919216},
+        {"swap", R"(
+int main() {
+    int a = 1;
+    int b = 2;
+    int c = 3;
+    int i = 0;
+    while (i < 1000) {
+        int t = a;
+        a = b;
+        b = c;
+        c = t + i % 7;
+        i = i + 1;
+    }
+    return a * 10000 + b * 100 + c;
+}
+)", 10071204},
+        {"nested", R"(
+int main() {
+    int total = 0;
+    int i = 0;
+    while (i < 60) {
+        int j = 0;
+        while (j < 60) {
+            if ((i + j) % 3 == 0 || (i * j) % 5 == 1) {
+                total = total + i * j;
+            } else if (i > j && !(j % 4)) {
+                total = total - j;
+            }
+            if (j > 50) {
+                break;
+            }
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return total;
+}
+)", 1027700},
+        {"pressure", R"(
+int mix(int a, int b, int c, int d, int e, int f, int g, int h) {
+    int x1 = a * 3 + b;
+    int x2 = b * 5 - c;
+    int x3 = c * 7 + d;
+    int x4 = d * 11 - e;
+    int x5 = e * 13 + f;
+    int x6 = f * 17 - g;
+    int x7 = g * 19 + h;
+    int x8 = h * 23 - a;
+    int x9 = x1 + x2 * x3;
+    int x10 = x4 - x5 * x6;
+    int x11 = x7 + x8 * x1;
+    int x12 = x2 - x3 * x4;
+    int x13 = x5 + x6 * x7;
+    int x14 = x8 - x9 * x10;
+    return x1 + x2 + x3 + x4 + x5 + x6 + x7 + x8 + x9 + x10 + x11 + x12 + x13 + x14
+         + mix2(x1, x2, x3) - mix2(x4, x5, x6);
+}
+int mix2(int a, int b, int c) {
+    return a * b - c;
+}
+int main() {
+    int i = 0;
+    int s = 0;
+    while (i < 200) {
+        s = s + mix(i, i + 1, i + 2, i + 3, i + 4, i + 5, i + 6, i + 7) % 1000;
+        i = i + 1;
+    }
+    return s;
+}
+)", 8192},
+        {"spill", R"(
+int main() {
+    int v0 = 1;
+    int v1 = 2;
+    int v2 = 3;
+    int v3 = 4;
+    int v4 = 5;
+    int v5 = 6;
+    int v6 = 7;
+    int v7 = 8;
+    int v8 = 9;
+    int v9 = 10;
+    int v10 = 11;
+    int v11 = 12;
+    int v12 = 13;
+    int v13 = 14;
+    int v14 = 15;
+    int v15 = 16;
+    int v16 = 17;
+    int v17 = 18;
+    int v18 = 19;
+    int v19 = 20;
+    int v20 = 21;
+    int v21 = 22;
+    int v22 = 23;
+    int v23 = 24;
+    int v24 = 25;
+    int v25 = 26;
+    int v26 = 27;
+    int v27 = 28;
+    int v28 = 29;
+    int v29 = 30;
+    int i = 0;
+    while (i < 200) {
+        v0 = v0 + v1 % 3 + i;
+        v1 = v1 + v2 % 4 + i;
+        v2 = v2 + v3 % 5 + i;
+        v3 = v3 + v4 % 6 + i;
+        v4 = v4 + v5 % 7 + i;
+        v5 = v5 + v6 % 8 + i;
+        v6 = v6 + v7 % 9 + i;
+        v7 = v7 + v8 % 10 + i;
+        v8 = v8 + v9 % 11 + i;
+        v9 = v9 + v10 % 12 + i;
+        v10 = v10 + v11 % 13 + i;
+        v11 = v11 + v12 % 14 + i;
+        v12 = v12 + v13 % 15 + i;
+        v13 = v13 + v14 % 16 + i;
+        v14 = v14 + v15 % 17 + i;
+        v15 = v15 + v16 % 18 + i;
+        v16 = v16 + v17 % 19 + i;
+        v17 = v17 + v18 % 20 + i;
+        v18 = v18 + v19 % 21 + i;
+        v19 = v19 + v20 % 22 + i;
+        v20 = v20 + v21 % 23 + i;
+        v21 = v21 + v22 % 24 + i;
+        v22 = v22 + v23 % 25 + i;
+        v23 = v23 + v24 % 26 + i;
+        v24 = v24 + v25 % 27 + i;
+        v25 = v25 + v26 % 28 + i;
+        v26 = v26 + v27 % 29 + i;
+        v27 = v27 + v28 % 30 + i;
+        v28 = v28 + v29 % 31 + i;
+        v29 = v29 + v0 % 32 + i;
+        i = i + 1;
+    }
+    return v0 % 7 + v1 % 8 + v2 % 9 + v3 % 10 + v4 % 11 + v5 % 12 + v6 % 13 + v7 % 14 + v8 % 15 + v9 % 16 + v10 % 17 + v11 % 18 + v12 % 19 + v13 % 20 + v14 % 21 + v15 % 22 + v16 % 23 + v17 % 24 + v18 % 25 + v19 % 26 + v20 % 27 + v21 % 28 + v22 % 29 + v23 % 30 + v24 % 31 + v25 % 32 + v26 % 33 + v27 % 34 + v28 % 35 + v29 % 36;
+}
+)", 241},
+        {"ackermann", R"(
+int ack(int m, int n) {
+    if (m == 0) {
+        return n + 1;
+    }
+    if (n == 0) {
+        return ack(m - 1, 1);
+    }
+    return ack(m - 1, ack(m, n - 1));
+}
+int main() {
+    return ack(2, 3) * 100 + ack(3, 3);
+}
+)", 961},
+        {"sum", R"(
+int sum(int n) {
+    if (n == 0) {
+        return 0;
+    }
+    return n + sum(n - 1);
+}
+int tri(int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        s = s + i;
+        i = i + 1;
+    }
+    return s;
+}
+int main() {
+    return sum(1000) - tri(1001);
+}
+)", 0},
+        {"logic", R"(
+int check(int x) {
+    return x > 3 && x < 10 || x == 42 || !(x % 17);
+}
+int zero() {
+    return 0;
+}
+int main() {
+    int i = -20;
+    int c = 0;
+    while (i < 100) {
+        c = c + check(i);
+        if (zero() && 1 / zero()) {
+            c = c + 1000;
+        }
+        i = i + 1;
+    }
+    return c;
+}
+)", 14},
+    };
+    return programs;
+}
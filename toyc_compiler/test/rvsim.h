@@ -0,0 +1,568 @@
+// rvsim.h
+// 测试用的 RV32IM 汇编解释器：直接执行编译器输出的汇编文本，
+// 统计动态指令数与访存次数，并在每次返回时检查调用约定（ra、sp、s0-s11 已恢复）。
+#pragma once
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class RiscvSim {
+public:
+    struct Stats {
+        uint64_t instrs = 0;
+        uint64_t loads = 0;
+        uint64_t stores = 0;
+        uint64_t branches = 0;          // 条件分支（含未跳转）
+        uint64_t takenBranches = 0;     // 跳转的条件分支与无条件跳转
+        uint64_t calls = 0;
+        uint64_t muls = 0;              // mul/mulh*
+        uint64_t divs = 0;              // div/rem 及无符号形式
+        uint32_t maxStackBytes = 0;
+    };
+
+    explicit RiscvSim(const std::string &asmText) { parse(asmText); }
+
+    // 从 entry 开始执行，args 依次放入 a0-a7；成功时 result() 为返回的 a0
+    bool run(const std::string &entry = "main", const std::vector<int32_t> &args = {},
+             uint64_t maxSteps = 2000000000ull) {
+        stats_ = Stats();
+        error_.clear();
+        std::fill(mem.begin(), mem.end(), 0);
+        for (auto &init : dataInit) std::memcpy(&mem[init.first], &init.second, 4);
+        std::memset(regs, 0, sizeof(regs));
+        shadow.clear();
+
+        auto it = textLabels.find(entry);
+        if (it == textLabels.end()) return fail("no such function '" + entry + "'");
+        for (size_t i = 0; i < args.size() && i < 8; i++) regs[10 + i] = (uint32_t)args[i];
+        regs[2] = kStackTop;
+        regs[1] = kExitAddr;
+        pushFrame(kExitAddr);
+
+        uint32_t pc = it->second;
+        while (true) {
+            if (stats_.instrs >= maxSteps) return fail("step limit exceeded");
+            if (pc >= prog.size()) return fail("pc out of range");
+            const Inst &in = prog[pc];
+            stats_.instrs += in.cost;
+            uint32_t next = pc + 1;
+            uint32_t a = regs[in.rs1], b = regs[in.rs2];
+            int32_t sa = (int32_t)a, sb = (int32_t)b;
+            uint32_t v = 0;
+            bool write = true;
+            switch (in.op) {
+                case Op::ADD: v = a + b; break;
+                case Op::SUB: v = a - b; break;
+                case Op::MUL: v = a * b; stats_.muls++; break;
+                case Op::MULH: v = (uint32_t)(((int64_t)sa * (int64_t)sb) >> 32); stats_.muls++; break;
+                case Op::MULHU: v = (uint32_t)(((uint64_t)a * (uint64_t)b) >> 32); stats_.muls++; break;
+                case Op::MULHSU: v = (uint32_t)(((int64_t)sa * (int64_t)(uint64_t)b) >> 32); stats_.muls++; break;
+                case Op::DIV:
+                    stats_.divs++;
+                    if (b == 0) v = 0xffffffffu;
+                    else if (sa == INT32_MIN && sb == -1) v = a;
+                    else v = (uint32_t)(sa / sb);
+                    break;
+                case Op::DIVU: v = b == 0 ? 0xffffffffu : a / b; stats_.divs++; break;
+                case Op::REM:
+                    stats_.divs++;
+                    if (b == 0) v = a;
+                    else if (sa == INT32_MIN && sb == -1) v = 0;
+                    else v = (uint32_t)(sa % sb);
+                    break;
+                case Op::REMU: v = b == 0 ? a : a % b; stats_.divs++; break;
+                case Op::AND: v = a & b; break;
+                case Op::OR: v = a | b; break;
+                case Op::XOR: v = a ^ b; break;
+                case Op::SLL: v = a << (b & 31); break;
+                case Op::SRL: v = a >> (b & 31); break;
+                case Op::SRA: v = (uint32_t)(sa >> (b & 31)); break;
+                case Op::SLT: v = sa < sb; break;
+                case Op::SLTU: v = a < b; break;
+                case Op::ADDI: v = a + (uint32_t)in.imm; break;
+                case Op::ANDI: v = a & (uint32_t)in.imm; break;
+                case Op::ORI: v = a | (uint32_t)in.imm; break;
+                case Op::XORI: v = a ^ (uint32_t)in.imm; break;
+                case Op::SLLI: v = a << (in.imm & 31); break;
+                case Op::SRLI: v = a >> (in.imm & 31); break;
+                case Op::SRAI: v = (uint32_t)(sa >> (in.imm & 31)); break;
+                case Op::SLTI: v = sa < in.imm; break;
+                case Op::SLTIU: v = a < (uint32_t)in.imm; break;
+                case Op::LI: v = (uint32_t)in.imm; break;
+                case Op::LW: {
+                    uint32_t addr = a + (uint32_t)in.imm;
+                    if (!checkAddr(addr)) return false;
+                    std::memcpy(&v, &mem[addr], 4);
+                    stats_.loads++;
+                    break;
+                }
+                case Op::SW: {
+                    uint32_t addr = b + (uint32_t)in.imm;
+                    if (!checkAddr(addr)) return false;
+                    std::memcpy(&mem[addr], &a, 4);
+                    stats_.stores++;
+                    write = false;
+                    break;
+                }
+                case Op::BEQ: case Op::BNE: case Op::BLT: case Op::BGE: case Op::BLTU: case Op::BGEU: {
+                    bool taken = false;
+                    switch (in.op) {
+                        case Op::BEQ: taken = a == b; break;
+                        case Op::BNE: taken = a != b; break;
+                        case Op::BLT: taken = sa < sb; break;
+                        case Op::BGE: taken = sa >= sb; break;
+                        case Op::BLTU: taken = a < b; break;
+                        default: taken = a >= b; break;
+                    }
+                    stats_.branches++;
+                    if (taken) {
+                        stats_.takenBranches++;
+                        next = in.target;
+                    }
+                    write = false;
+                    break;
+                }
+                case Op::JAL:
+                    if (in.target == kUnresolved) return fail("call to undefined symbol '" + in.sym + "'");
+                    v = codeAddr(pc + 1);
+                    next = in.target;
+                    stats_.takenBranches++;
+                    if (in.rd == 1) {
+                        stats_.calls++;
+                        pushFrame(v);
+                    }
+                    break;
+                case Op::JALR: {
+                    uint32_t dest = a + (uint32_t)in.imm;
+                    v = codeAddr(pc + 1);
+                    stats_.takenBranches++;
+                    if (in.rd == 0 && in.rs1 == 1) {
+                        if (!popFrame(dest)) return false;
+                        if (dest == kExitAddr) {
+                            result_ = (int32_t)regs[10];
+                            return true;
+                        }
+                    }
+                    if (dest < kCodeBase || (dest - kCodeBase) / 4 >= prog.size()) return fail("bad jump target");
+                    next = (dest - kCodeBase) / 4;
+                    break;
+                }
+                case Op::NOP: write = false; break;
+            }
+            if (write && in.rd != 0) regs[in.rd] = v;
+            if (in.rd == 2 && write) {
+                uint32_t depth = kStackTop - regs[2];
+                if (regs[2] <= kStackTop && depth > stats_.maxStackBytes) stats_.maxStackBytes = depth;
+            }
+            pc = next;
+        }
+    }
+
+    int32_t result() const { return result_; }
+    const std::string &error() const { return error_; }
+    const Stats &stats() const { return stats_; }
+
+private:
+    enum class Op {
+        ADD, SUB, MUL, MULH, MULHU, MULHSU, DIV, DIVU, REM, REMU,
+        AND, OR, XOR, SLL, SRL, SRA, SLT, SLTU,
+        ADDI, ANDI, ORI, XORI, SLLI, SRLI, SRAI, SLTI, SLTIU, LI,
+        LW, SW, BEQ, BNE, BLT, BGE, BLTU, BGEU, JAL, JALR, NOP
+    };
+
+    struct Inst {
+        Op op = Op::NOP;
+        int rd = 0, rs1 = 0, rs2 = 0;
+        int32_t imm = 0;
+        uint32_t target = 0;
+        int cost = 1;
+        std::string label;  // 待解析的目标标号
+        std::string sym;    // 数据符号（la / %hi / %lo）
+        int line = 0;
+    };
+
+    struct Frame {
+        uint32_t ret;
+        uint32_t sp;
+        uint32_t saved[12];
+    };
+
+    static constexpr uint32_t kMemSize = 16u << 20;
+    static constexpr uint32_t kDataBase = 0x10000;
+    static constexpr uint32_t kStackTop = kMemSize - 16;
+    static constexpr uint32_t kCodeBase = 0x40000000u;
+    static constexpr uint32_t kExitAddr = 0xfffffff0u;
+    static constexpr uint32_t kUnresolved = 0xffffffffu;
+
+    std::vector<Inst> prog;
+    std::unordered_map<std::string, uint32_t> textLabels;
+    std::unordered_map<std::string, uint32_t> dataLabels;
+    std::vector<std::pair<uint32_t, int32_t>> dataInit;
+    std::vector<uint8_t> mem = std::vector<uint8_t>(kMemSize);
+    uint32_t regs[32] = {};
+    std::vector<Frame> shadow;
+    Stats stats_;
+    std::string error_;
+    int32_t result_ = 0;
+
+    static uint32_t codeAddr(uint32_t index) { return kCodeBase + index * 4; }
+
+    bool fail(const std::string &msg) {
+        error_ = msg;
+        return false;
+    }
+
+    bool checkAddr(uint32_t addr) {
+        if (addr % 4 != 0 || addr < kDataBase || addr + 4 > kMemSize) {
+            std::ostringstream os;
+            os << "bad memory access at 0x" << std::hex << addr;
+            return fail(os.str());
+        }
+        return true;
+    }
+
+    static const int *savedRegs() {
+        static const int s[12] = {8, 9, 18, 19, 20, 21, 22, 23, 24, 25, 26, 27};
+        return s;
+    }
+
+    void pushFrame(uint32_t ret) {
+        Frame f;
+        f.ret = ret;
+        f.sp = regs[2];
+        for (int i = 0; i < 12; i++) f.saved[i] = regs[savedRegs()[i]];
+        shadow.push_back(f);
+    }
+
+    bool popFrame(uint32_t dest) {
+        if (shadow.empty()) return fail("return without call");
+        Frame f = shadow.back();
+        shadow.pop_back();
+        if (f.ret != dest) return fail("return address not preserved");
+        if (f.sp != regs[2]) return fail("sp not restored on return");
+        for (int i = 0; i < 12; i++) {
+            if (f.saved[i] != regs[savedRegs()[i]]) return fail("callee-saved register not restored on return");
+        }
+        // 破坏调用者保存寄存器，暴露跨调用依赖它们的错误代码
+        static const int clobber[] = {5, 6, 7, 11, 12, 13, 14, 15, 16, 17, 28, 29, 30, 31};
+        for (int r : clobber) regs[r] = 0xdeadbeefu;
+        return true;
+    }
+
+    // ---------------------------------------------------------------- 解析
+
+    static std::string trim(const std::string &s) {
+        size_t b = s.find_first_not_of(" \t\r");
+        if (b == std::string::npos) return "";
+        size_t e = s.find_last_not_of(" \t\r");
+        return s.substr(b, e - b + 1);
+    }
+
+    [[noreturn]] static void parseError(int line, const std::string &msg) {
+        throw std::runtime_error("rvsim: line " + std::to_string(line) + ": " + msg);
+    }
+
+    static int regIndex(const std::string &name) {
+        static const std::unordered_map<std::string, int> names = {
+            {"zero", 0}, {"ra", 1}, {"sp", 2}, {"gp", 3}, {"tp", 4},
+            {"t0", 5}, {"t1", 6}, {"t2", 7}, {"s0", 8}, {"fp", 8}, {"s1", 9},
+            {"a0", 10}, {"a1", 11}, {"a2", 12}, {"a3", 13}, {"a4", 14}, {"a5", 15}, {"a6", 16}, {"a7", 17},
+            {"s2", 18}, {"s3", 19}, {"s4", 20}, {"s5", 21}, {"s6", 22}, {"s7", 23}, {"s8", 24},
+            {"s9", 25}, {"s10", 26}, {"s11", 27}, {"t3", 28}, {"t4", 29}, {"t5", 30}, {"t6", 31},
+        };
+        auto it = names.find(name);
+        if (it != names.end()) return it->second;
+        if (name.size() >= 2 && name[0] == 'x') {
+            int n = std::atoi(name.c_str() + 1);
+            if (n >= 0 && n < 32) return n;
+        }
+        return -1;
+    }
+
+    static bool parseInt(const std::string &s, int64_t &out) {
+        if (s.empty()) return false;
+        size_t pos = 0;
+        try {
+            out = std::stoll(s, &pos, 0);
+        } catch (...) {
+            return false;
+        }
+        return pos == s.size();
+    }
+
+    struct Parsed {
+        std::vector<std::string> args;
+        int line;
+    };
+
+    int reg(const Parsed &p, size_t i) {
+        if (i >= p.args.size()) parseError(p.line, "missing operand");
+        int r = regIndex(p.args[i]);
+        if (r < 0) parseError(p.line, "bad register '" + p.args[i] + "'");
+        return r;
+    }
+
+    int32_t imm(const Parsed &p, size_t i, Inst &in) {
+        if (i >= p.args.size()) parseError(p.line, "missing operand");
+        const std::string &s = p.args[i];
+        if (s.rfind("%lo(", 0) == 0 || s.rfind("%hi(", 0) == 0) {
+            in.sym = s;
+            return 0;
+        }
+        int64_t v;
+        if (!parseInt(s, v)) parseError(p.line, "bad immediate '" + s + "'");
+        return (int32_t)v;
+    }
+
+    // off(reg) 或 %lo(sym)(reg)
+    void memOperand(const Parsed &p, size_t i, Inst &in, int &base) {
+        if (i >= p.args.size()) parseError(p.line, "missing operand");
+        const std::string &s = p.args[i];
+        size_t close = s.rfind(')');
+        size_t open = s.rfind('(');
+        if (open == std::string::npos || close != s.size() - 1) parseError(p.line, "bad memory operand '" + s + "'");
+        base = regIndex(s.substr(open + 1, close - open - 1));
+        if (base < 0) parseError(p.line, "bad base register in '" + s + "'");
+        std::string off = s.substr(0, open);
+        if (off.empty()) {
+            in.imm = 0;
+        } else if (off.rfind("%lo(", 0) == 0) {
+            in.sym = off;
+        } else {
+            int64_t v;
+            if (!parseInt(off, v)) parseError(p.line, "bad offset '" + off + "'");
+            in.imm = (int32_t)v;
+        }
+    }
+
+    void parse(const std::string &text) {
+        std::istringstream is(text);
+        std::string raw;
+        int lineNo = 0;
+        bool inText = true;
+        uint32_t dataPtr = kDataBase;
+        while (std::getline(is, raw)) {
+            lineNo++;
+            size_t hash = raw.find('#');
+            if (hash != std::string::npos) raw = raw.substr(0, hash);
+            std::string line = trim(raw);
+            while (!line.empty()) {
+                size_t colon = line.find(':');
+                size_t space = line.find_first_of(" \t");
+                if (colon == std::string::npos || (space != std::string::npos && space < colon)) break;
+                std::string label = line.substr(0, colon);
+                if (inText) textLabels[label] = (uint32_t)prog.size();
+                else dataLabels[label] = dataPtr;
+                line = trim(line.substr(colon + 1));
+            }
+            if (line.empty()) continue;
+
+            size_t sp = line.find_first_of(" \t");
+            std::string op = line.substr(0, sp);
+            Parsed p;
+            p.line = lineNo;
+            if (sp != std::string::npos) {
+                std::string rest = line.substr(sp);
+                std::string cur;
+                for (char c : rest) {
+                    if (c == ',') {
+                        p.args.push_back(trim(cur));
+                        cur.clear();
+                    } else {
+                        cur += c;
+                    }
+                }
+                if (!trim(cur).empty()) p.args.push_back(trim(cur));
+            }
+
+            if (op[0] == '.') {
+                if (op == ".text") inText = true;
+                else if (op == ".data" || op == ".bss") inText = false;
+                else if (op == ".section") inText = !p.args.empty() && p.args[0].rfind(".text", 0) == 0;
+                else if (op == ".zero" || op == ".space") {
+                    int64_t n = 0;
+                    if (p.args.empty() || !parseInt(p.args[0], n)) parseError(lineNo, "bad size");
+                    dataPtr += (uint32_t)n;
+                } else if (op == ".word") {
+                    for (auto &a : p.args) {
+                        int64_t v = 0;
+                        if (!parseInt(a, v)) parseError(lineNo, "bad word");
+                        dataInit.push_back({dataPtr, (int32_t)v});
+                        dataPtr += 4;
+                    }
+                } else if ((op == ".align" || op == ".p2align") && !inText) {
+                    int64_t n = 0;
+                    if (!p.args.empty() && parseInt(p.args[0], n)) {
+                        uint32_t al = 1u << n;
+                        dataPtr = (dataPtr + al - 1) & ~(al - 1);
+                    }
+                } else if (op == ".comm" || op == ".lcomm") {
+                    int64_t n = 0;
+                    if (p.args.size() < 2 || !parseInt(p.args[1], n)) parseError(lineNo, "bad .comm");
+                    dataPtr = (dataPtr + 15) & ~15u;
+                    dataLabels[p.args[0]] = dataPtr;
+                    dataPtr += (uint32_t)n;
+                }
+                // .globl / .type / .size 等忽略
+                continue;
+            }
+            if (!inText) parseError(lineNo, "instruction outside of .text");
+            prog.push_back(decode(op, p));
+        }
+        if (dataPtr > kStackTop - (8u << 20)) throw std::runtime_error("rvsim: data section too large");
+
+        for (auto &in : prog) {
+            if (!in.label.empty()) {
+                auto it = textLabels.find(in.label);
+                if (it != textLabels.end()) {
+                    in.target = it->second;
+                } else if (in.op == Op::JAL) {
+                    in.target = kUnresolved;
+                    in.sym = in.label;
+                } else {
+                    parseError(in.line, "undefined label '" + in.label + "'");
+                }
+            }
+            if (!in.sym.empty() && in.op != Op::JAL) resolveSymbol(in);
+        }
+    }
+
+    void resolveSymbol(Inst &in) {
+        std::string name = in.sym;
+        bool hi = false, lo = false;
+        if (name.rfind("%hi(", 0) == 0) hi = true;
+        if (name.rfind("%lo(", 0) == 0) lo = true;
+        if (hi || lo) name = name.substr(4, name.size() - 5);
+        auto it = dataLabels.find(name);
+        if (it == dataLabels.end()) parseError(in.line, "undefined symbol '" + name + "'");
+        uint32_t addr = it->second;
+        int32_t low = (int32_t)(addr << 20) >> 20;
+        if (hi) in.imm = (int32_t)((addr - (uint32_t)low) & 0xfffff000u);
+        else if (lo) in.imm = low;
+        else in.imm = (int32_t)addr;
+    }
+
+    Inst decode(const std::string &op, const Parsed &p) {
+        Inst in;
+        in.line = p.line;
+        static const std::unordered_map<std::string, Op> rtype = {
+            {"add", Op::ADD}, {"sub", Op::SUB}, {"mul", Op::MUL}, {"mulh", Op::MULH},
+            {"mulhu", Op::MULHU}, {"mulhsu", Op::MULHSU}, {"div", Op::DIV}, {"divu", Op::DIVU},
+            {"rem", Op::REM}, {"remu", Op::REMU}, {"and", Op::AND}, {"or", Op::OR},
+            {"xor", Op::XOR}, {"sll", Op::SLL}, {"srl", Op::SRL}, {"sra", Op::SRA},
+            {"slt", Op::SLT}, {"sltu", Op::SLTU},
+        };
+        static const std::unordered_map<std::string, Op> itype = {
+            {"addi", Op::ADDI}, {"andi", Op::ANDI}, {"ori", Op::ORI}, {"xori", Op::XORI},
+            {"slli", Op::SLLI}, {"srli", Op::SRLI}, {"srai", Op::SRAI}, {"slti", Op::SLTI},
+            {"sltiu", Op::SLTIU},
+        };
+        static const std::unordered_map<std::string, Op> branch = {
+            {"beq", Op::BEQ}, {"bne", Op::BNE}, {"blt", Op::BLT}, {"bge", Op::BGE},
+            {"bltu", Op::BLTU}, {"bgeu", Op::BGEU},
+        };
+        static const std::unordered_map<std::string, std::pair<Op, bool>> swapped = {
+            {"bgt", {Op::BLT, true}}, {"ble", {Op::BGE, true}},
+            {"bgtu", {Op::BLTU, true}}, {"bleu", {Op::BGEU, true}},
+        };
+        // 与零比较的分支：第二个字段表示寄存器放在 rs2
+        static const std::unordered_map<std::string, std::pair<Op, bool>> zbranch = {
+            {"beqz", {Op::BEQ, false}}, {"bnez", {Op::BNE, false}}, {"bltz", {Op::BLT, false}},
+            {"bgez", {Op::BGE, false}}, {"blez", {Op::BGE, true}}, {"bgtz", {Op::BLT, true}},
+        };
+
+        if (auto it = rtype.find(op); it != rtype.end()) {
+            in.op = it->second;
+            in.rd = reg(p, 0); in.rs1 = reg(p, 1); in.rs2 = reg(p, 2);
+        } else if (op == "sgt" || op == "sgtu") {
+            in.op = op == "sgt" ? Op::SLT : Op::SLTU;
+            in.rd = reg(p, 0); in.rs1 = reg(p, 2); in.rs2 = reg(p, 1);
+        } else if (auto it = itype.find(op); it != itype.end()) {
+            in.op = it->second;
+            in.rd = reg(p, 0); in.rs1 = reg(p, 1); in.imm = imm(p, 2, in);
+            if (in.imm < -2048 || in.imm > 2047) parseError(p.line, "immediate out of range");
+        } else if (op == "li") {
+            in.op = Op::LI;
+            in.rd = reg(p, 0); in.imm = imm(p, 1, in);
+            in.cost = (in.imm >= -2048 && in.imm <= 2047) || (in.imm & 0xfff) == 0 ? 1 : 2;
+        } else if (op == "la") {
+            in.op = Op::LI;
+            in.rd = reg(p, 0);
+            in.sym = p.args.size() > 1 ? p.args[1] : "";
+            in.cost = 2;
+        } else if (op == "lui") {
+            in.op = Op::LI;
+            in.rd = reg(p, 0);
+            in.imm = imm(p, 1, in);
+            if (in.sym.empty()) {
+                if (in.imm < 0 || in.imm > 0xfffff) parseError(p.line, "lui immediate out of range");
+                in.imm = (int32_t)((uint32_t)in.imm << 12);
+            }
+        } else if (op == "mv") {
+            in.op = Op::ADDI; in.rd = reg(p, 0); in.rs1 = reg(p, 1);
+        } else if (op == "not") {
+            in.op = Op::XORI; in.rd = reg(p, 0); in.rs1 = reg(p, 1); in.imm = -1;
+        } else if (op == "neg") {
+            in.op = Op::SUB; in.rd = reg(p, 0); in.rs2 = reg(p, 1);
+        } else if (op == "seqz") {
+            in.op = Op::SLTIU; in.rd = reg(p, 0); in.rs1 = reg(p, 1); in.imm = 1;
+        } else if (op == "snez") {
+            in.op = Op::SLTU; in.rd = reg(p, 0); in.rs2 = reg(p, 1);
+        } else if (op == "sltz") {
+            in.op = Op::SLT; in.rd = reg(p, 0); in.rs1 = reg(p, 1);
+        } else if (op == "sgtz") {
+            in.op = Op::SLT; in.rd = reg(p, 0); in.rs2 = reg(p, 1);
+        } else if (op == "lw") {
+            in.op = Op::LW; in.rd = reg(p, 0); memOperand(p, 1, in, in.rs1);
+        } else if (op == "sw") {
+            in.op = Op::SW; in.rs1 = reg(p, 0); memOperand(p, 1, in, in.rs2);
+        } else if (auto it = branch.find(op); it != branch.end()) {
+            in.op = it->second; in.rs1 = reg(p, 0); in.rs2 = reg(p, 1); in.label = labelArg(p, 2);
+        } else if (auto it = swapped.find(op); it != swapped.end()) {
+            in.op = it->second.first; in.rs1 = reg(p, 1); in.rs2 = reg(p, 0); in.label = labelArg(p, 2);
+        } else if (auto it = zbranch.find(op); it != zbranch.end()) {
+            in.op = it->second.first;
+            if (it->second.second) in.rs2 = reg(p, 0);
+            else in.rs1 = reg(p, 0);
+            in.label = labelArg(p, 1);
+        } else if (op == "j") {
+            in.op = Op::JAL; in.label = labelArg(p, 0);
+        } else if (op == "jal") {
+            in.op = Op::JAL;
+            if (p.args.size() == 1) {
+                in.rd = 1; in.label = labelArg(p, 0);
+            } else {
+                in.rd = reg(p, 0); in.label = labelArg(p, 1);
+            }
+        } else if (op == "call") {
+            in.op = Op::JAL; in.rd = 1; in.label = labelArg(p, 0);
+        } else if (op == "tail") {
+            in.op = Op::JAL; in.rd = 0; in.label = labelArg(p, 0);
+        } else if (op == "ret") {
+            in.op = Op::JALR; in.rs1 = 1;
+        } else if (op == "jr") {
+            in.op = Op::JALR; in.rs1 = reg(p, 0);
+        } else if (op == "jalr") {
+            in.op = Op::JALR;
+            if (p.args.size() == 1) {
+                in.rd = 1; in.rs1 = reg(p, 0);
+            } else {
+                in.rd = reg(p, 0); in.rs1 = reg(p, 1); in.imm = p.args.size() > 2 ? imm(p, 2, in) : 0;
+            }
+        } else if (op == "nop") {
+            in.op = Op::NOP;
+        } else {
+            parseError(p.line, "unsupported instruction '" + op + "'");
+        }
+        return in;
+    }
+
+    static std::string labelArg(const Parsed &p, size_t i) {
+        if (i >= p.args.size()) parseError(p.line, "missing label");
+        return p.args[i];
+    }
+};
@@ -0,0 +1,166 @@
+// test_attributes.cpp
+#include "analysis.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+static int countCalls(const ir::Function &f, const std::string &callee) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == ir::Opcode::Call && instr.callee == callee;
+    }
+    return n;
+}
+
+// --opt-report 中 "stack: @name: at most N bytes" 的 N，无界时为 -1
+static int reportedStack(const std::string &report, const std::string &name) {
+    std::string key = "stack: @" + name + ": ";
+    size_t at = report.find(key);
+    assert(at != std::string::npos);
+    std::string rest = report.substr(at + key.size());
+    if (rest.rfind("unbounded", 0) == 0) return -1;
+    assert(rest.rfind("at most ", 0) == 0);
+    return atoi(rest.c_str() + 8);
+}
+
+static const char *attributeSource = R"(
+int sq(int x) { return x * x; }
+int norm(int a, int b) { return sq(a) + sq(b); }
+int sum(int n) { int s = 0; while (n > 0) { s = s + n; n = n - 1; } return s; }
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int even(int n) { if (n == 0) { return 1; } return odd(n - 1); }
+int odd(int n) { if (n == 0) { return 0; } return even(n - 1); }
+int log(int x) { putint(x); return x; }
+int main() { return norm(3, 4) + sum(5) + fib(6) + even(4) + log(0); }
+)";
+
+void testInference() {
+    auto module = lowerToSSA(attributeSource);
+    auto attrs = ir::inferFunctionAttributes(*module);
+    assert(attrs.size() == 8);
+    // 叶子、只调用纯函数的函数都是纯的
+    assert(attrs["sq"].pure && attrs["sq"].leaf && attrs["sq"].noRecurse && attrs["sq"].willReturn);
+    assert(attrs["norm"].pure && !attrs["norm"].leaf && attrs["norm"].willReturn);
+    // 有循环的函数不保证返回，递归的函数既不保证返回也不是 norecurse
+    assert(attrs["sum"].pure && attrs["sum"].leaf && !attrs["sum"].willReturn);
+    assert(attrs["fib"].pure && !attrs["fib"].noRecurse && !attrs["fib"].willReturn);
+    assert(attrs["even"].pure && !attrs["even"].noRecurse && !attrs["odd"].noRecurse);
+    // 调用运行时库有副作用，但不妨碍返回
+    assert(!attrs["log"].pure && !attrs["log"].leaf && attrs["log"].willReturn);
+    assert(!attrs["main"].pure && attrs["main"].noRecurse && !attrs["main"].willReturn);
+
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::ostringstream report;
+    opts.report = &report;
+    compileSource(attributeSource, opts);
+    assert(report.str().find("attributes: @sq: pure norecurse leaf willreturn\n") != std::string::npos);
+    assert(report.str().find("attributes: @fib: pure\n") != std::string::npos);
+    assert(report.str().find("attributes: @log: norecurse willreturn\n") != std::string::npos);
+    std::cout << "Function attribute inference test passed\n";
+}
+
+void testDeadCalls() {
+    const char *src = R"(
+int sq(int x) { return x * x; }
+int sum(int n) { int s = 0; while (n > 0) { s = s + n; n = n - 1; } return s; }
+int log(int x) { putint(x); return x; }
+int main() { sq(3); sum(4); log(5); int a = sq(6); return a; }
+)";
+    auto module = lowerToSSA(src);
+    std::unordered_set<std::string> removable;
+    for (auto &[name, attrs] : ir::inferFunctionAttributes(*module)) {
+        if (attrs.pure && attrs.willReturn) removable.insert(name);
+    }
+    ir::Function &main = *module->getFunction("main");
+    ir::DCEStats stats;
+    assert(ir::eliminateDeadCode(main, &removable, &stats));
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    // 结果没人用的 sq(3) 删掉；sum 可能不返回、log 有副作用，都保留；结果被用到的 sq(6) 保留
+    assert(stats.deadCalls == 1);
+    assert(countCalls(main, "sq") == 1 && countCalls(main, "sum") == 1 && countCalls(main, "log") == 1);
+
+    // 不传 removableFunctions 时调用都当作有副作用
+    auto plain = lowerToSSA(src);
+    ir::DCEStats none;
+    ir::eliminateDeadCode(*plain->getFunction("main"), nullptr, &none);
+    assert(none.deadCalls == 0 && countCalls(*plain->getFunction("main"), "sq") == 2);
+
+    // 流水线中：同样的纯函数调用只算一次，结果没人用的调用被删掉
+    const char *dup = R"(
+int mix(int a, int b) { if (a > b) { return a * 31 - b; } return b * 17 + a / 3 + a * b - 4; }
+int main() {
+    int i = 0;
+    int s = 0;
+    while (i < 50) { s = s + mix(i, 7) + mix(i, 7); mix(s, i); i = i + 1; }
+    return s % 256;
+}
+)";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.disabledPasses.insert("inline");
+    std::ostringstream report;
+    opts.report = &report;
+    RiscvSim sim(compileSource(dup, opts));
+    opts.disabledPasses.insert("gvn");
+    opts.disabledPasses.insert("dce");
+    RiscvSim slow(compileSource(dup, opts));
+    assert(sim.run() && slow.run() && sim.result() == slow.result());
+    assert(sim.stats().calls == 50 && slow.stats().calls == 150);
+    assert(report.str().find("(1 unused calls)") != std::string::npos);
+    std::cout << "Dead call elimination test passed\n";
+}
+
+void testStackBound() {
+    const char *src = R"(
+int leaf(int x) { return x * 3; }
+int mid(int x) { int a = leaf(x); int b = leaf(a + 1); return a + b; }
+int top(int x) { return mid(x) + mid(x + 1) * leaf(x); }
+int main() { return top(4); }
+)";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.disabledPasses.insert("inline");
+    std::ostringstream report;
+    opts.report = &report;
+    RiscvSim sim(compileSource(src, opts));
+    assert(sim.run());
+    // 不需要栈帧的叶子函数不占栈，调用链上最深的那条路径在模拟器中正好走到
+    assert(reportedStack(report.str(), "leaf") == 0);
+    assert(reportedStack(report.str(), "main") > 0);
+    assert((int)sim.stats().maxStackBytes == reportedStack(report.str(), "main"));
+
+    // 每个基准程序：上界不小于实际用到的栈；递归的函数没有上界
+    for (int level : {1, 2}) {
+        for (auto &prog : benchmarkPrograms()) {
+            CompileOptions o;
+            o.optLevel = level;
+            std::ostringstream r;
+            o.report = &r;
+            RiscvSim s(compileSource(prog.source, o));
+            assert(s.run() && s.result() == prog.expected);
+            int bound = reportedStack(r.str(), "main");
+            assert(bound < 0 || (int)s.stats().maxStackBytes <= bound);
+        }
+    }
+    report.str("");
+    compileSource("int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+                  "int main() { return fib(5); }",
+                  opts);
+    assert(reportedStack(report.str(), "fib") == -1 && reportedStack(report.str(), "main") == -1);
+    std::cout << "Stack bound test passed\n";
+}
+
+int main() {
+    testInference();
+    testDeadCalls();
+    testStackBound();
+    return 0;
+}
@@ -0,0 +1,172 @@
+// test_callgraph.cpp
+#include "callgraph.h"
+#include "driver.h"
+#include "irgen.h"
+#include "lexer.h"
+#include "parser.h"
+#include "programs.h"
+#include "rvsim.h"
+#include "threadpool.h"
+#include <atomic>
+#include <cassert>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+static std::vector<std::unique_ptr<FuncDef>> parse(const std::string &src) {
+    Lexer lexer(src);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    return parser.parseCompUnit();
+}
+
+static std::unique_ptr<ir::Module> lower(const std::string &src) {
+    auto ast = parse(src);
+    IRGen irgen;
+    return irgen.generate(ast);
+}
+
+static const char *recursiveSource = R"(
+int leaf(int x) { return x + 1; }
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int even(int n) { if (n == 0) { return 1; } return odd(n - 1); }
+int odd(int n) { if (n == 0) { return 0; } return even(leaf(n) - 2); }
+int unused(int n) { return fib(n) + helper(putint(n)); }
+int helper(int n) { return n * 2; }
+int main() { return fib(10) + even(7) + leaf(1); }
+)";
+
+static void checkGraph(const CallGraph &graph) {
+    assert(graph.functions().size() == 7);
+    assert(graph.contains("leaf") && !graph.contains("putint"));
+    assert((graph.callees("main") == std::vector<std::string>{"fib", "even", "leaf"}));
+    assert((graph.callees("odd") == std::vector<std::string>{"leaf", "even"}));
+
+    // 互相递归的 even/odd 是一个 SCC，其余各自一个
+    assert(graph.sccs().size() == 6);
+    assert(graph.sccOf("even") == graph.sccOf("odd"));
+    assert((graph.sccs()[graph.sccOf("even")] == std::vector<std::string>{"even", "odd"}));
+    assert(graph.isRecursive("fib") && graph.isRecursive("even") && !graph.isRecursive("leaf"));
+    assert((graph.mutuallyRecursive() == std::unordered_set<std::string>{"even", "odd"}));
+
+    // 自底向上：被调用的 SCC 排在调用者前面
+    for (size_t scc = 0; scc < graph.sccs().size(); scc++) {
+        for (int callee : graph.calleeSCCs((int)scc)) assert(callee < (int)scc);
+    }
+    assert(graph.sccOf("leaf") < graph.sccOf("even"));
+    assert(graph.sccOf("helper") < graph.sccOf("unused"));
+    assert(graph.sccOf("main") == (int)graph.sccs().size() - 1);
+
+    auto live = graph.reachableFrom("main");
+    assert(live.size() == 5 && !live.count("unused") && !live.count("helper"));
+    assert(graph.reachableFrom("nowhere").empty());
+}
+
+void testSCCs() {
+    // AST 和 IR 上建立的调用图相同
+    auto ast = parse(recursiveSource);
+    checkGraph(CallGraph(ast));
+    auto module = lower(recursiveSource);
+    checkGraph(CallGraph(*module));
+
+    // 很长的调用链不会让 Tarjan 爆栈
+    std::string chain = "int f0(int x) { return x; }\n";
+    for (int i = 1; i < 5000; i++)
+        chain += "int f" + std::to_string(i) + "(int x) { return f" + std::to_string(i - 1) + "(x); }\n";
+    CallGraph deep(parse(chain));
+    assert(deep.sccs().size() == 5000 && deep.sccOf("f0") == 0 && deep.sccOf("f4999") == 4999);
+    std::cout << "Call graph SCC test passed\n";
+}
+
+void testWholeProgram() {
+    auto ast = parse(recursiveSource);
+    auto removed = eliminateDeadFunctions(ast);
+    assert((removed == std::vector<std::string>{"unused", "helper"}));
+    assert(ast.size() == 5);
+    // 没有 main 的翻译单元不能判断谁是死的
+    auto library = parse("int f(int x) { return x; } int g(int x) { return f(x); }");
+    assert(eliminateDeadFunctions(library).empty() && library.size() == 2);
+
+    for (int level : {0, 1, 2}) {
+        CompileOptions opts;
+        opts.optLevel = level;
+        std::string plain = compileSource(recursiveSource, opts);
+        opts.wholeProgram = true;
+        std::ostringstream report;
+        opts.report = &report;
+        std::string pruned = compileSource(recursiveSource, opts);
+        assert(plain.find("unused:") != std::string::npos && plain.find("helper:") != std::string::npos);
+        assert(pruned.find("unused:") == std::string::npos && pruned.find("helper:") == std::string::npos);
+        assert(report.str().find("whole-program: @unused removed, unreachable from @main") != std::string::npos);
+        RiscvSim a(plain), b(pruned);
+        assert(a.run() && b.run() && a.result() == b.result());
+    }
+
+    // 全部内联进 main 之后，被调用者在 IR 上也没有调用者了
+    const char *src = "int sq(int x) { return x * x; } int main() { return sq(7); }";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.wholeProgram = true;
+    std::ostringstream report;
+    opts.report = &report;
+    std::string asmText = compileSource(src, opts);
+    assert(asmText.find("sq:") == std::string::npos);
+    assert(report.str().find("whole-program: @sq removed") != std::string::npos);
+    RiscvSim sim(asmText);
+    assert(sim.run() && sim.result() == 49);
+    std::cout << "Whole-program dead function test passed\n";
+}
+
+void testParallelPipeline() {
+    // 并发优化与单线程的输出逐字相同，报告也按同样的顺序输出
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    programs.push_back({"recursive", recursiveSource, 0});
+    for (auto &prog : programs) {
+        for (int level : {1, 2}) {
+            CompileOptions opts;
+            opts.optLevel = level;
+            std::ostringstream serialReport, parallelReport;
+            opts.report = &serialReport;
+            std::string serial = compileSource(prog.source, opts);
+            opts.jobs = 4;
+            opts.report = &parallelReport;
+            std::string parallel = compileSource(prog.source, opts);
+            assert(serial == parallel);
+            assert(serialReport.str() == parallelReport.str());
+        }
+    }
+
+    // 调度顺序：每个 SCC 恰好处理一次，开始时它调用的 SCC 都已完成
+    CallGraph graph(parse(recursiveSource));
+    std::vector<std::atomic<bool>> done(graph.sccs().size());
+    forEachSCCBottomUp(graph, 3, [&](int scc) {
+        for (int callee : graph.calleeSCCs(scc)) assert(done[callee]);
+        assert(!done[scc].exchange(true));
+    });
+    for (auto &d : done) assert(d);
+
+    // 某个 SCC 出错时异常传回调用者
+    bool threw = false;
+    try {
+        forEachSCCBottomUp(graph, 3, [&](int scc) {
+            if (graph.sccs()[scc][0] == "fib") throw std::runtime_error("boom");
+        });
+    } catch (const std::runtime_error &e) {
+        threw = std::string(e.what()) == "boom";
+    }
+    assert(threw);
+
+    ThreadPool pool(2);
+    std::atomic<int> count{0};
+    for (int i = 0; i < 100; i++) pool.submit([&] { count++; });
+    pool.wait();
+    assert(count == 100);
+    std::cout << "Parallel pipeline test passed\n";
+}
+
+int main() {
+    testSCCs();
+    testWholeProgram();
+    testParallelPipeline();
+    return 0;
+}
@@ -1,11 +1,40 @@
 #include "codegen.h"
 #include <sstream>
 #include "ast.h"
+#include "driver.h"
+#include "programs.h"
+#include "rvsim.h"
 #include "semantic.h"
+#include <cassert>
+#include <iostream>
 #include <memory>
 #include <vector>
 #include <string>
 
+static std::string compileO0(const std::string &src) {
+    CompileOptions opts;
+    opts.optLevel = 0;
+    return compileSource(src, opts);
+}
+
+static int runO0(const std::string &src) {
+    std::string asmText = compileO0(src);
+    RiscvSim sim(asmText);
+    if (!sim.run()) {
+        std::cerr << asmText << "\n" << sim.error() << "\n";
+        assert(false);
+    }
+    return sim.result();
+}
+
+// 返回函数 name 的汇编（到下一个 .globl 为止）
+static std::string functionText(const std::string &asmText, const std::string &name) {
+    size_t begin = asmText.find(".globl " + name + "\n");
+    assert(begin != std::string::npos);
+    size_t end = asmText.find(".globl ", begin + 1);
+    return asmText.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
 void testSimpleFunction() {
     auto block = std::make_unique<Block>();
     auto returnStmt = std::make_unique<ReturnStmt>();
@@ -151,10 +180,268 @@ void testWhileLoop() {
     codegen.generate(funcs);
 }
 
+static const char *kShortCircuitProgram =
+    "int hang() { while (1) { } return 0; }\n"
+    "int main() {\n"
+    "    int r = 0;\n"
+    "    if (0 && hang()) { r = 100; }\n"
+    "    if (1 || hang()) { r = r + 1; }\n"
+    "    int x = 5;\n"
+    "    if (!(x < 3) && x != 4) { r = r + 10; }\n"
+    "    int v = x > 3 && x < 10;\n"
+    "    int w = x > 7 || x == 5;\n"
+    "    int z = x < 7 || hang() == 0 && x < 3;\n"
+    "    if (v) { r = r + 100; }\n"
+    "    if (w) { r = r + 1000; }\n"
+    "    if (z) { r = r + 10000; }\n"
+    "    return r;\n"
+    "}\n";
+
+void testShortCircuit() {
+    // 短路：右边的 hang() 一旦被求值就不会返回
+    assert(runO0(kShortCircuitProgram) == 11111);
+    // 条件上下文的比较直接生成分支，不再先算出 0/1
+    std::string src = "int main() { int i = 0; int n = 50; while (i * i <= n) { i = i + 1; } return i; }";
+    std::string asmText = compileO0(src);
+    assert(asmText.find("blt t1, t0") != std::string::npos);
+    assert(asmText.find("xori") == std::string::npos && asmText.find("beqz") == std::string::npos);
+    assert(runO0(src) == 8);
+    std::cout << "Short-circuit condition test passed\n";
+}
+
+void testFrameLayout() {
+    std::string src =
+        "int leaf(int x) { return x; }\n"
+        "int noframe() { return 42; }\n"
+        "int fib(int n) {\n"
+        "    if (n < 2) { return n; }\n"
+        "    int a = fib(n - 1);\n"
+        "    int b = fib(n - 2);\n"
+        "    return a + b;\n"
+        "}\n"
+        "int main() {\n"
+        "    int a = 1; int b = 2; int c = 3; int d = 4; int e = 5;\n"
+        "    int f = fib(12);\n"
+        "    a = leaf(a);\n"
+        "    b = noframe();\n"
+        "    return f + a + b - c - d - e;\n"
+        "}\n";
+    std::string asmText = compileO0(src);
+
+    // 不用栈的叶子函数没有栈帧
+    std::string noframe = functionText(asmText, "noframe");
+    assert(noframe.find("sp") == std::string::npos);
+    // 只有一个参数槽的叶子函数：16 字节，不保存 ra
+    std::string leaf = functionText(asmText, "leaf");
+    assert(leaf.find("addi sp, sp, -16") != std::string::npos);
+    assert(leaf.find("ra") == std::string::npos);
+    // fib：3 个槽 + ra = 16 字节；ra 在调用后仍然有效
+    std::string fib = functionText(asmText, "fib");
+    assert(fib.find("addi sp, sp, -16") != std::string::npos);
+    assert(fib.find("sw ra, 12(sp)") != std::string::npos);
+    // main：6 个槽 + ra = 28 字节，对齐到 32
+    std::string mainText = functionText(asmText, "main");
+    assert(mainText.find("addi sp, sp, -32") != std::string::npos);
+
+    assert(runO0(src) == 144 + 1 + 42 - 12);
+    std::cout << "Frame layout test passed\n";
+}
+
+// 600 个局部变量，第 i 个的初值是 init(i)；所有变量都活到 return，栈槽无法共用
+static std::string largeFrameProgram(const std::string &prelude, std::string (*init)(int)) {
+    std::string src = prelude + "int main() {\n";
+    for (int i = 0; i < 600; i++) src += "    int v" + std::to_string(i) + " = " + init(i) + ";\n";
+    src += "    return v0";
+    for (int i = 1; i < 600; i++) src += " + v" + std::to_string(i);
+    src += ";\n}\n";
+    return src;
+}
+
+static int runWith(const std::string &src, const CompileOptions &opts) {
+    std::string asmText = compileSource(src, opts);
+    RiscvSim sim(asmText);
+    if (!sim.run()) {
+        std::cerr << asmText << "\n" << sim.error() << "\n";
+        assert(false);
+    }
+    return sim.result();
+}
+
+void testLargeFrame() {
+    // 帧超过 2048 字节，栈指针调整和访存都要经过临时寄存器
+    std::string constants = largeFrameProgram("", [](int i) { return std::to_string(i); });
+    std::string asmText = compileO0(constants);
+    assert(asmText.find("add sp, sp, t0") != std::string::npos);
+    assert(runO0(constants) == 599 * 600 / 2);
+
+    // IR 流水线：不提升到寄存器时每个变量占一个栈槽
+    CompileOptions slots;
+    slots.optLevel = 1;
+    slots.disabledPasses.insert("mem2reg");
+    asmText = compileSource(constants, slots);
+    assert(asmText.find("add sp, sp, t0") != std::string::npos);
+    assert(asmText.find("add s0, sp, s0") != std::string::npos);
+    assert(runWith(constants, slots) == 599 * 600 / 2);
+
+    // -O2：跨调用活跃的值溢出到栈上
+    std::string calls = largeFrameProgram("int g(int x) { return x * x - 7; }\n",
+                                          [](int i) { return "g(" + std::to_string(i) + ")"; });
+    CompileOptions o2;
+    o2.optLevel = 2;
+    asmText = compileSource(calls, o2);
+    assert(asmText.find("add sp, sp, t0") != std::string::npos);
+    assert(asmText.find("add s0, sp, s0") != std::string::npos);
+    assert(runWith(calls, o2) == 599 * 600 * 1199 / 6 - 7 * 600);
+    std::cout << "Large frame test passed\n";
+}
+
+void testSlotColoring() {
+    // 兄弟作用域中的变量共用栈槽：r + 3 个槽，16 字节
+    std::string siblings =
+        "int main() {\n"
+        "    int r = 0;\n"
+        "    if (r == 0) { int a = 1; int b = 2; int c = 3; r = a + b + c; }\n"
+        "    else { int d = 4; int e = 5; int f = 6; r = d + e + f; }\n"
+        "    { int g = 7; int h = 8; r = r + g + h; }\n"
+        "    return r;\n"
+        "}\n";
+    assert(compileO0(siblings).find("addi sp, sp, -16") != std::string::npos);
+    assert(runO0(siblings) == 21);
+
+    // 内层同名变量不能覆盖外层变量的槽
+    std::string shadow =
+        "int main() {\n"
+        "    int x = 1;\n"
+        "    { int x = 2; x = x + 10; }\n"
+        "    return x;\n"
+        "}\n";
+    assert(runO0(shadow) == 1);
+
+    // 循环中用到的外层变量一直活到循环结束，循环体内的临时变量不能占用它们的槽
+    std::string loop =
+        "int main() {\n"
+        "    int s = 0;\n"
+        "    int i = 0;\n"
+        "    while (i < 5) {\n"
+        "        int t = i * 2;\n"
+        "        s = s + t;\n"
+        "        int u = s;\n"
+        "        i = i + 1;\n"
+        "    }\n"
+        "    int w = 100;\n"
+        "    return s + w;\n"
+        "}\n";
+    assert(runO0(loop) == 120);
+
+    // 参数的槽在最后一次使用后也可以复用：5 个变量只需 2 个槽
+    std::string params =
+        "int f(int a) {\n"
+        "    int b = a + 1;\n"
+        "    int c = b * 2;\n"
+        "    int d = c + 1;\n"
+        "    int e = d * 3;\n"
+        "    return e;\n"
+        "}\n"
+        "int main() {\n"
+        "    int r = f(3);\n"
+        "    return r;\n"
+        "}\n";
+    std::string asmText = compileO0(params);
+    assert(functionText(asmText, "f").find("addi sp, sp, -16") != std::string::npos);
+    assert(runO0(params) == 27);
+    std::cout << "Stack slot coloring test passed\n";
+}
+
+// 完全平衡的 2^depth 叶子表达式树，Sethi–Ullman 编号为 depth + 1；叶子依次取 x0..x3（值为 1..4）
+static std::string balancedTree(int depth, int &leaf, int &value) {
+    if (depth == 0) {
+        value = leaf % 4 + 1;
+        return "x" + std::to_string(leaf++ % 4);
+    }
+    int l, r;
+    std::string lhs = balancedTree(depth - 1, leaf, l);
+    std::string rhs = balancedTree(depth - 1, leaf, r);
+    bool add = depth % 2 == 1;
+    value = add ? l + r : l - r;
+    return "(" + lhs + (add ? " + " : " - ") + rhs + ")";
+}
+
+void testNestedExpressions() {
+    // 右边本身是二元表达式或调用时不能覆盖左边已经算好的值
+    std::string src =
+        "int f(int x) { return x + 1; }\n"
+        "int g(int a, int b) { return a * 10 + b; }\n"
+        "int h(int a, int b, int c, int d, int e, int f, int g, int h) {\n"
+        "    return a - b + c - d + e - f + g - h * 100;\n"
+        "}\n"
+        "int main() {\n"
+        "    int a = 3; int b = 4; int c = 5;\n"
+        "    int r1 = a - (b - (c - (a * b - (c + 1))));\n"
+        "    int r2 = f(a) + f(b) * g(f(c), b - f(a));\n"
+        "    int r3 = g(3, 4) - g(g(1, 2), f(0));\n"
+        "    int r4 = h(f(1), f(2), f(3), f(4), f(5), f(6), f(7), f(8));\n"
+        "    return r1 * 1000000 + r2 * 1000 + r3 + r4;\n"
+        "}\n";
+    int r1 = 3 - (4 - (5 - (12 - 6)));
+    int r2 = 4 + 5 * (6 * 10 + (4 - 4));
+    int r3 = 34 - (12 * 10 + 1);
+    int r4 = 2 - 3 + 4 - 5 + 6 - 7 + 8 - 9 * 100;
+    assert(runO0(src) == r1 * 1000000 + r2 * 1000 + r3 + r4);
+
+    // 需要 9 个寄存器的表达式超出 t0-t6，只能溢出到栈上
+    int leaf = 0, value = 0;
+    std::string tree = balancedTree(8, leaf, value);
+    std::string deep = "int main() { int x0 = 1; int x1 = 2; int x2 = 3; int x3 = 4; return " + tree + "; }";
+    assert(runO0(deep) == value);
+
+    // 寄存器池够用时不再经过 a0 中转
+    std::string simple = "int main() { int a = 3; int b = 4; return a * b + (a - b) * (a + b); }";
+    std::string asmText = compileO0(simple);
+    assert(asmText.find("mv t0, a0") == std::string::npos);
+    // 只有两个变量的写入，没有溢出
+    size_t stores = 0;
+    for (size_t pos = asmText.find("\tsw "); pos != std::string::npos; pos = asmText.find("\tsw ", pos + 1)) stores++;
+    assert(stores == 2);
+    assert(runO0(simple) == 5);
+    std::cout << "Nested expression test passed\n";
+}
+
+void testImmediateOperands() {
+    // 计数器加一是 lw/addi/sw 三条指令，s != 0 折叠成对 s 本身的 beqz
+    std::string src = "int main() { int i = 0; int s = 0; while (i < 100) { s = s + i; i = i + 1; }\n"
+                      "  if (s != 0) { return s - 4950; } return 70000; }";
+    std::string asmText = compileO0(src);
+    assert(asmText.find("addi t0, t0, 1") != std::string::npos);
+    assert(asmText.find("li t1, 1\n") == std::string::npos);
+    assert(asmText.find("sw zero, 0(sp)") != std::string::npos);
+    assert(asmText.find("beqz t0") != std::string::npos);
+    assert(asmText.find("lui ") != std::string::npos);
+    assert(runO0(src) == 0);
+    std::cout << "Immediate operand test passed\n";
+}
+
+void testBenchmarksAtO0() {
+    for (auto &prog : benchmarkPrograms()) {
+        int result = runO0(prog.source);
+        if (result != prog.expected) {
+            std::cerr << prog.name << ": wrong result " << result << "\n";
+            assert(false);
+        }
+    }
+    std::cout << "-O0 benchmark corpus test passed\n";
+}
+
 int main() {
     testSimpleFunction();
     testArithmeticOperations();
     testIfStatement();
     testWhileLoop();
+    testFrameLayout();
+    testLargeFrame();
+    testSlotColoring();
+    testShortCircuit();
+    testNestedExpressions();
+    testImmediateOperands();
+    testBenchmarksAtO0();
     return 0;
 }
@@ -0,0 +1,145 @@
+// test_consteval.cpp
+#include "driver.h"
+#include "interp.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+static int countCalls(const ir::Module &module, const std::string &callee) {
+    int n = 0;
+    for (auto &f : module.functions) {
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) n += instr.op == ir::Opcode::Call && instr.callee == callee;
+        }
+    }
+    return n;
+}
+
+void testInterpreter() {
+    const char *src = R"(
+int gcd(int a, int b) { while (b != 0) { int t = a % b; a = b; b = t; } return a; }
+int fact(int n) { if (n <= 1) { return 1; } return n * fact(n - 1); }
+int spin(int x) { while (x > 0) { x = x + 1; } return x; }
+int log(int x) { putint(x); return x; }
+int ratio(int a, int b) { return a / b; }
+void nothing(int x) { }
+int main() { return gcd(84, 36) + fact(5); }
+)";
+    // 栈槽形式和 SSA 形式的结果相同
+    for (bool toSSA : {false, true}) {
+        auto module = toSSA ? lowerToSSA(src) : lowerToIR(src);
+        auto r = ir::evaluateFunction(*module, "gcd", {1071, 462}, 1000);
+        assert(r.finished() && r.value == 21 && r.steps > 0);
+        r = ir::evaluateFunction(*module, "fact", {10}, 1000);
+        assert(r.finished() && r.value == 3628800);
+        // 按 32 位回绕
+        r = ir::evaluateFunction(*module, "fact", {13}, 1000);
+        assert(r.finished() && r.value == (int)(6227020800LL & 0xffffffff));
+        r = ir::evaluateFunction(*module, "main", {}, 1000);
+        assert(r.finished() && r.value == 12 + 120);
+        r = ir::evaluateFunction(*module, "nothing", {3}, 10);
+        assert(r.finished());
+
+        // 停下来的三种情况
+        r = ir::evaluateFunction(*module, "spin", {1}, 5000);
+        assert(r.status == ir::EvalResult::Status::OutOfSteps && r.steps == 5000);
+        r = ir::evaluateFunction(*module, "log", {1}, 1000);
+        assert(r.status == ir::EvalResult::Status::External && r.detail == "putint");
+        r = ir::evaluateFunction(*module, "ratio", {7, 0}, 1000);
+        assert(r.status == ir::EvalResult::Status::Trap && r.detail == "division by zero");
+        r = ir::evaluateFunction(*module, "ratio", {7, 2}, 1000);
+        assert(r.finished() && r.value == 3);
+    }
+    std::cout << "IR interpreter test passed\n";
+}
+
+// 每个基准程序：解释器的结果与编译出的汇编在模拟器上的结果一致（反过来也检查了代码生成），
+// 打开 -fconst-eval 后 main 只剩 li a0, <结果>; ret
+void testWholeProgram() {
+    for (auto &prog : benchmarkPrograms()) {
+        auto module = lowerToSSA(prog.source);
+        auto expected = ir::evaluateFunction(*module, "main", {}, 100000000);
+        assert(expected.finished() && expected.value == prog.expected);
+        for (int level : {1, 2, 3}) {
+            CompileOptions opts;
+            opts.optLevel = level;
+            RiscvSim sim(compileSource(prog.source, opts));
+            assert(sim.run() && sim.result() == expected.value);
+
+            opts.constEvalSteps = 10000000;
+            opts.wholeProgram = true;
+            std::ostringstream report;
+            opts.report = &report;
+            std::string asmText = compileSource(prog.source, opts);
+            RiscvSim folded(asmText);
+            assert(folded.run() && folded.result() == prog.expected);
+            assert(folded.stats().instrs <= 3 && folded.stats().calls == 0);
+            assert(asmText.find("main:\n\tli a0, " + std::to_string(prog.expected) + "\n") != std::string::npos ||
+                   asmText.find("main:\n\tlui a0, ") != std::string::npos);
+            assert(report.str().find("const-eval: @main evaluated to " + std::to_string(prog.expected) + " in ") !=
+                   std::string::npos);
+        }
+    }
+    std::cout << "Whole-program evaluation test passed\n";
+}
+
+void testPartialEvaluation() {
+    // 步数不够执行完 main，但 fib(18) 执行得完：调用换成结果，循环留到运行时
+    const char *src = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int main() {
+    int i = 0;
+    int s = fib(18);
+    while (i < 300000) { s = (s + i % 7) % 1000; i = i + 1; }
+    return s + fib(18) % 3;
+}
+)";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.constEvalSteps = 200000;
+    std::ostringstream report;
+    opts.report = &report;
+    RiscvSim fast(compileSource(src, opts));
+    opts.constEvalSteps = 0;
+    RiscvSim slow(compileSource(src, opts));
+    assert(fast.run() && slow.run() && fast.result() == slow.result());
+    assert(fast.stats().calls == 0 && slow.stats().calls > 1000);
+    assert(report.str().find("const-eval: @main not evaluated: step budget of 200000 exhausted\n") !=
+           std::string::npos);
+    assert(report.str().find("const-eval: @main: @fib(18) = 2584 in ") != std::string::npos);
+
+    // 调用运行时库、运行时会除以 0 的调用不求值，其余常量实参的调用照样折叠
+    const char *effects = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int ratio(int a, int b) { return a / b; }
+int main() { putint(fib(10)); return ratio(fib(6), 0); }
+)";
+    auto module = lowerToSSA(effects);
+    ir::ConstEvalStats stats;
+    std::ostringstream remarks;
+    assert(ir::evaluateAtCompileTime(*module, 100000, &remarks, &stats));
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    assert(!stats.mainEvaluated && stats.callsFolded == 2);
+    assert(countCalls(*module, "fib") == 2 && countCalls(*module, "putint") == 1);
+    assert(countCalls(*module, "ratio") == 1);
+    assert(remarks.str().find("const-eval: @main not evaluated: calls @putint\n") != std::string::npos);
+
+    // 不开时不求值
+    report.str("");
+    opts.optLevel = 2;
+    compileSource(src, opts);
+    assert(report.str().find("const-eval") == std::string::npos);
+    std::cout << "Partial evaluation test passed\n";
+}
+
+int main() {
+    testInterpreter();
+    testWholeProgram();
+    testPartialEvaluation();
+    return 0;
+}
@@ -0,0 +1,220 @@
+// test_dce.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static std::string readExample(const std::string &name) {
+    std::ifstream file(std::string(TOYC_EXAMPLES_DIR) + "/" + name);
+    assert(file && "cannot open example");
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+static ir::DCEStats runDCE(ir::Module &module) {
+    ir::DCEStats stats;
+    for (auto &f : module.functions) {
+        ir::eliminateDeadCode(*f, nullptr, &stats);
+        ir::simplifyCFG(*f, &stats);
+    }
+    std::string err;
+    bool ok = ir::verifyModule(module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+    return stats;
+}
+
+static int countOps(const ir::Function &f, ir::Opcode op) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == op;
+    }
+    return n;
+}
+
+// 汇编中的指令条数（不含标签和伪指令）
+static int staticInstrs(const std::string &asmText) {
+    int n = 0;
+    std::istringstream in(asmText);
+    std::string line;
+    while (std::getline(in, line)) n += !line.empty() && line[0] == '\t';
+    return n;
+}
+
+static int countLines(const std::string &asmText, const std::string &prefix) {
+    int n = 0;
+    std::istringstream in(asmText);
+    std::string line;
+    while (std::getline(in, line)) n += line.rfind("\t" + prefix, 0) == 0;
+    return n;
+}
+
+static std::string compileO0(const std::string &src, bool dce = true) {
+    CompileOptions opts;
+    if (!dce) opts.disabledPasses.insert("dce");
+    return compileSource(src, opts);
+}
+
+void testCodeGenDeadCode() {
+    // then 分支以 return 结尾时没有 j endif，所有路径都已返回时没有末尾的尾声
+    std::string both = compileO0("int f(int x) { if (x > 0) { return 1; } else { return 2; } }\n"
+                                 "int main() { return f(3); }");
+    std::string f = both.substr(0, both.find(".globl main"));
+    assert(f.find("\tj ") == std::string::npos);
+    assert(countLines(f, "ret") == 2);
+
+    // return、break 之后的语句，以及值不被使用的无副作用表达式都不生成
+    std::string src = R"(
+int g(int x) { return x + 1; }
+int main() {
+    int s = 0;
+    int i = 0;
+    while (1) {
+        if (i == 5) {
+            break;
+            s = s + 100;
+        }
+        s + i * 3;
+        g(i) + 1;
+        i = i + 1;
+    }
+    if (0) { s = s + 1000; }
+    return s + i;
+    s = 1234;
+}
+)";
+    std::string asmText = compileO0(src), plain = compileO0(src, false);
+    for (const char *dead : {"100", "1000", "1234", "li t1, 3"}) {
+        assert(asmText.find(dead) == std::string::npos);
+        assert(plain.find(dead) != std::string::npos);
+    }
+    // 调用还要保留
+    assert(countLines(asmText, "call g") == 1);
+    RiscvSim fast(asmText), slow(plain);
+    assert(fast.run() && slow.run() && fast.result() == 5 && slow.result() == 5);
+    assert(fast.stats().instrs < slow.stats().instrs);
+    std::cout << "CodeGen dead code test passed\n";
+}
+
+void testDeadInstructions() {
+    // 只在环里互相使用的 phi、结果没用的运算和调用返回值
+    auto module = lowerToSSA(R"(
+int g(int x) { return x; }
+int main() {
+    int i = 0;
+    int unused = 0;
+    int total = 0;
+    while (i < 10) {
+        unused = unused + i * 7;
+        int r = g(i);
+        total = total + i;
+        i = i + 1;
+    }
+    g(total);
+    return i;
+}
+)");
+    ir::DCEStats stats = runDCE(*module);
+    ir::Function &main = *module->getFunction("main");
+    // unused 的 phi、乘法和加法都被删掉，只剩循环头和出口处 i 和 total 的 phi；两个调用的返回值都没人用
+    assert(countOps(main, ir::Opcode::Phi) == 4);
+    assert(countOps(main, ir::Opcode::Mul) == 0);
+    assert(countOps(main, ir::Opcode::Add) == 2);
+    assert(countOps(main, ir::Opcode::Call) == 2);
+    for (auto &bb : main.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op == ir::Opcode::Call) assert(instr.dst < 0);
+        }
+    }
+    assert(stats.deadInstrs == 3);
+    std::cout << "Dead instruction elimination test passed\n";
+}
+
+void testCFGSimplification() {
+    // if 的两边都是空的：br 的两个目标最终相同，整个 if 消失
+    auto module = lowerToSSA("int main() { int x = 3; int y = 0; if (x > 1) { y = 1; } else { y = 1; } return y; }");
+    runDCE(*module);
+    ir::Function &main = *module->functions[0];
+    assert(main.blocks.size() == 1);
+    assert(countOps(main, ir::Opcode::Br) == 0 && countOps(main, ir::Opcode::Jmp) == 0);
+
+    // SCCP 折叠分支后留下的 jmp 链合并成一个块
+    auto chain = lowerToSSA("int main() { int x = 10; int y = 15; int r = 0;\n"
+                            "  if (x < y) { r = x + y; } else { r = x - y; }\n"
+                            "  if (r == 25) { r = r * 2; } return r; }");
+    for (auto &f : chain->functions) ir::sparseConditionalConstantPropagation(*f);
+    ir::DCEStats stats = runDCE(*chain);
+    assert(stats.jumpsRemoved >= 4);
+    assert(chain->functions[0]->blocks.size() == 1);
+
+    // 临界边上的空块不能跳过：汇合处的 phi 在两条边上取不同的值
+    auto diamond = lowerToSSA(benchmarkPrograms()[3].source);
+    runDCE(*diamond);
+    CompileOptions opts;
+    opts.optLevel = 1;
+    RiscvSim sim(compileSource(benchmarkPrograms()[3].source, opts));
+    assert(sim.run() && sim.result() == benchmarkPrograms()[3].expected);
+    std::cout << "CFG simplification test passed\n";
+}
+
+// 每个示例程序在 -O0 和 -O1 下开关死代码消除的指令数
+void testInstructionCounts() {
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    std::string example = readExample("test.c");
+    programs.insert(programs.begin(), {"examples/test.c", example.c_str(), 5});
+
+    std::cout << "  " << std::left << std::setw(18) << "program" << std::right << std::setw(14) << "-O0 static"
+              << std::setw(22) << "-O0 dynamic" << std::setw(14) << "-O1 IR" << std::setw(14) << "-O1 static"
+              << "\n";
+    for (auto &prog : programs) {
+        CompileOptions o0, o1, ir;
+        o1.optLevel = ir.optLevel = 1;
+        ir.emitIR = true;
+        CompileOptions o0Plain = o0, o1Plain = o1, irPlain = ir;
+        for (auto *opts : {&o0Plain, &o1Plain, &irPlain}) opts->disabledPasses.insert("dce");
+
+        std::string a0 = compileSource(prog.source, o0), b0 = compileSource(prog.source, o0Plain);
+        std::string a1 = compileSource(prog.source, o1), b1 = compileSource(prog.source, o1Plain);
+        RiscvSim fast0(a0), slow0(b0), fast1(a1), slow1(b1);
+        assert(fast0.run() && slow0.run() && fast1.run() && slow1.run());
+        for (auto *sim : {&fast0, &slow0, &fast1, &slow1}) assert(sim->result() == prog.expected);
+
+        // IR 指令数：以两个空格缩进的行
+        auto irInstrs = [&](const CompileOptions &opts) {
+            int n = 0;
+            std::istringstream in(compileSource(prog.source, opts));
+            std::string line;
+            while (std::getline(in, line)) n += line.rfind("  ", 0) == 0;
+            return n;
+        };
+        int irAfter = irInstrs(ir), irBefore = irInstrs(irPlain);
+        // -O0 每个函数至少省掉落到末尾的那份尾声
+        assert(staticInstrs(a0) < staticInstrs(b0));
+        assert(fast0.stats().instrs <= slow0.stats().instrs);
+        assert(irAfter <= irBefore);
+        assert(staticInstrs(a1) <= staticInstrs(b1));
+        assert(fast1.stats().instrs <= slow1.stats().instrs);
+
+        auto cell = [](int before, int after) { return std::to_string(before) + " -> " + std::to_string(after); };
+        std::cout << "  " << std::left << std::setw(18) << prog.name << std::right << std::setw(14)
+                  << cell(staticInstrs(b0), staticInstrs(a0)) << std::setw(22)
+                  << cell((int)slow0.stats().instrs, (int)fast0.stats().instrs) << std::setw(14)
+                  << cell(irBefore, irAfter) << std::setw(14) << cell(staticInstrs(b1), staticInstrs(a1)) << "\n";
+    }
+    std::cout << "Dead code instruction count test passed\n";
+}
+
+int main() {
+    testCodeGenDeadCode();
+    testDeadInstructions();
+    testCFGSimplification();
+    testInstructionCounts();
+    return 0;
+}
@@ -0,0 +1,162 @@
+// test_fold.cpp
+#include "driver.h"
+#include "fold.h"
+#include "lexer.h"
+#include "parser.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <climits>
+#include <iostream>
+
+struct Folded {
+    std::vector<std::unique_ptr<FuncDef>> funcs;
+    FoldStats stats;
+    // main 的第一条 return 语句的表达式
+    Expr *result() const {
+        for (auto &f : funcs) {
+            if (f->name != "main") continue;
+            for (auto &stmt : f->body->stmts) {
+                if (auto ret = dynamic_cast<ReturnStmt *>(stmt.get())) return ret->expr.get();
+            }
+        }
+        return nullptr;
+    }
+};
+
+static Folded foldSource(const std::string &src) {
+    Lexer lexer(src);
+    auto tokens = lexer.tokenize();
+    Parser parser(tokens);
+    Folded folded{parser.parseCompUnit(), {}};
+    ConstantFolder folder;
+    folder.run(folded.funcs);
+    folded.stats = folder.stats();
+    return folded;
+}
+
+// main 中 return 的表达式折叠后的结果
+static Folded foldReturn(const std::string &expr) {
+    return foldSource("int f(int n) { return n; }\n"
+                      "int main() { int x = 3; int c = 1; return " + expr + "; }");
+}
+
+static bool isNumber(Expr *e, int value) {
+    auto num = dynamic_cast<NumberExpr *>(e);
+    return num && num->value == value;
+}
+
+static bool isVar(Expr *e, const std::string &name) {
+    auto var = dynamic_cast<VarExpr *>(e);
+    return var && var->name == name;
+}
+
+static BinaryExpr *asBinary(Expr *e, const std::string &op) {
+    auto bin = dynamic_cast<BinaryExpr *>(e);
+    return bin && bin->op == op ? bin : nullptr;
+}
+
+void testConstantFolding() {
+    assert(isNumber(foldReturn("60 * 60 * 24").result(), 86400));
+    assert(isNumber(foldReturn("-(3 - 10) * 2 + 7 / 2 - 7 % 3").result(), 16));
+    // 32 位补码回绕
+    assert(isNumber(foldReturn("2147483647 + 1").result(), INT_MIN));
+    assert(isNumber(foldReturn("65536 * 65536").result(), 0));
+    assert(isNumber(foldReturn("(0 - 2147483647 - 1) / -1").result(), INT_MIN));
+    assert(isNumber(foldReturn("(0 - 2147483647 - 1) % -1").result(), 0));
+    assert(isNumber(foldReturn("-7 / 2").result(), -3));
+    assert(isNumber(foldReturn("-7 % 2").result(), -1));
+    assert(isNumber(foldReturn("+5 - +(2 * 3)").result(), -1));
+    assert(isNumber(foldReturn("(3 < 5) + (5 <= 4) * 2 + (2 == 2) * 4 + !0 * 8 + !7 * 16").result(), 13));
+    assert(isNumber(foldReturn("0 && f(1)").result(), 0));
+    assert(isNumber(foldReturn("3 || f(1)").result(), 1));
+
+    // 除以 0 保留原运算并报告
+    Folded div = foldReturn("x / (2 - 2) + 1 % 0");
+    assert(div.stats.divisionsByZero == 2);
+    assert(asBinary(div.result(), "+"));
+    std::cout << "Constant folding test passed\n";
+}
+
+void testAlgebraicIdentities() {
+    assert(isVar(foldReturn("x + 0").result(), "x"));
+    assert(isVar(foldReturn("0 + x").result(), "x"));
+    assert(isVar(foldReturn("x * 1").result(), "x"));
+    assert(isVar(foldReturn("1 * (x - 0)").result(), "x"));
+    assert(isVar(foldReturn("x / 1").result(), "x"));
+    assert(isVar(foldReturn("-(-x)").result(), "x"));
+    assert(isVar(foldReturn("x * -1 * -1").result(), "x"));
+    assert(isNumber(foldReturn("x * 0").result(), 0));
+    assert(isNumber(foldReturn("x % 1").result(), 0));
+    // 有副作用的子树不能删掉
+    assert(asBinary(foldReturn("f(x) * 0").result(), "*"));
+    assert(asBinary(foldReturn("f(x) && 0").result(), "&&"));
+
+    // !!c 只有在 c 是 0/1 时才等于 c
+    Folded f1 = foldReturn("!(!c)");
+    auto notnot = dynamic_cast<UnaryExpr *>(f1.result());
+    assert(notnot && notnot->op == "!");
+    assert(asBinary(foldReturn("!(!(x < c))").result(), "<"));
+
+    // !(a < b) => a >= b，常量比较换到右边
+    Folded f2 = foldReturn("!(x < c)"), f3 = foldReturn("5 < x");
+    auto ge = asBinary(f2.result(), ">=");
+    assert(ge && isVar(ge->lhs.get(), "x") && isVar(ge->rhs.get(), "c"));
+    auto gt = asBinary(f3.result(), ">");
+    assert(gt && isVar(gt->lhs.get(), "x") && isNumber(gt->rhs.get(), 5));
+    assert(asBinary(foldReturn("!(x == 1)").result(), "!="));
+
+    // 与常量的 && / || 规范成 0/1
+    Folded f4 = foldReturn("1 && x");
+    auto ne = asBinary(f4.result(), "!=");
+    assert(ne && isVar(ne->lhs.get(), "x") && isNumber(ne->rhs.get(), 0));
+    assert(asBinary(foldReturn("x || 0").result(), "!="));
+    assert(isNumber(foldReturn("x && 0").result(), 0));
+
+    // 条件上下文：!!c 和 c != 0 都化简为 c
+    Folded cond = foldSource("int main() { int c = 2; if (!(!c)) { return 1; } while (c != 0) { c = c - 1; } return 0; }");
+    auto ifStmt = dynamic_cast<IfStmt *>(cond.funcs[0]->body->stmts[1].get());
+    auto whileStmt = dynamic_cast<WhileStmt *>(cond.funcs[0]->body->stmts[2].get());
+    assert(isVar(ifStmt->condition.get(), "c") && isVar(whileStmt->condition.get(), "c"));
+    std::cout << "Algebraic simplification test passed\n";
+}
+
+// 折叠前后的程序结果一致，-O0 的指令数不增加
+void testFoldingPreservesResults() {
+    CompileOptions folded;
+    CompileOptions literal;
+    literal.disabledPasses.insert("fold");
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    programs.push_back({"identities", R"(
+int id(int v) { return v; }
+int main() {
+    int x = 7; int c = 2; int s = 0;
+    int day = 60 * 60 * 24;
+    s = s + (x + 0) * 1 - -(-x) + day / 3600;
+    if (!(!c)) { s = s + 1; }
+    if (!(x < c)) { s = s + 10; }
+    if (1 && x) { s = s + 100; }
+    s = s + (id(x) * 0) + (x * 0) + (0 - x) + (x / -1) + !(!c);
+    s = s + (2147483647 + 1) / 65536;
+    return s;
+}
+)", 7 - 7 + 24 + 1 + 10 + 100 - 7 - 7 + 1 - 32768});
+    for (auto &prog : programs) {
+        RiscvSim fast(compileSource(prog.source, folded)), slow(compileSource(prog.source, literal));
+        assert(fast.run() && slow.run());
+        if (fast.result() != prog.expected || slow.result() != prog.expected) {
+            std::cerr << prog.name << ": " << fast.result() << " / " << slow.result() << "\n";
+            assert(false);
+        }
+        assert(fast.stats().instrs <= slow.stats().instrs);
+        if (std::string(prog.name) == "identities") assert(fast.stats().instrs < slow.stats().instrs);
+    }
+    std::cout << "Folding differential test passed\n";
+}
+
+int main() {
+    testConstantFolding();
+    testAlgebraicIdentities();
+    testFoldingPreservesResults();
+    return 0;
+}
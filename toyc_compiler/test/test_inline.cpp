@@ -0,0 +1,200 @@
+// test_inline.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static int countCalls(const ir::Function &f, const std::string &callee) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == ir::Opcode::Call && instr.callee == callee;
+    }
+    return n;
+}
+
+// remarks 中 caller -> callee 的那一行
+static std::string remarkFor(const std::string &remarks, const std::string &caller, const std::string &callee) {
+    std::string key = "inline: @" + caller + " -> @" + callee + ": ";
+    size_t begin = remarks.find(key);
+    assert(begin != std::string::npos);
+    return remarks.substr(begin + key.size(), remarks.find('\n', begin) - begin - key.size());
+}
+
+static CompileOptions withoutInlining(CompileOptions opts) {
+    opts.disabledPasses.insert("inline");
+    return opts;
+}
+
+void testSmallHelpers() {
+    const char *src = R"(
+int add(int a, int b) { return a + b; }
+int clamp(int x) { if (x < 0) { return 0; } if (x > 9) { return 9; } return x; }
+void nothing(int x) { }
+int main() { nothing(3); return add(clamp(-4), add(clamp(7), clamp(12))); }
+)";
+    auto module = lowerToSSA(src);
+    ir::InlineStats stats;
+    assert(ir::inlineCalls(*module, 40, nullptr, &stats));
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    assert(stats.inlined == 6 && stats.notInlined == 0);
+    // 有多个 ret 的函数体把返回值合并成 phi，void 函数的调用直接消失
+    ir::Function &main = *module->getFunction("main");
+    for (const char *callee : {"add", "clamp", "nothing"}) assert(countCalls(main, callee) == 0);
+
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource(src, opts);
+    assert(asmText.find("call") == std::string::npos);
+    RiscvSim sim(asmText);
+    assert(sim.run() && sim.result() == 16);
+    // 内联后的常量实参一路传播，main 只剩一个常量
+    assert(sim.stats().instrs <= 3);
+
+    // 没有 mem2reg 时被调用者的栈槽在调用者中重新分配
+    opts.disabledPasses.insert("mem2reg");
+    RiscvSim slots(compileSource(src, opts));
+    assert(slots.run() && slots.result() == 16);
+    std::cout << "Small helper inlining test passed\n";
+}
+
+void testCostModel() {
+    // body 大约 20 条指令：顶层调用超过阈值，循环里的调用和常量实参放宽阈值后内联
+    const char *src = R"(
+int body(int a, int b) {
+    int x = a * 3 + b;
+    int y = x / 7 - a % 5;
+    int z = (x + y) * (x - y) + a * b;
+    if (z > 100) { z = z - x * 2; } else { z = z + y * 3; }
+    return z * 5 + x - y / 3 + (a - b) % 4;
+}
+int outer(int n) { return body(n, n + 1); }
+int loop(int n) { int s = 0; int i = 0; while (i < n) { s = s + body(i, s); i = i + 1; } return s; }
+int folded(int n) { return body(4, 5) + n; }
+int main() { return outer(3) + loop(10) + folded(1); }
+)";
+    std::ostringstream remarks;
+    auto module = lowerToSSA(src);
+    ir::inlineCalls(*module, 5, &remarks);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    assert(countCalls(*module->getFunction("outer"), "body") == 1);
+    assert(countCalls(*module->getFunction("loop"), "body") == 0);
+    assert(countCalls(*module->getFunction("folded"), "body") == 0);
+    // 每个决定都有理由：代价、阈值以及放宽阈值的各项
+    std::string outer = remarkFor(remarks.str(), "outer", "body");
+    assert(outer.rfind("not inlined (cost ", 0) == 0 && outer.find("> threshold 15 = 5 + leaf 10") != std::string::npos);
+    std::string loop = remarkFor(remarks.str(), "loop", "body");
+    assert(loop.rfind("inlined (cost ", 0) == 0 && loop.find("loop depth 1 20") != std::string::npos);
+    assert(remarkFor(remarks.str(), "folded", "body").find("2 constant args 20") != std::string::npos);
+
+    // 更高的阈值连顶层调用也内联；阈值 0 只内联不比调用本身大的函数
+    auto generous = lowerToSSA(src);
+    ir::inlineCalls(*generous, 100);
+    assert(countCalls(*generous->getFunction("outer"), "body") == 0);
+    auto strict = lowerToSSA("int id(int x) { return x; } int main() { return id(id(2)); }");
+    ir::InlineStats stats;
+    ir::inlineCalls(*strict, 0, nullptr, &stats);
+    assert(stats.inlined == 2);
+
+    // -finline-threshold 对应 CompileOptions::inlineThreshold，结果都不变
+    for (int threshold : {0, 10, 40, 1000}) {
+        CompileOptions opts;
+        opts.optLevel = 1;
+        opts.inlineThreshold = threshold;
+        RiscvSim sim(compileSource(src, opts));
+        RiscvSim plain(compileSource(src, withoutInlining(opts)));
+        assert(sim.run() && plain.run() && sim.result() == plain.result());
+        assert(sim.stats().calls <= plain.stats().calls);
+    }
+    std::cout << "Inline cost model test passed\n";
+}
+
+void testRecursion() {
+    const char *src = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int even(int n) { if (n == 0) { return 1; } return odd(n - 1); }
+int odd(int n) { if (n == 0) { return 0; } return even(n - 1); }
+int twice(int n) { return fib(n) * 2; }
+int log(int x) { return putint(x); }
+int main() { return twice(10) + even(6) + log(1); }
+)";
+    std::ostringstream remarks;
+    auto module = lowerToSSA(src);
+    ir::InlineStats stats;
+    ir::inlineCalls(*module, 1000, &remarks, &stats);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    // 递归和互相递归的函数无论阈值多高都不展开，调用它们的非递归函数照常内联
+    assert(countCalls(*module->getFunction("fib"), "fib") == 2);
+    assert(countCalls(*module->getFunction("even"), "odd") == 1);
+    assert(countCalls(*module->getFunction("main"), "twice") == 0);
+    assert(countCalls(*module->getFunction("main"), "fib") == 1);
+    assert(countCalls(*module->getFunction("main"), "putint") == 1);
+    assert(remarkFor(remarks.str(), "fib", "fib") == "not inlined (@fib is recursive)");
+    assert(remarkFor(remarks.str(), "odd", "even") == "not inlined (@even is recursive)");
+    assert(remarkFor(remarks.str(), "log", "putint") == "not inlined (no definition in this module)");
+    // 自底向上：twice 先内联好（这里没有可内联的），再整个内联进 main，fib 的调用只决定一次
+    assert(remarks.str().find("inline: @main -> @fib") == std::string::npos);
+    std::cout << "Recursive inlining test passed\n";
+}
+
+// 调用小函数很多的程序
+static const TestProgram helperPrograms[] = {
+    {"helpers", R"(
+int add(int a, int b) { return a + b; }
+int max(int a, int b) { if (a > b) { return a; } return b; }
+int sq(int x) { return x * x; }
+int main() {
+    int s = 0;
+    int i = 0;
+    while (i < 500) { s = add(s, max(sq(i % 7), i % 11)); i = add(i, 1); }
+    return s % 256;
+}
+)", 87},
+    {"stepper", R"(
+int inc(int x) { return x + 1; }
+int step(int x, int k) { if (k % 3 == 0) { return inc(x); } return inc(inc(x)); }
+int walk(int n) { int x = 0; int k = 0; while (k < n) { x = step(x, k); k = inc(k); } return x; }
+int main() { return walk(900) % 256; }
+)", 220},
+};
+
+void testBenchmarks() {
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    programs.insert(programs.end(), std::begin(helperPrograms), std::end(helperPrograms));
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(20) << "calls"
+              << std::setw(24) << "dynamic instrs" << "\n";
+    for (auto &prog : programs) {
+        RiscvSim fast(compileSource(prog.source, opts)), slow(compileSource(prog.source, withoutInlining(opts)));
+        assert(fast.run() && slow.run());
+        assert(fast.result() == prog.expected && slow.result() == prog.expected);
+        assert(fast.stats().calls <= slow.stats().calls);
+        assert(fast.stats().instrs <= slow.stats().instrs);
+        bool helperHeavy = &prog >= &programs[programs.size() - std::size(helperPrograms)];
+        if (helperHeavy) {
+            assert(fast.stats().calls == 0);
+            assert(fast.stats().instrs * 4 < slow.stats().instrs * 3);
+        }
+        std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(20)
+                  << std::to_string(slow.stats().calls) + " -> " + std::to_string(fast.stats().calls)
+                  << std::setw(24)
+                  << std::to_string(slow.stats().instrs) + " -> " + std::to_string(fast.stats().instrs) << "\n";
+    }
+    std::cout << "Inline benchmark test passed\n";
+}
+
+int main() {
+    testSmallHelpers();
+    testCostModel();
+    testRecursion();
+    testBenchmarks();
+    return 0;
+}
@@ -0,0 +1,211 @@
+// test_ipsccp.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static std::vector<const ir::Instr *> callsTo(const ir::Module &module, const std::string &callee) {
+    std::vector<const ir::Instr *> calls;
+    for (auto &f : module.functions) {
+        for (auto &bb : f->blocks) {
+            for (auto &instr : bb->instrs) {
+                if (instr.op == ir::Opcode::Call && instr.callee == callee) calls.push_back(&instr);
+            }
+        }
+    }
+    return calls;
+}
+
+static void verify(const ir::Module &module) {
+    std::string err;
+    bool ok = ir::verifyModule(module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+}
+
+static CompileOptions withoutIPSCCP(CompileOptions opts) {
+    opts.disabledPasses.insert("ipsccp");
+    return opts;
+}
+
+void testConstantArguments() {
+    const char *src = R"(
+int scale(int x, int k) { return x * k; }
+int outer(int x, int k, int unused) { return scale(x, k + 1) + scale(x + 1, k + 1); }
+int pow(int b, int e) { if (e == 0) { return 1; } return b * pow(b, e - 1); }
+int main() { return outer(2, 4, 9) + outer(5, 4, 0) + pow(3, 4) + pow(3, 2); }
+)";
+    std::ostringstream remarks;
+    auto module = lowerToSSA(src);
+    ir::IPSCCPStats stats;
+    assert(ir::propagateConstantsAcrossCalls(*module, true, &remarks, &stats));
+    verify(*module);
+    // outer 的 k 总是 4，经 SCCP 传给 scale 的 k 总是 5；pow 递归时原样传回的 b 总是 3
+    assert(stats.constantArgs == 3 && stats.deadArgs == 4);
+    assert(module->getFunction("outer")->paramNames == std::vector<std::string>{"x"});
+    assert(module->getFunction("scale")->paramNames == std::vector<std::string>{"x"});
+    assert(module->getFunction("pow")->paramNames == std::vector<std::string>{"e"});
+    for (auto *call : callsTo(*module, "pow")) assert(call->ops.size() == 1);
+    assert(remarks.str().find("ipsccp: @scale: argument k is always 5\n") != std::string::npos);
+    assert(remarks.str().find("ipsccp: @outer: removed unused argument unused\n") != std::string::npos);
+
+    // 模块外可能还有调用者时签名不变
+    auto open = lowerToSSA(src);
+    ir::IPSCCPStats none;
+    ir::propagateConstantsAcrossCalls(*open, false, nullptr, &none);
+    assert(none.constantArgs == 0 && none.deadArgs == 0);
+    assert(open->getFunction("outer")->paramNames.size() == 3);
+
+    for (int level : {1, 2}) {
+        CompileOptions opts;
+        opts.optLevel = level;
+        opts.wholeProgram = true;
+        RiscvSim a(compileSource(src, opts)), b(compileSource(src, withoutIPSCCP(opts)));
+        assert(a.run() && b.run() && a.result() == b.result() && a.result() == 2 * 5 + 3 * 5 + 5 * 5 + 6 * 5 + 81 + 9);
+    }
+    std::cout << "Constant argument propagation test passed\n";
+}
+
+// 比特化上限小、常量代入后明显变简单的函数
+static const char *kernelSource = R"(
+int kernel(int n, int mode, int step) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        if (mode == 1) { s = s + i * step; } else if (mode == 2) { s = s - i / step; } else { s = s + i % step; }
+        if (s > 10000) { s = s % 997; }
+        if (s < -10000) { s = -(-s % 991); }
+        s = s + (i * i) % 13 + (s / 7) % 5 + (n - i) * 2 + (s % 11) * 3 + i / 3 + (s * i) % 17;
+        s = s - (s / 9) % 4 + (i * 5) % 7 - (s % 19) + (n * i) % 23 + (s / 3) % 29 - (i % 31);
+        i = i + 1;
+    }
+    return s;
+}
+)";
+
+void testSpecialization() {
+    std::string src = std::string(kernelSource) + R"(
+int once(int n) { return kernel(n, 3, 5); }
+int main() {
+    int t = 0;
+    int r = 0;
+    while (r < 6) { t = t + kernel(r, 1, 3) + kernel(r + 1, 1, 3) + kernel(r, 2, r + 1); r = r + 1; }
+    return (t + once(4)) % 256;
+}
+)";
+    std::ostringstream remarks;
+    auto module = lowerToSSA(src);
+    ir::IPSCCPStats stats;
+    assert(ir::propagateConstantsAcrossCalls(*module, false, &remarks, &stats));
+    verify(*module);
+    // 同样的常量组合共用一个特化版本，循环外的调用不特化，原函数不变
+    assert(stats.specialized == 3);
+    auto spec0 = callsTo(*module, "kernel.spec0"), spec1 = callsTo(*module, "kernel.spec1");
+    assert(spec0.size() == 2 && spec1.size() == 1);
+    assert(spec0[0]->ops.size() == 1 && spec1[0]->ops.size() == 2);
+    assert(module->getFunction("kernel.spec0")->internal && module->getFunction("kernel.spec0")->paramNames.size() == 1);
+    assert(module->getFunction("kernel")->paramNames.size() == 3 && callsTo(*module, "kernel").size() == 1);
+    assert(remarks.str().find("ipsccp: @kernel: specialized as @kernel.spec0 for mode = 1 step = 3\n") !=
+           std::string::npos);
+
+    // 特化版本在流水线中单独优化：mode 的分支折叠掉，step 的乘法变成常量乘法。
+    // 调低内联阈值让它们保留为调用
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.inlineThreshold = 0;
+    std::ostringstream report;
+    opts.report = &report;
+    std::string asmText = compileSource(src, opts);
+    assert(asmText.find("kernel.spec0:") != std::string::npos);
+    RiscvSim fast(asmText), slow(compileSource(src, withoutIPSCCP(opts)));
+    assert(fast.run() && slow.run() && fast.result() == slow.result());
+    assert(fast.stats().instrs < slow.stats().instrs);
+
+    // 递归的函数和太大的函数不特化；全部内联掉的特化版本随后删除
+    const char *rec = R"(
+int fact(int n, int k) { if (n <= 1) { return k; } return fact(n - 1, k) * n; }
+int tiny(int x, int k) { return x * k + 1; }
+int main() { int i = 0; int s = 0; while (i < 5) { s = s + fact(i, 2) + tiny(i, 3); i = i + 1; } return s; }
+)";
+    auto recModule = lowerToSSA(rec);
+    ir::IPSCCPStats recStats;
+    ir::propagateConstantsAcrossCalls(*recModule, false, nullptr, &recStats);
+    assert(recStats.specialized == 1 && callsTo(*recModule, "fact").size() == 2);
+    report.str("");
+    opts.inlineThreshold = 40;
+    asmText = compileSource(rec, opts);
+    assert(report.str().find("ipsccp: @tiny.spec0 removed, every call was inlined") != std::string::npos);
+    assert(asmText.find("tiny.spec0") == std::string::npos);
+    std::cout << "Function specialization test passed\n";
+}
+
+void testConstantReturns() {
+    const char *src = R"(
+int status(int x) { if (x > 3) { return 1; } return 1; }
+int noisy(int x) { putint(x); return 0; }
+void nothing(int x) { }
+int main() { nothing(1); return status(5) + status(2) * 2 + noisy(3); }
+)";
+    auto module = lowerToSSA(src);
+    for (auto &f : module->functions) ir::sparseConditionalConstantPropagation(*f);
+    std::ostringstream remarks;
+    ir::IPSCCPStats stats;
+    assert(ir::propagateConstantReturns(*module->getFunction("main"), *module, &remarks, &stats));
+    verify(*module);
+    // 结果换成常量，调用本身还在：有副作用的 noisy 必须照常调用
+    assert(stats.constantReturns == 3);
+    assert(callsTo(*module, "status").size() == 2 && callsTo(*module, "noisy").size() == 1);
+    for (auto *call : callsTo(*module, "status")) assert(call->dst < 0);
+    assert(remarks.str().find("ipsccp: @main: @noisy always returns 0\n") != std::string::npos);
+
+    // 流水线中：总会返回的纯函数的调用随后被 DCE 删掉
+    const char *pureSrc = R"(
+int check(int x) { int r = 2; if (x > 3) { r = 1 + 1; } return r; }
+int main() { int i = 0; int s = 0; while (i < 10) { s = s + check(i); i = i + 1; } return s; }
+)";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.disabledPasses.insert("inline");
+    RiscvSim sim(compileSource(pureSrc, opts));
+    assert(sim.run() && sim.result() == 20 && sim.stats().calls == 0);
+    RiscvSim plain(compileSource(pureSrc, withoutIPSCCP(opts)));
+    assert(plain.run() && plain.result() == 20 && plain.stats().calls == 10);
+    std::cout << "Constant return propagation test passed\n";
+}
+
+void testBenchmarks() {
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(24) << "dynamic instrs"
+              << "\n";
+    for (auto &prog : programs) {
+        for (int level : {1, 2}) {
+            for (bool wholeProgram : {false, true}) {
+                CompileOptions opts;
+                opts.optLevel = level;
+                opts.wholeProgram = wholeProgram;
+                RiscvSim fast(compileSource(prog.source, opts)), slow(compileSource(prog.source, withoutIPSCCP(opts)));
+                assert(fast.run() && slow.run());
+                assert(fast.result() == prog.expected && slow.result() == prog.expected);
+                if (level == 1 && wholeProgram) {
+                    std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(24)
+                              << std::to_string(slow.stats().instrs) + " -> " + std::to_string(fast.stats().instrs)
+                              << "\n";
+                }
+            }
+        }
+    }
+    std::cout << "IPSCCP benchmark test passed\n";
+}
+
+int main() {
+    testConstantArguments();
+    testSpecialization();
+    testConstantReturns();
+    testBenchmarks();
+    return 0;
+}
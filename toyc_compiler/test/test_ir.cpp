@@ -0,0 +1,258 @@
+// test_ir.cpp
+#include "driver.h"
+#include "ir.h"
+#include "lowering.h"
+#include "rvsim.h"
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static std::string readExample(const std::string &name) {
+    std::ifstream file(std::string(TOYC_EXAMPLES_DIR) + "/" + name);
+    assert(file && "cannot open example");
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+    return buffer.str();
+}
+
+// 用 IR 流水线编译并在模拟器中运行，返回 main 的结果
+static int runProgram(const std::string &src, int optLevel = 1) {
+    CompileOptions opts;
+    opts.optLevel = optLevel;
+    std::string asmText = compileSource(src, opts);
+    RiscvSim sim(asmText);
+    if (!sim.run()) {
+        std::cerr << asmText << "\nsimulation failed: " << sim.error() << "\n";
+        assert(false);
+    }
+    return sim.result();
+}
+
+static const char *kShortCircuitProgram =
+    "int hang() { while (1) { } return 0; }\n"
+    "int main() {\n"
+    "    int r = 0;\n"
+    "    if (0 && hang()) { r = 100; }\n"
+    "    if (1 || hang()) { r = r + 1; }\n"
+    "    int x = 5;\n"
+    "    if (!(x < 3) && x != 4) { r = r + 10; }\n"
+    "    int v = x > 3 && x < 10;\n"
+    "    int w = x > 7 || x == 5;\n"
+    "    int z = x < 7 || hang() == 0 && x < 3;\n"
+    "    if (v) { r = r + 100; }\n"
+    "    if (w) { r = r + 1000; }\n"
+    "    if (z) { r = r + 10000; }\n"
+    "    return r;\n"
+    "}\n";
+
+void testShortCircuit() {
+    assert(runProgram(kShortCircuitProgram) == 11111);
+    // && 在条件上下文中成为分支链，不再出现 and
+    auto module = lowerToIR("int f(int a, int b) { if (a > 0 && b > 0) { return 1; } return 0; }");
+    std::ostringstream oss;
+    ir::printModule(oss, *module);
+    assert(oss.str().find("land.rhs") != std::string::npos);
+    assert(oss.str().find(" and ") == std::string::npos);
+
+    // 只被分支使用的比较与分支合并
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource("int f(int i, int n) { while (i * i <= n) { i = i + 1; } return i; }", opts);
+    assert(asmText.find("slt") == std::string::npos);
+    assert(asmText.find("blt") != std::string::npos);
+    std::cout << "Short-circuit lowering test passed\n";
+}
+
+void testLowerExample() {
+    auto module = lowerToIR(readExample("test.c"));
+    std::string err;
+    bool ok = ir::verifyModule(*module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+    assert(module->functions.size() == 4);
+
+    ir::Function *gcd = module->getFunction("gcd");
+    assert(gcd && gcd->paramNames.size() == 2);
+    // 轮转后的循环：循环体有两个前驱（入口处的判断和底部的判断），底部的判断跳回循环体或退出
+    bool foundLoop = false;
+    for (auto &bb : gcd->blocks) {
+        if (bb->name.rfind("while.body", 0) == 0) assert(bb->preds.size() == 2);
+        if (bb->name.rfind("while.cond", 0) == 0) {
+            assert(bb->succs.size() == 2);
+            foundLoop = true;
+        }
+    }
+    assert(foundLoop);
+
+    std::ostringstream oss;
+    ir::printModule(oss, *module);
+    assert(oss.str().find("func i32 @gcd(a, b)") != std::string::npos);
+    assert(oss.str().find("call i32 @gcd(") != std::string::npos);
+    std::cout << "IR lowering test passed\n";
+}
+
+void testVerifierRejectsBrokenIR() {
+    auto module = lowerToIR("int main() { int x = 1; if (x) { x = 2; } return x; }");
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+
+    ir::Function &f = *module->functions[0];
+    // 删除终结指令
+    ir::Instr saved = f.blocks[0]->instrs.back();
+    f.blocks[0]->instrs.pop_back();
+    assert(!ir::verifyFunction(f, module.get(), err));
+    f.blocks[0]->instrs.push_back(saved);
+    assert(ir::verifyFunction(f, module.get(), err));
+
+    // 过期的前驱/后继列表
+    f.blocks[0]->succs.clear();
+    assert(!ir::verifyFunction(f, module.get(), err));
+    f.rebuildCFG();
+    assert(ir::verifyFunction(f, module.get(), err));
+
+    // 重复定义同一个虚拟寄存器
+    ir::Instr dup(ir::Opcode::Copy);
+    dup.dst = 0;
+    dup.ops = {ir::Value::imm(3)};
+    f.blocks[0]->instrs.insert(f.blocks[0]->instrs.begin(), dup);
+    f.blocks[0]->instrs.insert(f.blocks[0]->instrs.begin(), dup);
+    assert(!ir::verifyFunction(f, module.get(), err));
+    std::cout << "IR verifier test passed\n";
+}
+
+void testDeadCodeAfterReturn() {
+    auto module = lowerToIR("int main() { return 1; int y = 2; return y; }");
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    assert(module->functions[0]->blocks.size() == 1);
+    std::cout << "Unreachable block removal test passed\n";
+}
+
+void testBackendRunsExample() {
+    assert(runProgram(readExample("test.c")) == 5);
+    std::cout << "IR backend example test passed\n";
+}
+
+void testBackendPrograms() {
+    assert(runProgram("int fib(int n) { if (n <= 1) { return n; } return fib(n - 1) + fib(n - 2); }\n"
+                      "int main() { return fib(15); }") == 610);
+    assert(runProgram("int add(int a, int b) { return a + b; }\n"
+                      "int main() { return add(1, add(add(2, 3), add(4, 5))); }") == 15);
+    // 作用域遮蔽
+    assert(runProgram("int main() { int x = 1; { int x = 2; x = x + 1; } return x; }") == 1);
+    // break / continue
+    assert(runProgram("int main() { int i = 0; int s = 0;\n"
+                      "  while (1) { i = i + 1; if (i > 10) { break; } if (i % 2 == 0) { continue; } s = s + i; }\n"
+                      "  return s; }") == 25);
+    // 比较、逻辑运算与一元运算
+    assert(runProgram("int main() { int a = 3; int b = -4;\n"
+                      "  return (a < b) + 2 * (a > b) + 4 * (a <= 3) + 8 * (b >= a) + 16 * (a == 3)\n"
+                      "       + 32 * (a != b) + 64 * (a && b) + 128 * (0 || b) + 256 * !a + 512 * (-b == 4); }") ==
+           2 + 4 + 16 + 32 + 64 + 128 + 512);
+    assert(runProgram("int main() { return -7 / 2 * 10 + -7 % 2; }") == -31);
+    // void 函数与 8 个参数
+    assert(runProgram("void nop(int x) { return; }\n"
+                      "int sum8(int a, int b, int c, int d, int e, int f, int g, int h) {\n"
+                      "  return a + 2 * b + 3 * c + 4 * d + 5 * e + 6 * f + 7 * g + 8 * h; }\n"
+                      "int main() { nop(1); return sum8(1, 1, 1, 1, 1, 1, 1, 2); }") == 44);
+    std::cout << "IR backend programs test passed\n";
+}
+
+// 每个比较与常量组合按位编码，x 取边界附近的值，-O0 和 -O1 都与宿主计算对照
+void testImmediateOperands() {
+    std::string src =
+        "int f(int x) {\n"
+        "  return (x < 5) + 2 * (x <= 5) + 4 * (x > 5) + 8 * (x >= 5) + 16 * (x == 5) + 32 * (x != 0)\n"
+        "       + 64 * (3 < x) + 128 * (-2048 >= x) + 256 * (x > 2047) + 512 * (x == -7) + 1024 * (0 == x);\n"
+        "}\n"
+        "int g(int x) { return (x + 2047) * 8 - (x - -2048) + 3 * x + 305419896 - (x - 2048) * 2; }\n"
+        "int main() {\n"
+        "  int s = 0; int i = -3000;\n"
+        "  while (i < 3000) { s = s * 3 + f(i) + g(i); i = i + 499; }\n"
+        "  return s + f(5) + f(0) + f(-7) + f(2047) + f(2048) + f(-2048);\n"
+        "}\n";
+    auto f = [](int x) {
+        return (x < 5) + 2 * (x <= 5) + 4 * (x > 5) + 8 * (x >= 5) + 16 * (x == 5) + 32 * (x != 0) + 64 * (3 < x) +
+               128 * (-2048 >= x) + 256 * (x > 2047) + 512 * (x == -7) + 1024 * (0 == x);
+    };
+    auto g = [](int x) { return (x + 2047) * 8 - (x + 2048) + 3 * x + 305419896 - (x - 2048) * 2; };
+    uint32_t s = 0;
+    for (int i = -3000; i < 3000; i += 499) s = s * 3 + (uint32_t)f(i) + (uint32_t)g(i);
+    int expected = (int)(s + f(5) + f(0) + f(-7) + f(2047) + f(2048) + f(-2048));
+    assert(runProgram(src, 0) == expected);
+    assert(runProgram(src, 1) == expected);
+
+    // 计数器和与常量的比较不再先 li 再做寄存器运算；大常量拆成 lui + addi
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource(src, opts);
+    for (const char *op : {"addi", "slti", "xori", "slli", "seqz", "snez", "lui"}) {
+        assert(asmText.find(std::string("\t") + op + " ") != std::string::npos);
+    }
+    assert(asmText.find(", 305419896") == std::string::npos);
+    std::cout << "Immediate operand selection test passed\n";
+}
+
+// 在一个函数的汇编里 [from, to) 两个标签之间（to 为空时到函数结尾）有多少行包含 text
+static int countBetween(const std::string &asmText, const std::string &from, const std::string &to,
+                        const std::string &text) {
+    size_t begin = asmText.find(from + ":\n"), end = to.empty() ? asmText.find(".globl", begin)
+                                                                : asmText.find(to + ":\n", begin);
+    assert(begin != std::string::npos);
+    std::istringstream in(asmText.substr(begin, end == std::string::npos ? std::string::npos : end - begin));
+    int n = 0;
+    std::string line;
+    while (std::getline(in, line)) n += line.find(text) != std::string::npos;
+    return n;
+}
+
+// 循环里装入寄存器的常量（比较的 3000、除以 1009 的魔数）在不含调用的循环中只在循环前装一次；
+// 循环里有调用时常量要跨调用活着，每次迭代重新装入
+void testLoopConstants() {
+    std::string src = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int plain(int n) {
+    int i = 0;
+    int s = 0;
+    while (i < 3000) {
+        s = (s * 31 + i + n) % 1009;
+        i = i + 1;
+    }
+    return s;
+}
+int withCall(int n) {
+    int i = 0;
+    int s = 0;
+    while (i < 3000) {
+        s = (s * 31 + fib(i % 5) + n) % 1009;
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return plain(5) + withCall(2); }
+)";
+    assert(runProgram(src, 1) == runProgram(src, 0));
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource(src, opts);
+    // 3000 装入为 lui 1 + addi -1096
+    assert(countBetween(asmText, "plain", ".Lplain_while.body0", ", -1096") == 1);
+    assert(countBetween(asmText, ".Lplain_while.body0", ".Lplain_while.end2", ", -1096") == 0);
+    assert(countBetween(asmText, ".Lplain_while.body0", ".Lplain_while.end2", "lui ") == 0);
+    assert(countBetween(asmText, "withCall", ".LwithCall_while.body0", ", -1096") == 0);
+    assert(countBetween(asmText, ".LwithCall_while.body0", ".LwithCall_while.end2", ", -1096") == 1);
+    std::cout << "Loop constant hoisting test passed\n";
+}
+
+int main() {
+    testShortCircuit();
+    testLowerExample();
+    testVerifierRejectsBrokenIR();
+    testDeadCodeAfterReturn();
+    testBackendRunsExample();
+    testBackendPrograms();
+    testImmediateOperands();
+    testLoopConstants();
+    return 0;
+}
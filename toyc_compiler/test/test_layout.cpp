@@ -0,0 +1,159 @@
+// test_layout.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static int countLines(const std::string &asmText, const std::string &prefix) {
+    int n = 0;
+    std::istringstream in(asmText);
+    std::string line;
+    while (std::getline(in, line)) n += line.rfind("\t" + prefix, 0) == 0;
+    return n;
+}
+
+static CompileOptions withoutLayout(CompileOptions opts) {
+    opts.disabledPasses.insert("loop-rotate");
+    opts.disabledPasses.insert("block-placement");
+    return opts;
+}
+
+static const char *countedLoop = R"(
+int main() {
+    int i = 0;
+    int s = 0;
+    while (i < 1000) {
+        if (i % 3 == 0) { s = s + i; }
+        i = i + 1;
+    }
+    return s % 256;
+}
+)";
+
+void testLoopRotation() {
+    // 轮转后没有回到循环顶部的 j：循环底部的条件分支直接跳回循环体
+    const char *src = "int f(int n) { int i = 0; while (i < n) { i = i + 2; } return i; }\n"
+                      "int main() { return f(21); }";
+    for (int level : {0, 1}) {
+        CompileOptions opts;
+        opts.optLevel = level;
+        // f 不内联进 main，循环只出现一次
+        opts.disabledPasses.insert("inline");
+        std::string rotated = compileSource(src, opts), plain = compileSource(src, withoutLayout(opts));
+        assert(countLines(rotated, "j ") == 0);
+        assert(countLines(plain, "j ") == 1);
+        RiscvSim fast(rotated), slow(plain);
+        assert(fast.run() && slow.run() && fast.result() == 22 && slow.result() == 22);
+        // 11 次迭代：之前每次迭代一个不跳转的顶部判断加一个 j，之后只有底部一个跳转的分支；入口处多一次判断
+        assert(fast.stats().instrs + 8 <= slow.stats().instrs);
+        assert(fast.stats().takenBranches < slow.stats().takenBranches);
+    }
+
+    // IR：入口处的判断和底部的判断各一个 br，continue 跳到底部的判断
+    auto module = lowerToSSA("int f(int n) { int i = 0; int s = 0;\n"
+                             "  while (i < n) { i = i + 1; if (i == 3) { continue; } s = s + i; } return s; }");
+    ir::Function &f = *module->functions[0];
+    int brs = 0, backBrs = 0;
+    for (auto &bb : f.blocks) {
+        if (bb->terminator().op != ir::Opcode::Br) continue;
+        brs++;
+        backBrs += bb->name.rfind("while.cond", 0) == 0 && bb->terminator().blocks[0]->name.rfind("while.body", 0) == 0;
+    }
+    assert(brs == 3 && backBrs == 1);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    CompileOptions opts;
+    opts.optLevel = 1;
+    RiscvSim sim(compileSource("int f(int n) { int i = 0; int s = 0;\n"
+                               "  while (i < n) { i = i + 1; if (i == 3) { continue; } s = s + i; } return s; }\n"
+                               "int main() { return f(6); }",
+                               opts));
+    assert(sim.run() && sim.result() == 18);
+    std::cout << "Loop rotation test passed\n";
+}
+
+void testBlockPlacement() {
+    // 不轮转时 while.end 紧跟在判断之后，循环体里 if 的两个块被挤到函数末尾，每次迭代都要跳过去再跳回来
+    auto module = lowerToSSA(countedLoop, false);
+    ir::Function &main = *module->functions[0];
+    ir::LayoutStats stats;
+    assert(ir::placeBlocks(main, &stats));
+    assert(stats.fallThroughsAfter > stats.fallThroughsBefore);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    // 循环里的块排在 while.end 之前
+    bool seenEnd = false;
+    for (auto &bb : main.blocks) {
+        if (bb->name.rfind("while.end", 0) == 0) seenEnd = true;
+        if (bb->name.rfind("if.", 0) == 0) assert(!seenEnd);
+    }
+
+    // 已经是最好的顺序时不动
+    auto straight = lowerToSSA("int main() { int x = 1; if (x > 0) { x = 2; } return x; }");
+    ir::LayoutStats none;
+    assert(!ir::placeBlocks(*straight->functions[0], &none));
+    assert(none.fallThroughsAfter == none.fallThroughsBefore);
+    std::cout << "Block placement test passed\n";
+}
+
+void testTakenBranches() {
+    // 每次迭代的跳转数：之前是顶部判断之后的 j 加上跳到函数末尾的 if 块，之后只剩 if 本身的分支和回跳
+    CompileOptions opts;
+    opts.optLevel = 1;
+    RiscvSim fast(compileSource(countedLoop, opts)), slow(compileSource(countedLoop, withoutLayout(opts)));
+    assert(fast.run() && slow.run() && fast.result() == slow.result());
+    assert(slow.stats().takenBranches >= 2000);
+    assert(fast.stats().takenBranches <= 1700);
+
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(24) << "-O0 taken"
+              << std::setw(24) << "-O1 taken" << std::setw(24) << "-O1 instrs" << "\n";
+    for (auto &prog : benchmarkPrograms()) {
+        std::string cells[3];
+        for (int level : {0, 1}) {
+            CompileOptions o;
+            o.optLevel = level;
+            RiscvSim a(compileSource(prog.source, o)), b(compileSource(prog.source, withoutLayout(o)));
+            assert(a.run() && b.run());
+            assert(a.result() == prog.expected && b.result() == prog.expected);
+            assert(a.stats().takenBranches <= b.stats().takenBranches);
+            cells[level] = std::to_string(b.stats().takenBranches) + " -> " + std::to_string(a.stats().takenBranches);
+            if (level == 1) cells[2] = std::to_string(b.stats().instrs) + " -> " + std::to_string(a.stats().instrs);
+        }
+        std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(24) << cells[0]
+                  << std::setw(24) << cells[1] << std::setw(24) << cells[2] << "\n";
+    }
+    std::cout << "Taken branch test passed\n";
+}
+
+void testLoopAlignment() {
+    for (int level : {0, 1}) {
+        CompileOptions opts;
+        opts.optLevel = level;
+        opts.alignLoops = 16;
+        std::string asmText = compileSource(countedLoop, opts);
+        // 对齐放在循环头的标签之前
+        size_t align = asmText.find(".p2align 4\n");
+        assert(align != std::string::npos);
+        std::string next = asmText.substr(align + 11, asmText.find('\n', align + 11) - align - 11);
+        assert(next.find(':') != std::string::npos);
+        RiscvSim sim(asmText);
+        assert(sim.run() && sim.result() == 177);
+
+        opts.alignLoops = 0;
+        assert(compileSource(countedLoop, opts).find(".p2align") == std::string::npos);
+    }
+    std::cout << "Loop alignment test passed\n";
+}
+
+int main() {
+    testLoopRotation();
+    testBlockPlacement();
+    testTakenBranches();
+    testLoopAlignment();
+    return 0;
+}
@@ -0,0 +1,282 @@
+// test_licm.cpp
+#include "analysis.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static ir::LICMStats runLICM(ir::Module &module) {
+    ir::LICMStats stats;
+    auto pure = ir::findPureFunctions(module);
+    auto speculatable = ir::findSpeculatableFunctions(module, pure);
+    for (auto &f : module.functions) ir::hoistLoopInvariants(*f, &pure, &speculatable, &stats);
+    std::string err;
+    bool ok = ir::verifyModule(module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+    return stats;
+}
+
+// 循环中（任意一层）op 指令的条数
+static int countInLoops(const ir::Function &f, ir::Opcode op) {
+    ir::DominatorTree dt(f);
+    auto loops = ir::findNaturalLoops(dt);
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        bool inLoop = false;
+        for (auto &loop : loops) inLoop = inLoop || loop.contains(bb.get());
+        if (!inLoop) continue;
+        for (auto &instr : bb->instrs) n += instr.op == op;
+    }
+    return n;
+}
+
+static int countCallsInLoops(const ir::Function &f, const std::string &callee) {
+    ir::DominatorTree dt(f);
+    auto loops = ir::findNaturalLoops(dt);
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        bool inLoop = false;
+        for (auto &loop : loops) inLoop = inLoop || loop.contains(bb.get());
+        for (auto &instr : bb->instrs) n += inLoop && instr.op == ir::Opcode::Call && instr.callee == callee;
+    }
+    return n;
+}
+
+void testLoopsAndPreheaders() {
+    auto module = lowerToSSA(R"(
+int f(int n) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        int j = 0;
+        while (j < i) { s = s + j; j = j + 1; }
+        i = i + 1;
+    }
+    return s;
+}
+)");
+    ir::Function &f = *module->functions[0];
+    ir::DominatorTree dt(f);
+    auto loops = ir::findNaturalLoops(dt);
+    assert(loops.size() == 2);
+    // 内层在前
+    assert(loops[0].depth == 2 && loops[1].depth == 1);
+    assert(loops[1].contains(loops[0].header) && !loops[0].contains(loops[1].header));
+    assert(loops[0].latches.size() == 1 && loops[0].exitingBlocks().size() == 1);
+
+    // then 分支被 CFG 化简直接接到循环头上，循环头有两个循环外的前驱，需要新建前置块
+    auto twoEntries = lowerToSSA(R"(
+int g(int x) { return x; }
+int f(int c, int n) {
+    int i = 0;
+    if (c) { g(c); }
+    while (i < n) { i = i + n * 3; }
+    return i;
+}
+)");
+    for (auto &fn : twoEntries->functions) ir::simplifyCFG(*fn);
+    ir::LICMStats stats = runLICM(*twoEntries);
+    assert(stats.preheaders == 1 && stats.hoisted == 1);
+    assert(countInLoops(*twoEntries->getFunction("f"), ir::Opcode::Mul) == 0);
+    std::cout << "Natural loop and preheader test passed\n";
+}
+
+void testSpeculation() {
+    auto module = lowerToSSA(R"(
+int sq(int x) { return x * x; }
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int f(int n, int k, int d) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        s = s + k * 2 + i;
+        s = s + k / 3;
+        if (i > 5) {
+            s = s + k / d;
+            s = s + fib(k);
+        }
+        s = s + sq(k + 1);
+        s = s + putint(k);
+        i = i + 1;
+    }
+    return s;
+}
+int g(int n, int k, int d) {
+    int i = 0;
+    while (i < fib(k) + n / d) { i = i + 1; }
+    return i;
+}
+int h(int n, int k, int d) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        s = s + k / d + fib(k);
+        i = i + 1;
+    }
+    return s;
+}
+int p(int n, int k, int d) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        putint(i);
+        s = s + k / d + fib(k);
+        i = i + 1;
+    }
+    return s;
+}
+)");
+    runLICM(*module);
+    ir::Function &f = *module->getFunction("f");
+    // n * 2、除以非零常量、可以推测执行的纯函数调用提出去
+    assert(countInLoops(f, ir::Opcode::Mul) == 0);
+    assert(countCallsInLoops(f, "sq") == 0);
+    // 除数可能为 0 的除法和递归纯函数只在 i > 5 时执行，不能提到循环前；外部函数不是纯的
+    assert(countInLoops(f, ir::Opcode::Div) == 1);
+    assert(countCallsInLoops(f, "fib") == 1);
+    assert(countCallsInLoops(f, "putint") == 1);
+    // 循环条件每次进入循环都会求值：受保护的除法和调用都提出去
+    ir::Function &g = *module->getFunction("g");
+    assert(countInLoops(g, ir::Opcode::Div) == 0);
+    assert(countCallsInLoops(g, "fib") == 0);
+    // 轮转后的循环体只在入口处的判断成立时执行，前置块在判断之后：循环体里一定执行的也提出去
+    ir::Function &h = *module->getFunction("h");
+    assert(countInLoops(h, ir::Opcode::Div) == 0);
+    assert(countCallsInLoops(h, "fib") == 0);
+    // 同样一定执行，但前面先输出：fib 不返回或除以 0 时 putint 本该先输出，不能提到它前面
+    ir::Function &p = *module->getFunction("p");
+    assert(countInLoops(p, ir::Opcode::Div) == 1);
+    assert(countCallsInLoops(p, "fib") == 1);
+    std::cout << "LICM speculation safety test passed\n";
+}
+
+void testNestedLoops() {
+    // 只依赖外层不变量的 a * b 一路提到最外层循环之前
+    auto module = lowerToSSA(R"(
+int f(int n, int a, int b) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        int j = 0;
+        while (j < n) { s = s + a * b + i * 4; j = j + 1; }
+        i = i + 1;
+    }
+    return s;
+}
+)");
+    ir::LICMStats stats = runLICM(*module);
+    ir::Function &f = *module->functions[0];
+    ir::DominatorTree dt(f);
+    auto loops = ir::findNaturalLoops(dt);
+    assert(countInLoops(f, ir::Opcode::Mul) == 1);
+    // i * 4 只对内层不变，留在外层循环里
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) {
+            if (instr.op != ir::Opcode::Mul) continue;
+            assert(!loops[0].contains(bb.get()));
+        }
+    }
+    assert(stats.hoisted >= 3);
+    std::cout << "Nested loop hoisting test passed\n";
+}
+
+// 循环多、不变量多的程序：模拟器里的动态指令数已经按循环次数加权
+static const TestProgram loopPrograms[] = {
+    {"invariant", R"(
+int work(int n, int k) {
+    int s = 0;
+    int i = 0;
+    while (i < n) {
+        s = (s + k * 13 + (k + 5) * (k - 2) + i) % 10007;
+        i = i + 1;
+    }
+    return s;
+}
+int main() { return work(300, 7) % 256; }
+)", 87},
+    {"matrix", R"(
+int cell(int r, int c) { return r * 31 + c * 17; }
+int main() {
+    int n = 24;
+    int total = 0;
+    int i = 0;
+    while (i < n) {
+        int j = 0;
+        while (j < n) {
+            total = total + cell(i, j) % (n * 2 + 1) + i * n;
+            j = j + 1;
+        }
+        i = i + 1;
+    }
+    return total % 256;
+}
+)", 241},
+    {"scaled", R"(
+int main() {
+    int total = 0;
+    int m = 1;
+    while (m < 120) {
+        int k = 0;
+        while (k < 40) {
+            total = total + k * (m * m) + 5000 / m;
+            k = k + 1;
+        }
+        m = m + 1;
+    }
+    return total % 256;
+}
+)", 192},
+};
+
+void testBenchmark() {
+    CompileOptions opts;
+    opts.optLevel = 1;
+    // 内联会把常量实参传播进循环，不变量直接折叠掉，看不到外提本身的效果
+    opts.disabledPasses.insert("inline");
+    // SCEV 要用 LICM 准备的前置块，它把乘法换成两条加法，动态指令数反而变多
+    opts.disabledPasses.insert("scev");
+    CompileOptions plain = opts;
+    plain.disabledPasses.insert("licm");
+
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    programs.insert(programs.end(), std::begin(loopPrograms), std::end(loopPrograms));
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(10) << "hoisted"
+              << std::setw(24) << "dynamic instrs" << "\n";
+    for (auto &prog : programs) {
+        std::ostringstream report;
+        CompileOptions reported = opts;
+        reported.report = &report;
+        RiscvSim fast(compileSource(prog.source, reported)), slow(compileSource(prog.source, plain));
+        assert(fast.run() && slow.run());
+        assert(fast.result() == prog.expected && slow.result() == prog.expected);
+        assert(fast.stats().instrs <= slow.stats().instrs);
+
+        int hoisted = 0;
+        std::istringstream lines(report.str());
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.rfind("licm: ", 0) == 0) hoisted += std::stoi(line.substr(line.find(": ", 6) + 2));
+        }
+        // 专门的循环程序必须真的外提了指令，并且因此变快
+        bool loopHeavy = &prog >= &programs[programs.size() - std::size(loopPrograms)];
+        if (loopHeavy) assert(hoisted > 0 && fast.stats().instrs < slow.stats().instrs);
+        std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(10) << hoisted
+                  << std::setw(24)
+                  << std::to_string(slow.stats().instrs) + " -> " + std::to_string(fast.stats().instrs) << "\n";
+    }
+    std::cout << "LICM benchmark test passed\n";
+}
+
+int main() {
+    testLoopsAndPreheaders();
+    testSpeculation();
+    testNestedLoops();
+    testBenchmark();
+    return 0;
+}
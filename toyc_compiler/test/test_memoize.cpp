@@ -0,0 +1,203 @@
+// test_memoize.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+static int countCalls(const ir::Function &f, const std::string &callee) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == ir::Opcode::Call && instr.callee == callee;
+    }
+    return n;
+}
+
+static CompileOptions withoutMemoize(CompileOptions opts) {
+    opts.disabledPasses.insert("memoize");
+    return opts;
+}
+
+void testRewrite() {
+    const char *src = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int binom(int n, int k) { if (k == 0 || k == n) { return 1; } return binom(n - 1, k - 1) + binom(n - 1, k); }
+int sum(int n) { if (n == 0) { return 0; } return n + sum(n - 1); }
+int noisy(int n) { if (n < 2) { putint(n); return n; } return noisy(n - 1) + noisy(n - 2); }
+int even(int n) { if (n == 0) { return 1; } return odd(n - 1) * odd(n - 1); }
+int odd(int n) { if (n == 0) { return 0; } return even(n - 1) * even(n - 1); }
+int three(int a, int b, int c) { if (a < 1) { return b + c; } return three(a - 1, c, b) + three(a - 2, b, c); }
+int split(int n) { if (n < 2) { return n; } if (n % 2) { return split(n - 1) + 1; } return split(n - 2) * 2; }
+int grow(int n) { if (n < 0 || n > 40) { return n; } return grow(n + 1) + grow(n + 3); }
+int ack(int m, int n) { if (m == 0) { return n + 1; } if (n == 0) { return ack(m - 1, 1); } return ack(m - 1, ack(m, n - 1)); }
+int main() {
+    return fib(25) + binom(20, 10) + sum(4) + noisy(3) + even(2) + three(3, 1, 2) + split(30) + grow(0) + ack(2, 3);
+}
+)";
+    auto module = lowerToSSA(src);
+    std::ostringstream remarks;
+    // 线性递归（包括两处自调用分在两个分支里）、有副作用、互相递归、形参太多、实参会变大的函数，
+    // 以及只有一处自调用不在尾位置的 ack 都不动
+    assert(ir::memoizeRecursiveFunctions(*module, &remarks) == 2);
+    std::string err;
+    bool ok = ir::verifyModule(*module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+    assert(module->globals.size() == 4);
+    assert(module->getGlobal("fib.memo")->words == 4096 && module->getGlobal("binom.memo.valid")->words == 4096);
+    // 包装在原名字上，原函数体改名为 internal 的 .body，其中的自调用经过包装
+    ir::Function *fib = module->getFunction("fib"), *body = module->getFunction("fib.body");
+    assert(fib && body && body->internal && !fib->internal);
+    assert(countCalls(*fib, "fib.body") == 2 && countCalls(*body, "fib") == 2);
+    assert(!module->getFunction("sum.body") && !module->getFunction("noisy.body") && !module->getFunction("three.body"));
+    assert(!module->getFunction("split.body") && !module->getFunction("grow.body") && !module->getFunction("ack.body"));
+    assert(remarks.str().find("memoize: @fib: cached in @fib.memo for 0 <= n < 4096\n") != std::string::npos);
+    assert(remarks.str().find("memoize: @binom: cached in @binom.memo for 0 <= n < 64, 0 <= k < 64\n") !=
+           std::string::npos);
+
+    // 表在 .bss 中，IR 中打印为 global
+    std::ostringstream ir;
+    ir::printModule(ir, *module);
+    assert(ir.str().find("global @fib.memo[4096]\n") != std::string::npos);
+    assert(ir.str().find("gload @fib.memo.valid[") != std::string::npos);
+
+    // 只在 -O3 做
+    CompileOptions opts;
+    opts.optLevel = 2;
+    std::ostringstream report;
+    opts.report = &report;
+    std::string asmText = compileSource(src, opts);
+    assert(report.str().find("memoize:") == std::string::npos && asmText.find(".bss") == std::string::npos);
+    opts.optLevel = 3;
+    asmText = compileSource(src, opts);
+    assert(report.str().find("memoize: @fib:") != std::string::npos);
+    assert(asmText.find(".bss\n") != std::string::npos && asmText.find("fib.memo:\n\t.zero 16384\n") != std::string::npos);
+    std::cout << "Memoization rewrite test passed\n";
+}
+
+// 调用树小或者实参在编译期不知道时查表的开销比省下的调用多，不做
+void testProfitability() {
+    const char *fib = "int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }\n";
+    const char *mains[] = {
+        "int main() { return fib(5); }",
+        "int main() { int i = 0; int s = 0; while (i < 8) { s = s + fib(i); i = i + 1; } return s; }",
+    };
+    for (const char *main : mains) {
+        auto module = lowerToSSA(std::string(fib) + main);
+        assert(ir::memoizeRecursiveFunctions(*module) == 0);
+        assert(!module->getFunction("fib.body") && module->globals.empty());
+    }
+    auto big = lowerToSSA(std::string(fib) + "int main() { return fib(5) + fib(18); }");
+    assert(ir::memoizeRecursiveFunctions(*big) == 1);
+    std::cout << "Memoization profitability test passed\n";
+}
+
+// -O3 在测试程序集和 examples/test.c 上都不比 -O2 慢
+void testNotSlower() {
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    std::ifstream file(std::string(TOYC_EXAMPLES_DIR) + "/test.c");
+    std::stringstream example;
+    example << file.rdbuf();
+    std::string exampleSource = example.str();
+    programs.push_back({"test.c", exampleSource.c_str(), 5});
+    for (auto &prog : programs) {
+        CompileOptions o2, o3;
+        o2.optLevel = 2;
+        o3.optLevel = 3;
+        RiscvSim slow(compileSource(prog.source, o2)), fast(compileSource(prog.source, o3));
+        assert(slow.run() && fast.run());
+        assert(slow.result() == prog.expected && fast.result() == prog.expected);
+        if (fast.stats().instrs > slow.stats().instrs) {
+            std::cerr << prog.name << ": -O3 " << fast.stats().instrs << " > -O2 " << slow.stats().instrs << "\n";
+            assert(false);
+        }
+    }
+    std::cout << "Memoization not-slower test passed\n";
+}
+
+// 与不做记忆化的结果逐个比较：表内、表外、负数实参，结果为 0 的项，以及两个形参的函数
+void testDifferential() {
+    const char *functions = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int trib(int n) { if (n <= 0) { return 0; } if (n < 3) { return 1; } return (trib(n - 1) + trib(n - 2) + trib(n - 3)) % 7; }
+int binom(int n, int k) { if (k < 0 || k > n) { return 0; } if (k == 0 || k == n) { return 1; } return binom(n - 1, k - 1) + binom(n - 1, k); }
+int paths(int r, int c) { if (r == 0 || c == 0) { return 1; } return (paths(r - 1, c) + paths(r, c - 1) * 3) % 1009; }
+int ack(int m, int n) { if (m == 0) { return n + 1; } if (n == 0) { return ack(m - 1, 1); } return ack(m - 1, ack(m, n - 1)); }
+)";
+    const char *calls[] = {
+        "fib(0) + fib(1) + fib(2) * 3", "fib(15) - fib(14)", "fib(-5) + fib(-1)",
+        "trib(20) * 10 + trib(6)", "trib(-2) + trib(3)",
+        "binom(10, 4) + binom(12, 6) % 100", "binom(5, -1) + binom(3, 7) + binom(-2, -3)",
+        "paths(6, 7) + paths(0, 5)", "paths(63, 1) % 100 + paths(64, 1) % 100",
+        "ack(2, 3) * 100 + ack(3, 3)", "ack(1, 70) + ack(0, 80)",
+    };
+    int checked = 0;
+    for (const char *call : calls) {
+        std::string src = std::string(functions) + "int main() { return " + call + "; }\n";
+        for (int jobs : {1, 3}) {
+            CompileOptions opts;
+            opts.optLevel = 3;
+            opts.jobs = jobs;
+            RiscvSim memo(compileSource(src, opts)), plain(compileSource(src, withoutMemoize(opts)));
+            CompileOptions o2;
+            o2.optLevel = 2;
+            RiscvSim reference(compileSource(src, o2));
+            assert(memo.run() && plain.run() && reference.run());
+            if (memo.result() != reference.result() || plain.result() != reference.result()) {
+                std::cerr << call << ": " << memo.result() << " != " << reference.result() << "\n";
+                assert(false);
+            }
+            checked++;
+        }
+    }
+    for (auto &prog : benchmarkPrograms()) {
+        CompileOptions opts;
+        opts.optLevel = 3;
+        RiscvSim sim(compileSource(prog.source, opts));
+        assert(sim.run() && sim.result() == prog.expected);
+        checked++;
+    }
+    std::cout << "Memoization differential test passed (" << checked << " programs)\n";
+}
+
+void testSpeedup() {
+    // 指数的调用树变成线性：fib(24) 的调用次数从 75025 次降到几十次
+    const char *src = R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int main() { return fib(24) % 256; }
+)";
+    CompileOptions opts;
+    opts.optLevel = 3;
+    RiscvSim fast(compileSource(src, opts)), slow(compileSource(src, withoutMemoize(opts)));
+    assert(fast.run() && slow.run() && fast.result() == slow.result() && fast.result() == 46368 % 256);
+    assert(fast.stats().calls < 100 && slow.stats().calls > 10000);
+    assert(fast.stats().instrs * 100 < slow.stats().instrs);
+
+    // 超出表的范围时按普通的递归算，递归下降到表内以后又能查表
+    const char *big = R"(
+int fib(int n) { if (n < 2) { return n; } return (fib(n - 1) + fib(n - 2)) % 10007; }
+int main() { return fib(4100); }
+)";
+    int a = 0, b = 1;
+    for (int i = 0; i < 4100; i++) {
+        int c = (a + b) % 10007;
+        a = b;
+        b = c;
+    }
+    RiscvSim outside(compileSource(big, opts));
+    assert(outside.run() && outside.result() == a);
+    std::cout << "Memoization speedup test passed\n";
+}
+
+int main() {
+    testRewrite();
+    testProfitability();
+    testNotSlower();
+    testDifferential();
+    testSpeedup();
+    return 0;
+}
@@ -0,0 +1,252 @@
+// test_regalloc.cpp
+#include "backend.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "regalloc.h"
+#include "rvsim.h"
+#include <algorithm>
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static RiscvSim::Stats runProgram(const TestProgram &prog, const CompileOptions &opts) {
+    std::string asmText = compileSource(prog.source, opts);
+    RiscvSim sim(asmText);
+    bool ok = sim.run();
+    if (!ok || sim.result() != prog.expected) {
+        std::cerr << asmText << "\n" << prog.name << ": " << (ok ? "wrong result " + std::to_string(sim.result())
+                                                                 : sim.error()) << "\n";
+        assert(false);
+    }
+    return sim.stats();
+}
+
+// 返回 [from, to) 两个标签之间的汇编行
+static std::vector<std::string> linesBetween(const std::string &asmText, const std::string &from, const std::string &to) {
+    std::istringstream in(asmText);
+    std::vector<std::string> lines;
+    std::string line;
+    bool inside = false;
+    while (std::getline(in, line)) {
+        if (line == from + ":") inside = true;
+        else if (line == to + ":") inside = false;
+        if (inside) lines.push_back(line);
+    }
+    return lines;
+}
+
+void testLoopDepth() {
+    auto module = lowerToIR("int main() { int i = 0; int s = 0; while (i < 10) { int j = 0;\n"
+                        "  while (j < i) { s = s + j; j = j + 1; } i = i + 1; } return s; }");
+    std::ostringstream oss;
+    RiscvBackend backend(oss);
+    auto mf = backend.selectFunction(*module->functions[0]);
+    mf->rebuildCFG();
+    mf->computeLoopDepth();
+    // 轮转后的循环：循环体是循环头，底部的判断跳回循环体
+    int checked = 0;
+    for (auto &bb : mf->blocks) {
+        int expected = 0;
+        if (bb->label.find("while.body0") != std::string::npos) expected = 1;
+        if (bb->label.find("while.cond1") != std::string::npos) expected = 1;
+        if (bb->label.find("while.body3") != std::string::npos) expected = 2;
+        if (bb->label.find("while.cond4") != std::string::npos) expected = 2;
+        if (bb->label.find("while.end5") != std::string::npos) expected = 1;
+        if (bb->label.find("while.end2") != std::string::npos) expected = -1;
+        if (!expected) continue;
+        assert(bb->loopDepth == std::max(expected, 0));
+        checked++;
+    }
+    assert(checked == 6);
+    assert(mf->blocks.front()->loopDepth == 0);
+    std::cout << "Loop depth test passed\n";
+}
+
+// 两段汇编之间没有 lw/sw
+static bool noMemoryAccess(const std::vector<std::string> &lines) {
+    for (auto &line : lines) {
+        if (line.find("\tlw ") != std::string::npos || line.find("\tsw ") != std::string::npos) return false;
+    }
+    return true;
+}
+
+void testHotLoopsInRegisters() {
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource(benchmarkPrograms()[1].source, opts);
+    // gcd 的循环和内联了 gcd 的 main 的两层循环都不应访问内存
+    for (auto &[from, to] : {std::pair<std::string, std::string>{".Lgcd_while.body0", ".Lgcd_while.end2"},
+                             {".Lmain_while.body0", ".Lmain_while.end2"}}) {
+        auto lines = linesBetween(asmText, from, to);
+        assert(!lines.empty());
+        if (!noMemoryAccess(lines)) {
+            std::cerr << asmText;
+            assert(false);
+        }
+    }
+    // gcd 是不需要栈的叶子函数，不建立栈帧；内联之后 main 也是
+    assert(asmText.find("sp") == std::string::npos);
+
+    // fib 递归，不会被内联：main 的循环里留着调用，跨调用的 i、s 放在被调用者保存寄存器里，由序言保存
+    const TestProgram withCall = {"call-in-loop", R"(
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int main() {
+    int i = 0;
+    int s = 0;
+    while (i < 300) {
+        s = s + fib(i % 10) * i;
+        i = i + 1;
+    }
+    return s;
+}
+)", [] {
+        int fib[10] = {0, 1};
+        for (int k = 2; k < 10; k++) fib[k] = fib[k - 1] + fib[k - 2];
+        int s = 0;
+        for (int i = 0; i < 300; i++) s += fib[i % 10] * i;
+        return s;
+    }()};
+    runProgram(withCall, opts);
+    asmText = compileSource(withCall.source, opts);
+    auto loop = linesBetween(asmText, ".Lmain_while.body0", ".Lmain_while.end2");
+    assert(!loop.empty() && asmText.find("\tcall fib") != std::string::npos);
+    if (!noMemoryAccess(loop)) {
+        std::cerr << asmText;
+        assert(false);
+    }
+    assert(asmText.find("sw s1,") != std::string::npos);
+    std::cout << "Hot loop register test passed\n";
+}
+
+void testRematerialization() {
+    // 30 个同时活跃的常量超过可分配寄存器数，只能重新物化而不是装载
+    mir::MFunction mf;
+    mf.name = "f";
+    mf.blocks.push_back(std::make_unique<mir::MBlock>("f"));
+    auto &instrs = mf.blocks[0]->instrs;
+    std::vector<int> vals;
+    for (int i = 0; i < 30; i++) {
+        vals.push_back(mf.newVReg());
+        instrs.emplace_back("li", std::vector<mir::MOperand>{mir::MOperand::r(vals.back()), mir::MOperand::i(i * 3)});
+    }
+    int acc = mf.newVReg();
+    instrs.emplace_back("li", std::vector<mir::MOperand>{mir::MOperand::r(acc), mir::MOperand::i(0)});
+    for (int i = 29; i >= 0; i--) {
+        instrs.emplace_back("add", std::vector<mir::MOperand>{mir::MOperand::r(acc), mir::MOperand::r(acc),
+                                                              mir::MOperand::r(vals[i])});
+    }
+    instrs.emplace_back("mv", std::vector<mir::MOperand>{mir::MOperand::r(mir::A0), mir::MOperand::r(acc)});
+    mir::MInstr ret("ret");
+    ret.implicitUses.push_back(mir::A0);
+    instrs.push_back(std::move(ret));
+
+    mir::allocateLinearScan(mf);
+    assert(mf.frameObjects.empty());
+    for (auto &instr : mf.blocks[0]->instrs) {
+        assert(instr.op != "lw" && instr.op != "sw");
+        for (auto &o : instr.ops) assert(!o.isReg() || !mir::isVirtReg(o.reg));
+    }
+    std::cout << "Rematerialization test passed\n";
+}
+
+void testAgainstSpillAll() {
+    CompileOptions linearScan;
+    linearScan.optLevel = 1;
+    CompileOptions spillAll = linearScan;
+    spillAll.disabledPasses.insert("regalloc");
+
+    for (auto &prog : benchmarkPrograms()) {
+        RiscvSim::Stats slow = runProgram(prog, spillAll);
+        RiscvSim::Stats fast = runProgram(prog, linearScan);
+        assert(fast.loads + fast.stores < slow.loads + slow.stores);
+        assert(fast.instrs < slow.instrs);
+        std::cout << "  " << prog.name << ": instrs " << slow.instrs << " -> " << fast.instrs << ", loads+stores "
+                  << slow.loads + slow.stores << " -> " << fast.loads + fast.stores << "\n";
+    }
+    std::cout << "Linear scan vs spill-all test passed\n";
+}
+
+void testLargeFrame() {
+    // 600 个跨调用活跃的值都要溢出到栈上：帧超过 2048 字节，sp 的调整和远处的栈槽都要经过临时寄存器
+    std::string src = "int g(int x) { return x * 3 + 1; }\nint main() {\n";
+    for (int i = 0; i < 600; i++) src += "    int v" + std::to_string(i) + " = g(" + std::to_string(i) + ");\n";
+    src += "    return v0";
+    for (int i = 1; i < 600; i++) src += " + v" + std::to_string(i);
+    src += ";\n}\n";
+    TestProgram prog{"large-frame", src.c_str(), 3 * 599 * 600 / 2 + 600};
+    for (int level : {1, 2}) {
+        CompileOptions opts;
+        opts.optLevel = level;
+        std::string asmText = compileSource(prog.source, opts);
+        assert(asmText.find("add sp, sp, t0") != std::string::npos);
+        assert(asmText.find("add s0, sp, s0") != std::string::npos);
+        runProgram(prog, opts);
+    }
+    std::cout << "Large frame test passed\n";
+}
+
+struct AllocResult {
+    BackendStats stats;
+    RiscvSim::Stats dynamic;
+    int moves = 0;
+};
+
+static AllocResult runWithAllocator(const TestProgram &prog, mir::RegAllocKind kind) {
+    auto module = lowerToIR(prog.source);
+    for (auto &f : module->functions) ir::promoteMemoryToRegisters(*f);
+    std::ostringstream oss;
+    RiscvBackend backend(oss, kind);
+    backend.emitModule(*module);
+    RiscvSim sim(oss.str());
+    bool ok = sim.run();
+    if (!ok || sim.result() != prog.expected) {
+        std::cerr << oss.str() << "\n" << prog.name << ": " << (ok ? "wrong result" : sim.error()) << "\n";
+        assert(false);
+    }
+    AllocResult result{backend.stats(), sim.stats(), 0};
+    std::istringstream in(oss.str());
+    std::string line;
+    while (std::getline(in, line)) result.moves += line.rfind("\tmv ", 0) == 0;
+    return result;
+}
+
+// 线性扫描与图着色的对照：静态溢出指令数、静态 mv 数和动态指令数
+void testGraphColoringReport() {
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(16) << "spills(LS/GC)"
+              << std::setw(16) << "moves(LS/GC)" << std::setw(24) << "dynamic instrs(LS/GC)" << "\n";
+    uint64_t lsDynamic = 0, gcDynamic = 0;
+    int lsMoves = 0, gcMoves = 0;
+    for (auto &prog : benchmarkPrograms()) {
+        AllocResult ls = runWithAllocator(prog, mir::RegAllocKind::LinearScan);
+        AllocResult gc = runWithAllocator(prog, mir::RegAllocKind::GraphColoring);
+        std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(16)
+                  << std::to_string(ls.stats.spillInstrs) + "/" + std::to_string(gc.stats.spillInstrs) << std::setw(16)
+                  << std::to_string(ls.moves) + "/" + std::to_string(gc.moves) << std::setw(24)
+                  << std::to_string(ls.dynamic.instrs) + "/" + std::to_string(gc.dynamic.instrs) << "\n";
+        lsDynamic += ls.dynamic.instrs;
+        gcDynamic += gc.dynamic.instrs;
+        lsMoves += ls.moves;
+        gcMoves += gc.moves;
+    }
+    // 合并应当消掉更多复制，整体动态指令数不应变差
+    assert(gcMoves <= lsMoves);
+    assert(gcDynamic <= lsDynamic);
+
+    CompileOptions o2;
+    o2.optLevel = 2;
+    for (auto &prog : benchmarkPrograms()) runProgram(prog, o2);
+    std::cout << "Graph coloring report test passed\n";
+}
+
+int main() {
+    testLoopDepth();
+    testHotLoopsInRegisters();
+    testRematerialization();
+    testAgainstSpillAll();
+    testLargeFrame();
+    testGraphColoringReport();
+    return 0;
+}
@@ -0,0 +1,150 @@
+// test_sccp.cpp
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+static ir::SCCPStats runSCCP(ir::Module &module) {
+    ir::SCCPStats stats;
+    for (auto &f : module.functions) ir::sparseConditionalConstantPropagation(*f, &stats);
+    std::string err;
+    bool ok = ir::verifyModule(module, err);
+    if (!ok) std::cerr << err << "\n";
+    assert(ok);
+    return stats;
+}
+
+static int countOps(const ir::Function &f, ir::Opcode op) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == op;
+    }
+    return n;
+}
+
+// 函数中唯一一条 ret 的返回值
+static ir::Value returnValue(const ir::Function &f) {
+    assert(countOps(f, ir::Opcode::Ret) == 1);
+    for (auto &bb : f.blocks) {
+        if (bb->terminator().op == ir::Opcode::Ret) return bb->terminator().ops[0];
+    }
+    return ir::Value();
+}
+
+// 只剩一条 jmp 链（合并留给后面的 CFG 化简），最后返回常量 expected
+static bool returnsConstant(const ir::Function &f, int expected) {
+    if (countOps(f, ir::Opcode::Br) != 0) return false;
+    for (auto &bb : f.blocks) {
+        if (bb->instrs.size() != 1) return false;
+    }
+    return returnValue(f) == ir::Value::imm(expected);
+}
+
+void testConstantBranches() {
+    // 与 examples/test.c 一样先给 x、y 赋常量再分支：else 分支和其中的循环整个被删掉
+    auto module = lowerToSSA(R"(
+int work(int n) { return n * 3; }
+int main() {
+    int x = 10;
+    int y = 15;
+    int result = 0;
+    if (x < y) {
+        result = x + y;
+    } else {
+        int i = 0;
+        while (i < y) {
+            result = result + work(i);
+            i = i + 1;
+        }
+    }
+    if (result == 25) {
+        result = result * 2;
+    }
+    return result;
+}
+)");
+    ir::SCCPStats stats = runSCCP(*module);
+    ir::Function &main = *module->getFunction("main");
+    assert(stats.branchesFolded == 2);
+    assert(stats.blocksRemoved >= 4);
+    assert(countOps(main, ir::Opcode::Call) == 0);
+    assert(returnsConstant(main, 50));
+    std::cout << "Constant branch test passed\n";
+}
+
+void testConstantsThroughPhis() {
+    // 循环里的 k 只在 k != 5 时改变：乐观假设 k 恒为 5 成立，分支和加法都被删掉。
+    // 只做常量传播或只删不可达块都得不到这个结果
+    auto module = lowerToSSA(R"(
+int main() {
+    int i = 0;
+    int k = 5;
+    while (i < 10) {
+        if (k != 5) {
+            k = k + 1;
+        }
+        i = i + 1;
+    }
+    return k;
+}
+)");
+    ir::SCCPStats stats = runSCCP(*module);
+    ir::Function &main = *module->functions[0];
+    // 轮转后循环入口处的 0 < 10 也被折叠
+    assert(stats.branchesFolded == 2 && stats.blocksRemoved == 1);
+    assert(returnValue(main) == ir::Value::imm(5));
+    // 循环本身保留：i 不是常量
+    assert(countOps(main, ir::Opcode::Br) == 1);
+
+    // 两条路径上的值相同时 phi 也是常量；不同时保留
+    auto same = lowerToSSA("int main() { int p = 1; int a = 0; if (p > 0) { a = 3; } else { a = 3; } return a * 2; }");
+    runSCCP(*same);
+    assert(returnsConstant(*same->functions[0], 6));
+    auto differ = lowerToSSA("int f(int p) { int a = 3; if (p > 0) { a = 4; } return a; }");
+    runSCCP(*differ);
+    assert(countOps(*differ->functions[0], ir::Opcode::Phi) == 1);
+    std::cout << "Phi propagation test passed\n";
+}
+
+void testRuntimeSemantics() {
+    // 除以 0 不折叠，回绕与 RV32 一致
+    auto module = lowerToSSA("int main() { int z = 0; int m = 2147483647; int q = 7 / z; return m + 1; }");
+    runSCCP(*module);
+    ir::Function &main = *module->functions[0];
+    assert(countOps(main, ir::Opcode::Div) == 1);
+    assert(returnValue(main) == ir::Value::imm(-2147483647 - 1));
+    std::cout << "SCCP runtime semantics test passed\n";
+}
+
+void testProgramsAndReport() {
+    CompileOptions opts;
+    opts.optLevel = 1;
+    // 不折叠 AST，观察 SCCP 自己的效果
+    opts.disabledPasses.insert("fold");
+    CompileOptions plain = opts;
+    plain.disabledPasses.insert("sccp");
+    for (auto &prog : benchmarkPrograms()) {
+        RiscvSim fast(compileSource(prog.source, opts)), slow(compileSource(prog.source, plain));
+        assert(fast.run() && slow.run());
+        assert(fast.result() == prog.expected && slow.result() == prog.expected);
+        assert(fast.stats().instrs <= slow.stats().instrs);
+    }
+
+    std::ostringstream report;
+    opts.report = &report;
+    compileSource("int main() { int x = 10; int y = 15; if (x > y) { return x; } return y; }", opts);
+    assert(report.str().find("sccp: @main: 1 constants propagated, 1 branches folded, 1 blocks removed\n") != std::string::npos);
+    std::cout << "SCCP program and report test passed\n";
+}
+
+int main() {
+    testConstantBranches();
+    testConstantsThroughPhis();
+    testRuntimeSemantics();
+    testProgramsAndReport();
+    return 0;
+}
@@ -0,0 +1,212 @@
+// test_scev.cpp
+#include "analysis.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include "strength.h"
+#include <cassert>
+#include <iostream>
+#include <sstream>
+
+static CompileOptions withoutSCEV(CompileOptions opts) {
+    opts.disabledPasses.insert("scev");
+    return opts;
+}
+
+static bool isRec(const ir::AddRec &r, int c0, int c1, int c2) {
+    return r.coeffs[0].isConstant() && r.coeffs[0].constant == c0 && r.coeffs[1].isConstant() &&
+           r.coeffs[1].constant == c1 && r.coeffs[2].isConstant() && r.coeffs[2].constant == c2;
+}
+
+void testEvolution() {
+    auto module = lowerToSSA(R"(
+int sum(int n) { int s = 0; int i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }
+int down(int n) { int s = 7; while (n > 0) { s = s + 3; n = n - 1; } return s; }
+int hop(int n) { int i = 0; while (i != n) { i = i + 2; } return i; }
+int grow(int n) { int i = 1; int k = 0; while (i < n) { i = i * 2; k = k + 1; } return k; }
+int fixed() { int i = 3; int s = 0; while (i <= 30) { s = s + i * i; i = i + 4; } return s; }
+)");
+    auto analyse = [&](const std::string &name, auto check) {
+        ir::Function &f = *module->getFunction(name);
+        ir::DominatorTree dt(f);
+        auto loops = ir::findNaturalLoops(dt);
+        assert(loops.size() == 1);
+        ir::ScalarEvolution se(f, loops);
+        std::vector<ir::AddRec> phis;
+        for (auto &instr : loops[0].header->instrs) {
+            if (instr.op != ir::Opcode::Phi) continue;
+            auto rec = se.evolution(ir::Value::reg(instr.dst), loops[0]);
+            if (rec) phis.push_back(*rec);
+        }
+        check(phis, se.backedgeCount(loops[0], dt));
+    };
+
+    // IRGen 生成的循环在底部判断：i = {0,+,1}，s = {0,+,0,+,1} 即 k(k-1)/2；
+    // 出口比较的是 i + 1 = {1,+,1}，回边执行 n - 1 次（入口处已经判断过 0 < n）
+    analyse("sum", [](const std::vector<ir::AddRec> &phis, std::optional<ir::BackedgeCount> count) {
+        assert(phis.size() == 2);
+        int found = 0;
+        for (auto &r : phis) found += isRec(r, 0, 1, 0) * 1 + isRec(r, 0, 0, 1) * 2;
+        assert(found == 3);
+        assert(count && count->lower.isConstant() && count->lower.constant == 1 &&
+               count->upper.constant == 0 && count->upper.terms.size() == 1 &&
+               count->upper.terms.begin()->second == 1);
+    });
+    // 递减的形参：n = {n0,+,-1}，出口比较 n - 1 > 0，回边次数为 n0 - 1
+    analyse("down", [](const std::vector<ir::AddRec> &phis, std::optional<ir::BackedgeCount> count) {
+        assert(phis.size() == 2);
+        bool counter = false;
+        for (auto &r : phis) counter = counter || isRec(r, 7, 3, 0);
+        assert(counter);
+        assert(count && count->lower.isZero() && count->upper.terms.size() == 1);
+    });
+    // != 比较时步长 2 可能跨过 n，乘法不是加法递推：都算不出次数
+    analyse("hop", [](const std::vector<ir::AddRec> &phis, std::optional<ir::BackedgeCount> count) {
+        assert(phis.size() == 1 && isRec(phis[0], 0, 2, 0) && !count);
+    });
+    analyse("grow", [](const std::vector<ir::AddRec> &phis, std::optional<ir::BackedgeCount> count) {
+        assert(phis.size() == 1 && isRec(phis[0], 0, 1, 0) && !count);
+    });
+    // 边界都是常量时步长任意：i = 3, 7, ..., 27，回边 6 次；i * i 为 {9,+,40,+,32}
+    analyse("fixed", [](const std::vector<ir::AddRec> &phis, std::optional<ir::BackedgeCount> count) {
+        assert(count && count->lower.isZero() && count->upper.isConstant() && count->upper.constant == 6);
+        bool iv = false;
+        for (auto &r : phis) iv = iv || isRec(r, 3, 4, 0);
+        assert(iv);
+    });
+    std::cout << "Scalar evolution test passed\n";
+}
+
+// 求和一类的循环换成出口值后与不化简时的结果相同，并且动态指令数与循环次数无关
+void testClosedForm() {
+    struct Case {
+        const char *source;
+        std::vector<std::vector<int>> args;
+    };
+    std::vector<std::vector<int>> oneArg = {{-7}, {0}, {1}, {2}, {3}, {10}, {1000}, {70000}, {200000}};
+    const Case cases[] = {
+        {"int f(int n) { int s = 0; int i = 0; while (i < n) { s = s + i; i = i + 1; } return s; }", oneArg},
+        {"int f(int n) { int s = 7; while (n > 0) { s = s + 3; n = n - 1; } return s * 10 + n; }", oneArg},
+        {"int f(int n) { int s = 1; int i = 5; while (i <= 100) { s = s + n; i = i + 1; } return s - i; }", oneArg},
+        {"int f(int n) { int s = 0; int i = n; while (i >= -3) { s = s + i * 2 + 1; i = i - 1; } return s + i; }",
+         oneArg},
+        {"int f(int a, int b) { int s = 0; while (a < b) { s = s + a; a = a + 1; } return s * 3 + a; }",
+         {{0, 10}, {-5, 5}, {10, 0}, {-100000, 100000}, {3, 3}, {-300000, 300000}}},
+        {"int f(int n) { int i = 0; int j = 0; int s = 0; while (i < n) { j = j + 3; s = s + j; i = i + 1; } "
+         "return s + j; }",
+         oneArg},
+    };
+    int checked = 0;
+    for (auto &c : cases) {
+        std::string src = std::string(c.source) + "\nint main() { return 0; }\n";
+        for (int level : {1, 2}) {
+            CompileOptions opts;
+            opts.optLevel = level;
+            std::ostringstream report;
+            opts.report = &report;
+            RiscvSim fast(compileSource(src, opts)), slow(compileSource(src, withoutSCEV(opts)));
+            if (report.str().find("scev: @f: 1 loops replaced") == std::string::npos) {
+                std::cerr << c.source << "\n" << report.str();
+                assert(false);
+            }
+            for (auto &args : c.args) {
+                assert(fast.run("f", args) && slow.run("f", args));
+                if (fast.result() != slow.result()) {
+                    std::cerr << c.source << ": " << fast.result() << " != " << slow.result() << "\n";
+                    assert(false);
+                }
+                assert(fast.stats().instrs < 100 && fast.stats().takenBranches <= 2);
+                checked++;
+            }
+        }
+    }
+    std::cout << "Closed-form exit value test passed (" << checked << " runs)\n";
+}
+
+// 有副作用、次数算不出来或出口值不是加法递推的循环保持不变
+void testUntouched() {
+    const char *sources[] = {
+        "int f(int n) { int i = 0; while (i < n) { putint(i); i = i + 1; } return i; }",
+        "int f(int n) { int i = 0; while (i != n) { i = i + 1; } return i; }",
+        "int f(int n) { int i = 1; while (i < n) { i = i * 3; } return i; }",
+        "int f(int n) { int s = 0; int i = 0; while (i < n) { s = s + i * i; i = i + 1; } return s; }",
+        "int f(int n) { int s = 0; int i = 0; while (i < n) { if (i % 3 == 0) { s = s + 1; } i = i + 1; } return s; }",
+        "int f(int n) { int i = 0; while (i < n) { if (i == 50) { return 1; } i = i + 1; } return i; }",
+    };
+    for (const char *source : sources) {
+        std::string src = std::string(source) + "\nint main() { return 0; }\n";
+        CompileOptions opts;
+        opts.optLevel = 2;
+        std::ostringstream report;
+        opts.report = &report;
+        std::string asmText = compileSource(src, opts);
+        assert(report.str().find("scev: @f: 1 loops replaced") == std::string::npos);
+        if (std::string(source).find("putint") != std::string::npos) continue;
+        RiscvSim fast(asmText), slow(compileSource(src, withoutSCEV(opts)));
+        for (int n : {0, 1, 7, 100}) {
+            assert(fast.run("f", {n}) && slow.run("f", {n}) && fast.result() == slow.result());
+        }
+    }
+    std::cout << "Untouched loop test passed\n";
+}
+
+// isPrime 中每次迭代的 i * i 改为累加：i*i 的增量 2i+1 本身也逐次加 2
+void testStrengthReduction() {
+    const TestProgram *primes = nullptr;
+    for (auto &prog : benchmarkPrograms()) {
+        if (std::string(prog.name) == "primes") primes = &prog;
+    }
+    assert(primes);
+    CompileOptions opts;
+    opts.optLevel = 2;
+    std::ostringstream report;
+    opts.report = &report;
+    RiscvSim fast(compileSource(primes->source, opts)), slow(compileSource(primes->source, withoutSCEV(opts)));
+    assert(fast.run() && slow.run() && fast.result() == primes->expected && slow.result() == primes->expected);
+    assert(report.str().find("scev: @isPrime: 0 loops replaced by 0 closed-form exit values, 1 multiplications "
+                             "strength-reduced\n") != std::string::npos);
+    // 按 generic 的延迟估算周期数：每次迭代多一条加法，省掉的是一条乘法
+    auto cycles = [](const RiscvSim::Stats &st) {
+        const mir::CoreCostModel &cost = mir::coreCostModel("generic");
+        return st.instrs + st.muls * (cost.mul - 1) + st.divs * (cost.div - 1);
+    };
+    assert(fast.stats().muls * 10 < slow.stats().muls && cycles(fast.stats()) < cycles(slow.stats()));
+    std::cout << "  primes: mul " << slow.stats().muls << " -> " << fast.stats().muls << ", estimated cycles "
+              << cycles(slow.stats()) << " -> " << cycles(fast.stats()) << "\n";
+
+    // 平方和：乘法化简后 s 是 3 阶递推，循环保留
+    const char *squares = R"(
+int f(int n) { int s = 0; int i = 0; while (i < n) { s = s + i * i; i = i + 1; } return s; }
+int main() { return f(1000) % 1000; }
+)";
+    for (int level : {1, 2}) {
+        opts.optLevel = level;
+        RiscvSim a(compileSource(squares, opts)), b(compileSource(squares, withoutSCEV(opts)));
+        assert(a.run() && b.run() && a.result() == b.result());
+        for (int n : {-3, 0, 1, 2, 50, 100000}) {
+            assert(a.run("f", {n}) && b.run("f", {n}) && a.result() == b.result());
+            assert(a.stats().muls == 0);
+        }
+    }
+
+    // 所有基准程序的结果不变
+    for (auto &prog : benchmarkPrograms()) {
+        for (int level : {1, 2, 3}) {
+            CompileOptions o;
+            o.optLevel = level;
+            RiscvSim sim(compileSource(prog.source, o));
+            assert(sim.run() && sim.result() == prog.expected);
+        }
+    }
+    std::cout << "Strength reduction test passed\n";
+}
+
+int main() {
+    testEvolution();
+    testClosedForm();
+    testUntouched();
+    testStrengthReduction();
+    return 0;
+}
@@ -0,0 +1,119 @@
+// test_ssa.cpp
+#include "analysis.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <algorithm>
+#include <cassert>
+#include <iostream>
+
+static RiscvSim::Stats runProgram(const TestProgram &prog, const CompileOptions &opts) {
+    std::string asmText = compileSource(prog.source, opts);
+    RiscvSim sim(asmText);
+    bool ok = sim.run();
+    if (!ok || sim.result() != prog.expected) {
+        std::cerr << asmText << "\n" << prog.name << ": " << (ok ? "wrong result " + std::to_string(sim.result())
+                                                                 : sim.error()) << "\n";
+        assert(false);
+    }
+    return sim.stats();
+}
+
+static int countOps(const ir::Function &f, ir::Opcode op) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == op;
+    }
+    return n;
+}
+
+void testDominators() {
+    auto module = lowerToIR("int main() { int i = 0; while (i < 10) { if (i % 2) { i = i + 3; } else { i = i + 1; } }\n"
+                        "  return i; }");
+    ir::Function &f = *module->functions[0];
+    ir::DominatorTree dt(f);
+    ir::BasicBlock *body = nullptr, *thenBB = nullptr, *join = nullptr, *end = nullptr;
+    for (auto &bb : f.blocks) {
+        if (bb->name.rfind("while.body", 0) == 0) body = bb.get();
+        if (bb->name.rfind("if.then", 0) == 0) thenBB = bb.get();
+        if (bb->name.rfind("if.end", 0) == 0) join = bb.get();
+        if (bb->name.rfind("while.end", 0) == 0) end = bb.get();
+    }
+    assert(body && thenBB && join && end);
+    assert(dt.dominates(f.entry(), join));
+    assert(dt.dominates(body, thenBB));
+    assert(!dt.dominates(thenBB, join));
+    // if 的两个分支在汇合块相遇；汇合块经底部的判断回到循环体，或者和入口处的判断一起到达循环出口
+    auto &df = dt.frontier(thenBB);
+    assert(df.size() == 1 && df[0] == join);
+    auto &joinDF = dt.frontier(join);
+    assert(joinDF.size() == 2);
+    assert(std::count(joinDF.begin(), joinDF.end(), body) == 1 && std::count(joinDF.begin(), joinDF.end(), end) == 1);
+    std::cout << "Dominance frontier test passed\n";
+}
+
+void testPromotion() {
+    for (auto &prog : benchmarkPrograms()) {
+        auto module = lowerToIR(prog.source);
+        for (auto &f : module->functions) ir::promoteMemoryToRegisters(*f);
+        std::string err;
+        bool ok = ir::verifyModule(*module, err);
+        if (!ok) std::cerr << prog.name << ": " << err << "\n";
+        assert(ok);
+        for (auto &f : module->functions) {
+            assert(f->slots.empty());
+            assert(countOps(*f, ir::Opcode::Load) == 0);
+            assert(countOps(*f, ir::Opcode::Store) == 0);
+        }
+    }
+    auto module = lowerToIR(benchmarkPrograms()[1].source);
+    ir::Function *gcd = module->getFunction("gcd");
+    ir::promoteMemoryToRegisters(*gcd);
+    // a、b 在循环头需要 phi，循环出口还要合并入口处判断和底部判断两条路径上的 a；temp 只在循环体内使用，不需要
+    assert(countOps(*gcd, ir::Opcode::Phi) == 3);
+    std::cout << "mem2reg promotion test passed\n";
+}
+
+void testSSADestruction() {
+    // 交换与丢失复制问题：phi 之间互相引用
+    auto module = lowerToIR(benchmarkPrograms()[4].source);
+    ir::Function &f = *module->functions[0];
+    ir::promoteMemoryToRegisters(f);
+    // 循环头 4 个，出口合并 3 个循环后还要用的值
+    assert(countOps(f, ir::Opcode::Phi) == 7);
+    ir::destroySSA(f);
+    assert(countOps(f, ir::Opcode::Phi) == 0);
+    std::cout << "SSA destruction test passed\n";
+}
+
+void testMemoryTrafficDrops() {
+    CompileOptions withSSA;
+    withSSA.optLevel = 1;
+    // GVN 也会在块内转发 load，关掉以便只比较 mem2reg 本身
+    withSSA.disabledPasses.insert("gvn");
+    CompileOptions withoutSSA = withSSA;
+    withoutSSA.disabledPasses.insert("mem2reg");
+
+    uint64_t before = 0, after = 0;
+    for (auto &prog : benchmarkPrograms()) {
+        RiscvSim::Stats slow = runProgram(prog, withoutSSA);
+        RiscvSim::Stats fast = runProgram(prog, withSSA);
+        assert(fast.loads + fast.stores <= slow.loads + slow.stores);
+        before += slow.loads + slow.stores;
+        after += fast.loads + fast.stores;
+        std::cout << "  " << prog.name << ": loads+stores " << slow.loads + slow.stores << " -> "
+                  << fast.loads + fast.stores << "\n";
+    }
+    assert(after < before);
+    std::cout << "mem2reg memory traffic test passed\n";
+}
+
+int main() {
+    testDominators();
+    testPromotion();
+    testSSADestruction();
+    testMemoryTrafficDrops();
+    return 0;
+}
@@ -0,0 +1,223 @@
+// test_strength.cpp
+#include "driver.h"
+#include "programs.h"
+#include "rvsim.h"
+#include "strength.h"
+#include <algorithm>
+#include <cassert>
+#include <climits>
+#include <cstdlib>
+#include <iostream>
+
+using namespace mir;
+
+// 直线型 MIR 序列的解释器：先把指令解码成操作码，寄存器值放在按编号索引的数组里
+class SeqEvaluator {
+public:
+    SeqEvaluator(const std::vector<MInstr> &seq, int numRegs) : regs(numRegs, 0) {
+        static const std::vector<std::string> names = {"li", "mv", "neg", "add", "sub", "mul", "mulh",
+                                                       "slli", "srli", "srai", "andi"};
+        for (auto &in : seq) {
+            auto it = std::find(names.begin(), names.end(), in.op);
+            if (it == names.end()) {
+                std::cerr << "unexpected instruction " << in.op << "\n";
+                assert(false);
+            }
+            Decoded d;
+            d.op = (Op)(it - names.begin());
+            d.rd = in.ops[0].reg;
+            d.rs1 = in.ops.size() > 1 && in.ops[1].isReg() ? in.ops[1].reg : 0;
+            d.rs2 = in.ops.size() > 2 && in.ops[2].isReg() ? in.ops[2].reg : 0;
+            d.imm = in.ops.back().kind == MOperand::Kind::Imm ? in.ops.back().imm : 0;
+            code.push_back(d);
+        }
+    }
+
+    int32_t run(int src, int dst, int32_t x) {
+        regs[src] = x;
+        for (auto &d : code) {
+            uint32_t a = (uint32_t)regs[d.rs1], b = (uint32_t)regs[d.rs2], v = 0;
+            switch (d.op) {
+                case Op::Li: v = (uint32_t)d.imm; break;
+                case Op::Mv: v = a; break;
+                case Op::Neg: v = 0u - a; break;
+                case Op::Add: v = a + b; break;
+                case Op::Sub: v = a - b; break;
+                case Op::Mul: v = a * b; break;
+                case Op::Mulh: v = (uint32_t)(((int64_t)(int32_t)a * (int64_t)(int32_t)b) >> 32); break;
+                case Op::Slli: v = a << d.imm; break;
+                case Op::Srli: v = a >> d.imm; break;
+                case Op::Srai: v = (uint32_t)((int32_t)a >> d.imm); break;
+                case Op::Andi: v = a & (uint32_t)d.imm; break;
+            }
+            regs[d.rd] = (int32_t)v;
+        }
+        return regs[dst];
+    }
+
+private:
+    enum class Op { Li, Mv, Neg, Add, Sub, Mul, Mulh, Slli, Srli, Srai, Andi };
+    struct Decoded {
+        Op op;
+        int rd, rs1, rs2, imm;
+    };
+    std::vector<Decoded> code;
+    std::vector<int32_t> regs;
+};
+
+// 被测的被除数/被乘数：0 附近和两端的稠密区间，加上覆盖整个 32 位范围的稀疏采样。
+// 设置 TOYC_EXHAUSTIVE=1 时遍历全部 2^32 个值
+template <typename F>
+static void forEachInput(F check) {
+    if (std::getenv("TOYC_EXHAUSTIVE")) {
+        for (int64_t x = INT_MIN; x <= INT_MAX; x++) check((int32_t)x);
+        return;
+    }
+    for (int32_t x = -70000; x <= 70000; x++) check(x);
+    for (int32_t i = 0; i < 5000; i++) {
+        check(INT_MIN + i);
+        check(INT_MAX - i);
+    }
+    for (int64_t x = INT_MIN; x <= INT_MAX; x += 65521) check((int32_t)x);
+}
+
+static const int32_t kDivisors[] = {
+    2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 16, 25, 60, 100, 125, 641, 1000, 1024, 2048, 4096, 12345,
+    65536, 65537, 1 << 20, 1 << 30, 0x7fffffff, 1, -1, -2, -3, -5, -7, -8, -10, -16, -100, -1000, -4096,
+    -65536, -(1 << 30), INT_MIN + 1, INT_MIN,
+};
+
+void testMagicNumbers() {
+    // Hacker's Delight 表 10-1 中的值
+    assert(signedDivMagic(3).magic == 0x55555556 && signedDivMagic(3).shift == 0);
+    assert(signedDivMagic(5).magic == 0x66666667 && signedDivMagic(5).shift == 1);
+    assert(signedDivMagic(7).magic == (int32_t)0x92492493 && signedDivMagic(7).shift == 2);
+    assert(signedDivMagic(-5).magic == (int32_t)0x99999999 && signedDivMagic(-5).shift == 1);
+    std::cout << "Division magic number test passed\n";
+}
+
+void testDivisionSequences() {
+    for (const char *core : {"generic", "sifive-e31"}) {
+        const CoreCostModel &cost = coreCostModel(core);
+        for (int32_t k : kDivisors) {
+            for (bool isRem : {false, true}) {
+                MFunction mf;
+                int src = mf.newVReg(), dst = mf.newVReg();
+                std::vector<MInstr> seq;
+                if (!expandDivByConst(mf, seq, dst, src, k, isRem, cost)) {
+                    // 只有 INT_MIN 保留 div/rem
+                    assert(k == INT_MIN);
+                    continue;
+                }
+                for (auto &in : seq) assert(in.op != "div" && in.op != "rem");
+                SeqEvaluator eval(seq, mf.nextVReg);
+                forEachInput([&](int32_t x) {
+                    // INT_MIN / -1 溢出，RISC-V 的 div 给出 INT_MIN、rem 给出 0
+                    int32_t expected = k == -1 ? (isRem ? 0 : (int32_t)(0u - (uint32_t)x)) : isRem ? x % k : x / k;
+                    int32_t got = eval.run(src, dst, x);
+                    if (got != expected) {
+                        std::cerr << x << (isRem ? " % " : " / ") << k << ": expected " << expected << ", got " << got
+                                  << "\n";
+                        assert(false);
+                    }
+                });
+            }
+        }
+    }
+    // 乘法和除法一样慢的核上 mulh 魔数不划算，2 的幂仍然用移位
+    MFunction mf;
+    std::vector<MInstr> seq;
+    assert(!expandDivByConst(mf, seq, mf.newVReg(), mf.newVReg(), 7, false, coreCostModel("picorv32")));
+    assert(expandDivByConst(mf, seq, mf.newVReg(), mf.newVReg(), 16, true, coreCostModel("picorv32")));
+    std::cout << "Division strength reduction test passed\n";
+}
+
+void testMultiplySequences() {
+    const CoreCostModel &cost = coreCostModel("picorv32");
+    std::vector<int32_t> factors;
+    for (int32_t k = -1100; k <= 1100; k++) factors.push_back(k);
+    for (int32_t k : {INT_MIN, INT_MAX, INT_MIN + 1, 0x55555555, (int32_t)0xaaaaaaaa, 0x0f0f0f0f, 1 << 20, 12345679}) {
+        factors.push_back(k);
+    }
+    int expanded = 0;
+    for (int32_t k : factors) {
+        MFunction mf;
+        int src = mf.newVReg(), dst = mf.newVReg();
+        std::vector<MInstr> seq;
+        if (!expandMulByConst(mf, seq, dst, src, k, cost)) continue;
+        expanded++;
+        for (auto &in : seq) assert(in.op != "mul");
+        SeqEvaluator eval(seq, mf.nextVReg);
+        for (int32_t x : {0, 1, -1, 2, 7, -13, 1000, -65536, 123456789, INT_MAX, INT_MIN, INT_MIN + 1}) {
+            assert(eval.run(src, dst, x) == (int32_t)((uint32_t)x * (uint32_t)k));
+        }
+    }
+    // 乘法很慢的核上 ±1100 以内的常量都值得展开
+    assert(expanded >= 2201);
+
+    // 乘法快的核上只展开很短的序列
+    MFunction mf;
+    std::vector<MInstr> seq;
+    assert(expandMulByConst(mf, seq, mf.newVReg(), mf.newVReg(), 8, coreCostModel("sifive-e31")));
+    assert(seq.size() == 1 && seq[0].op == "slli");
+    seq.clear();
+    assert(!expandMulByConst(mf, seq, mf.newVReg(), mf.newVReg(), 12345, coreCostModel("sifive-e31")));
+    std::cout << "Multiplication strength reduction test passed\n";
+}
+
+void testBackendStrengthReduction() {
+    // collatz 中的 n % 2、n / 2、3 * n 都不再需要乘除法指令
+    CompileOptions opts;
+    opts.optLevel = 1;
+    const TestProgram &collatz = benchmarkPrograms()[3];
+    std::string asmText = compileSource(collatz.source, opts);
+    std::string steps = asmText.substr(0, asmText.find(".globl main"));
+    for (const char *op : {"\tmul ", "\tdiv ", "\trem "}) assert(steps.find(op) == std::string::npos);
+    // main 中的 s * 1000 需要 5 条移位/加减，不比 li + mul 便宜，保留乘法
+    assert(asmText.find("\tmul ") != std::string::npos);
+
+    // 按 generic 的延迟估算周期数：指令数变多，但省掉的 div/rem 远不止这些
+    auto cycles = [](const RiscvSim::Stats &st) {
+        const CoreCostModel &cost = coreCostModel("generic");
+        return st.instrs + st.muls * (cost.mul - 1) + st.divs * (cost.div - 1);
+    };
+    CompileOptions plain = opts;
+    plain.disabledPasses.insert("strength-reduce");
+    uint64_t before = 0, after = 0;
+    for (auto &prog : benchmarkPrograms()) {
+        RiscvSim slow(compileSource(prog.source, plain)), fast(compileSource(prog.source, opts));
+        assert(slow.run() && fast.run() && fast.result() == prog.expected);
+        assert(fast.stats().divs <= slow.stats().divs);
+        before += cycles(slow.stats());
+        after += cycles(fast.stats());
+        std::cout << "  " << prog.name << ": div/rem " << slow.stats().divs << " -> " << fast.stats().divs
+                  << ", estimated cycles " << cycles(slow.stats()) << " -> " << cycles(fast.stats()) << "\n";
+    }
+    assert(after < before);
+
+    // 整个程序集合在每种代价模型下结果不变
+    for (const char *core : {"generic", "sifive-e31", "picorv32"}) {
+        opts.tune = core;
+        for (auto &prog : benchmarkPrograms()) {
+            RiscvSim sim(compileSource(prog.source, opts));
+            assert(sim.run() && sim.result() == prog.expected);
+        }
+    }
+    std::string src = "int main() { int s = 0; int i = -500; while (i < 500) {\n"
+                      "  s = s + i / 7 + i % 7 * 3 + i / -4 - i % 16 + i * 10 - i * -3 + i / 1000; i = i + 1; }\n"
+                      "  return s; }";
+    int expected = 0;
+    for (int i = -500; i < 500; i++) expected += i / 7 + i % 7 * 3 + i / -4 - i % 16 + i * 10 - i * -3 + i / 1000;
+    opts.tune = "generic";
+    RiscvSim sim(compileSource(src, opts));
+    assert(sim.run() && sim.result() == expected);
+    std::cout << "Backend strength reduction test passed\n";
+}
+
+int main() {
+    testMagicNumbers();
+    testDivisionSequences();
+    testMultiplySequences();
+    testBackendStrengthReduction();
+    return 0;
+}
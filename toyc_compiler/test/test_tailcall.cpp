@@ -0,0 +1,206 @@
+// test_tailcall.cpp
+#include "analysis.h"
+#include "driver.h"
+#include "lowering.h"
+#include "passes.h"
+#include "programs.h"
+#include "rvsim.h"
+#include <cassert>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+static int countCalls(const ir::Function &f, const std::string &callee) {
+    int n = 0;
+    for (auto &bb : f.blocks) {
+        for (auto &instr : bb->instrs) n += instr.op == ir::Opcode::Call && instr.callee == callee;
+    }
+    return n;
+}
+
+// 某个函数的汇编（到下一个 .globl 为止）
+static std::string functionText(const std::string &asmText, const std::string &name) {
+    size_t begin = asmText.find(".globl " + name + "\n");
+    assert(begin != std::string::npos);
+    size_t end = asmText.find(".globl ", begin + 1);
+    return asmText.substr(begin, end == std::string::npos ? std::string::npos : end - begin);
+}
+
+static CompileOptions withoutTailCalls(CompileOptions opts) {
+    opts.disabledPasses.insert("tailrec");
+    opts.disabledPasses.insert("sibling-calls");
+    return opts;
+}
+
+void testTailRecursion() {
+    auto module = lowerToSSA(R"(
+int gcd(int a, int b) { if (b == 0) { return a; } return gcd(b, a % b); }
+int depth(int n) { if (n == 0) { return 0; } int r = depth(n - 1); return r - 1; }
+int tick(int n) { return n; }
+void down(int n) { if (n > 0) { tick(n); down(n - 1); } }
+)");
+    ir::TailRecursionStats stats;
+    for (auto &f : module->functions) ir::eliminateTailRecursion(*f, &stats);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    assert(stats.calls == 2);
+
+    // 尾递归变成以新循环头为 header 的循环，入口块只剩 arg
+    ir::Function &gcd = *module->getFunction("gcd");
+    assert(countCalls(gcd, "gcd") == 0);
+    ir::DominatorTree dt(gcd);
+    auto loops = ir::findNaturalLoops(dt);
+    assert(loops.size() == 1 && loops[0].header->name.rfind("tailrec", 0) == 0);
+    for (auto &instr : gcd.entry()->instrs) assert(instr.op == ir::Opcode::Arg || instr.op == ir::Opcode::Jmp);
+    // void 函数的调用跳到只有 ret 的块也是尾调用
+    assert(countCalls(*module->getFunction("down"), "down") == 0);
+    assert(countCalls(*module->getFunction("down"), "tick") == 1);
+    // 调用结果还要参与（不满足结合律的）运算的不是尾调用
+    assert(countCalls(*module->getFunction("depth"), "depth") == 1);
+
+    // 没有 mem2reg 时形参经过栈槽，同样正确
+    CompileOptions opts;
+    opts.optLevel = 1;
+    opts.disabledPasses.insert("mem2reg");
+    RiscvSim sim(compileSource("int gcd(int a, int b) { if (b == 0) { return a; } return gcd(b, a % b); }\n"
+                               "int main() { return gcd(1071, 462); }",
+                               opts));
+    assert(sim.run() && sim.result() == 21);
+    std::cout << "Tail recursion elimination test passed\n";
+}
+
+void testAccumulators() {
+    auto module = lowerToSSA(R"(
+int sum(int n) { if (n == 0) { return 0; } return n + sum(n - 1); }
+int fact(int n) { if (n <= 1) { return 1; } int r = fact(n - 1); return r * n; }
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int digits(int n, int base) { if (n < base) { return n; } if (n % 2) { return digits(n / base, base); } return digits(n / base, base) + n % base; }
+int mixed(int n) { if (n == 0) { return 1; } if (n % 2 == 0) { return 2 * mixed(n - 1); } return mixed(n - 1) + 3; }
+)");
+    ir::TailRecursionStats stats;
+    for (auto &f : module->functions) ir::eliminateTailRecursion(*f, &stats);
+    std::string err;
+    assert(ir::verifyModule(*module, err));
+    // 累加器形式的调用点（sum、fact、fib 的后一个调用、digits 的第二个）和 digits 中的尾调用
+    assert(stats.accumulators == 4 && stats.calls == 1);
+    assert(countCalls(*module->getFunction("sum"), "sum") == 0);
+    assert(countCalls(*module->getFunction("fact"), "fact") == 0);
+    assert(countCalls(*module->getFunction("digits"), "digits") == 0);
+    // fib 的前一个调用照常递归，栈深度减半
+    assert(countCalls(*module->getFunction("fib"), "fib") == 1);
+    // 加法和乘法混用时没有统一的累加器
+    assert(countCalls(*module->getFunction("mixed"), "mixed") == 2);
+
+    // 累加器从单位元开始：base case 直接返回累加器，其余返回累加器与原返回值的和
+    ir::Function &sum = *module->getFunction("sum");
+    int accPhis = 0;
+    for (auto &instr : sum.blocks[1]->instrs) {
+        accPhis += instr.op == ir::Opcode::Phi && instr.ops[0] == ir::Value::imm(0);
+    }
+    assert(accPhis == 1);
+
+    CompileOptions opts;
+    opts.optLevel = 1;
+    RiscvSim sim(compileSource(R"(
+int sum(int n) { if (n == 0) { return 0; } return n + sum(n - 1); }
+int fact(int n) { if (n <= 1) { return 1; } int r = fact(n - 1); return r * n; }
+int fib(int n) { if (n < 2) { return n; } return fib(n - 1) + fib(n - 2); }
+int digits(int n, int base) { if (n < base) { return n; } if (n % 2) { return digits(n / base, base); } return digits(n / base, base) + n % base; }
+int mixed(int n) { if (n == 0) { return 1; } if (n % 2 == 0) { return 2 * mixed(n - 1); } return mixed(n - 1) + 3; }
+int main() { return (sum(100) + fact(10) + fib(15) + digits(987654321, 10) + mixed(9)) % 256; }
+)", opts));
+    assert(sim.run() && sim.result() == (5050 + 3628800 + 610 + 29 + 109) % 256);
+    std::cout << "Accumulator introduction test passed\n";
+}
+
+void testSiblingCalls() {
+    const char *src = R"(
+int even(int n) { if (n == 0) { return 1; } return odd(n - 1); }
+int odd(int n) { if (n == 0) { return 0; } return even(n - 1); }
+int main() { return even(100001) * 10 + odd(7); }
+)";
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::string asmText = compileSource(src, opts), plain = compileSource(src, withoutTailCalls(opts));
+    // 互相递归的尾调用改成 tail；ra 不再被破坏，两个函数都不需要栈帧
+    std::string even = functionText(asmText, "even");
+    assert(even.find("\ttail odd") != std::string::npos);
+    assert(even.find("call") == std::string::npos && even.find("sp") == std::string::npos);
+    assert(functionText(plain, "even").find("\tcall odd") != std::string::npos);
+    // main 中的调用结果还要用，不是尾调用
+    assert(functionText(asmText, "main").find("\tcall even") != std::string::npos);
+
+    RiscvSim fast(asmText), slow(plain);
+    assert(fast.run() && slow.run());
+    assert(fast.result() == 1 && slow.result() == 1);
+    assert(fast.stats().maxStackBytes <= 16);
+    assert(slow.stats().maxStackBytes > 100000 * 16);
+    assert(fast.stats().instrs < slow.stats().instrs);
+    std::cout << "Sibling call test passed\n";
+}
+
+// 尾递归和线性递归写法：递归深度随参数线性增长
+static const TestProgram tailPrograms[] = {
+    {"euclid", R"(
+int gcd(int a, int b) { if (b == 0) { return a; } return gcd(b, a % b); }
+int main() {
+    int s = 0;
+    int i = 1;
+    while (i < 300) { s = s + gcd(i * 7919, 104729 % i + i); i = i + 1; }
+    return s % 256;
+}
+)", 43},
+    {"accumulate", R"(
+int sum(int n, int acc) { if (n == 0) { return acc; } return sum(n - 1, acc + n); }
+int main() { return sum(20000, 0) % 256; }
+)", 16},
+    {"countdown", R"(
+int steps(int n, int k) { if (n <= 1) { return k; } if (n % 2 == 0) { return steps(n / 2, k + 1); } return steps(3 * n + 1, k + 1); }
+int walk(int n, int total) { if (n == 0) { return total; } return walk(n - 1, total + steps(n, 0)); }
+int main() { return walk(3000, 0) % 256; }
+)", 23},
+    {"linear", R"(
+int sum(int n) { if (n == 0) { return 0; } return n + sum(n - 1); }
+int power(int b, int e) { if (e == 0) { return 1; } return b * power(b, e - 1); }
+int main() { return (sum(20000) + power(3, 5000)) % 256; }
+)", 177},
+};
+
+void testConstantStack() {
+    CompileOptions opts;
+    opts.optLevel = 1;
+    std::vector<TestProgram> programs = benchmarkPrograms();
+    programs.insert(programs.end(), std::begin(tailPrograms), std::end(tailPrograms));
+    std::cout << "  " << std::left << std::setw(12) << "program" << std::right << std::setw(22) << "stack bytes"
+              << std::setw(24) << "dynamic instrs" << "\n";
+    for (auto &prog : programs) {
+        std::ostringstream report;
+        CompileOptions reported = opts;
+        reported.report = &report;
+        RiscvSim fast(compileSource(prog.source, reported)), slow(compileSource(prog.source, withoutTailCalls(opts)));
+        assert(fast.run() && slow.run());
+        assert(fast.result() == prog.expected && slow.result() == prog.expected);
+        assert(fast.stats().instrs <= slow.stats().instrs);
+        assert(fast.stats().maxStackBytes <= slow.stats().maxStackBytes);
+        // 专门的尾递归程序只用常数栈空间，并且真的变快
+        bool tailHeavy = &prog >= &programs[programs.size() - std::size(tailPrograms)];
+        if (tailHeavy) {
+            assert(fast.stats().maxStackBytes <= 32);
+            assert(fast.stats().instrs < slow.stats().instrs);
+            assert(report.str().find("tailrec: @") != std::string::npos);
+        }
+        std::cout << "  " << std::left << std::setw(12) << prog.name << std::right << std::setw(22)
+                  << std::to_string(slow.stats().maxStackBytes) + " -> " + std::to_string(fast.stats().maxStackBytes)
+                  << std::setw(24)
+                  << std::to_string(slow.stats().instrs) + " -> " + std::to_string(fast.stats().instrs) << "\n";
+    }
+    std::cout << "Constant stack test passed\n";
+}
+
+int main() {
+    testTailRecursion();
+    testAccumulators();
+    testSiblingCalls();
+    testConstantStack();
+    return 0;
+}